@@ -0,0 +1,110 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* bench_descriptor_distance.cc - Micro-benchmark of the descriptor distance kernels
+*
+* Compares the specialized kernels behind ORBmatcher::DescriptorDistance against the
+* previous implementation (global extractor type lookup + cv::norm) for ORB, SIFT and
+* SuperPoint-sized descriptors.
+*
+* Usage: ./bench_descriptor_distance [num_pairs] [repetitions]
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "ORBmatcher.h"
+#include "GlobalFeatureExtractorType.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+// Distance as computed before the kernels were introduced
+static float LegacyDescriptorDistance(const cv::Mat &a, const cv::Mat &b)
+{
+    if (a.type() == CV_8U)
+        return cv::norm(a, b, cv::NORM_HAMMING);
+
+    if (GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "SIFT")
+        return cv::norm(a, b, cv::NORM_L2SQR);
+    else if (GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "Xfeat")
+        return 512 * cv::norm(a, b, cv::NORM_L2SQR);
+    else
+        return cv::norm(a, b, cv::NORM_L2) * 100;
+}
+
+template <typename F>
+static double TimeMs(const cv::Mat &A, const cv::Mat &B, int nReps, F f, double &checksum)
+{
+    checksum = 0;
+    auto t1 = chrono::steady_clock::now();
+    for (int r = 0; r < nReps; r++)
+        for (int i = 0; i < A.rows; i++)
+            checksum += f(A.row(i), B.row(i));
+    auto t2 = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::duration<double, milli>>(t2 - t1).count();
+}
+
+static bool RunCase(const string &name, const string &type, NormType norm, int depth, int length, int nPairs, int nReps)
+{
+    cv::Mat A(nPairs, length, depth), B(nPairs, length, depth);
+    if (depth == CV_8U)
+    {
+        cv::randu(A, cv::Scalar(0), cv::Scalar(256));
+        cv::randu(B, cv::Scalar(0), cv::Scalar(256));
+    }
+    else
+    {
+        cv::randn(A, cv::Scalar(0), cv::Scalar(0.1));
+        cv::randn(B, cv::Scalar(0), cv::Scalar(0.1));
+    }
+
+    GlobalFeatureExtractorInfo::SetFeatureExtractorType(type);
+    const bool bSquared = (type == "SIFT");
+    ORBmatcher::SetDescriptorMetric(DescriptorMetric(norm, length, norm == NormType::L2 && bSquared,
+                                                     norm == NormType::L2 && !bSquared ? 100.0f : 1.0f));
+
+    // Correctness against the legacy path
+    float maxRelErr = 0.f;
+    for (int i = 0; i < nPairs; i++)
+    {
+        const float ref = LegacyDescriptorDistance(A.row(i), B.row(i));
+        const float cur = ORBmatcher::DescriptorDistance(A.row(i), B.row(i));
+        maxRelErr = max(maxRelErr, fabs(ref - cur) / max(1.f, fabs(ref)));
+    }
+
+    double sumLegacy, sumNew;
+    const double tLegacy = TimeMs(A, B, nReps, LegacyDescriptorDistance, sumLegacy);
+    const double tNew = TimeMs(A, B, nReps, ORBmatcher::DescriptorDistance, sumNew);
+    const double nCalls = double(nPairs) * nReps;
+
+    cout << name << " (" << ORBmatcher::GetDescriptorMetric().ToString() << ")" << endl;
+    cout << "  legacy: " << tLegacy * 1e6 / nCalls << " ns/call" << endl;
+    cout << "  kernel: " << tNew * 1e6 / nCalls << " ns/call" << endl;
+    cout << "  speedup: " << tLegacy / tNew << "x | max rel. error: " << maxRelErr << endl;
+
+    return maxRelErr < 1e-4f;
+}
+
+int main(int argc, char **argv)
+{
+    const int nPairs = argc > 1 ? stoi(argv[1]) : 10000;
+    const int nReps = argc > 2 ? stoi(argv[2]) : 100;
+
+    bool bOk = true;
+    bOk &= RunCase("ORB 256-bit", "ORB", NormType::HAMMING, CV_8U, 32, nPairs, nReps);
+    bOk &= RunCase("SIFT 128-float", "SIFT", NormType::L2, CV_32F, 128, nPairs, nReps);
+    bOk &= RunCase("SuperPoint 256-float", "DUMMY", NormType::L2, CV_32F, 256, nPairs, nReps);
+
+    if (!bOk)
+    {
+        cerr << "Kernel distances differ from the legacy implementation" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* bench_orb_kernels.cc - Micro-benchmark of the ORB orientation and descriptor kernels
+*
+* Detects FAST corners on a set of images (e.g. EuRoC mav0/cam0/data) and compares the
+* runtime-selected IC_Angle / rBRIEF kernels against the scalar references. Fails if any
+* moment or descriptor bit differs.
+*
+* Usage: ./bench_orb_kernels path_to_image_folder [max_images] [repetitions]
+*/
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "ORBextractor.h"
+#include "ORBKernels.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+// Same border ORBextractor keeps around every keypoint
+static const int BORDER = 19;
+
+// The rBRIEF pattern and circular patch extents, as set up by ORBextractor
+class PatternAccess : public ORBextractor
+{
+public:
+    PatternAccess() : ORBextractor(1000, 1.2f, 1, 20, 7) {}
+    const vector<cv::Point>& Pattern() const { return pattern; }
+    const vector<int>& UMax() const { return umax; }
+};
+
+struct ImageCase
+{
+    cv::Mat image, blurred;
+    vector<cv::KeyPoint> keypoints;
+};
+
+template <typename F>
+static double TimeMs(const vector<ImageCase> &cases, int nReps, F f)
+{
+    auto t1 = chrono::steady_clock::now();
+    for (int r = 0; r < nReps; r++)
+        for (const ImageCase &c : cases)
+            for (const cv::KeyPoint &kp : c.keypoints)
+                f(c, kp);
+    auto t2 = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::duration<double, milli>>(t2 - t1).count();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        cerr << "Usage: ./bench_orb_kernels path_to_image_folder [max_images] [repetitions]" << endl;
+        return 1;
+    }
+    const size_t nMaxImages = argc > 2 ? stoul(argv[2]) : 100;
+    const int nReps = argc > 3 ? stoi(argv[3]) : 5;
+
+    vector<cv::String> vFiles;
+    cv::glob(string(argv[1]) + "/*.png", vFiles);
+    if (vFiles.size() > nMaxImages)
+        vFiles.resize(nMaxImages);
+
+    vector<ImageCase> cases;
+    size_t nKeys = 0;
+    for (const cv::String &file : vFiles)
+    {
+        ImageCase c;
+        c.image = cv::imread(file, cv::IMREAD_GRAYSCALE);
+        if (c.image.empty())
+            continue;
+        cv::GaussianBlur(c.image, c.blurred, cv::Size(7, 7), 2, 2, cv::BORDER_REFLECT_101);
+
+        vector<cv::KeyPoint> vKeys;
+        cv::FAST(c.image, vKeys, 20, true);
+        cv::KeyPointsFilter::runByImageBorder(vKeys, c.image.size(), BORDER);
+        cv::KeyPointsFilter::retainBest(vKeys, 2000);
+        c.keypoints = vKeys;
+        nKeys += vKeys.size();
+        cases.push_back(c);
+    }
+    if (cases.empty())
+    {
+        cerr << "No images found in " << argv[1] << endl;
+        return 1;
+    }
+
+    PatternAccess extractor;
+    const ORBKernels::ICAngleWeights weights(extractor.UMax());
+    const ORBKernels::DescriptorPattern pattern(extractor.Pattern());
+
+    auto center = [](const cv::Mat &im, const cv::KeyPoint &kp) {
+        return &im.at<uchar>(cvRound(kp.pt.y), cvRound(kp.pt.x));
+    };
+
+    // Correctness against the scalar references, with the reference angle fed to both descriptors
+    size_t nAngleDiff = 0, nDescDiff = 0;
+    for (ImageCase &c : cases)
+    {
+        for (cv::KeyPoint &kp : c.keypoints)
+        {
+            int m01r, m10r, m01, m10;
+            ORBKernels::ICMomentsScalar(center(c.image, kp), (int)c.image.step1(), weights, m01r, m10r);
+            ORBKernels::ICMoments(center(c.image, kp), (int)c.image.step1(), weights, m01, m10);
+            nAngleDiff += (m01 != m01r || m10 != m10r);
+            kp.angle = cv::fastAtan2((float)m01r, (float)m10r);
+
+            uchar ref[32], cur[32];
+            ORBKernels::DescribeScalar(center(c.blurred, kp), (int)c.blurred.step, kp.angle, pattern, ref);
+            ORBKernels::Describe(center(c.blurred, kp), (int)c.blurred.step, kp.angle, pattern, cur);
+            nDescDiff += (memcmp(ref, cur, 32) != 0);
+        }
+    }
+
+    int m01, m10;
+    uchar desc[32];
+    const double tAngleRef = TimeMs(cases, nReps, [&](const ImageCase &c, const cv::KeyPoint &kp) {
+        ORBKernels::ICMomentsScalar(center(c.image, kp), (int)c.image.step1(), weights, m01, m10);
+    });
+    const double tAngle = TimeMs(cases, nReps, [&](const ImageCase &c, const cv::KeyPoint &kp) {
+        ORBKernels::ICMoments(center(c.image, kp), (int)c.image.step1(), weights, m01, m10);
+    });
+    const double tDescRef = TimeMs(cases, nReps, [&](const ImageCase &c, const cv::KeyPoint &kp) {
+        ORBKernels::DescribeScalar(center(c.blurred, kp), (int)c.blurred.step, kp.angle, pattern, desc);
+    });
+    const double tDesc = TimeMs(cases, nReps, [&](const ImageCase &c, const cv::KeyPoint &kp) {
+        ORBKernels::Describe(center(c.blurred, kp), (int)c.blurred.step, kp.angle, pattern, desc);
+    });
+    const double nCalls = double(nKeys) * nReps;
+
+    cout << cases.size() << " images, " << nKeys << " keypoints, kernels: " << ORBKernels::ActiveISA() << endl;
+    cout << "IC_Angle" << endl;
+    cout << "  scalar: " << tAngleRef * 1e6 / nCalls << " ns/keypoint" << endl;
+    cout << "  kernel: " << tAngle * 1e6 / nCalls << " ns/keypoint" << endl;
+    cout << "  speedup: " << tAngleRef / tAngle << "x | mismatches: " << nAngleDiff << endl;
+    cout << "rBRIEF descriptor" << endl;
+    cout << "  scalar: " << tDescRef * 1e6 / nCalls << " ns/keypoint" << endl;
+    cout << "  kernel: " << tDesc * 1e6 / nCalls << " ns/keypoint" << endl;
+    cout << "  speedup: " << tDescRef / tDesc << "x | mismatches: " << nDescDiff << endl;
+
+    if (nAngleDiff || nDescDiff)
+    {
+        cerr << "Vector kernels differ from the scalar reference" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,242 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* bench_snapshot_contention.cc - Read latency of map point and keyframe geometry under concurrent writes
+*
+* A reader thread runs the per point reads of the tracking projection (isBad, GetWorldPos, GetNormal,
+* GetMaxDistanceInvariance, the keyframe pose) over a set of map points, alone and while a writer
+* thread keeps updating the same points and keyframe as local bundle adjustment does. The same loop
+* is timed on mutex guarded copies of the data (the getters before the snapshots) for comparison,
+* plus a descriptor row read through SeqLockBuffer and through a mutex guarded cv::Mat.
+* Reports p50/p99 of the time of one pass over the points.
+*
+* Usage: ./bench_snapshot_contention [points] [passes]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "KeyFrame.h"
+#include "Map.h"
+#include "MapPoint.h"
+#include "utils/SeqLock.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+// The map point getters before the snapshots: every read takes the point's mutex
+struct LockedPoint
+{
+    mutex mMutexPos;
+    Eigen::Vector3f mWorldPos, mNormalVector;
+    float mfMaxDistance = 10.f;
+    bool mbBad = false;
+
+    Eigen::Vector3f GetWorldPos() { unique_lock<mutex> lock(mMutexPos); return mWorldPos; }
+    Eigen::Vector3f GetNormal() { unique_lock<mutex> lock(mMutexPos); return mNormalVector; }
+    float GetMaxDistanceInvariance() { unique_lock<mutex> lock(mMutexPos); return 1.2f * mfMaxDistance; }
+    bool isBad() { unique_lock<mutex> lock(mMutexPos); return mbBad; }
+    void Set(const Eigen::Vector3f &pos, const Eigen::Vector3f &normal)
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        mWorldPos = pos;
+        mNormalVector = normal;
+    }
+};
+
+struct LockedPose
+{
+    mutex mMutexPose;
+    Sophus::SE3f mTcw;
+
+    Sophus::SE3f GetPose() { unique_lock<mutex> lock(mMutexPose); return mTcw; }
+    void SetPose(const Sophus::SE3f &Tcw) { unique_lock<mutex> lock(mMutexPose); mTcw = Tcw; }
+};
+
+struct LockedDescriptor
+{
+    mutex mMutexFeatures;
+    cv::Mat mDescriptor;
+
+    void Get(cv::Mat &descriptor) { unique_lock<mutex> lock(mMutexFeatures); mDescriptor.copyTo(descriptor); }
+    void Set(const cv::Mat &descriptor) { unique_lock<mutex> lock(mMutexFeatures); descriptor.copyTo(mDescriptor); }
+};
+
+struct Percentiles
+{
+    double p50Us, p99Us;
+};
+
+// Times passes of read() while write() runs in a loop on another thread (if bContended).
+// The values read are summed into checksum, which is printed so the reads cannot be optimized away.
+template <typename R, typename W>
+static Percentiles Run(int nPasses, bool bContended, R read, W write, double &checksum)
+{
+    atomic<bool> bStop(false);
+    thread writer;
+    if(bContended)
+        writer = thread([&]() { for(int i=0; !bStop.load(memory_order_relaxed); i++) write(i); });
+
+    vector<double> vUs;
+    vUs.reserve(nPasses);
+    for(int i=0; i<nPasses; i++)
+    {
+        auto t1 = chrono::steady_clock::now();
+        checksum += read();
+        auto t2 = chrono::steady_clock::now();
+        vUs.push_back(chrono::duration<double, micro>(t2 - t1).count());
+    }
+
+    bStop = true;
+    if(writer.joinable())
+        writer.join();
+
+    sort(vUs.begin(), vUs.end());
+    return {vUs[vUs.size()/2], vUs[min(vUs.size()-1, vUs.size()*99/100)]};
+}
+
+static void Print(const string &name, const Percentiles &idle, const Percentiles &contended)
+{
+    cout << left << setw(22) << name << right << fixed << setprecision(2)
+         << setw(10) << idle.p50Us << setw(10) << idle.p99Us
+         << setw(12) << contended.p50Us << setw(12) << contended.p99Us << endl;
+}
+
+int main(int argc, char **argv)
+{
+    const int nPoints = argc > 1 ? atoi(argv[1]) : 2000;
+    const int nPasses = argc > 2 ? atoi(argv[2]) : 2000;
+
+    mt19937 rng(42);
+    uniform_real_distribution<float> U(-5.f, 5.f);
+
+    Map* pMap = new Map();
+    KeyFrame* pKF = new KeyFrame();
+    pKF->mnId = 0;
+    pKF->SetPose(Sophus::SE3f());
+
+    vector<MapPoint*> vpMPs(nPoints);
+    vector<LockedPoint> vLocked(nPoints);
+    vector<Eigen::Vector3f> vPos(nPoints);
+    for(int i=0; i<nPoints; i++)
+    {
+        vPos[i] = Eigen::Vector3f(U(rng), U(rng), 5.f + U(rng));
+        vpMPs[i] = new MapPoint(vPos[i], pKF, pMap);
+        vpMPs[i]->SetNormalVector(vPos[i].normalized());
+        vLocked[i].Set(vPos[i], vPos[i].normalized());
+    }
+    LockedPose lockedPose;
+
+    // Projection of every point in the keyframe, as SearchByProjection does
+    auto readSnapshots = [&]() {
+        const Sophus::SE3f Tcw = pKF->GetPose();
+        float s = 0.f;
+        for(MapPoint* pMP : vpMPs)
+        {
+            if(pMP->isBad())
+                continue;
+            const Eigen::Vector3f Pc = Tcw * pMP->GetWorldPos();
+            s += Pc(2) + pMP->GetNormal()(0) + pMP->GetMaxDistanceInvariance();
+        }
+        return s;
+    };
+    auto readLocked = [&]() {
+        const Sophus::SE3f Tcw = lockedPose.GetPose();
+        float s = 0.f;
+        for(LockedPoint &p : vLocked)
+        {
+            if(p.isBad())
+                continue;
+            const Eigen::Vector3f Pc = Tcw * p.GetWorldPos();
+            s += Pc(2) + p.GetNormal()(0) + p.GetMaxDistanceInvariance();
+        }
+        return s;
+    };
+
+    // Local BA writing back the points and the keyframe pose
+    auto writeSnapshots = [&](int it) {
+        const float d = 1e-4f * (it % 100);
+        for(int i=0; i<nPoints; i++)
+        {
+            vpMPs[i]->SetWorldPos(vPos[i] + Eigen::Vector3f::Constant(d));
+            vpMPs[i]->SetNormalVector(vPos[i].normalized());
+        }
+        pKF->SetPose(Sophus::SE3f(Eigen::Matrix3f::Identity(), Eigen::Vector3f::Constant(d)));
+    };
+    auto writeLocked = [&](int it) {
+        const float d = 1e-4f * (it % 100);
+        for(int i=0; i<nPoints; i++)
+            vLocked[i].Set(vPos[i] + Eigen::Vector3f::Constant(d), vPos[i].normalized());
+        lockedPose.SetPose(Sophus::SE3f(Eigen::Matrix3f::Identity(), Eigen::Vector3f::Constant(d)));
+    };
+
+    // Descriptor rows of 32 bytes (ORB)
+    vector<cv::Mat> vDesc(nPoints);
+    vector<unique_ptr<SeqLockBuffer>> vpSeqDesc(nPoints);
+    vector<LockedDescriptor> vLockedDesc(nPoints);
+    for(int i=0; i<nPoints; i++)
+    {
+        vDesc[i] = cv::Mat(1, 32, CV_8U);
+        cv::randu(vDesc[i], 0, 256);
+        vpSeqDesc[i].reset(new SeqLockBuffer(32));
+        vpSeqDesc[i]->Store(vDesc[i].data);
+        vLockedDesc[i].Set(vDesc[i]);
+    }
+    cv::Mat descriptor(1, 32, CV_8U);
+    auto readSeqDesc = [&]() {
+        float s = 0.f;
+        for(int i=0; i<nPoints; i++)
+        {
+            vpSeqDesc[i]->Load(descriptor.data);
+            s += descriptor.data[i % 32];
+        }
+        return s;
+    };
+    auto readLockedDesc = [&]() {
+        float s = 0.f;
+        for(int i=0; i<nPoints; i++)
+        {
+            vLockedDesc[i].Get(descriptor);
+            s += descriptor.data[i % 32];
+        }
+        return s;
+    };
+    auto writeSeqDesc = [&](int it) {
+        for(int i=0; i<nPoints; i++)
+            vpSeqDesc[(i + it) % nPoints]->Store(vDesc[i].data);
+    };
+    auto writeLockedDesc = [&](int it) {
+        for(int i=0; i<nPoints; i++)
+            vLockedDesc[(i + it) % nPoints].Set(vDesc[i]);
+    };
+
+    cout << "points: " << nPoints << ", passes: " << nPasses << endl;
+    cout << left << setw(22) << "us per pass" << right << setw(10) << "p50" << setw(10) << "p99"
+         << setw(12) << "p50 (BA)" << setw(12) << "p99 (BA)" << endl;
+
+    double checksum = 0.0;
+    Print("geometry, mutex", Run(nPasses, false, readLocked, writeLocked, checksum), Run(nPasses, true, readLocked, writeLocked, checksum));
+    Print("geometry, snapshot", Run(nPasses, false, readSnapshots, writeSnapshots, checksum), Run(nPasses, true, readSnapshots, writeSnapshots, checksum));
+    Print("descriptor, mutex", Run(nPasses, false, readLockedDesc, writeLockedDesc, checksum), Run(nPasses, true, readLockedDesc, writeLockedDesc, checksum));
+    Print("descriptor, snapshot", Run(nPasses, false, readSeqDesc, writeSeqDesc, checksum), Run(nPasses, true, readSeqDesc, writeSeqDesc, checksum));
+    cout << "checksum: " << checksum << endl;
+
+    for(MapPoint* pMP : vpMPs)
+        delete pMP;
+    delete pKF;
+    delete pMap;
+
+    return 0;
+}
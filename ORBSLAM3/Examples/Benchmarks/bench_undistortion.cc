@@ -0,0 +1,177 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* bench_undistortion.cc - Accuracy and runtime of the keypoint undistortion lookup
+*
+* Undistorts random keypoints with the path Frame::UndistortKeyPoints used before
+* (cv::undistortPoints / cv::fisheye::undistortPoints on a packed cv::Mat) and with UndistortionMap,
+* for the EuRoC cam0 (radial-tangential) and TUM-VI cam0 (Kannala-Brandt) calibrations.
+* Reports the largest difference against the OpenCV path and against the converged inverse
+* of the model, and fails if a refined lookup is further than 0.01 px from the converged inverse.
+*
+* Usage: ./bench_undistortion [cell_size] [keypoints_per_frame] [frames]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/calib3d/calib3d.hpp>
+#include <opencv2/core/core.hpp>
+
+#include "UndistortionMap.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+// Largest distance to the converged inverse tolerated for a refined lookup
+static const float MAX_REFINED_ERROR = 0.01f;
+
+struct CameraCase
+{
+    string name;
+    UndistortionMap::Model model;
+    vector<float> vK, vDist;
+    cv::Size imSize;
+    float maxThetaDeg;  // keypoints beyond this angle from the optical axis are not compared (fisheye only)
+};
+
+// The undistortion Frame::UndistortKeyPoints and KannalaBrandt8 used to run
+static void UndistortOpenCV(const CameraCase &cam, const vector<cv::KeyPoint> &vKeys, vector<cv::KeyPoint> &vKeysUn)
+{
+    const int N = vKeys.size();
+    cv::Mat K = (cv::Mat_<float>(3,3) << cam.vK[0], 0.f, cam.vK[2], 0.f, cam.vK[1], cam.vK[3], 0.f, 0.f, 1.f);
+    cv::Mat D(cam.vDist.size(), 1, CV_32F, const_cast<float*>(cam.vDist.data()));
+
+    cv::Mat mat(N,2,CV_32F);
+    for(int i=0; i<N; i++)
+    {
+        mat.at<float>(i,0)=vKeys[i].pt.x;
+        mat.at<float>(i,1)=vKeys[i].pt.y;
+    }
+
+    mat=mat.reshape(2);
+    if(cam.model == UndistortionMap::RADIAL_TANGENTIAL)
+        cv::undistortPoints(mat,mat,K,D,cv::Mat(),K);
+    else
+        cv::fisheye::undistortPoints(mat,mat,K,D,cv::Mat::eye(3,3,CV_32F),K);
+    mat=mat.reshape(1);
+
+    vKeysUn.resize(N);
+    for(int i=0; i<N; i++)
+    {
+        cv::KeyPoint kp = vKeys[i];
+        kp.pt.x=mat.at<float>(i,0);
+        kp.pt.y=mat.at<float>(i,1);
+        vKeysUn[i]=kp;
+    }
+}
+
+template <typename F>
+static double TimeMs(int nFrames, F f)
+{
+    auto t1 = chrono::steady_clock::now();
+    for(int i=0; i<nFrames; i++)
+        f(i);
+    auto t2 = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::duration<double, milli>>(t2 - t1).count();
+}
+
+int main(int argc, char **argv)
+{
+    const float cellSize = argc > 1 ? stof(argv[1]) : UndistortionMap::DEFAULT_CELL_SIZE;
+    const int nKeys = argc > 2 ? stoi(argv[2]) : 1000;
+    const int nFrames = argc > 3 ? stoi(argv[3]) : 200;
+
+    vector<CameraCase> vCases = {
+        {"EuRoC cam0", UndistortionMap::RADIAL_TANGENTIAL, {458.654f, 457.296f, 367.215f, 248.375f},
+         {-0.28340811f, 0.07395907f, 0.00019359f, 1.76187114e-05f}, cv::Size(752, 480), 90.f},
+        {"TUM-VI cam0", UndistortionMap::KANNALA_BRANDT, {190.978f, 190.973f, 254.932f, 256.897f},
+         {0.00348238940f, 0.000715034845f, -0.00205323610f, 0.000202936736f}, cv::Size(512, 512), 80.f}};
+
+    bool bOk = true;
+    mt19937 rng(42);
+
+    for(const CameraCase &cam : vCases)
+    {
+        // One set of keypoints per frame, uniformly spread over the image
+        uniform_real_distribution<float> ux(0.f, cam.imSize.width), uy(0.f, cam.imSize.height);
+        vector<vector<cv::KeyPoint>> vFrames(nFrames, vector<cv::KeyPoint>(nKeys));
+        for(vector<cv::KeyPoint> &vKeys : vFrames)
+            for(cv::KeyPoint &kp : vKeys)
+                kp = cv::KeyPoint(ux(rng), uy(rng), 7.f);
+
+        cout << cam.name << ": " << nFrames << " frames x " << nKeys << " keypoints, cell " << cellSize << " px" << endl;
+
+        vector<cv::KeyPoint> vKeysUn;
+        const double tOpenCV = TimeMs(nFrames, [&](int f) { UndistortOpenCV(cam, vFrames[f], vKeysUn); });
+        cout << "  OpenCV path:             " << tOpenCV / nFrames * 1000.0 << " us/frame" << endl;
+
+        for(int nRefine = 0; nRefine <= 2; nRefine++)
+        {
+            auto t0 = chrono::steady_clock::now();
+            UndistortionMap map(cam.model, cam.vK, cam.vDist, cam.imSize, cellSize, nRefine);
+            auto t1 = chrono::steady_clock::now();
+            const double tBuild = chrono::duration_cast<chrono::duration<double, milli>>(t1 - t0).count();
+
+            vKeysUn.resize(nKeys);
+            const double tMap = TimeMs(nFrames, [&](int f) { map.Undistort(vFrames[f].data(), vKeysUn.data(), nKeys); });
+
+            double maxOpenCV = 0.0, sumOpenCV = 0.0, maxExact = 0.0;
+            size_t nCompared = 0;
+            vector<cv::KeyPoint> vKeysUnOpenCV;
+            for(const vector<cv::KeyPoint> &vKeys : vFrames)
+            {
+                UndistortOpenCV(cam, vKeys, vKeysUnOpenCV);
+                for(int i=0; i<nKeys; i++)
+                {
+                    const cv::Point2f exact = map.UndistortExact(vKeys[i].pt);
+                    const float theta = atan(cv::norm(exact - cv::Point2f(cam.vK[2], cam.vK[3])) / cam.vK[0]);
+                    if(!std::isfinite(exact.x) || theta * 180.f / CV_PI > cam.maxThetaDeg)
+                        continue;
+
+                    const cv::Point2f lookup = map.Undistort(vKeys[i].pt);
+                    const double dOpenCV = cv::norm(lookup - vKeysUnOpenCV[i].pt);
+                    maxOpenCV = max(maxOpenCV, dOpenCV);
+                    sumOpenCV += dOpenCV;
+                    maxExact = max(maxExact, static_cast<double>(cv::norm(lookup - exact)));
+                    nCompared++;
+                }
+            }
+
+            cout << "  lookup, " << nRefine << " refinement(s):  " << tMap / nFrames * 1000.0 << " us/frame"
+                 << " (built in " << tBuild << " ms)"
+                 << ", vs OpenCV max " << maxOpenCV << " px / mean " << sumOpenCV / max<size_t>(nCompared, 1) << " px"
+                 << ", vs converged max " << maxExact << " px" << endl;
+
+            if(nRefine > 0 && maxExact > MAX_REFINED_ERROR)
+            {
+                cerr << "  refined lookup exceeds " << MAX_REFINED_ERROR << " px" << endl;
+                bOk = false;
+            }
+        }
+
+        // How far the OpenCV path itself is from the converged inverse (cv::undistortPoints stops after 5 iterations)
+        UndistortionMap exactMap(cam.model, cam.vK, cam.vDist, cam.imSize, cellSize, 0);
+        double maxOpenCVExact = 0.0;
+        vector<cv::KeyPoint> vKeysUnOpenCV;
+        for(const vector<cv::KeyPoint> &vKeys : vFrames)
+        {
+            UndistortOpenCV(cam, vKeys, vKeysUnOpenCV);
+            for(int i=0; i<nKeys; i++)
+            {
+                const cv::Point2f exact = exactMap.UndistortExact(vKeys[i].pt);
+                const float theta = atan(cv::norm(exact - cv::Point2f(cam.vK[2], cam.vK[3])) / cam.vK[0]);
+                if(std::isfinite(exact.x) && theta * 180.f / CV_PI <= cam.maxThetaDeg)
+                    maxOpenCVExact = max(maxOpenCVExact, static_cast<double>(cv::norm(vKeysUnOpenCV[i].pt - exact)));
+            }
+        }
+        cout << "  OpenCV path vs converged max " << maxOpenCVExact << " px" << endl;
+    }
+
+    return bOk ? 0 : 1;
+}
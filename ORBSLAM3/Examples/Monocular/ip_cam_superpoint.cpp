@@ -16,7 +16,7 @@
 
 #include <System.h>
 #include "SuperPointFast.h"
-#include "utils/ThreadSafeQueue.h"
+#include "utils/PipelineQueue.h"
 #include "utils/FeatureExtractorTypes.h"
 #include "PipelinedFE/PipelinedProcessFactory.h"
 #include "SuperPointFast.h"
@@ -199,8 +199,8 @@ int main(int argc, char *argv[])
     const size_t OUTPUT_QUEUE_SIZE = 10;
 
     // Create thread-safe queues for our pipeline
-    ThreadSafeQueue<ORB_SLAM3::InputQueueItem> inputQueue(INPUT_QUEUE_SIZE);
-    ThreadSafeQueue<ORB_SLAM3::ResultQueueItem> outputQueue(OUTPUT_QUEUE_SIZE);
+    ORB_SLAM3::PipelineQueue<ORB_SLAM3::InputQueueItem> inputQueue(INPUT_QUEUE_SIZE);
+    ORB_SLAM3::PipelineQueue<ORB_SLAM3::ResultQueueItem> outputQueue(OUTPUT_QUEUE_SIZE);
 
     // Create the real-time SuperPoint feature extractor
     auto featureProcessor = ORB_SLAM3::PipelinedProcessFactory::CreatePipelinedProcess(
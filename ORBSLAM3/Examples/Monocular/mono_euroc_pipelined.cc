@@ -25,9 +25,11 @@
 #include <opencv2/core/core.hpp>
 
 #include <System.h>
-#include "utils/ThreadSafeQueue.h"
+#include "utils/PipelineQueue.h"
+#include "utils/FramePool.h"
 #include "utils/FeatureExtractorTypes.h"
 #include "PipelinedFE/PipelinedProcessFactory.h"
+#include "PipelinedFE/BowPipelinedProcess.h"
 
 using namespace std;
 
@@ -91,25 +93,38 @@ int main(int argc, char **argv)
     const size_t INPUT_QUEUE_SIZE = 20;
     const size_t OUTPUT_QUEUE_SIZE = 50;
 
+    // Image buffers shared by the producer, extractor and tracker, recycled once all of them release a frame
+    ORB_SLAM3::FramePool framePool(INPUT_QUEUE_SIZE + OUTPUT_QUEUE_SIZE + 8);
+
     // Process each sequence
     for (seq = 0; seq<num_seq; seq++)
     {
         // Create thread-safe queues for our pipeline
-        ThreadSafeQueue<ORB_SLAM3::InputQueueItem> inputQueue(INPUT_QUEUE_SIZE);
-        ThreadSafeQueue<ORB_SLAM3::ResultQueueItem> outputQueue(OUTPUT_QUEUE_SIZE);
+        ORB_SLAM3::PipelineQueue<ORB_SLAM3::InputQueueItem> inputQueue(INPUT_QUEUE_SIZE);
+        ORB_SLAM3::PipelineQueue<ORB_SLAM3::ResultQueueItem> outputQueue(OUTPUT_QUEUE_SIZE);
         
-        // Create the feature extractor processor using the factory
+        // Create the feature extractor processor using the factory, configured from the settings file
         auto featureProcessor = ORB_SLAM3::PipelinedProcessFactory::CreatePipelinedProcess(
             ORB_SLAM3::FeatureExtractorType::ORB, 
             inputQueue, 
-            outputQueue
+            outputQueue,
+            SLAM.settings_
         );
         
         // Start the processor thread
         featureProcessor->StartProcessing();
 
+        // Optional BoW stage between extraction and tracking
+        ORB_SLAM3::PipelineQueue<ORB_SLAM3::BowResultQueueItem> bowQueue(OUTPUT_QUEUE_SIZE);
+        std::unique_ptr<ORB_SLAM3::BowPipelinedProcess> bowProcessor;
+        if (SLAM.settings_ && SLAM.settings_->pipelineBoW())
+        {
+            bowProcessor.reset(new ORB_SLAM3::BowPipelinedProcess(outputQueue, bowQueue, SLAM.GetVocabulary()));
+            bowProcessor->StartProcessing();
+        }
+
         // Create a producer thread to read images and fill the input queue
-        std::thread producerThread([&vstrImageFilenames, &vTimestampsCam, seq, &nImages, &inputQueue, imageScale, &SLAM]() {
+        std::thread producerThread([&vstrImageFilenames, &vTimestampsCam, seq, &nImages, &inputQueue, &framePool, imageScale, &SLAM]() {
             cv::Mat im;
 
             // Process all images in the sequence
@@ -118,7 +133,7 @@ int main(int argc, char **argv)
 
                 std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
                 // Read image from file
-                im = cv::imread(vstrImageFilenames[seq][ni], cv::IMREAD_UNCHANGED);
+                im = framePool.Read(vstrImageFilenames[seq][ni], cv::IMREAD_UNCHANGED);
                 double tframe = vTimestampsCam[seq][ni];
 
                 // Check if image is valid
@@ -133,9 +148,13 @@ int main(int argc, char **argv)
                 {
                     int width = im.cols * imageScale;
                     int height = im.rows * imageScale;
-                    cv::resize(im, im, cv::Size(width, height));
+                    cv::Mat resized = framePool.Acquire(cv::Size(width, height), im.type());
+                    cv::resize(im, resized, resized.size());
+                    im = resized;
                 }else if(SLAM.settings_ && SLAM.settings_->needToResize()){
-                    cv::resize(im, im, SLAM.settings_->newImSize());
+                    cv::Mat resized = framePool.Acquire(SLAM.settings_->newImSize(), im.type());
+                    cv::resize(im, resized, resized.size());
+                    im = resized;
                 }
 
                 // Create input item and enqueue
@@ -143,7 +162,7 @@ int main(int argc, char **argv)
                 item.index = ni;
                 item.timestamp = tframe;
                 item.filename = vstrImageFilenames[seq][ni];
-                item.image = im.clone();
+                item.image = im;
                 
                 inputQueue.enqueue(item);
 
@@ -167,9 +186,13 @@ int main(int argc, char **argv)
 
         // Consumer (main thread) - process results from the processing thread
         int processedFrames = 0;
-        ORB_SLAM3::ResultQueueItem result;
-        
-        while (outputQueue.dequeue(result)) 
+        ORB_SLAM3::BowResultQueueItem item;
+        ORB_SLAM3::ResultQueueItem &result = item.result;
+        auto dequeueResult = [&]() {
+            return bowProcessor ? bowQueue.dequeue(item) : outputQueue.dequeue(result);
+        };
+
+        while (dequeueResult())
         {
             int ni = result.index;
             double tframe = result.timestamp;
@@ -213,7 +236,7 @@ int main(int argc, char **argv)
 #endif
             
             // Track using the SLAM system
-            SLAM.TrackMonocular(result);
+            SLAM.TrackMonocular(result, bowProcessor ? &item.bow : nullptr);
             
             std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
             double ttrack = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
@@ -231,8 +254,15 @@ int main(int argc, char **argv)
         // Wait for the producer to finish
         producerThread.join();
         
-        // Stop the processor
+        // Stop the processors
         featureProcessor->Stop();
+        if (bowProcessor)
+            bowProcessor->Stop();
+
+#ifdef PIPELINE_SPSC_QUEUE
+        cout << "Input queue: " << inputQueue.GetStats() << endl;
+        cout << "Output queue: " << outputQueue.GetStats() << endl;
+#endif
 
         // Handle map transitions between sequences
         if(seq < num_seq - 1)
@@ -17,7 +17,8 @@
 #include <opencv2/highgui.hpp>
 
 #include <System.h>
-#include "utils/ThreadSafeQueue.h"
+#include "utils/PipelineQueue.h"
+#include "utils/FramePool.h"
 #include "utils/FeatureExtractorTypes.h"
 #include "PipelinedFE/PipelinedProcessFactory.h"
 
@@ -143,6 +144,9 @@ int main(int argc, char **argv)
     const size_t INPUT_QUEUE_SIZE = 20;
     const size_t OUTPUT_QUEUE_SIZE = 50;
 
+    // Image buffers shared by the producer, extractor and tracker, recycled once all of them release a frame
+    ORB_SLAM3::FramePool framePool(INPUT_QUEUE_SIZE + OUTPUT_QUEUE_SIZE + 8);
+
     // Create a window for parameter adjustment with trackbars
     cv::namedWindow("SuperPoint Parameters", cv::WINDOW_NORMAL);
     
@@ -164,8 +168,8 @@ int main(int argc, char **argv)
     for (seq = 0; seq < num_seq; seq++)
     {
         // Create thread-safe queues for our pipeline
-        ThreadSafeQueue<ORB_SLAM3::InputQueueItem> inputQueue(INPUT_QUEUE_SIZE);
-        ThreadSafeQueue<ORB_SLAM3::ResultQueueItem> outputQueue(OUTPUT_QUEUE_SIZE);
+        ORB_SLAM3::PipelineQueue<ORB_SLAM3::InputQueueItem> inputQueue(INPUT_QUEUE_SIZE);
+        ORB_SLAM3::PipelineQueue<ORB_SLAM3::ResultQueueItem> outputQueue(OUTPUT_QUEUE_SIZE);
 
         // Create the real-time SuperPoint feature extractor
         auto featureProcessor = ORB_SLAM3::PipelinedProcessFactory::CreatePipelinedProcess(
@@ -180,7 +184,7 @@ int main(int argc, char **argv)
         featureProcessor->StartProcessing();
 
         // Create a producer thread to read images and fill the input queue
-        std::thread producerThread([&vstrImageFilenames, &vTimestampsCam, seq, &nImages, &inputQueue, imageScale, &SLAM]()
+        std::thread producerThread([&vstrImageFilenames, &vTimestampsCam, seq, &nImages, &inputQueue, &framePool, imageScale, &SLAM]()
                                 {
             cv::Mat im;
 
@@ -189,7 +193,7 @@ int main(int argc, char **argv)
             {
                 std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
                 // Read image from file
-                im = cv::imread(vstrImageFilenames[seq][ni], cv::IMREAD_UNCHANGED);
+                im = framePool.Read(vstrImageFilenames[seq][ni], cv::IMREAD_UNCHANGED);
                 double tframe = vTimestampsCam[seq][ni];
 
                 // Check if image is valid
@@ -204,9 +208,13 @@ int main(int argc, char **argv)
                 {
                     int width = im.cols * imageScale;
                     int height = im.rows * imageScale;
-                    cv::resize(im, im, cv::Size(width, height));
+                    cv::Mat resized = framePool.Acquire(cv::Size(width, height), im.type());
+                    cv::resize(im, resized, resized.size());
+                    im = resized;
                 }else if(SLAM.settings_ && SLAM.settings_->needToResize()){
-                    cv::resize(im, im, SLAM.settings_->newImSize());
+                    cv::Mat resized = framePool.Acquire(SLAM.settings_->newImSize(), im.type());
+                    cv::resize(im, resized, resized.size());
+                    im = resized;
                 }
 
                 // Create input item and enqueue
@@ -214,7 +222,7 @@ int main(int argc, char **argv)
                 item.index = ni;
                 item.timestamp = tframe;
                 item.filename = vstrImageFilenames[seq][ni];
-                item.image = im.clone();
+                item.image = im;
                 
                 inputQueue.enqueue(item);
 
@@ -0,0 +1,119 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* build_feature_cache.cc - Packs precomputed per-image features into one feature cache file
+*
+* Reads the <name>.kp/.kpts and <name>.desc files written by FeatureIO and writes a single
+* FeatureCache file that DummyPipelinedProcess and DummyExtractor map instead of opening two
+* files per frame. The written cache is read back and compared against the source files.
+*
+* Usage: ./build_feature_cache path_to_features_dir [output_file]
+*          (keypoints in features_dir/kpts, descriptors in features_dir/desc,
+*           output defaults to features_dir/features.cache)
+*        ./build_feature_cache path_to_keypoints_dir path_to_descriptors_dir output_file
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "FeatureExtractors/Dummy/FeatureCache.h"
+#include "FeatureExtractors/Dummy/FeatureIO.h"
+
+using namespace std;
+using namespace ORB_SLAM3;
+
+static bool SameKeyPoint(const cv::KeyPoint& a, const cv::KeyPoint& b)
+{
+    return a.pt == b.pt && a.size == b.size && a.angle == b.angle &&
+           a.response == b.response && a.octave == b.octave && a.class_id == b.class_id;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2 || argc > 4)
+    {
+        cerr << endl << "Usage: ./build_feature_cache path_to_features_dir [output_file]" << endl
+             << "       ./build_feature_cache path_to_keypoints_dir path_to_descriptors_dir output_file" << endl;
+        return 1;
+    }
+
+    string keypointsDir, descriptorsDir, outputPath;
+    if(argc == 4)
+    {
+        keypointsDir = argv[1];
+        descriptorsDir = argv[2];
+        outputPath = argv[3];
+    }
+    else
+    {
+        string featuresDir = argv[1];
+        keypointsDir = featuresDir + "/kpts";
+        descriptorsDir = featuresDir + "/desc";
+        outputPath = (argc == 3) ? string(argv[2]) : featuresDir + "/" + FeatureCache::DEFAULT_FILENAME;
+    }
+
+    // Frames are stored in filename order, which is timestamp order for EuRoC/TUM style datasets
+    vector<string> vNames;
+    error_code ec;
+    for(const auto& entry : filesystem::directory_iterator(keypointsDir, ec))
+    {
+        string ext = entry.path().extension().string();
+        if(entry.is_regular_file() && (ext == ".kp" || ext == ".kpts"))
+            vNames.push_back(entry.path().stem().string());
+    }
+    if(ec || vNames.empty())
+    {
+        cerr << "No keypoint files found in " << keypointsDir << endl;
+        return 1;
+    }
+    sort(vNames.begin(), vNames.end());
+    vNames.erase(unique(vNames.begin(), vNames.end()), vNames.end());
+
+    cout << "Packing " << vNames.size() << " frames into " << outputPath << endl;
+    if(!FeatureCache::Write(vNames, keypointsDir, descriptorsDir, outputPath))
+        return 1;
+
+    FeatureCache cache;
+    if(!cache.Open(outputPath))
+    {
+        cerr << "Cannot read back " << outputPath << endl;
+        return 1;
+    }
+
+    // Check every packed frame against its source files
+    size_t nChecked = 0, nMismatches = 0;
+    vector<cv::KeyPoint> vCachedKeys, vFileKeys;
+    cv::Mat cachedDesc, fileDesc;
+    for(const string& name : vNames)
+    {
+        if(!cache.Load(name, vCachedKeys, cachedDesc))
+            continue;
+
+        string kptsPath = keypointsDir + "/" + name + ".kp";
+        if(!filesystem::exists(kptsPath))
+            kptsPath = keypointsDir + "/" + name + ".kpts";
+        FeatureIO::loadFeatures(vFileKeys, fileDesc, kptsPath, descriptorsDir + "/" + name + ".desc");
+
+        bool same = vCachedKeys.size() == vFileKeys.size() &&
+                    equal(vCachedKeys.begin(), vCachedKeys.end(), vFileKeys.begin(), SameKeyPoint) &&
+                    cachedDesc.size() == fileDesc.size() && cachedDesc.type() == fileDesc.type() &&
+                    (cachedDesc.empty() || memcmp(cachedDesc.data, fileDesc.data, cachedDesc.total()*cachedDesc.elemSize()) == 0);
+        if(!same)
+        {
+            cerr << "Mismatch for frame " << name << endl;
+            nMismatches++;
+        }
+        nChecked++;
+    }
+
+    cout << "Packed " << cache.Size() << " of " << vNames.size() << " frames, "
+         << nChecked << " verified, " << nMismatches << " mismatches" << endl;
+
+    return nMismatches == 0 ? 0 : 1;
+}
@@ -19,6 +19,7 @@
 #ifndef CAMERAMODELS_GEOMETRICCAMERA_H
 #define CAMERAMODELS_GEOMETRICCAMERA_H
 
+#include <memory>
 #include <vector>
 
 #include <opencv2/core/core.hpp>
@@ -38,6 +39,7 @@
 
 #include "Converter.h"
 #include "GeometricTools.h"
+#include "UndistortionMap.h"
 
 namespace ORB_SLAM3 {
     class GeometricCamera {
@@ -92,6 +94,10 @@ namespace ORB_SLAM3 {
 
         unsigned int GetType() { return mnType; }
 
+        // Undistortion lookup of this camera, built once by Tracking (not serialized). Null if there is none.
+        const UndistortionMap* GetUndistortionMap() const { return mpUndistortionMap.get(); }
+        void SetUndistortionMap(const std::shared_ptr<const UndistortionMap> &pMap) { mpUndistortionMap = pMap; }
+
         const static unsigned int CAM_PINHOLE = 0;
         const static unsigned int CAM_FISHEYE = 1;
 
@@ -103,6 +109,8 @@ namespace ORB_SLAM3 {
         unsigned int mnId;
 
         unsigned int mnType;
+
+        std::shared_ptr<const UndistortionMap> mpUndistortionMap;
     };
 }
 
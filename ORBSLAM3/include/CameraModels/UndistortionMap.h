@@ -0,0 +1,96 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+* Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+*
+* ORB-SLAM3 is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+* the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with ORB-SLAM3.
+* If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CAMERAMODELS_UNDISTORTIONMAP_H
+#define CAMERAMODELS_UNDISTORTIONMAP_H
+
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+namespace ORB_SLAM3 {
+
+    // Undistortion of keypoints through a lookup table built once per camera.
+    // The distorted image domain is covered by a grid of nodes whose exact undistorted position is precomputed;
+    // a point is undistorted by bilinear interpolation of its cell, optionally refined with Gauss-Newton steps on
+    // the distortion model. The output is in pixels of the ideal pinhole camera with the same K, as returned by
+    // cv::undistortPoints(..., K, D, noArray(), K). The map is immutable once built, so it can be shared by
+    // every Frame and KeyFrame of the camera and used from any thread.
+    class UndistortionMap {
+    public:
+        enum Model {
+            RADIAL_TANGENTIAL = 0,  // k1, k2, p1, p2[, k3] (OpenCV plumb bob)
+            KANNALA_BRANDT = 1      // k1, k2, k3, k4 (OpenCV fisheye)
+        };
+
+        static constexpr float DEFAULT_CELL_SIZE = 8.f;
+        static constexpr int DEFAULT_REFINE_ITERATIONS = 1;
+
+        // vK = [fx, fy, cx, cy]. The grid covers the imSize image plus one cell on every side.
+        UndistortionMap(Model model, const std::vector<float> &vK, const std::vector<float> &vDistortion,
+                        const cv::Size &imSize, float cellSize = DEFAULT_CELL_SIZE,
+                        int nRefineIterations = DEFAULT_REFINE_ITERATIONS);
+
+        // Undistort a pixel. Points outside the grid are solved iteratively.
+        cv::Point2f Undistort(const cv::Point2f &p) const;
+
+        // Undistort n keypoints, copying every other field. in and out may be the same array. No allocations.
+        void Undistort(const cv::KeyPoint* in, cv::KeyPoint* out, size_t n) const;
+
+        // Undistort by solving the model until convergence, without the table
+        cv::Point2f UndistortExact(const cv::Point2f &p) const;
+
+        // Apply the distortion model to an undistorted pixel
+        cv::Point2f Distort(const cv::Point2f &p) const;
+
+        // True if distCoef (a 4 or 5 element radial-tangential vector) is the distortion this map was built for
+        bool HasDistortion(const cv::Mat &distCoef) const;
+
+        Model GetModel() const { return mModel; }
+        cv::Size GetImageSize() const { return mImSize; }
+        float GetCellSize() const { return mfCellSize; }
+        int GetRefineIterations() const { return mnRefineIterations; }
+
+    private:
+        // Normalized undistorted -> normalized distorted coordinates.
+        // J receives the row major 2x2 Jacobian (radial-tangential only, Kannala-Brandt is refined on theta).
+        void DistortNormalized(double x, double y, double &xd, double &yd, double* J) const;
+
+        // One refinement step of (x, y) towards the normalized undistorted point of the distorted (xd, yd):
+        // Gauss-Newton for radial-tangential, Newton on theta for Kannala-Brandt
+        void RefineNormalized(double xd, double yd, double &x, double &y) const;
+
+        const Model mModel;
+        const double fx, fy, cx, cy, invfx, invfy;
+        double k1, k2, k3, k4, p1, p2;
+        std::vector<float> mvDistortion;
+
+        const cv::Size mImSize;
+        const float mfCellSize, mfInvCellSize;
+        const int mnRefineIterations;
+
+        // Grid origin (in pixels) and number of nodes per row/column
+        float mfMinX, mfMinY;
+        int mnCols, mnRows;
+        // Undistorted pixel of every node, row major
+        std::vector<cv::Point2f> mvNodes;
+    };
+
+}
+
+#endif //CAMERAMODELS_UNDISTORTIONMAP_H
@@ -24,10 +24,6 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
-#ifndef REGISTER_TIMES
-#define REGISTER_TIMES
-#endif
-
 namespace ORB_SLAM3
 {
 
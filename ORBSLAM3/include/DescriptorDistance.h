@@ -0,0 +1,226 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* DescriptorDistance.h - Type-specialized descriptor distance kernels
+*
+* The descriptor metric is resolved once, when the feature extractor is created,
+* so the matching hot loops never look up the extractor type or go through cv::norm.
+*/
+
+#ifndef DESCRIPTORDISTANCE_H
+#define DESCRIPTORDISTANCE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+#if defined(__AVX2__) || defined(__POPCNT__)
+#include <immintrin.h>
+#endif
+
+#include "FeatureExtractorBase.h"
+
+namespace ORB_SLAM3
+{
+
+namespace DescriptorKernels
+{
+
+    // Hamming distance between two 256-bit binary descriptors (ORB)
+    inline int Hamming256(const uint8_t* a, const uint8_t* b)
+    {
+#if defined(__AVX2__) && defined(__POPCNT__)
+        const __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b)));
+        return static_cast<int>(_mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(x, 0))) +
+                                _mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(x, 1))) +
+                                _mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(x, 2))) +
+                                _mm_popcnt_u64(static_cast<uint64_t>(_mm256_extract_epi64(x, 3))));
+#else
+        int dist = 0;
+        for(int i=0; i<4; i++)
+        {
+            uint64_t va, vb;
+            std::memcpy(&va, a + 8*i, 8);
+            std::memcpy(&vb, b + 8*i, 8);
+            dist += __builtin_popcountll(va ^ vb);
+        }
+        return dist;
+#endif
+    }
+
+    // Hamming distance for binary descriptors of arbitrary length (in bytes)
+    inline int HammingN(const uint8_t* a, const uint8_t* b, const int nBytes)
+    {
+        int dist = 0;
+        int i = 0;
+        for(; i+8<=nBytes; i+=8)
+        {
+            uint64_t va, vb;
+            std::memcpy(&va, a + i, 8);
+            std::memcpy(&vb, b + i, 8);
+            dist += __builtin_popcountll(va ^ vb);
+        }
+        for(; i<nBytes; i++)
+            dist += __builtin_popcount(static_cast<unsigned int>(a[i] ^ b[i]));
+        return dist;
+    }
+
+    // Squared L2 distance for float descriptors of arbitrary length
+    inline float L2SqrN(const float* a, const float* b, const int n)
+    {
+        float sum = 0.f;
+        for(int i=0; i<n; i++)
+        {
+            const float d = a[i] - b[i];
+            sum += d*d;
+        }
+        return sum;
+    }
+
+    // Squared L2 distance for float descriptors of compile-time length N (SIFT: 128, SuperPoint: 256)
+    template<int N>
+    inline float L2Sqr(const float* a, const float* b)
+    {
+#if defined(__AVX2__) && defined(__FMA__)
+        static_assert(N % 16 == 0, "AVX2 L2 kernel expects a multiple of 16 floats");
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for(int i=0; i<N; i+=16)
+        {
+            const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+            const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+            acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+            acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        }
+        const __m256 acc = _mm256_add_ps(acc0, acc1);
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        s = _mm_add_ss(s, _mm_movehdup_ps(s));
+        return _mm_cvtss_f32(s);
+#else
+        return L2SqrN(a, b, N);
+#endif
+    }
+
+} // namespace DescriptorKernels
+
+// Descriptor metric used by the matchers. Binary descriptors always use Hamming distance.
+// Float descriptors use L2 or squared L2 scaled to the threshold range of the extractor
+// (SIFT: L2^2, Xfeat: 512*L2^2, any other float extractor such as SuperPoint: 100*L2).
+class DescriptorMetric
+{
+public:
+    // Raw distance between two descriptors of mLength elements
+    typedef float (*Kernel)(const uint8_t* a, const uint8_t* b);
+
+    DescriptorMetric();
+    DescriptorMetric(NormType norm, int length, bool bSquared, float scale);
+
+    // Select the metric from the extractor traits (norm(), descriptorLength()) and its type name
+    static DescriptorMetric FromExtractor(const FeatureExtractor* pExtractor, const std::string& type);
+
+    inline float operator()(const cv::Mat &a, const cv::Mat &b) const
+    {
+        if(a.type() == CV_8U)
+        {
+            if(mNorm == NormType::HAMMING && a.cols == mLength)
+                return mKernel(a.data, b.data);
+            return static_cast<float>(DescriptorKernels::HammingN(a.data, b.data, a.cols));
+        }
+
+        float d2;
+        if(mNorm == NormType::L2 && a.cols == mLength)
+            d2 = mKernel(a.data, b.data);
+        else
+            d2 = FloatL2Sqr(a.ptr<float>(), b.ptr<float>(), a.cols);
+
+        return mfScale * (mbSquared ? d2 : std::sqrt(d2));
+    }
+
+    // Squared L2 distance dispatched to the specialized kernels by length
+    static inline float FloatL2Sqr(const float* a, const float* b, const int n)
+    {
+        switch(n)
+        {
+            case 128: return DescriptorKernels::L2Sqr<128>(a, b);
+            case 256: return DescriptorKernels::L2Sqr<256>(a, b);
+            default:  return DescriptorKernels::L2SqrN(a, b, n);
+        }
+    }
+
+    // Distances between one query descriptor and n descriptors stored contiguously every step bytes
+    void Distances(const cv::Mat &query, const uint8_t* block, size_t step, int n, float* out) const;
+
+    NormType norm() const { return mNorm; }
+    int length() const { return mLength; }
+    bool squared() const { return mbSquared; }
+    float scale() const { return mfScale; }
+
+    std::string ToString() const;
+
+private:
+    NormType mNorm;
+    int mLength;
+    bool mbSquared;
+    float mfScale;
+    Kernel mKernel;
+};
+
+// Candidate descriptors gathered into one contiguous block for one-to-many matching.
+// The buffers are kept between queries, so matching does not allocate in the steady state.
+class DescriptorBatch
+{
+public:
+    // Best and second best candidate of a query. Indices and octaves are those passed to Add().
+    struct Result
+    {
+        float bestDist;
+        float bestDist2;
+        int bestIdx;
+        int bestLevel;
+        int bestLevel2;
+    };
+
+    DescriptorBatch();
+
+    // Start a new batch of rows taken from descriptor matrices of the same type as descriptors
+    void Clear(const cv::Mat &descriptors);
+
+    inline void Add(const cv::Mat &descriptors, const size_t row, const size_t idx, const int octave)
+    {
+        const size_t n = mvIdx.size();
+        if((n+1)*mRowBytes > mBlock.size())
+            mBlock.resize(2*(n+1)*mRowBytes);
+        std::memcpy(mBlock.data() + n*mRowBytes, descriptors.ptr(static_cast<int>(row)), mRowBytes);
+        mvIdx.push_back(idx);
+        mvLevel.push_back(octave);
+    }
+
+    inline bool empty() const { return mvIdx.empty(); }
+    inline size_t size() const { return mvIdx.size(); }
+
+    // Compute the distances to all gathered rows in a single pass and keep the best two.
+    // Candidates at distance >= maxDist are never selected.
+    Result Match(const DescriptorMetric &metric, const cv::Mat &query,
+                 const float maxDist = std::numeric_limits<float>::max());
+
+    // Distances computed by the last call to Match, in insertion order
+    inline const std::vector<float>& GetDistances() const { return mvDist; }
+
+private:
+    std::vector<uint8_t> mBlock;
+    size_t mRowBytes;
+
+    std::vector<size_t> mvIdx;
+    std::vector<int> mvLevel;
+    std::vector<float> mvDist;
+};
+
+} // namespace ORB_SLAM3
+
+#endif // DESCRIPTORDISTANCE_H
@@ -12,6 +12,7 @@
 #include <list>
 #include <map>
 #include <opencv2/opencv.hpp>
+#include "FeatureExtractors/Dummy/FeatureCache.h"
 
 namespace ORB_SLAM3
 {
@@ -38,6 +39,8 @@ public:
     void configureForExtractorType();
     void SetKeypointsDirectory(const std::string& dir) { keypointsDirectory = dir; }
     void SetDescriptorsDirectory(const std::string& dir) { descriptorsDirectory = dir; }
+    // Read features from a packed cache file instead of the per-image files
+    bool OpenFeatureCache(const std::string& filePath) { return featureCache.Open(filePath); }
 
     // Accessor methods
     int inline GetLevels() const { return nlevels; }
@@ -78,9 +81,8 @@ protected:
     std::vector<float> mvLevelSigma2;
     std::vector<float> mvInvLevelSigma2;
     
-    // Cache for loaded keypoints and descriptors
-    std::map<std::string, std::vector<cv::KeyPoint>> keypointsCache;
-    std::map<std::string, cv::Mat> descriptorsCache;
+    // Memory-mapped features of the whole sequence, if a cache file was found
+    FeatureCache featureCache;
 
     // Image pyramid (for API compatibility)
     std::vector<cv::Mat> mvImagePyramid;
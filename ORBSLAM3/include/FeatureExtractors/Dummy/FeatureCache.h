@@ -0,0 +1,115 @@
+/**
+ * File: FeatureCache.h
+ * Date: April 2025
+ * Description: Packed, memory-mapped cache of precomputed keypoints and descriptors for a whole sequence
+ * License: see LICENSE.txt
+ *
+ * File layout (native byte order):
+ *   Header       64 bytes, see FeatureCache::Header
+ *   Frame data   per frame, 64-byte aligned: keypoints as SoA columns
+ *                (x, y, size, angle, response as float; octave, class_id as int32),
+ *                then the descriptor rows at the next 64-byte boundary
+ *   Frame table  nFrames x FeatureCache::FrameEntry
+ *   Names        base filenames (no directory, no extension), not NUL terminated
+ */
+
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include <opencv2/core/core.hpp>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ORB_SLAM3 {
+
+class FeatureCache {
+public:
+    static constexpr const char* DEFAULT_FILENAME = "features.cache";
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 64;
+
+    struct Header {
+        char magic[8];          // "ORBFCACH"
+        uint32_t version;
+        uint32_t nFrames;
+        int32_t descriptorType;
+        int32_t descriptorCols;
+        uint32_t descriptorRowBytes;
+        uint32_t reserved0;
+        uint64_t tableOffset;
+        uint64_t namesOffset;
+        uint64_t fileSize;
+        uint64_t reserved1;
+    };
+
+    struct FrameEntry {
+        uint64_t keypointsOffset;
+        uint64_t descriptorsOffset;
+        uint32_t nKeypoints;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t reserved;
+    };
+
+    FeatureCache();
+    ~FeatureCache();
+
+    FeatureCache(const FeatureCache&) = delete;
+    FeatureCache& operator=(const FeatureCache&) = delete;
+
+    /**
+     * @brief Map a cache file and index its frames
+     * @param filePath Path to the cache file
+     * @return True if the file is a valid cache
+     */
+    bool Open(const std::string& filePath);
+
+    void Close();
+
+    bool IsOpen() const { return mpData != nullptr; }
+
+    size_t Size() const { return mpHeader ? mpHeader->nFrames : 0; }
+
+    /**
+     * @brief Copy the features of one frame out of the mapping. Safe to call from several threads.
+     * @param baseName Image filename without directory or extension
+     * @param keypoints Output keypoints
+     * @param descriptors Output descriptors, one row per keypoint
+     * @return False if the frame is not in the cache
+     */
+    bool Load(const std::string& baseName,
+              std::vector<cv::KeyPoint>& keypoints,
+              cv::Mat& descriptors) const;
+
+    /**
+     * @brief Pack the per-image files produced by FeatureIO into a single cache file
+     * @param baseNames Frames to pack, in the order they will be replayed
+     * @param keypointsDir Directory with <name>.kp or <name>.kpts files
+     * @param descriptorsDir Directory with <name>.desc files
+     * @param outputPath Path of the cache file to write
+     * @return True if the cache was written. Frames whose files cannot be read are skipped.
+     */
+    static bool Write(const std::vector<std::string>& baseNames,
+                      const std::string& keypointsDir,
+                      const std::string& descriptorsDir,
+                      const std::string& outputPath);
+
+private:
+    void Load(const FrameEntry& entry,
+              std::vector<cv::KeyPoint>& keypoints,
+              cv::Mat& descriptors) const;
+
+    const uint8_t* mpData;
+    size_t mnSize;
+    const Header* mpHeader;
+    const FrameEntry* mpFrames;
+
+    // Base filename -> frame index
+    std::unordered_map<std::string, uint32_t> mIndex;
+};
+
+} // namespace ORB_SLAM3
+
+#endif // FEATURE_CACHE_H
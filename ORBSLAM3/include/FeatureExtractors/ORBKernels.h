@@ -0,0 +1,66 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* ORBKernels.h - Orientation (IC_Angle) and rBRIEF descriptor kernels of the ORB extractor
+*
+* Each kernel has a scalar reference and AVX2 / SSE4.1 versions that produce bit-identical
+* results. The vector versions are compiled with target attributes and picked at runtime
+* from the CPU features, so the library does not depend on -march.
+*/
+
+#ifndef ORBKERNELS_H
+#define ORBKERNELS_H
+
+#include <cstdint>
+#include <vector>
+#include <opencv2/core/types.hpp>
+
+namespace ORB_SLAM3
+{
+
+namespace ORBKernels
+{
+
+    const int HALF_PATCH_SIZE = 15;
+    const int DESCRIPTOR_PAIRS = 256;
+
+    // Row extents of the circular orientation patch, expanded to the per-row int16 weights
+    // used by the vector kernels. Rows cover u = -15..16; column 16 always has weight 0.
+    struct ICAngleWeights
+    {
+        explicit ICAngleWeights(const std::vector<int>& u_max);
+
+        std::vector<int> umax;
+        alignas(32) int16_t wu[HALF_PATCH_SIZE+1][32];   // u if |u| <= umax[v] else 0
+        alignas(32) int16_t wv[HALF_PATCH_SIZE+1][32];   // v if |u| <= umax[v] else 0
+    };
+
+    // rBRIEF sampling pattern: 256 point pairs, also kept as float columns for the vector kernels
+    struct DescriptorPattern
+    {
+        explicit DescriptorPattern(const std::vector<cv::Point>& pattern);
+
+        std::vector<cv::Point> points;
+        alignas(32) float x[2*DESCRIPTOR_PAIRS];
+        alignas(32) float y[2*DESCRIPTOR_PAIRS];
+    };
+
+    // Intensity centroid moments of the patch centred at center (row stride step).
+    // The vector versions load whole 32-byte rows, columns -15..+16 around the center.
+    void ICMoments(const uint8_t* center, int step, const ICAngleWeights& w, int& m_01, int& m_10);
+
+    // 32-byte rBRIEF descriptor of the patch centred at center, rotated by angle (degrees)
+    void Describe(const uint8_t* center, int step, float angle, const DescriptorPattern& pattern, uint8_t* desc);
+
+    // Scalar references, always available
+    void ICMomentsScalar(const uint8_t* center, int step, const ICAngleWeights& w, int& m_01, int& m_10);
+    void DescribeScalar(const uint8_t* center, int step, float angle, const DescriptorPattern& pattern, uint8_t* desc);
+
+    // Instruction set selected at runtime: "AVX2", "SSE4.1" or "scalar"
+    const char* ActiveISA();
+
+} // namespace ORBKernels
+
+} // namespace ORB_SLAM3
+
+#endif // ORBKERNELS_H
@@ -21,8 +21,11 @@
 
 #include <vector>
 #include <list>
+#include <memory>
 #include <opencv2/opencv.hpp>
 #include "FeatureExtractorBase.h"
+#include "ORBKernels.h"
+#include "utils/ThreadPool.h"
 
 
 namespace ORB_SLAM3
@@ -47,8 +50,10 @@ public:
     
     enum {HARRIS_SCORE=0, FAST_SCORE=1 };
 
+    // nThreads > 1 runs per-level detection and description as tasks on a private pool.
+    // The output is identical to the sequential path.
     ORBextractor(int nfeatures, float scaleFactor, int nlevels,
-                 int iniThFAST, int minThFAST);
+                 int iniThFAST, int minThFAST, int nThreads = 1);
 
     ~ORBextractor(){}
 
@@ -74,6 +79,12 @@ protected:
 
     void ComputePyramid(cv::Mat image);
     void ComputeKeyPointsOctTree(std::vector<std::vector<cv::KeyPoint> >& allKeypoints);    
+    void ComputeKeyPointsOctTreeLevel(const int level, std::vector<cv::KeyPoint>& keypoints);
+    void ComputeDescriptorsLevel(const int level, std::vector<cv::KeyPoint>& keypoints,
+                                 const std::vector<int>& vDstIdx, cv::Mat& descriptors);
+
+    // Runs f(level) for every pyramid level, on the pool when there is one
+    template<typename F> void ForEachLevel(F&& f);
     std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint>& vToDistributeKeys, const int &minX,
                                            const int &maxX, const int &minY, const int &maxY, const int &nFeatures, const int &level);
 
@@ -93,6 +104,10 @@ protected:
 
     std::vector<int> umax;
 
+    // umax and pattern in the layout of the vectorized orientation and descriptor kernels
+    std::unique_ptr<ORBKernels::ICAngleWeights> mpAngleWeights;
+    std::unique_ptr<ORBKernels::DescriptorPattern> mpDescriptorPattern;
+
     // Scale factors for the different levels, mvScaleFactor[level_i] = scaleFactor^i
     std::vector<float> mvScaleFactor;
     std::vector<float> mvInvScaleFactor;    
@@ -103,6 +118,16 @@ protected:
 
     // Image pyramid moved to private use GetImagePyramid() to access it
     std::vector<cv::Mat> mvImagePyramid;
+
+    // Buffers reused across frames: bordered pyramid storage (mvImagePyramid are views into it),
+    // blurred levels for description, and per-level keypoint scratch
+    std::vector<cv::Mat> mvPyramidBorder;
+    std::vector<cv::Mat> mvBlurredPyramid;
+    std::vector<std::vector<cv::KeyPoint> > mvAllKeypoints;
+    std::vector<std::vector<cv::KeyPoint> > mvToDistributeKeys;
+    std::vector<std::vector<int> > mvDstIdx;
+
+    std::unique_ptr<ThreadPool> mpThreadPool;
 };
 
 } //namespace ORB_SLAM
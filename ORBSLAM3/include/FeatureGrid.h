@@ -0,0 +1,263 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* FeatureGrid.h - Flat (CSR) spatial index of the keypoints of a frame
+*
+* Keypoints are bucketed in a cols x rows grid stored as one offsets array plus one
+* index array, with the x/y/octave of every entry kept alongside (SoA) in cell order.
+* Queries scan contiguous memory and write into a caller-provided buffer or visitor.
+*
+* StereoRowIndex is the same layout keyed by image row, used to look up the right image
+* keypoints along the epipolar line of a rectified stereo pair.
+*/
+
+#ifndef FEATUREGRID_H
+#define FEATUREGRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+namespace ORB_SLAM3
+{
+
+class FeatureGrid
+{
+public:
+    FeatureGrid()
+        : mnCols(0), mnRows(0), mfMinX(0), mfMinY(0), mfCellWidthInv(0), mfCellHeightInv(0)
+    {}
+
+    /**
+     * Build the index over the first nKeys keypoints of vKeys
+     * @param posInGrid Callable (const cv::KeyPoint&, int& x, int& y) -> bool giving the cell of a keypoint
+     */
+    template<typename PosInGridFn>
+    void Build(const std::vector<cv::KeyPoint> &vKeys, const size_t nKeys, const int nCols, const int nRows,
+               const float minX, const float minY, const float cellWidthInv, const float cellHeightInv,
+               PosInGridFn posInGrid);
+
+    /**
+     * Visit the features inside the square window of half side r centered at (x,y).
+     * Octaves are restricted to [minLevel, maxLevel]; a negative maxLevel disables the upper bound.
+     * Features are visited cell by cell (x major) in keypoint order, as the original nested grid did.
+     */
+    template<typename Visitor>
+    void ForEachInArea(const float x, const float y, const float r, const int minLevel, const int maxLevel,
+                       Visitor &&visit) const;
+
+    // Same query, writing the feature indices into vIndices (cleared first). Returns the number of features.
+    inline size_t GetFeaturesInArea(const float x, const float y, const float r, const int minLevel, const int maxLevel,
+                                    std::vector<size_t> &vIndices) const
+    {
+        vIndices.clear();
+        ForEachInArea(x, y, r, minLevel, maxLevel, [&vIndices](const size_t idx){ vIndices.push_back(idx); });
+        return vIndices.size();
+    }
+
+    // Keypoint indices assigned to a cell
+    inline const size_t* CellBegin(const int ix, const int iy) const { return mvIndices.data() + mvCellStart[ix*mnRows + iy]; }
+    inline const size_t* CellEnd(const int ix, const int iy) const { return mvIndices.data() + mvCellStart[ix*mnRows + iy + 1]; }
+
+    inline bool empty() const { return mvIndices.empty(); }
+    inline int cols() const { return mnCols; }
+    inline int rows() const { return mnRows; }
+
+private:
+    int mnCols;
+    int mnRows;
+    float mfMinX;
+    float mfMinY;
+    float mfCellWidthInv;
+    float mfCellHeightInv;
+
+    // Offsets of each cell (x major) into the arrays below, size cols*rows+1
+    std::vector<size_t> mvCellStart;
+
+    // Keypoint index and its position/octave, stored in cell order
+    std::vector<size_t> mvIndices;
+    std::vector<float> mvX;
+    std::vector<float> mvY;
+    std::vector<int> mvOctave;
+};
+
+// Right image keypoints of a rectified stereo pair indexed by image row (CSR).
+// Every keypoint is listed in all the rows within 2 scale factors of its y coordinate, in keypoint order,
+// with its x and octave kept alongside. The buffers are reused when the index is rebuilt.
+class StereoRowIndex
+{
+public:
+    StereoRowIndex() : mnRows(0) {}
+
+    void Build(const std::vector<cv::KeyPoint> &vKeys, const int nRows, const std::vector<float> &vScaleFactors);
+
+    // Entries [RowBegin(y), RowEnd(y)) of the arrays below belong to row y
+    inline size_t RowBegin(const int y) const { return mvRowStart[y]; }
+    inline size_t RowEnd(const int y) const { return mvRowStart[y+1]; }
+
+    inline size_t Index(const size_t k) const { return mvIndices[k]; }
+    inline float X(const size_t k) const { return mvX[k]; }
+    inline int Octave(const size_t k) const { return mvOctave[k]; }
+
+    inline int rows() const { return mnRows; }
+
+private:
+    // Row span [minr, maxr] of a keypoint, clamped to the image
+    inline void RowSpan(const cv::KeyPoint &kp, const std::vector<float> &vScaleFactors, int &minr, int &maxr) const
+    {
+        const float r = 2.0f*vScaleFactors[kp.octave];
+        minr = std::max(0, (int)std::floor(kp.pt.y-r));
+        maxr = std::min(mnRows-1, (int)std::ceil(kp.pt.y+r));
+    }
+
+    int mnRows;
+    std::vector<size_t> mvRowStart;
+    std::vector<size_t> mvIndices;
+    std::vector<float> mvX;
+    std::vector<int> mvOctave;
+    // Scatter position of every row while building
+    std::vector<size_t> mvCursor;
+};
+
+template<typename PosInGridFn>
+void FeatureGrid::Build(const std::vector<cv::KeyPoint> &vKeys, const size_t nKeys, const int nCols, const int nRows,
+                        const float minX, const float minY, const float cellWidthInv, const float cellHeightInv,
+                        PosInGridFn posInGrid)
+{
+    mnCols = nCols;
+    mnRows = nRows;
+    mfMinX = minX;
+    mfMinY = minY;
+    mfCellWidthInv = cellWidthInv;
+    mfCellHeightInv = cellHeightInv;
+
+    const int nCells = mnCols*mnRows;
+    mvCellStart.assign(nCells+1, 0);
+
+    // Count the keypoints of every cell
+    std::vector<int> vCellOfKey(nKeys, -1);
+    for(size_t i=0; i<nKeys; i++)
+    {
+        int nGridPosX, nGridPosY;
+        if(posInGrid(vKeys[i], nGridPosX, nGridPosY))
+        {
+            vCellOfKey[i] = nGridPosX*mnRows + nGridPosY;
+            mvCellStart[vCellOfKey[i]+1]++;
+        }
+    }
+
+    for(int c=0; c<nCells; c++)
+        mvCellStart[c+1] += mvCellStart[c];
+
+    const size_t nAssigned = mvCellStart[nCells];
+    mvIndices.resize(nAssigned);
+    mvX.resize(nAssigned);
+    mvY.resize(nAssigned);
+    mvOctave.resize(nAssigned);
+
+    // Scatter in keypoint order, so each cell keeps increasing indices
+    std::vector<size_t> vCursor(mvCellStart.begin(), mvCellStart.end()-1);
+    for(size_t i=0; i<nKeys; i++)
+    {
+        if(vCellOfKey[i] < 0)
+            continue;
+
+        const size_t k = vCursor[vCellOfKey[i]]++;
+        const cv::KeyPoint &kp = vKeys[i];
+        mvIndices[k] = i;
+        mvX[k] = kp.pt.x;
+        mvY[k] = kp.pt.y;
+        mvOctave[k] = kp.octave;
+    }
+}
+
+inline void StereoRowIndex::Build(const std::vector<cv::KeyPoint> &vKeys, const int nRows,
+                                  const std::vector<float> &vScaleFactors)
+{
+    mnRows = nRows;
+    mvRowStart.assign(mnRows+1, 0);
+
+    // Count the entries of every row
+    for(const cv::KeyPoint &kp : vKeys)
+    {
+        int minr, maxr;
+        RowSpan(kp, vScaleFactors, minr, maxr);
+        for(int y=minr; y<=maxr; y++)
+            mvRowStart[y+1]++;
+    }
+
+    for(int y=0; y<mnRows; y++)
+        mvRowStart[y+1] += mvRowStart[y];
+
+    const size_t nEntries = mvRowStart[mnRows];
+    mvIndices.resize(nEntries);
+    mvX.resize(nEntries);
+    mvOctave.resize(nEntries);
+
+    // Scatter in keypoint order, so each row keeps increasing indices
+    mvCursor.assign(mvRowStart.begin(), mvRowStart.end()-1);
+    for(size_t i=0; i<vKeys.size(); i++)
+    {
+        const cv::KeyPoint &kp = vKeys[i];
+        int minr, maxr;
+        RowSpan(kp, vScaleFactors, minr, maxr);
+        for(int y=minr; y<=maxr; y++)
+        {
+            const size_t k = mvCursor[y]++;
+            mvIndices[k] = i;
+            mvX[k] = kp.pt.x;
+            mvOctave[k] = kp.octave;
+        }
+    }
+}
+
+template<typename Visitor>
+void FeatureGrid::ForEachInArea(const float x, const float y, const float r, const int minLevel, const int maxLevel,
+                                Visitor &&visit) const
+{
+    if(mvCellStart.empty())
+        return;
+
+    const int nMinCellX = std::max(0,(int)std::floor((x-mfMinX-r)*mfCellWidthInv));
+    if(nMinCellX>=mnCols)
+        return;
+
+    const int nMaxCellX = std::min(mnCols-1,(int)std::ceil((x-mfMinX+r)*mfCellWidthInv));
+    if(nMaxCellX<0)
+        return;
+
+    const int nMinCellY = std::max(0,(int)std::floor((y-mfMinY-r)*mfCellHeightInv));
+    if(nMinCellY>=mnRows)
+        return;
+
+    const int nMaxCellY = std::min(mnRows-1,(int)std::ceil((y-mfMinY+r)*mfCellHeightInv));
+    if(nMaxCellY<0)
+        return;
+
+    // Levels are only checked when a positive minimum or a maximum is given
+    const int lo = (minLevel>0 || maxLevel>=0) ? minLevel : INT_MIN;
+    const int hi = (maxLevel>=0) ? maxLevel : INT_MAX;
+
+    for(int ix = nMinCellX; ix<=nMaxCellX; ix++)
+    {
+        // Cells of one column are contiguous, scan them as a single range
+        const size_t kBegin = mvCellStart[ix*mnRows + nMinCellY];
+        const size_t kEnd = mvCellStart[ix*mnRows + nMaxCellY + 1];
+
+        for(size_t k=kBegin; k<kEnd; k++)
+        {
+            const int octave = mvOctave[k];
+            if(octave<lo || octave>hi)
+                continue;
+
+            if(std::fabs(mvX[k]-x)<r && std::fabs(mvY[k]-y)<r)
+                visit(mvIndices[k]);
+        }
+    }
+}
+
+} // namespace ORB_SLAM3
+
+#endif // FEATUREGRID_H
@@ -21,6 +21,7 @@
 #define FRAME_H
 
 #include<vector>
+#include<memory>
 
 #include "Thirdparty/FBOW/include/fbow/fbow.h"
 
@@ -32,6 +33,7 @@
 #include "Converter.h"
 #include "Settings.h"
 
+#include <functional>
 #include <mutex>
 #include <opencv2/opencv.hpp>
 
@@ -39,7 +41,9 @@
 #include "sophus/se3.hpp"
 
 #include "FeatureExtractors.h"
+#include "FeatureGrid.h"
 #include "utils/FeatureExtractorTypes.h"
+#include "utils/DedicatedWorker.h"
 
 namespace ORB_SLAM3
 {
@@ -52,23 +56,82 @@ class ConstraintPoseImu;
 class GeometricCamera;
 class FeatureExtractor;
 
+// Long-lived threads running the left and right extraction of stereo frames, owned by Tracking.
+// Each one always drives the same extractor, so its buffers stay in the worker's caches.
+struct StereoExtractorWorkers
+{
+    StereoExtractorWorkers(int leftCpu, int rightCpu)
+        : left(leftCpu, "ORB-extract-L"), right(rightCpu, "ORB-extract-R") {}
+
+    DedicatedWorker left;
+    DedicatedWorker right;
+};
+
+// Features of a frame: keypoints, descriptors, stereo correspondences, grids and BoW.
+// Filled once by the Frame constructors and shared, never copied, by every copy of the frame
+// (last frame, initial frame, drawer snapshot...). Only the BoW is written afterwards, by ComputeBoW.
+struct FrameFeatures
+{
+    // Vector of keypoints (original for visualization) and undistorted (actually used by the system).
+    // In the stereo case, mvKeysUn is redundant as images must be rectified.
+    // In the RGB-D case, RGB images can be distorted.
+    std::vector<cv::KeyPoint> mvKeys, mvKeysRight;
+    std::vector<cv::KeyPoint> mvKeysUn;
+
+    // Corresponding stereo coordinate and depth for each keypoint.
+    // "Monocular" keypoints have a negative value.
+    std::vector<float> mvuRight;
+    std::vector<float> mvDepth;
+
+    // Bag of Words Vector structures.
+    fbow::BoWVector mBowVec;
+    fbow::BoWFeatVector mFeatVec;
+
+    // ORB descriptor, each row associated to a keypoint.
+    cv::Mat mDescriptors, mDescriptorsRight;
+
+    // Keypoints are assigned to cells in a grid to reduce matching complexity when projecting MapPoints.
+    FeatureGrid mGrid;
+    //Grid for the right image
+    FeatureGrid mGridRight;
+
+    //For stereo matching
+    std::vector<int> mvLeftToRightMatch, mvRightToLeftMatch;
+
+    //Triangulated stereo observations using as reference the left camera. These are
+    //computed during ComputeStereoFishEyeMatches
+    std::vector<Eigen::Vector3f> mvStereo3Dpoints;
+};
+
+// BoW of a frame computed ahead of tracking, by BowPipelinedProcess, from the descriptors of a ResultQueueItem
+struct PrecomputedBoW
+{
+    fbow::BoWVector mBowVec;
+    fbow::BoWFeatVector mFeatVec;
+};
+
 class Frame
 {
 public:
     Frame();
 
-    // Copy constructor.
+    // Copy constructor. The features are shared with frame, only the tracking state is copied.
     Frame(const Frame &frame);
 
+    Frame(Frame &&frame) = default;
+    Frame& operator=(const Frame &frame) = default;
+    Frame& operator=(Frame &&frame) = default;
+
     // Constructor for stereo cameras.
-    Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera,Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib());
+    Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera,Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib(), StereoExtractorWorkers* pWorkers = nullptr);
 
     // Constructor for RGB-D cameras.
     Frame(const cv::Mat &imGray, const cv::Mat &imDepth, const double &timeStamp, FeatureExtractor* extractor,ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera,Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib());
 
     // Constructor for Monocular cameras.
     Frame(const cv::Mat &imGray, const double &timeStamp, FeatureExtractor* extractor,ORBVocabulary* voc, GeometricCamera* pCamera, cv::Mat &distCoef, const float &bf, const float &thDepth, Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib());
-    Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabulary* voc, GeometricCamera* pCamera, cv::Mat &distCoef, const float &bf, const float &thDepth, Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib());
+    // Pipelined monocular constructor. If pBoW is given, its vectors are adopted and ComputeBoW has nothing left to do.
+    Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabulary* voc, GeometricCamera* pCamera, cv::Mat &distCoef, const float &bf, const float &thDepth, Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib(), PrecomputedBoW* pBoW = nullptr);
 
     // Todo: Overload  a constructor  to accept keypoints and descriptors with the image for monocular cameras.
     // Destructor
@@ -77,6 +140,12 @@ public:
     // Extract ORB on the image. 0 for left image and 1 for right image.
     void ExtractORB(int flag, const cv::Mat &im, const int x0, const int x1);
 
+    // Extract both images of a stereo pair, on pWorkers when given or on two temporary threads otherwise.
+    // afterLeft runs on the calling thread as soon as the left image is done, overlapping the right extraction.
+    void ExtractStereoORB(const cv::Mat &imLeft, const cv::Mat &imRight, const int x0Left, const int x1Left,
+                          const int x0Right, const int x1Right, StereoExtractorWorkers* pWorkers,
+                          const std::function<void()> &afterLeft = std::function<void()>());
+
     // Compute Bag of Words representation.
     void ComputeBoW();
 
@@ -115,9 +184,20 @@ public:
 
     std::vector<size_t> GetFeaturesInArea(const float &x, const float  &y, const float  &r, const int minLevel=-1, const int maxLevel=-1, const bool bRight = false) const;
 
+    // Allocation-free variant: writes the indices into a caller-provided scratch buffer and returns their number
+    size_t GetFeaturesInArea(std::vector<size_t> &vIndices, const float &x, const float  &y, const float  &r, const int minLevel=-1, const int maxLevel=-1, const bool bRight = false) const;
+
+    // Calls visit(idx) for every feature in the area, without building a list of indices
+    template<typename Visitor>
+    void ForEachFeatureInArea(const float &x, const float  &y, const float  &r, const int minLevel, const int maxLevel, const bool bRight, Visitor &&visit) const
+    {
+        (!bRight ? mpFeatures->mGrid : mpFeatures->mGridRight).ForEachInArea(x, y, r, minLevel, maxLevel, std::forward<Visitor>(visit));
+    }
+
     // Search a match for each keypoint in the left image to a keypoint in the right image.
     // If there is a match, depth is computed and the right coordinate associated to the left keypoint is stored.
-    void ComputeStereoMatches();
+    // With pWorkers the left keypoints are split between the calling thread and the two extraction workers.
+    void ComputeStereoMatches(StereoExtractorWorkers* pWorkers = nullptr);
 
     // Associate a "right" coordinate to a keypoint if there is valid depth in the depthmap.
     void ComputeStereoFromRGBD(const cv::Mat &imDepth);
@@ -229,28 +309,12 @@ public:
     // Number of KeyPoints.
     int N;
 
-    // Vector of keypoints (original for visualization) and undistorted (actually used by the system).
-    // In the stereo case, mvKeysUn is redundant as images must be rectified.
-    // In the RGB-D case, RGB images can be distorted.
-    std::vector<cv::KeyPoint> mvKeys, mvKeysRight;
-    std::vector<cv::KeyPoint> mvKeysUn;
+    // Keypoints, descriptors, stereo and grid of the frame, shared between its copies.
+    std::shared_ptr<FrameFeatures> mpFeatures;
 
-    // Corresponding stereo coordinate and depth for each keypoint.
+    // MapPoints associated to keypoints, NULL pointer if no association.
     std::vector<MapPoint*> mvpMapPoints;
-    // "Monocular" keypoints have a negative value.
-    std::vector<float> mvuRight;
-    std::vector<float> mvDepth;
 
-    // Bag of Words Vector structures.
-    // DBoW2::BowVector mBowVec;
-    // DBoW2::FeatureVector mFeatVec;
-    fbow::BoWVector mBowVec;
-    fbow::BoWFeatVector mFeatVec;
-
-    // ORB descriptor, each row associated to a keypoint.
-    cv::Mat mDescriptors, mDescriptorsRight;
-
-    // MapPoints associated to keypoints, NULL pointer if no association.
     // Flag to identify outlier associations.
     std::vector<bool> mvbOutlier;
     int mnCloseMPs;
@@ -258,7 +322,6 @@ public:
     // Keypoints are assigned to cells in a grid to reduce matching complexity when projecting MapPoints.
     static float mfGridElementWidthInv;
     static float mfGridElementHeightInv;
-    std::vector<std::size_t> mGrid[FRAME_GRID_COLS][FRAME_GRID_ROWS];
 
     IMU::Bias mPredBias;
 
@@ -339,20 +402,10 @@ public:
     //Number of Non Lapping Keypoints
     int monoLeft, monoRight;
 
-    //For stereo matching
-    std::vector<int> mvLeftToRightMatch, mvRightToLeftMatch;
-
     //For stereo fisheye matching
     static cv::BFMatcher BFmatcher;
 
-    //Triangulated stereo observations using as reference the left camera. These are
-    //computed during ComputeStereoFishEyeMatches
-    std::vector<Eigen::Vector3f> mvStereo3Dpoints;
-
-    //Grid for the right image
-    std::vector<std::size_t> mGridRight[FRAME_GRID_COLS][FRAME_GRID_ROWS];
-
-    Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera, GeometricCamera* pCamera2, Sophus::SE3f& Tlr,Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib());
+    Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera, GeometricCamera* pCamera2, Sophus::SE3f& Tlr,Frame* pPrevF = static_cast<Frame*>(NULL), const IMU::Calib &ImuCalib = IMU::Calib(), StereoExtractorWorkers* pWorkers = nullptr);
 
     //Stereo fisheye
     void ComputeStereoFishEyeMatches();
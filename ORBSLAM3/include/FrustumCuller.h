@@ -0,0 +1,86 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* FrustumCuller.h - Data-parallel visibility test of the local map points against a frame
+*
+* The position, normal and distance bounds of every candidate point are copied once, under a single
+* lock per point, into structure-of-arrays buffers. The frustum test, the projection and the predicted
+* scale then run over those buffers in tight loops (vectorized for pinhole cameras), split across a
+* thread pool, and the results are written back to the points on the calling thread.
+*/
+
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ORB_SLAM3
+{
+
+class Frame;
+class MapPoint;
+class GeometricCamera;
+class ThreadPool;
+
+class FrustumCuller
+{
+public:
+    FrustumCuller() {}
+
+    // Same test and side effects as calling F.isInFrustum(pMP, viewingCosLimit) for every point of vpMapPoints
+    // that is not bad and was not seen by F yet (mnLastFrameSeen). Points found in view are counted as visible
+    // and their left projection is stored in F.mmProjectPoints. Returns the number of points in view.
+    int Run(Frame &F, const std::vector<MapPoint*> &vpMapPoints, const float viewingCosLimit, ThreadPool* pPool = nullptr);
+
+private:
+    // Pose of one camera of the frame and its projection
+    struct View
+    {
+        Eigen::Matrix3f Rcw;
+        Eigen::Vector3f tcw;
+        Eigen::Vector3f Ow;
+        GeometricCamera* pCamera;
+        bool bPinhole;
+        float fx, fy, cx, cy;
+    };
+
+    // Results of the test of every point against one view
+    struct ViewResult
+    {
+        // PROJECTED: in front of the camera and inside the image. IN_VIEW: every check passed.
+        std::vector<uint8_t> vFlags;
+        std::vector<float> vU, vV, vInvZ, vDepth, vViewCos;
+        std::vector<int> vLevel;
+
+        void resize(size_t n);
+    };
+
+    static const uint8_t PROJECTED = 1;
+    static const uint8_t IN_VIEW = 2;
+
+    // Snapshot the points [begin,end) and test them against the views
+    void ProcessRange(const Frame &F, const std::vector<MapPoint*> &vpMapPoints, const float viewingCosLimit,
+                      const size_t begin, const size_t end);
+
+    template<typename Projection>
+    void TestRange(const Frame &F, const View &view, const Projection &project, const float viewingCosLimit,
+                   const size_t begin, const size_t end, ViewResult &res) const;
+
+    View mLeft, mRight;
+    bool mbStereoFishEye = false;
+
+    // Snapshot of the candidate points (SoA). mvValid is 0 for points that are skipped.
+    std::vector<uint8_t> mvValid;
+    std::vector<float> mvX, mvY, mvZ;
+    std::vector<float> mvNx, mvNy, mvNz;
+    std::vector<float> mvMinDist, mvMaxDist;
+
+    ViewResult mResLeft, mResRight;
+};
+
+} // namespace ORB_SLAM3
+
+#endif // FRUSTUMCULLER_H
@@ -33,7 +33,10 @@
 
 #include "GeometricCamera.h"
 #include "SerializationUtils.h"
+#include "utils/SeqLock.h"
+#include "utils/SlabPool.h"
 
+#include <atomic>
 #include <mutex>
 
 #include <boost/serialization/base_object.hpp>
@@ -195,7 +198,11 @@ class KeyFrame
     }
 
 public:
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    // Allocated from a slab pool shared by all maps (16-byte aligned, as EIGEN_MAKE_ALIGNED_OPERATOR_NEW was)
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p);
+    static void operator delete(void* p, std::size_t size);
+
     KeyFrame();
     KeyFrame(Frame &F, Map* pMap, KeyFrameDatabase* pKFDB);
 
@@ -261,13 +268,19 @@ public:
     void EraseMapPointMatch(const int &idx);
     void EraseMapPointMatch(MapPoint* pMP);
     void ReplaceMapPointMatch(const int &idx, MapPoint* pMP);
+    // Erase the match at idx only if it is still pMP (used when pMP turned bad)
+    void ReleaseMapPointMatch(const size_t &idx, MapPoint* pMP);
     std::set<MapPoint*> GetMapPoints();
     std::vector<MapPoint*> GetMapPointMatches();
+    // Same, copying into a caller-provided buffer so no allocation is needed in the steady state
+    void GetMapPointMatches(std::vector<MapPoint*> &vpMapPoints);
     int TrackedMapPoints(const int &minObs);
     MapPoint* GetMapPoint(const size_t &idx);
 
     // KeyPoint functions
     std::vector<size_t> GetFeaturesInArea(const float &x, const float  &y, const float  &r, const bool bRight = false) const;
+    // Allocation-free variant: writes the indices into a caller-provided scratch buffer and returns their number
+    size_t GetFeaturesInArea(std::vector<size_t> &vIndices, const float &x, const float  &y, const float  &r, const bool bRight = false) const;
     bool UnprojectStereo(int i, Eigen::Vector3f &x3D);
 
     // Image
@@ -322,6 +335,8 @@ public:
 
     static long unsigned int nNextId;
     long unsigned int mnId;
+    // Dense index in the map holding the keyframe (a hint for DenseMap), -1 before it is added
+    std::atomic<int> mnMapIndex{-1};
     const long unsigned int mnFrameId;
 
     const double mTimeStamp;
@@ -334,11 +349,16 @@ public:
 
     // Variables used by the tracking
     long unsigned int mnTrackReferenceForFrame;
+    // Votes of the current frame's map points for this keyframe, valid while mnLocalMapEpoch matches the tracker's
+    long unsigned int mnLocalMapEpoch;
+    int mnLocalMapVotes;
     long unsigned int mnFuseTargetForKF;
 
     // Variables used by the local mapping
     long unsigned int mnBALocalForKF;
     long unsigned int mnBAFixedForKF;
+    // Tracer::NowNs() when the keyframe was queued for local mapping
+    uint64_t mnMappingQueuedNs;
 
     //Number of optimizations by BA(amount of iterations in BA)
     long unsigned int mnNumberOfOpt;
@@ -446,6 +466,14 @@ protected:
     Sophus::SE3<float> mTwc;
     Eigen::Matrix3f mRwc;
 
+    // Copy of mTcw/mTwc (Sophus parameters: quaternion x,y,z,w then translation) for the lock-free pose getters
+    struct PoseSnapshot
+    {
+        float Tcw[7] = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f};
+        float Twc[7] = {0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f};
+    };
+    SeqLock<PoseSnapshot> mPoseSnapshot;
+
     // IMU position
     Eigen::Vector3f mOwb;
     // Velocity (Only used for inertial SLAM)
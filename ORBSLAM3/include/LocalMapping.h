@@ -26,7 +26,10 @@
 #include "Tracking.h"
 #include "KeyFrameDatabase.h"
 #include "Settings.h"
+#include "utils/StateSignal.h"
+#include "utils/ThreadPool.h"
 
+#include <memory>
 #include <mutex>
 
 
@@ -48,6 +51,9 @@ public:
 
     void SetTracker(Tracking* pTracker);
 
+    // Threads triangulating new map points and fusing duplicates, the mapping thread included. Call before Run.
+    void SetThreads(int nThreads);
+
     // Main function
     void Run();
 
@@ -61,6 +67,8 @@ public:
     bool Stop();
     void Release();
     bool isStopped();
+    // Blocks until the mapping thread has stopped (or finished) after RequestStop
+    void WaitUntilStopped();
     bool stopRequested();
     bool AcceptKeyFrames();
     void SetAcceptKeyFrames(bool flag);
@@ -135,6 +143,19 @@ protected:
     void ProcessNewKeyFrame();
     void CreateNewMapPoints();
 
+    // A match with a neighbor keyframe that passed the triangulation checks
+    struct TriangulatedPoint
+    {
+        Eigen::Vector3f x3D;
+        int idx1, idx2; // keypoint in the current keyframe and in the neighbor
+    };
+    // Matches and triangulates against one neighbor; only reads the keyframes
+    void TriangulateWithNeighbor(KeyFrame* pKF2, const bool bCoarse, std::vector<TriangulatedPoint> &vPoints);
+    // Creates the map points of one neighbor's triangulations, under the map update lock
+    void CreateTriangulatedPoints(KeyFrame* pKF2, const std::vector<TriangulatedPoint> &vPoints);
+    // Workers for the triangulation and the fusion searches, null when both run on the mapping thread only
+    std::unique_ptr<ThreadPool> mpMappingPool;
+
     void MapPointCulling();
     void SearchInNeighbors();
     void KeyFrameCulling();
@@ -179,6 +200,11 @@ protected:
     bool mbAcceptKeyFrames;
     std::mutex mMutexAccept;
 
+    // Notified on every change of the queue, stop, reset and finish state above, so neither the mapping
+    // thread nor the threads waiting on it sleep through a hand-off
+    StateSignal mStateSignal;
+    bool HasWork();
+
     void InitializeIMU(float priorG = 1e2, float priorA = 1e6, bool bFirst = false);
     void ScaleRefinement();
 
@@ -27,6 +27,7 @@
 #include "Tracking.h"
 
 #include "KeyFrameDatabase.h"
+#include "utils/StateSignal.h"
 
 #include <boost/algorithm/string.hpp>
 #include <thread>
@@ -168,6 +169,10 @@ protected:
 
     std::mutex mMutexLoopQueue;
 
+    // Notified when a keyframe is queued and on reset and finish requests
+    StateSignal mStateSignal;
+    bool HasWork();
+
     // Loop detector parameters
     float mnCovisibilityConsistencyTh;
 
@@ -22,6 +22,7 @@
 
 #include "MapPoint.h"
 #include "KeyFrame.h"
+#include "utils/SlabPool.h"
 
 #include <set>
 #include <pangolin/pangolin.h>
@@ -76,6 +77,8 @@ public:
     void AddKeyFrame(KeyFrame* pKF);
     void AddMapPoint(MapPoint* pMP);
     void EraseMapPoint(MapPoint* pMP);
+    // Drop the points about to be freed (MapPoint::ReclaimRetired), and the bad reference points
+    void EraseRetiredMapPoints(const std::vector<MapPoint*> &vpMPs);
     void EraseKeyFrame(KeyFrame* pKF);
     void SetReferenceMapPoints(const std::vector<MapPoint*> &vpMPs);
     void InformNewBigChange();
@@ -162,6 +165,10 @@ protected:
     std::set<MapPoint*> mspMapPoints;
     std::set<KeyFrame*> mspKeyFrames;
 
+    // Dense indices of the members of the sets above
+    DenseIndex<MapPoint> mMapPointIndex;
+    DenseIndex<KeyFrame> mKeyFrameIndex;
+
     // Save/load, the set structure is broken in libboost 1.58 for ubuntu 16.04, a vector is serializated
     std::vector<MapPoint*> mvpBackupMapPoints;
     std::vector<KeyFrame*> mvpBackupKeyFrames;
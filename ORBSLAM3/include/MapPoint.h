@@ -26,9 +26,16 @@
 #include "Converter.h"
 
 #include "SerializationUtils.h"
+#include "utils/Quiescence.h"
+#include "utils/SeqLock.h"
+#include "utils/SlabPool.h"
 
 #include <opencv2/core/core.hpp>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/array.hpp>
@@ -40,6 +47,7 @@ namespace ORB_SLAM3
 class KeyFrame;
 class Map;
 class Frame;
+class ThreadPool;
 
 class MapPoint
 {
@@ -104,7 +112,11 @@ class MapPoint
 
 
 public:
-    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    // Allocated from a slab pool shared by all maps (16-byte aligned, as EIGEN_MAKE_ALIGNED_OPERATOR_NEW was)
+    static void* operator new(std::size_t size);
+    static void operator delete(void* p);
+    static void operator delete(void* p, std::size_t size);
+
     MapPoint();
 
     MapPoint(const Eigen::Vector3f &Pos, KeyFrame* pRefKF, Map* pMap);
@@ -122,6 +134,16 @@ public:
     std::map<KeyFrame*,std::tuple<int,int>> GetObservations();
     int Observations();
 
+    // Call visit(pKF, indexes) for every observation while holding the feature lock, without copying them.
+    // visit must be short and must not call back into this MapPoint.
+    template<typename Visitor>
+    void ForEachObservation(Visitor &&visit)
+    {
+        std::unique_lock<std::mutex> lock(mMutexFeatures);
+        for(const std::pair<KeyFrame* const, std::tuple<int,int>> &obs : mObservations)
+            visit(obs.first, obs.second);
+    }
+
     void AddObservation(KeyFrame* pKF,int idx);
     void EraseObservation(KeyFrame* pKF);
 
@@ -134,6 +156,17 @@ public:
     void Replace(MapPoint* pMP);    
     MapPoint* GetReplaced();
 
+    // Record that pKF keeps the point at idx without observing it, so the slot is released before the point is
+    // freed. Returns false if the point is already bad, and then pKF must not keep it.
+    bool AddHolder(KeyFrame* pKF, int idx);
+
+    // Threads keeping map point pointers beyond the shared structures (Tracking, LocalMapping, LoopClosing,
+    // global BA, Viewer) take part in this domain and quiesce regularly
+    static QuiescenceDomain& Reclamation();
+    // Unlink the bad points every participant has dropped and free the ones that are no longer reachable.
+    // Returns the number of points freed.
+    static size_t ReclaimRetired(const std::vector<Map*> &vpMaps);
+
     void IncreaseVisible(int n=1);
     void IncreaseFound(int n=1);
     float GetFoundRatio();
@@ -141,14 +174,21 @@ public:
         return mnFound;
     }
 
+    // Pick the observed descriptor with the least median (binary) or summed (float) distance to the others.
+    // Distances between observed descriptors are cached, so an update only measures the observations added
+    // since the previous one. Deferred while a DescriptorUpdateBatch is open on the calling thread.
     void ComputeDistinctiveDescriptors();
 
     cv::Mat GetDescriptor();
+    // Copy the descriptor into a caller-owned matrix, reusing its storage
+    void GetDescriptor(cv::Mat &descriptor);
 
     void UpdateNormalAndDepth();
 
     float GetMinDistanceInvariance();
     float GetMaxDistanceInvariance();
+    // Position, normal and raw distance bounds (without the 0.8/1.2 factors) under a single lock
+    void GetFrustumData(Eigen::Vector3f &pos, Eigen::Vector3f &normal, float &minDistance, float &maxDistance);
     int PredictScale(const float &currentDist, KeyFrame*pKF);
     int PredictScale(const float &currentDist, Frame* pF);
 
@@ -163,6 +203,8 @@ public:
 public:
     long unsigned int mnId;
     static long unsigned int nNextId;
+    // Dense index in the map holding the point (a hint for DenseMap), -1 before it is added
+    std::atomic<int> mnMapIndex{-1};
     long int mnFirstKFid;
     long int mnFirstFrame;
     int nObs;
@@ -232,7 +274,7 @@ protected:
      int mnVisible;
      int mnFound;
 
-     // Bad flag (we do not currently erase MapPoint from memory)
+     // Bad flag. Bad points are freed by ReclaimRetired once no thread can reach them anymore.
      bool mbBad;
      MapPoint* mpReplaced;
      // For save relation without pointer, this is necessary for save/load function
@@ -244,11 +286,82 @@ protected:
 
      Map* mpMap;
 
+     // Keyframe slots holding the point without an observation (copied from a frame, or kept by a keyframe
+     // after the observation was erased), released when the point is reclaimed
+     std::vector<std::pair<KeyFrame*,int>> mvHolders;
+     bool mbRetired = false;
+
      // Mutex
      std::mutex mMutexPos;
      std::mutex mMutexFeatures;
      std::mutex mMutexMap;
 
+private:
+     friend class DescriptorUpdateBatch;
+
+     void UpdateDistinctiveDescriptor();
+     void ReleaseDescriptorCache();
+
+     // Queue the point for reclamation, once. Called when it turns bad.
+     void Retire();
+
+     // Republish the snapshots below; called by every writer, under mMutexPos and mMutexFeatures respectively
+     void PublishGeometry();
+     void PublishDescriptor();
+
+     // Copies of the read-mostly fields for lock-free readers (Tracking, matchers, viewer). The mutex-guarded
+     // fields stay authoritative for the writers (LocalMapping, LoopClosing, Optimizer).
+     struct GeometrySnapshot
+     {
+         float pos[3];
+         float normal[3];
+         float minDistance;
+         float maxDistance;
+     };
+     SeqLock<GeometrySnapshot> mGeometry;
+     std::atomic<bool> mbBadSnapshot{false};
+
+     struct DescriptorSnapshot
+     {
+         DescriptorSnapshot(int nCols, int nType, size_t bytes) : cols(nCols), type(nType), data(bytes) {}
+         const int cols;
+         const int type;
+         SeqLockBuffer data;
+     };
+     // Replaced only if the descriptor shape changes; older snapshots live as long as the point for late readers
+     std::atomic<const DescriptorSnapshot*> mpDescriptorSnapshot{nullptr};
+     std::vector<std::unique_ptr<DescriptorSnapshot>> mvpDescriptorSnapshots;
+
+     // Observed descriptors (keyframe, keypoint index, row) and their pairwise distances, maintained
+     // incrementally by ComputeDistinctiveDescriptors. Rows of mvDescriptorDist and mvDescriptorDistSum
+     // follow mvDescriptorKeys; entries are swap-removed.
+     std::vector<std::pair<KeyFrame*,int>> mvDescriptorKeys;
+     std::vector<cv::Mat> mvDescriptorRows;
+     std::vector<std::vector<float>> mvDescriptorDist;
+     std::vector<double> mvDescriptorDistSum;
+     std::mutex mMutexDescriptorCache;
+
+};
+
+// Defers the ComputeDistinctiveDescriptors calls made on the constructing thread and runs them once per
+// point on Flush() or destruction, for stages (fusion) that touch the same points many times
+class DescriptorUpdateBatch
+{
+public:
+    DescriptorUpdateBatch();
+    ~DescriptorUpdateBatch();
+
+    DescriptorUpdateBatch(const DescriptorUpdateBatch&) = delete;
+    DescriptorUpdateBatch& operator=(const DescriptorUpdateBatch&) = delete;
+
+    // With a pool, the points are split across its workers and the calling thread
+    void Flush(ThreadPool* pPool = nullptr);
+
+private:
+    friend class MapPoint;
+
+    std::vector<MapPoint*> mvpPending;
+    DescriptorUpdateBatch* mpPrevious;
 };
 
 } //namespace ORB_SLAM
@@ -20,15 +20,18 @@
 #ifndef ORBMATCHER_H
 #define ORBMATCHER_H
 
+#include<utility>
 #include<vector>
 #include<opencv2/core/core.hpp>
 #include<opencv2/features2d/features2d.hpp>
 #include"sophus/sim3.hpp"
 #include "MatchVisualizer.h"
+#include "DescriptorDistance.h"
 
 
 #include"MapPoint.h"
 #include"KeyFrame.h"
+#include "utils/SlabPool.h"
 #include"Frame.h"
 #include "System.h"
 
@@ -36,15 +39,21 @@
 namespace ORB_SLAM3
 {
 
+    // The searches reuse per-instance scratch buffers (mBatch, mQueryDescriptor, mvAreaIndices, mAlreadyFound), so an
+    // instance must not be used by several threads at once. Concurrent searches each create their own matcher.
     class ORBmatcher
     {
     public:
 
         ORBmatcher(float nnratio=0.6, bool checkOri=true);
 
-        // Computes the Hamming distance between two ORB descriptors
+        // Computes the distance between two descriptors (Hamming for binary, scaled L2 for float)
         static float DescriptorDistance(const cv::Mat &a, const cv::Mat &b);
 
+        // Select the descriptor metric used by DescriptorDistance. Called once when the extractor is created.
+        static void SetDescriptorMetric(const DescriptorMetric &metric);
+        static const DescriptorMetric& GetDescriptorMetric();
+
         // Search matches between Frame keypoints and projected MapPoints. Returns number of matches
         // Used to track the local map (Tracking)
         int SearchByProjection(Frame &F, const std::vector<MapPoint*> &vpMapPoints, const float th=3, const bool bFarPoints = false, const float thFarPoints = 50.0f);
@@ -86,6 +95,13 @@ namespace ORB_SLAM3
         // Project MapPoints into KeyFrame and search for duplicated MapPoints.
         int Fuse(KeyFrame* pKF, const std::vector<MapPoint *> &vpMapPoints, const float th=3.0, const bool bRight = false);
 
+        // The two phases of Fuse. SearchFuse only reads the keyframe and the points, so the searches into several
+        // keyframes can run concurrently; it returns the (MapPoint, keypoint index) matches. ApplyFuse then replaces
+        // or adds them, skipping the points changed by the matches applied before; call it from a single thread.
+        int SearchFuse(KeyFrame* pKF, const std::vector<MapPoint *> &vpMapPoints, std::vector<std::pair<MapPoint*, int> > &vMatches,
+                       const float th=3.0, const bool bRight = false);
+        static int ApplyFuse(KeyFrame* pKF, const std::vector<std::pair<MapPoint*, int> > &vMatches);
+
         // Project MapPoints into KeyFrame using a given Sim3 and search for duplicated MapPoints.
         int Fuse(KeyFrame* pKF, Sophus::Sim3f &Scw, const std::vector<MapPoint*> &vpPoints, float th, std::vector<MapPoint *> &vpReplacePoint);
 
@@ -102,6 +118,18 @@ namespace ORB_SLAM3
         EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
     protected:
+        static DescriptorMetric msDescriptorMetric;
+
+        // Scratch buffers reused by the projection searches (one-to-many matching)
+        DescriptorBatch mBatch;
+        cv::Mat mQueryDescriptor;
+
+        // Scratch buffer for the grid queries (GetFeaturesInArea)
+        std::vector<size_t> mvAreaIndices;
+
+        // Scratch set of the points a keyframe already holds, for the searches and fusion by Sim3 projection
+        DenseMap<MapPoint,bool> mAlreadyFound;
+
         float RadiusByViewingCos(const float &viewCos);
 
         void ComputeThreeMaxima(std::vector<int>* histo, const int L, int &ind1, int &ind2, int &ind3);
@@ -11,7 +11,7 @@
 #include <atomic>
 #include <memory>
 #include <opencv2/core/core.hpp>
-#include "utils/ThreadSafeQueue.h"
+#include "utils/PipelineQueue.h"
 #include "../utils/FeatureExtractorTypes.h"
 
 namespace ORB_SLAM3
@@ -27,8 +27,8 @@ public:
      * @param outputQueue The queue to which processed results are written
      */
     BasePipelinedProcess(
-        ThreadSafeQueue<InputQueueItem>& inputQueue, 
-        ThreadSafeQueue<ResultQueueItem>& outputQueue)
+        PipelineQueue<InputQueueItem>& inputQueue, 
+        PipelineQueue<ResultQueueItem>& outputQueue)
         : mInputQueue(inputQueue), mOutputQueue(outputQueue), mbRunning(false)
     {}
 
@@ -85,8 +85,8 @@ protected:
     virtual ResultQueueItem ProcessItem(const InputQueueItem& input) = 0;
 
     // Input and output queues
-    ThreadSafeQueue<InputQueueItem>& mInputQueue;
-    ThreadSafeQueue<ResultQueueItem>& mOutputQueue;
+    PipelineQueue<InputQueueItem>& mInputQueue;
+    PipelineQueue<ResultQueueItem>& mOutputQueue;
 
     // Thread control
     std::thread mProcessThread;
@@ -0,0 +1,76 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* BowPipelinedProcess.h - Optional pipeline stage computing the BoW of the extracted features ahead of tracking
+*/
+
+#ifndef BOWPIPELINEDPROCESS_H
+#define BOWPIPELINEDPROCESS_H
+
+#include <thread>
+#include <atomic>
+#include "utils/PipelineQueue.h"
+#include "utils/FeatureExtractorTypes.h"
+#include "ORBVocabulary.h"
+#include "Frame.h"
+
+namespace ORB_SLAM3
+{
+
+// A result of the extraction stage together with the BoW of its descriptors
+struct BowResultQueueItem
+{
+    ResultQueueItem result;
+    PrecomputedBoW bow;
+};
+
+class BowPipelinedProcess
+{
+public:
+    /**
+     * Constructor for the BoW stage
+     * @param inputQueue Output queue of the extraction stage (ORBPipelinedProcess, DummyPipelinedProcess...)
+     * @param outputQueue The queue to which the results and their BoW are written, in input order
+     * @param voc Vocabulary of the SLAM system, see System::GetVocabulary
+     */
+    BowPipelinedProcess(
+        PipelineQueue<ResultQueueItem>& inputQueue,
+        PipelineQueue<BowResultQueueItem>& outputQueue,
+        ORBVocabulary* voc);
+
+    /**
+     * Stops the processing thread if it is still running
+     */
+    ~BowPipelinedProcess();
+
+    /**
+     * Start the processing thread
+     */
+    void StartProcessing();
+
+    /**
+     * Stop the processing thread
+     */
+    void Stop();
+
+    // Levels up from the leaves at which the feature vector is stored, as Frame::ComputeBoW and KeyFrame::ComputeBoW
+    static const int FEAT_VEC_LEVELS_UP = 4;
+
+private:
+    /**
+     * Dequeue results, compute their BoW and forward them until the input is exhausted
+     */
+    void Run();
+
+    PipelineQueue<ResultQueueItem>& mInputQueue;
+    PipelineQueue<BowResultQueueItem>& mOutputQueue;
+    ORBVocabulary* mpVocabulary;
+
+    // Thread control
+    std::thread mProcessThread;
+    std::atomic<bool> mbRunning;
+};
+
+} // namespace ORB_SLAM3
+
+#endif // BOWPIPELINEDPROCESS_H
@@ -3,6 +3,7 @@
 
 #include "BasePipelinedProcess.h"
 #include "../FeatureExtractors/Dummy/FeatureIO.h"
+#include "../FeatureExtractors/Dummy/FeatureCache.h"
 #include <string>
 
 namespace ORB_SLAM3
@@ -15,14 +16,15 @@ public:
      * Constructor for the dummy pipelined process
      * @param inputQueue The queue from which to read input items
      * @param outputQueue The queue to which processed results are written
-     * @param featuresDir The directory where precomputed features are stored
+     * @param featuresDir The directory where precomputed features are stored, or a packed feature cache file.
+     *                    A directory containing FeatureCache::DEFAULT_FILENAME is read through the cache.
      * @param extractorType The type of features to load (e.g., "SP" for SuperPoint)
      * @param descriptorType The descriptor type (CV_8U or CV_32F)
      * @param descriptorSize The size of the descriptor (256 for SuperPoint)
      */
     DummyPipelinedProcess(
-        ThreadSafeQueue<InputQueueItem>& inputQueue, 
-        ThreadSafeQueue<ResultQueueItem>& outputQueue,
+        PipelineQueue<InputQueueItem>& inputQueue, 
+        PipelineQueue<ResultQueueItem>& outputQueue,
         const std::string& featuresDir,
         const std::string& extractorType = "SP",
         int descriptorType = CV_32F,
@@ -67,6 +69,9 @@ private:
     
     // Directory containing precomputed features
     std::string mFeaturesDir;
+
+    // Packed features of the whole sequence, used instead of the per-image files when present
+    FeatureCache mFeatureCache;
     
     // Extractor configuration
     std::string mExtractorType;
@@ -9,13 +9,32 @@
 
 #include "BasePipelinedProcess.h"
 #include "../FeatureExtractors/ORBextractor.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
 
 namespace ORB_SLAM3
 {
 
 class ORBextractor;
 
+// Extractor configuration of the ORB pipelined process
+struct ORBPipelineParams
+{
+    int nFeatures = 1000;
+    float scaleFactor = 1.2f;
+    int nLevels = 8;
+    int iniThFAST = 20;
+    int minThFAST = 7;
+
+    // Extraction workers, each with its own ORBextractor
+    int nWorkers = 1;
+};
+
 class ORBPipelinedProcess : public BasePipelinedProcess
 {
 public:
@@ -23,10 +42,12 @@ public:
      * Constructor for the ORB pipelined process
      * @param inputQueue The queue from which to read input items
      * @param outputQueue The queue to which processed results are written
+     * @param params Extractor parameters and number of workers
      */
     ORBPipelinedProcess(
-        ThreadSafeQueue<InputQueueItem>& inputQueue, 
-        ThreadSafeQueue<ResultQueueItem>& outputQueue);
+        PipelineQueue<InputQueueItem>& inputQueue, 
+        PipelineQueue<ResultQueueItem>& outputQueue,
+        const ORBPipelineParams& params = ORBPipelineParams());
 
     /**
      * Destructor
@@ -35,7 +56,8 @@ public:
 
 protected:
     /**
-     * Main processing function that runs in a separate thread
+     * Main processing function that runs in a separate thread.
+     * With one worker it extracts the items itself; otherwise it starts the workers and hands them the items.
      */
     void Run() override;
 
@@ -47,10 +69,45 @@ protected:
     ResultQueueItem ProcessItem(const InputQueueItem& input) override;
 
 private:
-    // The ORB extractor instance
-    std::unique_ptr<ORBextractor> mpORBextractor;
+    /**
+     * Wait for the next input item
+     * @return False once processing is stopped or the input queue is shut down and drained
+     */
+    bool Receive(InputQueueItem& input);
+
+    /**
+     * Extract the items handed over by Run and pass the results to the reorder buffer until Run is done
+     * @param worker Index of the worker, selects its extractor
+     */
+    void WorkerLoop(int worker);
+
+    /**
+     * Extract features from an input item with the given extractor
+     */
+    ResultQueueItem ProcessItem(const InputQueueItem& input, ORBextractor& extractor);
+
+    /**
+     * Store a result and forward every result that is now in order to the output queue
+     * @param seq Position of the item in input order
+     */
+    void Emit(unsigned long seq, ResultQueueItem&& result);
+
+    // One ORB extractor per worker
+    std::vector<std::unique_ptr<ORBextractor>> mvpORBextractors;
+
+    // Items handed from Run, the only consumer of the input queue, to the workers. They are numbered as they are
+    // dequeued, so results can be put back in input order.
+    std::mutex mMutexDispatch;
+    std::condition_variable mCondDispatch;
+    std::deque<std::pair<unsigned long, InputQueueItem>> mDispatched;
+    bool mbDispatchDone;
+
+    // Finished results waiting for an earlier item
+    std::mutex mMutexReorder;
+    std::map<unsigned long, ResultQueueItem> mPendingResults;
+    unsigned long mnNextEmitted;
 };
 
 } // namespace ORB_SLAM3
 
-#endif // ORBPIPELINEDPROCESS_H
\ No newline at end of file
+#endif // ORBPIPELINEDPROCESS_H
@@ -15,6 +15,8 @@
 namespace ORB_SLAM3
 {
 
+class Settings;
+
 class PipelinedProcessFactory
 {
 public:
@@ -28,11 +30,27 @@ public:
      */
     static std::unique_ptr<BasePipelinedProcess> CreatePipelinedProcess(
         FeatureExtractorType type,
-        ThreadSafeQueue<InputQueueItem>& inputQueue,
-        ThreadSafeQueue<ResultQueueItem>& outputQueue,
+        PipelineQueue<InputQueueItem>& inputQueue,
+        PipelineQueue<ResultQueueItem>& outputQueue,
         const std::string& featureDir = "/mnt/sda1/FYP_2024/Ruchith/FYP_SLAM/datasets/feature_outputs/SP_H",
         const std::string& modelName = "/root/jupyter_notebooks/Fyp/FYP_SLAM/Thirdparty/super_point_vitis/compiled_SP_by_H.xmodel",
         int numThreads = 4);
+
+    /**
+     * Creates a pipelined process configured from the SLAM settings.
+     * ORB takes its extractor parameters and number of workers from the settings,
+     * the other types fall back to the defaults of the overload above.
+     * @param type Type of feature extractor to create
+     * @param inputQueue Input queue for the process
+     * @param outputQueue Output queue for the process
+     * @param settings Settings of the SLAM system, may be null
+     * @return A unique pointer to the created processor
+     */
+    static std::unique_ptr<BasePipelinedProcess> CreatePipelinedProcess(
+        FeatureExtractorType type,
+        PipelineQueue<InputQueueItem>& inputQueue,
+        PipelineQueue<ResultQueueItem>& outputQueue,
+        Settings* settings);
 };
 
 } // namespace ORB_SLAM3
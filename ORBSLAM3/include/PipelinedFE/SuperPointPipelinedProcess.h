@@ -26,8 +26,8 @@ public:
      * @param numThreads The number of processing threads to use
      */
     SuperPointPipelinedProcess(
-        ThreadSafeQueue<InputQueueItem>& inputQueue, 
-        ThreadSafeQueue<ResultQueueItem>& outputQueue,
+        PipelineQueue<InputQueueItem>& inputQueue, 
+        PipelineQueue<ResultQueueItem>& outputQueue,
         const std::string& modelName,
         int numThreads = 4);
     
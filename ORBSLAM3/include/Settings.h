@@ -20,11 +20,6 @@
 #define ORB_SLAM3_SETTINGS_H
 
 
-// Flag to activate the measurement of time in each process (track,localmap, place recognition).
-#ifndef REGISTER_TIMES
-#define REGISTER_TIMES
-#endif 
-
 #include "CameraModels/GeometricCamera.h"
 
 #include <unistd.h>
@@ -105,6 +100,11 @@ namespace ORB_SLAM3 {
         float initThFAST() {return initThFAST_;}
         float minThFAST() {return minThFAST_;}
         float scaleFactor() {return scaleFactor_;}
+        int extractorThreads() {return extractorThreads_;}
+        int pipelineWorkers() {return pipelineWorkers_;}
+        bool pipelineBoW() {return pipelineBoW_;}
+        int extractorCpuLeft() {return extractorCpuLeft_;}
+        int extractorCpuRight() {return extractorCpuRight_;}
 
         float keyFrameSize() {return keyFrameSize_;}
         float keyFrameLineWidth() {return keyFrameLineWidth_;}
@@ -121,7 +121,14 @@ namespace ORB_SLAM3 {
         std::string atlasLoadFile() {return sLoadFrom_;}
         std::string atlasSaveFile() {return sSaveto_;}
 
+        bool tracing() {return tracing_;}
+        std::string traceFile() {return traceFile_;}
+        float traceSummaryPeriod() {return traceSummaryPeriod_;}
+
         float thFarPoints() {return thFarPoints_;}
+        int bowThreads() {return bowThreads_;}
+        int trackingThreads() {return trackingThreads_;}
+        int mappingThreads() {return mappingThreads_;}
 
         cv::Mat M1l() {return M1l_;}
         cv::Mat M2l() {return M2l_;}
@@ -208,6 +215,9 @@ namespace ORB_SLAM3 {
          * Feature extractor stuff
         */
         std::string featureExtractorType_; // Feature extractor type (ORB, SIFT, etc.)
+        int pipelineWorkers_; // Extraction workers of the pipelined front end
+        bool pipelineBoW_; // BoW computed by a pipeline stage before tracking
+        int extractorCpuLeft_, extractorCpuRight_; // CPUs of the stereo extraction workers, -1 if unpinned
 
         float TH_LOW, TH_HIGH;
 
@@ -218,6 +228,7 @@ namespace ORB_SLAM3 {
         float scaleFactor_;
         int nLevels_;
         int initThFAST_, minThFAST_;
+        int extractorThreads_;
 
         /*
          * Viewer stuff
@@ -236,10 +247,20 @@ namespace ORB_SLAM3 {
          */
         std::string sLoadFrom_, sSaveto_;
 
+        /*
+         * Tracing
+         */
+        bool tracing_;
+        std::string traceFile_; // Chrome trace written at shutdown, none if empty
+        float traceSummaryPeriod_; // Seconds between span summaries while running, 0 for none
+
         /*
          * Other stuff
          */
         float thFarPoints_;
+        int bowThreads_; // Threads a single BoW transform may use
+        int trackingThreads_; // Threads for the local map frustum test and relocalization
+        int mappingThreads_; // Threads for the new map point triangulation and fusion
 
     };
 };
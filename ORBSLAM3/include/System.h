@@ -119,7 +119,8 @@ public:
     // Input images: RGB (CV_8UC3) or grayscale (CV_8U). RGB is converted to grayscale.
     // Returns the camera pose (empty if tracking fails).
     Sophus::SE3f TrackMonocular(const cv::Mat &im, const double &timestamp, const vector<IMU::Point>& vImuMeas = vector<IMU::Point>(), string filename="");
-    Sophus::SE3f TrackMonocular(const ResultQueueItem& Input);
+    // Pipelined version. pBoW, if given, is the BoW of Input computed by BowPipelinedProcess and is consumed.
+    Sophus::SE3f TrackMonocular(const ResultQueueItem& Input, PrecomputedBoW* pBoW = nullptr);
 
 
     // This stops local mapping thread (map building) and performs only camera tracking.
@@ -175,6 +176,7 @@ public:
     // Information from most recent processed frame
     // You can call this right after TrackMonocular (or stereo or RGBD)
     int GetTrackingState();
+    // The points are only guaranteed to be valid until the next call to Track*, bad points are freed afterwards
     std::vector<MapPoint*> GetTrackedMapPoints();
     std::vector<cv::KeyPoint> GetTrackedKeyPointsUn();
 
@@ -187,6 +189,9 @@ public:
 
     float GetImageScale();
 
+    // Vocabulary for pipelined stages that compute the BoW ahead of tracking
+    ORBVocabulary* GetVocabulary() { return mpVocabulary; }
+
     // Settings for the system
     Settings* settings_;
 
@@ -0,0 +1,100 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* Tracer.h - Low overhead tracing of scoped spans across the threads of the system
+*
+* Every thread that records a span gets its own ring buffer holding its last BUFFER_CAPACITY spans.
+* Recording is lock free and only touches the buffer of the calling thread; readers (summaries, the
+* Chrome trace export) copy the buffers concurrently and drop the entries overwritten while copying.
+* Spans carry the id of the frame or keyframe they worked on, so the pipelined front end, tracking,
+* local mapping and loop closing can be followed on a single timeline (chrome://tracing, Perfetto).
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace ORB_SLAM3
+{
+
+class Tracer
+{
+public:
+    static const size_t BUFFER_CAPACITY = 1 << 14;
+
+    // Duration statistics of the spans with one name
+    struct SpanStats
+    {
+        std::string name;
+        size_t count;
+        double meanMs, p50Ms, p90Ms, p99Ms, maxMs;
+    };
+
+    // Recording is enabled by default; disabled, a span costs one relaxed load
+    static void SetEnabled(bool bEnabled) { sbEnabled.store(bEnabled, std::memory_order_relaxed); }
+    static bool IsEnabled() { return sbEnabled.load(std::memory_order_relaxed); }
+
+    // Name of the calling thread in the exported trace
+    static void SetThreadName(const std::string &name);
+
+    // Nanoseconds on the steady clock since the tracer started
+    static uint64_t NowNs();
+
+    // Record a finished span of the calling thread. name must outlive the tracer (a string literal).
+    // id is the frame or keyframe the span worked on, -1 if none.
+    static void Record(const char* name, long id, uint64_t startNs, uint64_t endNs);
+
+    // Statistics per span name over the spans still buffered that ended at or after sinceNs, sorted by name
+    static std::vector<SpanStats> Summarize(uint64_t sinceNs = 0);
+    static void PrintSummary(std::ostream &out, uint64_t sinceNs = 0);
+
+    // Write every buffered span in the Chrome trace event format. Returns false if the file cannot be written.
+    static bool WriteChromeTrace(const std::string &filename);
+
+    // Print the summary of the last periodSeconds every periodSeconds, from a background thread
+    static void StartReporter(double periodSeconds);
+    static void StopReporter();
+
+private:
+    static std::atomic<bool> sbEnabled;
+};
+
+// Records the span from its construction to Stop() or its destruction on the calling thread
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, long id = -1)
+        : mName(name), mnId(id), mnStartNs(Tracer::IsEnabled() ? Tracer::NowNs() : 0), mbActive(Tracer::IsEnabled()) {}
+
+    ~TraceScope() { Stop(); }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    // For spans whose frame/keyframe is only known once they have started
+    void SetId(long id) { mnId = id; }
+
+    void Stop()
+    {
+        if(mbActive)
+        {
+            Tracer::Record(mName, mnId, mnStartNs, Tracer::NowNs());
+            mbActive = false;
+        }
+    }
+
+private:
+    const char* mName;
+    long mnId;
+    uint64_t mnStartNs;
+    bool mbActive;
+};
+
+} // namespace ORB_SLAM3
+
+#endif // TRACER_H
@@ -40,7 +40,10 @@
 #include "utils/FeatureExtractorTypes.h"
 #include "MatchVisualizer.h"
 #include "GeometricCamera.h"
+#include "FrustumCuller.h"
+#include "utils/ThreadPool.h"
 
+#include <memory>
 #include <mutex>
 #include <unordered_set>
 
@@ -74,7 +77,7 @@ public:
     Sophus::SE3f GrabImageStereo(const cv::Mat &imRectLeft,const cv::Mat &imRectRight, const double &timestamp, string filename);
     Sophus::SE3f GrabImageRGBD(const cv::Mat &imRGB,const cv::Mat &imD, const double &timestamp, string filename);
     Sophus::SE3f GrabImageMonocular(const cv::Mat &im, const double &timestamp, string filename);
-    Sophus::SE3f GrabImageMonocular(const ResultQueueItem& Input);
+    Sophus::SE3f GrabImageMonocular(const ResultQueueItem& Input, PrecomputedBoW* pBoW = nullptr);
 
     void GrabImuData(const IMU::Point &imuMeasurement);
 
@@ -235,7 +238,7 @@ protected:
     // Create appropriate feature extractor based on settings
     FeatureExtractor* CreateFeatureExtractor(
         int nFeatures, float scaleFactor, int nLevels, 
-        int iniThFAST, int minThFAST, const std::string& type);
+        int iniThFAST, int minThFAST, const std::string& type, int nThreads = 1);
 
     bool mbMapUpdated;
     
@@ -271,6 +274,8 @@ protected:
     //ORB
     FeatureExtractor* mpORBextractorLeft, *mpORBextractorRight;
     FeatureExtractor* mpIniORBextractor;
+    // Persistent threads extracting the left and right images of stereo frames
+    std::unique_ptr<StereoExtractorWorkers> mpStereoWorkers;
 
     //BoW
     ORBVocabulary* mpORBVocabulary;
@@ -284,6 +289,17 @@ protected:
     KeyFrame* mpReferenceKF;
     std::vector<KeyFrame*> mvpLocalKeyFrames;
     std::vector<MapPoint*> mvpLocalMapPoints;
+
+    // Local map construction: each call of UpdateLocalKeyFrames starts a new epoch, keyframes whose
+    // mnLocalMapEpoch differs have no votes yet. The buffers are scratch kept between frames.
+    long unsigned int mnLocalMapEpoch;
+    std::vector<KeyFrame*> mvpLocalMapVoted;
+    std::vector<MapPoint*> mvpLocalMapMatches;
+
+    // Frustum test of the local map points
+    FrustumCuller mFrustumCuller;
+    // Workers shared by the frustum test and relocalization when Tracking.nThreads > 1
+    std::unique_ptr<ThreadPool> mpTrackingPool;
     
     // System
     System* mpSystem;
@@ -348,6 +364,9 @@ protected:
 
     list<MapPoint*> mlpTemporalPoints;
 
+    // Participant id in MapPoint::Reclamation(); Tracking quiesces at the start of each frame
+    int mnQuiescenceId;
+
     //int nMapChangeIndex;
 
     int mnNumDataset;
@@ -0,0 +1,97 @@
+//utils/DedicatedWorker.h
+//Single long-lived thread that always runs the same kind of work, optionally pinned to one CPU.
+//Unlike ThreadPool, every task goes to the same thread, so whatever state the tasks touch (an extractor's
+//pyramid and keypoint buffers, for instance) stays warm in that core's caches from one call to the next.
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+
+namespace ORB_SLAM3 {
+
+class DedicatedWorker {
+public:
+    // cpu < 0 leaves the thread unpinned. name is shown by top/perf (truncated to 15 characters).
+    explicit DedicatedWorker(int cpu = -1, const std::string& name = std::string())
+        : mnCpu(cpu), mName(name)
+    {
+        mThread = std::thread(&DedicatedWorker::WorkerLoop, this);
+    }
+
+    ~DedicatedWorker()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mbStop = true;
+        }
+        mCond.notify_one();
+        if(mThread.joinable())
+            mThread.join();
+    }
+
+    DedicatedWorker(const DedicatedWorker&) = delete;
+    DedicatedWorker& operator=(const DedicatedWorker&) = delete;
+
+    int Cpu() const { return mnCpu; }
+
+    // Queue a task; tasks run one at a time in submission order.
+    // The returned future rethrows any exception the task raised.
+    std::future<void> Submit(std::function<void()> task)
+    {
+        std::packaged_task<void()> packaged(std::move(task));
+        std::future<void> result = packaged.get_future();
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTasks.push(std::move(packaged));
+        }
+        mCond.notify_one();
+        return result;
+    }
+
+private:
+    void WorkerLoop()
+    {
+        if(!mName.empty())
+            pthread_setname_np(pthread_self(), mName.substr(0, 15).c_str());
+
+        if(mnCpu >= 0)
+        {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(mnCpu, &cpuset);
+            if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) != 0)
+                std::cerr << "Could not pin worker " << mName << " to CPU " << mnCpu << ", running unpinned" << std::endl;
+        }
+
+        while(true)
+        {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCond.wait(lock, [this]() { return mbStop || !mTasks.empty(); });
+                if(mbStop && mTasks.empty())
+                    return;
+                task = std::move(mTasks.front());
+                mTasks.pop();
+            }
+            task();
+        }
+    }
+
+    const int mnCpu;
+    const std::string mName;
+    std::thread mThread;
+    std::queue<std::packaged_task<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    bool mbStop = false;
+};
+
+} // namespace ORB_SLAM3
@@ -0,0 +1,105 @@
+//utils/FramePool.h
+//Recycled image buffers for the frame pipeline.
+//A pooled cv::Mat is handed out by reference, so the producer, extractor and tracker all share
+//the same pixels. The buffer goes back to the pool when the last of them drops its header, which is
+//detected from the cv::Mat reference count (only the pool's own reference left).
+#pragma once
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+namespace ORB_SLAM3 {
+
+class FramePool {
+public:
+    explicit FramePool(size_t capacity) : mnCapacity(capacity)
+    {
+        mvBuffers.reserve(capacity);
+    }
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Buffer of the given size and type that nobody else references.
+    // When every pooled buffer is in use and the pool is full, a plain (unpooled) Mat is returned.
+    cv::Mat Acquire(const cv::Size& size, int type)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        for(cv::Mat& buffer : mvBuffers)
+        {
+            if(IsFree(buffer) && buffer.size() == size && buffer.type() == type)
+                return buffer;
+        }
+
+        // Replace a free buffer of the wrong geometry before growing the pool
+        for(cv::Mat& buffer : mvBuffers)
+        {
+            if(IsFree(buffer))
+            {
+                buffer = cv::Mat(size, type);
+                return buffer;
+            }
+        }
+
+        if(mvBuffers.size() < mnCapacity)
+        {
+            mvBuffers.push_back(cv::Mat(size, type));
+            return mvBuffers.back();
+        }
+
+        return cv::Mat(size, type);
+    }
+
+    // Equivalent of cv::imread that decodes into a pooled buffer and reuses the file read buffer.
+    // Returns an empty Mat if the file cannot be read or decoded.
+    cv::Mat Read(const std::string& filename, int flags = cv::IMREAD_COLOR)
+    {
+        std::unique_lock<std::mutex> lock(mMutexRead);
+
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if(!file.is_open())
+            return cv::Mat();
+        const std::streamsize nBytes = file.tellg();
+        if(nBytes <= 0)
+            return cv::Mat();
+        mvFileBytes.resize(static_cast<size_t>(nBytes));
+        file.seekg(0);
+        if(!file.read(reinterpret_cast<char*>(mvFileBytes.data()), nBytes))
+            return cv::Mat();
+
+        // imdecode reuses dst when its geometry matches, so guess from the previous frame
+        cv::Mat image;
+        if(mLastSize.area() > 0)
+            image = Acquire(mLastSize, mnLastType);
+        cv::imdecode(mvFileBytes, flags, &image);
+        if(image.empty())
+            return cv::Mat();
+
+        mLastSize = image.size();
+        mnLastType = image.type();
+        return image;
+    }
+
+    size_t Capacity() const { return mnCapacity; }
+
+private:
+    // The count is changed by other threads releasing their headers, so it is read atomically
+    static bool IsFree(const cv::Mat& buffer)
+    {
+        return buffer.u && CV_XADD(&buffer.u->refcount, 0) == 1;
+    }
+
+    const size_t mnCapacity;
+    std::vector<cv::Mat> mvBuffers;
+    std::mutex mMutex;
+
+    std::mutex mMutexRead;
+    std::vector<uchar> mvFileBytes;
+    cv::Size mLastSize;
+    int mnLastType = 0;
+};
+
+} // namespace ORB_SLAM3
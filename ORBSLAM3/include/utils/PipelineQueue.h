@@ -0,0 +1,26 @@
+//utils/PipelineQueue.h
+//Queue used between the pipelined stages (image producer -> feature extraction -> tracking).
+//Defaults to ThreadSafeQueue; configuring with -DPIPELINE_SPSC_QUEUE=ON switches to the lock-free SPSCQueue,
+//waiting with the policy given by PIPELINE_SPSC_WAIT_POLICY (Spin, Yield or Futex).
+#pragma once
+
+#ifdef PIPELINE_SPSC_QUEUE
+#include "utils/SPSCQueue.h"
+#ifndef PIPELINE_SPSC_WAIT_POLICY
+#define PIPELINE_SPSC_WAIT_POLICY Futex
+#endif
+#else
+#include "utils/ThreadSafeQueue.h"
+#endif
+
+namespace ORB_SLAM3 {
+
+#ifdef PIPELINE_SPSC_QUEUE
+template<typename T>
+using PipelineQueue = SPSCQueue<T, SPSCWaitPolicy::PIPELINE_SPSC_WAIT_POLICY>;
+#else
+template<typename T>
+using PipelineQueue = ThreadSafeQueue<T>;
+#endif
+
+} // namespace ORB_SLAM3
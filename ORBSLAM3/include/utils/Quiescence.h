@@ -0,0 +1,106 @@
+//utils/Quiescence.h
+//Quiescent-state tracking for objects shared between threads through raw pointers (map points), so that an object
+//taken out of the shared structures can be freed once no thread may still hold a pointer to it.
+//Each thread keeping such pointers registers as a participant and regularly calls Quiesce() at a point where it holds
+//none of them except in its own containers, which the scrub callback purges of the retired objects. An object is
+//retired with the Epoch() read after it became unreachable; once SafeEpoch() is above that value, every participant
+//has passed a quiescent point since and no longer holds it.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace ORB_SLAM3 {
+
+class QuiescenceDomain {
+public:
+    QuiescenceDomain() : mnEpoch(0) {}
+    QuiescenceDomain(const QuiescenceDomain&) = delete;
+    QuiescenceDomain& operator=(const QuiescenceDomain&) = delete;
+
+    // New participant, which may hold the objects retired from now on. Returns its id.
+    int Register()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        const uint64_t nEpoch = mnEpoch.load();
+        for(size_t i=0; i<mvLastQuiescent.size(); i++)
+        {
+            if(mvLastQuiescent[i] == UNUSED)
+            {
+                mvLastQuiescent[i] = nEpoch;
+                return static_cast<int>(i);
+            }
+        }
+        mvLastQuiescent.push_back(nEpoch);
+        return static_cast<int>(mvLastQuiescent.size()) - 1;
+    }
+
+    void Unregister(int id)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mvLastQuiescent[id] = UNUSED;
+    }
+
+    // Called by participant id when it holds no shared object outside the containers scrub() purges. The epoch is
+    // advanced before the scrub, so whatever was retired before is seen as such by it.
+    template<typename F>
+    void Quiesce(int id, F scrub)
+    {
+        const uint64_t nEpoch = mnEpoch.fetch_add(1) + 1;
+        scrub();
+        std::unique_lock<std::mutex> lock(mMutex);
+        mvLastQuiescent[id] = nEpoch;
+    }
+
+    void Quiesce(int id)
+    {
+        Quiesce(id, []() {});
+    }
+
+    // Stamp of an object retired now
+    uint64_t Epoch() const
+    {
+        return mnEpoch.load();
+    }
+
+    // Objects retired with a stamp below this are no longer held by any participant
+    uint64_t SafeEpoch()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        uint64_t nSafe = mnEpoch.load() + 1;
+        for(const uint64_t nLast : mvLastQuiescent)
+            nSafe = std::min(nSafe, nLast);
+        return nSafe;
+    }
+
+private:
+    static constexpr uint64_t UNUSED = std::numeric_limits<uint64_t>::max();
+
+    std::atomic<uint64_t> mnEpoch;
+    // Epoch of the last quiescent point of each participant, UNUSED for free ids
+    std::vector<uint64_t> mvLastQuiescent;
+    std::mutex mMutex;
+};
+
+// Participant for the lifetime of a scope, for threads that hold shared objects until they exit (a global bundle
+// adjustment) or that quiesce in their loop and unregister when it ends
+class QuiescenceScope {
+public:
+    explicit QuiescenceScope(QuiescenceDomain& domain) : mDomain(domain), mnId(domain.Register()) {}
+    ~QuiescenceScope() { mDomain.Unregister(mnId); }
+    QuiescenceScope(const QuiescenceScope&) = delete;
+    QuiescenceScope& operator=(const QuiescenceScope&) = delete;
+
+    template<typename F>
+    void Quiesce(F scrub) { mDomain.Quiesce(mnId, scrub); }
+    void Quiesce() { mDomain.Quiesce(mnId); }
+
+private:
+    QuiescenceDomain& mDomain;
+    const int mnId;
+};
+
+} // namespace ORB_SLAM3
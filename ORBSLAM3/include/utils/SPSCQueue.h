@@ -0,0 +1,286 @@
+//utils/SPSCQueue.h
+//Bounded lock-free single-producer/single-consumer ring buffer with the ThreadSafeQueue interface.
+//One thread enqueues and one thread dequeues; several threads may share a side only if they serialize
+//their calls with a mutex, since the lock orders their accesses.
+//Waiting on a full/empty queue is done by spinning, yielding or sleeping on a futex, picked at compile time.
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace ORB_SLAM3 {
+
+enum class SPSCWaitPolicy {
+    Spin,   // busy-wait, lowest hand-off latency, burns a core while waiting
+    Yield,  // busy-wait giving the core away on every iteration
+    Futex   // sleep in the kernel until the other side signals
+};
+
+struct SPSCQueueStats {
+    uint64_t nEnqueued = 0;
+    uint64_t nDequeued = 0;
+    uint64_t nMaxDepth = 0;
+    uint64_t nProducerWaits = 0;    // enqueues that found the queue full
+    uint64_t nConsumerWaits = 0;    // dequeues that found the queue empty
+    double producerWaitMs = 0.0;    // total time spent waiting for space
+    double consumerWaitMs = 0.0;    // total time spent waiting for items
+};
+
+inline std::ostream& operator<<(std::ostream& os, const SPSCQueueStats& stats)
+{
+    return os << stats.nEnqueued << " in, " << stats.nDequeued << " out, max depth " << stats.nMaxDepth
+              << ", producer waited " << stats.nProducerWaits << "x / " << stats.producerWaitMs << " ms"
+              << ", consumer waited " << stats.nConsumerWaits << "x / " << stats.consumerWaitMs << " ms";
+}
+
+template<typename T, SPSCWaitPolicy Policy = SPSCWaitPolicy::Futex>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity)
+        : mnCapacity(std::max<size_t>(capacity, 1)), mnMask(RoundUpPow2(mnCapacity) - 1),
+          mSlots(new T[mnMask + 1])
+    {}
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // Block until there is space. Items enqueued after shutdown() are dropped.
+    void enqueue(const T& item) { T copy(item); Push(copy, nullptr); }
+    void enqueue(T&& item) { Push(item, nullptr); }
+
+    template<class Rep, class Period>
+    bool try_enqueue_for(const T& item, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout);
+        T copy(item);
+        return Push(copy, &deadline);
+    }
+
+    // Block until an item is available. Returns false once the queue is shut down and drained.
+    bool dequeue(T& item) { return Pop(item, nullptr); }
+
+    template<class Rep, class Period>
+    bool try_dequeue_for(T& item, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        const Clock::time_point deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout);
+        return Pop(item, &deadline);
+    }
+
+    void shutdown()
+    {
+        mbShutdown.store(true, std::memory_order_seq_cst);
+        if (Policy == SPSCWaitPolicy::Futex) {
+            mItemsEvent.fetch_add(1, std::memory_order_release);
+            mSpaceEvent.fetch_add(1, std::memory_order_release);
+            FutexWake(mItemsEvent, INT_MAX);
+            FutexWake(mSpaceEvent, INT_MAX);
+        }
+    }
+
+    bool is_shutdown() const { return mbShutdown.load(std::memory_order_acquire); }
+
+    // Approximate when called concurrently with the producer or consumer
+    size_t size() const
+    {
+        const uint64_t head = mHead.load(std::memory_order_acquire);
+        const uint64_t tail = mTail.load(std::memory_order_acquire);
+        return static_cast<size_t>(tail - std::min(head, tail));
+    }
+
+    size_t capacity() const { return mnCapacity; }
+
+    SPSCQueueStats GetStats() const
+    {
+        SPSCQueueStats stats;
+        stats.nEnqueued = mTail.load(std::memory_order_relaxed);
+        stats.nDequeued = mHead.load(std::memory_order_relaxed);
+        stats.nMaxDepth = mnMaxDepth.load(std::memory_order_relaxed);
+        stats.nProducerWaits = mnProducerWaits.load(std::memory_order_relaxed);
+        stats.nConsumerWaits = mnConsumerWaits.load(std::memory_order_relaxed);
+        stats.producerWaitMs = mnProducerWaitNs.load(std::memory_order_relaxed) * 1e-6;
+        stats.consumerWaitMs = mnConsumerWaitNs.load(std::memory_order_relaxed) * 1e-6;
+        return stats;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    // The futex handshake needs the index store and the waiter-flag load to be sequentially consistent
+    static constexpr std::memory_order kPublishOrder =
+        Policy == SPSCWaitPolicy::Futex ? std::memory_order_seq_cst : std::memory_order_release;
+
+    static size_t RoundUpPow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n)
+            p <<= 1;
+        return p;
+    }
+
+    bool Push(T& item, const Clock::time_point* deadline)
+    {
+        if (mbShutdown.load(std::memory_order_acquire))
+            return false;
+
+        const uint64_t tail = mTail.load(std::memory_order_relaxed);
+        if (tail - mnHeadCache >= mnCapacity) {
+            mnHeadCache = mHead.load(std::memory_order_acquire);
+            if (tail - mnHeadCache >= mnCapacity) {
+                auto hasSpace = [this, tail]() {
+                    mnHeadCache = mHead.load(std::memory_order_seq_cst);
+                    return tail - mnHeadCache < mnCapacity;
+                };
+                if (!Wait(hasSpace, mSpaceEvent, mbProducerWaiting, deadline, mnProducerWaits, mnProducerWaitNs))
+                    return false;
+            }
+        }
+
+        mSlots[tail & mnMask] = std::move(item);
+        mTail.store(tail + 1, kPublishOrder);
+
+        const uint64_t depth = tail + 1 - mHead.load(std::memory_order_relaxed);
+        if (depth > mnMaxDepth.load(std::memory_order_relaxed))
+            mnMaxDepth.store(depth, std::memory_order_relaxed);
+
+        Notify(mItemsEvent, mbConsumerWaiting);
+        return true;
+    }
+
+    bool Pop(T& item, const Clock::time_point* deadline)
+    {
+        const uint64_t head = mHead.load(std::memory_order_relaxed);
+        if (head == mnTailCache) {
+            mnTailCache = mTail.load(std::memory_order_acquire);
+            if (head == mnTailCache) {
+                auto hasItem = [this, head]() {
+                    mnTailCache = mTail.load(std::memory_order_seq_cst);
+                    return head != mnTailCache;
+                };
+                if (!Wait(hasItem, mItemsEvent, mbConsumerWaiting, deadline, mnConsumerWaits, mnConsumerWaitNs))
+                    return false;
+            }
+        }
+
+        // Reset the slot so it does not keep the item's buffers alive until it is overwritten
+        T& slot = mSlots[head & mnMask];
+        item = std::move(slot);
+        slot = T();
+        mHead.store(head + 1, kPublishOrder);
+
+        Notify(mSpaceEvent, mbProducerWaiting);
+        return true;
+    }
+
+    // Slow path: wait until ready() holds. False on shutdown (ready() is checked first, so a
+    // shut down queue still drains) or when the deadline passes.
+    template<typename Ready>
+    bool Wait(Ready&& ready, std::atomic<uint32_t>& event, std::atomic<bool>& waiting,
+              const Clock::time_point* deadline, std::atomic<uint64_t>& nWaits, std::atomic<uint64_t>& waitNs)
+    {
+        const Clock::time_point t0 = Clock::now();
+        bool result = false;
+        while (true) {
+            if (ready()) { result = true; break; }
+            if (mbShutdown.load(std::memory_order_acquire))
+                break;
+            Clock::time_point now = Clock::now();
+            if (deadline && now >= *deadline)
+                break;
+
+            if (Policy == SPSCWaitPolicy::Spin) {
+                CpuRelax();
+            }
+            else if (Policy == SPSCWaitPolicy::Yield) {
+                std::this_thread::yield();
+            }
+            else {
+                const uint32_t seq = event.load(std::memory_order_acquire);
+                waiting.store(true, std::memory_order_seq_cst);
+                if (!ready() && !mbShutdown.load(std::memory_order_seq_cst)) {
+                    if (deadline) {
+                        const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(*deadline - now).count();
+                        timespec ts;
+                        ts.tv_sec = static_cast<time_t>(ns / 1000000000);
+                        ts.tv_nsec = static_cast<long>(ns % 1000000000);
+                        FutexWait(event, seq, &ts);
+                    }
+                    else {
+                        FutexWait(event, seq, nullptr);
+                    }
+                }
+                waiting.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        nWaits.store(nWaits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        waitNs.store(waitNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        return result;
+    }
+
+    // Wake the other side if it is asleep; a no-op for the busy-waiting policies
+    static void Notify(std::atomic<uint32_t>& event, std::atomic<bool>& waiting)
+    {
+        if (Policy != SPSCWaitPolicy::Futex)
+            return;
+        if (waiting.load(std::memory_order_seq_cst)) {
+            event.fetch_add(1, std::memory_order_release);
+            FutexWake(event, 1);
+        }
+    }
+
+    static void FutexWait(std::atomic<uint32_t>& word, uint32_t expected, const timespec* timeout)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+    }
+
+    static void FutexWake(std::atomic<uint32_t>& word, int count)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    static void CpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        asm volatile("yield");
+#endif
+    }
+
+    const size_t mnCapacity;
+    const size_t mnMask;
+    std::unique_ptr<T[]> mSlots;
+
+    // Producer side, written only by the producer
+    alignas(64) std::atomic<uint64_t> mTail{0};
+    uint64_t mnHeadCache = 0;
+    std::atomic<uint64_t> mnMaxDepth{0};
+    std::atomic<uint64_t> mnProducerWaits{0};
+    std::atomic<uint64_t> mnProducerWaitNs{0};
+
+    // Consumer side, written only by the consumer
+    alignas(64) std::atomic<uint64_t> mHead{0};
+    uint64_t mnTailCache = 0;
+    std::atomic<uint64_t> mnConsumerWaits{0};
+    std::atomic<uint64_t> mnConsumerWaitNs{0};
+
+    // Sleep/wake handshake, only touched on the slow path
+    alignas(64) std::atomic<bool> mbProducerWaiting{false};
+    std::atomic<bool> mbConsumerWaiting{false};
+    std::atomic<uint32_t> mSpaceEvent{0};
+    std::atomic<uint32_t> mItemsEvent{0};
+    std::atomic<bool> mbShutdown{false};
+};
+
+} // namespace ORB_SLAM3
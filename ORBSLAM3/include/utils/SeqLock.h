@@ -0,0 +1,107 @@
+//utils/SeqLock.h
+//Sequence locks for small read-mostly values (map point geometry, keyframe poses, descriptors).
+//Readers copy the value without taking any lock and retry if a write overlapped the copy, so they never wait on a
+//writer that is descheduled or busy. Writers must already be serialized, typically by the owner's mutex.
+//The value is kept as relaxed atomic words, so concurrent reads and writes are not data races.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace ORB_SLAM3 {
+
+namespace seqlock_detail {
+
+    inline void StoreWords(std::atomic<uint32_t> &seq, std::atomic<uint64_t>* words, const void* data, size_t bytes)
+    {
+        const uint32_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const unsigned char* src = static_cast<const unsigned char*>(data);
+        for(size_t i=0; i*8 < bytes; i++)
+        {
+            uint64_t w = 0;
+            std::memcpy(&w, src + i*8, bytes - i*8 < 8 ? bytes - i*8 : 8);
+            words[i].store(w, std::memory_order_relaxed);
+        }
+
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+    inline void LoadWords(const std::atomic<uint32_t> &seq, const std::atomic<uint64_t>* words, void* data, size_t bytes)
+    {
+        unsigned char* dst = static_cast<unsigned char*>(data);
+        while(true)
+        {
+            const uint32_t s0 = seq.load(std::memory_order_acquire);
+            if(s0 & 1)
+                continue;
+
+            for(size_t i=0; i*8 < bytes; i++)
+            {
+                const uint64_t w = words[i].load(std::memory_order_relaxed);
+                std::memcpy(dst + i*8, &w, bytes - i*8 < 8 ? bytes - i*8 : 8);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(seq.load(std::memory_order_relaxed) == s0)
+                return;
+        }
+    }
+
+} // namespace seqlock_detail
+
+// A value of trivially copyable type T
+template<typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied bytewise");
+
+public:
+    SeqLock() { Store(T()); }
+    explicit SeqLock(const T &value) { Store(value); }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Writers must be serialized by the caller
+    void Store(const T &value) { seqlock_detail::StoreWords(mnSeq, mWords, &value, sizeof(T)); }
+
+    T Load() const
+    {
+        T value;
+        seqlock_detail::LoadWords(mnSeq, mWords, &value, sizeof(T));
+        return value;
+    }
+
+private:
+    static const size_t WORDS = (sizeof(T) + 7) / 8;
+
+    std::atomic<uint32_t> mnSeq{0};
+    std::atomic<uint64_t> mWords[WORDS];
+};
+
+// A byte buffer whose size is fixed at construction (a descriptor row)
+class SeqLockBuffer {
+public:
+    explicit SeqLockBuffer(size_t bytes) : mnBytes(bytes), mWords(new std::atomic<uint64_t>[(bytes + 7) / 8]()) {}
+
+    SeqLockBuffer(const SeqLockBuffer&) = delete;
+    SeqLockBuffer& operator=(const SeqLockBuffer&) = delete;
+
+    size_t Size() const { return mnBytes; }
+
+    // Writers must be serialized by the caller; data holds Size() bytes
+    void Store(const void* data) { seqlock_detail::StoreWords(mnSeq, mWords.get(), data, mnBytes); }
+    void Load(void* data) const { seqlock_detail::LoadWords(mnSeq, mWords.get(), data, mnBytes); }
+
+private:
+    const size_t mnBytes;
+    std::atomic<uint32_t> mnSeq{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> mWords;
+};
+
+} // namespace ORB_SLAM3
@@ -0,0 +1,201 @@
+//utils/SlabPool.h
+//Slot allocator, dense indices and index-keyed scratch maps for the objects the map creates by the thousand (MapPoint, KeyFrame).
+//Objects are carved out of slabs of SLOTS_PER_SLAB contiguous slots instead of being scattered over the heap, so
+//the points created together (one keyframe's triangulation) sit together in memory. A deleted object's slot goes on
+//a free list and is handed to the next allocation, so the churn of short-lived points (Tracking's temporal points,
+//bad points freed by MapPoint::ReclaimRetired) does not fragment the heap. Keyframes are never freed.
+//Slabs are kept until the process exits.
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace ORB_SLAM3 {
+
+template<typename T, size_t SLOTS_PER_SLAB = 1024>
+class SlabPool {
+public:
+    // At least 16 bytes, which the fixed-size Eigen members need (as EIGEN_MAKE_ALIGNED_OPERATOR_NEW gave)
+    static const size_t ALIGNMENT = alignof(T) > 16 ? alignof(T) : 16;
+    static const size_t SLOT_SIZE = (sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+
+    SlabPool() = default;
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Storage for one T; bytes is the size passed to operator new, which must fit a slot
+    void* Allocate(size_t bytes)
+    {
+        if(bytes > SLOT_SIZE)
+            throw std::bad_alloc();
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        if(!mpFree)
+            AddSlab();
+
+        FreeSlot* pSlot = mpFree;
+        mpFree = pSlot->pNext;
+        return pSlot;
+    }
+
+    // Give back a slot from Allocate, after the object in it has been destroyed
+    void Release(void* p)
+    {
+        if(!p)
+            return;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        FreeSlot* pSlot = static_cast<FreeSlot*>(p);
+        pSlot->pNext = mpFree;
+        mpFree = pSlot;
+    }
+
+private:
+    struct FreeSlot
+    {
+        FreeSlot* pNext;
+    };
+
+    // Called with mMutex held. The slots of a new slab are handed out in address order.
+    void AddSlab()
+    {
+        std::unique_ptr<unsigned char[]> slab(new unsigned char[SLOT_SIZE * SLOTS_PER_SLAB + ALIGNMENT]);
+        const uintptr_t base = reinterpret_cast<uintptr_t>(slab.get());
+        unsigned char* first = slab.get() + (ALIGNMENT - base % ALIGNMENT) % ALIGNMENT;
+
+        for(size_t i=SLOTS_PER_SLAB; i-- > 0;)
+        {
+            FreeSlot* pSlot = reinterpret_cast<FreeSlot*>(first + i * SLOT_SIZE);
+            pSlot->pNext = mpFree;
+            mpFree = pSlot;
+        }
+        mvSlabs.push_back(std::move(slab));
+    }
+
+    std::vector<std::unique_ptr<unsigned char[]>> mvSlabs;
+    FreeSlot* mpFree = nullptr;
+    std::mutex mMutex;
+};
+
+// Dense indices for the objects of a container (a Map's keyframes or map points). Indices freed by Erase are handed
+// out again by Insert, so the indices stay below the peak number of objects held at once. An index can outlive its
+// object's membership (a stale pointer still carries it), so arrays indexed by it must check who owns the entry.
+// Not synchronized; the owner guards it with its own mutex.
+template<typename T>
+class DenseIndex {
+public:
+    // Index for p, which must not hold an index of this container yet
+    int Insert(T* p)
+    {
+        int idx;
+        if(!mvFree.empty())
+        {
+            idx = mvFree.back();
+            mvFree.pop_back();
+            mvpSlots[idx] = p;
+        }
+        else
+        {
+            idx = static_cast<int>(mvpSlots.size());
+            mvpSlots.push_back(p);
+        }
+        return idx;
+    }
+
+    // Free idx if it is p's. Objects moved to another container since have a different index there and keep the
+    // slot here reserved, which is harmless.
+    void Erase(int idx, T* p)
+    {
+        if(idx < 0 || idx >= static_cast<int>(mvpSlots.size()) || mvpSlots[idx] != p)
+            return;
+        mvpSlots[idx] = nullptr;
+        mvFree.push_back(idx);
+    }
+
+    void Clear()
+    {
+        mvpSlots.clear();
+        mvFree.clear();
+    }
+
+private:
+    std::vector<T*> mvpSlots;
+    std::vector<int> mvFree;
+};
+
+// Scratch map from objects carrying a dense index (mnMapIndex) to values, stored in an array indexed by it instead of
+// a tree keyed by pointer. The index is only a hint: objects of different maps, stale indices and objects without one
+// (-1) collide or miss, and those keys go to a small overflow map. An object moved to another map while inserted is
+// not found again. Clear() costs the number of keys inserted, so one instance is reused across calls.
+template<typename T, typename V>
+class DenseMap {
+public:
+    V& operator[](T* p)
+    {
+        const int idx = p->mnMapIndex.load(std::memory_order_relaxed);
+        if(idx < 0)
+            return mOverflow[p];
+        if(idx >= static_cast<int>(mvEntries.size()))
+            mvEntries.resize(idx+1, std::make_pair(static_cast<T*>(nullptr), V()));
+
+        std::pair<T*,V> &entry = mvEntries[idx];
+        if(!entry.first)
+        {
+            // p may have been inserted before the map gave it this index
+            if(!mOverflow.empty())
+            {
+                typename std::map<T*,V>::iterator it = mOverflow.find(p);
+                if(it != mOverflow.end())
+                    return it->second;
+            }
+            entry.first = p;
+            mvUsed.push_back(idx);
+        }
+        if(entry.first == p)
+            return entry.second;
+        return mOverflow[p];
+    }
+
+    // Value of p, or nullptr if p was not inserted
+    V* Find(T* p)
+    {
+        const int idx = p->mnMapIndex.load(std::memory_order_relaxed);
+        if(idx >= 0 && idx < static_cast<int>(mvEntries.size()) && mvEntries[idx].first == p)
+            return &mvEntries[idx].second;
+        typename std::map<T*,V>::iterator it = mOverflow.find(p);
+        return it == mOverflow.end() ? nullptr : &it->second;
+    }
+
+    // Move the entries out (in no particular order) and clear
+    void Extract(std::vector<std::pair<T*,V>> &vEntries)
+    {
+        vEntries.clear();
+        vEntries.reserve(mvUsed.size() + mOverflow.size());
+        for(const int idx : mvUsed)
+            vEntries.push_back(std::move(mvEntries[idx]));
+        for(typename std::map<T*,V>::iterator it=mOverflow.begin(); it!=mOverflow.end(); it++)
+            vEntries.push_back(std::make_pair(it->first, std::move(it->second)));
+        Clear();
+    }
+
+    void Clear()
+    {
+        for(const int idx : mvUsed)
+            mvEntries[idx] = std::make_pair(static_cast<T*>(nullptr), V());
+        mvUsed.clear();
+        mOverflow.clear();
+    }
+
+private:
+    std::vector<std::pair<T*,V>> mvEntries;
+    std::vector<int> mvUsed;
+    std::map<T*,V> mOverflow;
+};
+
+} // namespace ORB_SLAM3
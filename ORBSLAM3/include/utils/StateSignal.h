@@ -0,0 +1,75 @@
+//utils/StateSignal.h
+//Wakes the threads waiting for a condition on state that is guarded by other mutexes (stop/reset/finish flags,
+//keyframe queues), in place of sleep-and-poll loops. Whoever changes such state calls Notify() afterwards, and
+//waiters re-evaluate their predicate on every notification, so a hand-off costs a wakeup instead of a sleep period.
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace ORB_SLAM3 {
+
+class StateSignal {
+public:
+    StateSignal() = default;
+    StateSignal(const StateSignal&) = delete;
+    StateSignal& operator=(const StateSignal&) = delete;
+
+    // Wake every waiter; call after the state change has been published under its own mutex.
+    void Notify()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mnSeq++;
+        }
+        mCond.notify_all();
+    }
+
+    // Block until pred() holds. pred takes whatever locks it needs; it is never called with the signal's mutex held,
+    // and a notification between its evaluation and the wait is not lost.
+    template<typename Pred>
+    void Wait(Pred pred)
+    {
+        while(true)
+        {
+            const uint64_t seq = Sequence();
+            if(pred())
+                return;
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCond.wait(lock, [&]() { return mnSeq != seq; });
+        }
+    }
+
+    // As Wait, giving up after timeout. Returns the last value of pred().
+    template<typename Pred, typename Rep, typename Period>
+    bool WaitFor(Pred pred, const std::chrono::duration<Rep, Period> &timeout)
+    {
+        const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+        while(true)
+        {
+            const uint64_t seq = Sequence();
+            if(pred())
+                return true;
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(!mCond.wait_until(lock, deadline, [&]() { return mnSeq != seq; }))
+            {
+                lock.unlock();
+                return pred();
+            }
+        }
+    }
+
+private:
+    uint64_t Sequence()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        return mnSeq;
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    uint64_t mnSeq = 0;
+};
+
+} // namespace ORB_SLAM3
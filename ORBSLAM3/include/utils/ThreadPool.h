@@ -0,0 +1,109 @@
+//utils/ThreadPool.h
+//Fixed-size pool of worker threads for fanning short, independent tasks out of a hot path.
+//Workers are started once and reused, so submitting a task costs a queue push instead of a thread spawn.
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace ORB_SLAM3 {
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int nThreads)
+    {
+        if(nThreads < 1)
+            nThreads = 1;
+        mvWorkers.reserve(nThreads);
+        for(int i=0; i<nThreads; i++)
+            mvWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mbStop = true;
+        }
+        mCond.notify_all();
+        for(std::thread& worker : mvWorkers)
+            if(worker.joinable())
+                worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int Size() const { return static_cast<int>(mvWorkers.size()); }
+
+    // Queue a task; the returned future rethrows any exception the task raised.
+    std::future<void> Submit(std::function<void()> task)
+    {
+        std::packaged_task<void()> packaged(std::move(task));
+        std::future<void> result = packaged.get_future();
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mTasks.push(std::move(packaged));
+        }
+        mCond.notify_one();
+        return result;
+    }
+
+    // Run f(0..n-1), f(0) on the calling thread and the rest on the workers, and wait for all of them.
+    // Tasks must not call ParallelFor on the same pool, since a worker blocked on the wait cannot drain the queue.
+    template<typename F>
+    void ParallelFor(int n, F&& f)
+    {
+        if(n <= 0)
+            return;
+
+        std::vector<std::future<void>> vFutures;
+        vFutures.reserve(n-1);
+        for(int i=1; i<n; i++)
+            vFutures.push_back(Submit([&f, i]() { f(i); }));
+
+        // Always drain every future before returning, so no worker is left referencing f
+        std::exception_ptr eptr;
+        try { f(0); } catch(...) { eptr = std::current_exception(); }
+
+        for(std::future<void>& fut : vFutures)
+        {
+            try { fut.get(); }
+            catch(...) { if(!eptr) eptr = std::current_exception(); }
+        }
+
+        if(eptr)
+            std::rethrow_exception(eptr);
+    }
+
+private:
+    void WorkerLoop()
+    {
+        while(true)
+        {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCond.wait(lock, [this]() { return mbStop || !mTasks.empty(); });
+                if(mbStop && mTasks.empty())
+                    return;
+                task = std::move(mTasks.front());
+                mTasks.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> mvWorkers;
+    std::queue<std::packaged_task<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCond;
+    bool mbStop = false;
+};
+
+} // namespace ORB_SLAM3
@@ -183,19 +183,27 @@ namespace ORB_SLAM3 {
 
         //Correct FishEye distortion
         std::vector<cv::KeyPoint> vKeysUn1 = vKeys1, vKeysUn2 = vKeys2;
-        std::vector<cv::Point2f> vPts1(vKeys1.size()), vPts2(vKeys2.size());
+        if(mpUndistortionMap)
+        {
+            mpUndistortionMap->Undistort(vKeysUn1.data(),vKeysUn1.data(),vKeysUn1.size());
+            mpUndistortionMap->Undistort(vKeysUn2.data(),vKeysUn2.data(),vKeysUn2.size());
+        }
+        else
+        {
+            std::vector<cv::Point2f> vPts1(vKeys1.size()), vPts2(vKeys2.size());
 
-        for(size_t i = 0; i < vKeys1.size(); i++) vPts1[i] = vKeys1[i].pt;
-        for(size_t i = 0; i < vKeys2.size(); i++) vPts2[i] = vKeys2[i].pt;
+            for(size_t i = 0; i < vKeys1.size(); i++) vPts1[i] = vKeys1[i].pt;
+            for(size_t i = 0; i < vKeys2.size(); i++) vPts2[i] = vKeys2[i].pt;
 
-        cv::Mat D = (cv::Mat_<float>(4,1) << mvParameters[4], mvParameters[5], mvParameters[6], mvParameters[7]);
-        cv::Mat R = cv::Mat::eye(3,3,CV_32F);
-        cv::Mat K = this->toK();
-        cv::fisheye::undistortPoints(vPts1,vPts1,K,D,R,K);
-        cv::fisheye::undistortPoints(vPts2,vPts2,K,D,R,K);
+            cv::Mat D = (cv::Mat_<float>(4,1) << mvParameters[4], mvParameters[5], mvParameters[6], mvParameters[7]);
+            cv::Mat R = cv::Mat::eye(3,3,CV_32F);
+            cv::Mat K = this->toK();
+            cv::fisheye::undistortPoints(vPts1,vPts1,K,D,R,K);
+            cv::fisheye::undistortPoints(vPts2,vPts2,K,D,R,K);
 
-        for(size_t i = 0; i < vKeys1.size(); i++) vKeysUn1[i].pt = vPts1[i];
-        for(size_t i = 0; i < vKeys2.size(); i++) vKeysUn2[i].pt = vPts2[i];
+            for(size_t i = 0; i < vKeys1.size(); i++) vKeysUn1[i].pt = vPts1[i];
+            for(size_t i = 0; i < vKeys2.size(); i++) vKeysUn2[i].pt = vPts2[i];
+        }
 
         return tvr->Reconstruct(vKeysUn1,vKeysUn2,vMatches12,T21,vP3D,vbTriangulated);
     }
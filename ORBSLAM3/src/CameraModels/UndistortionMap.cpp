@@ -0,0 +1,246 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* Copyright (C) 2017-2021 Carlos Campos, Richard Elvira, Juan J. Gómez Rodríguez, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+* Copyright (C) 2014-2016 Raúl Mur-Artal, José M.M. Montiel and Juan D. Tardós, University of Zaragoza.
+*
+* ORB-SLAM3 is free software: you can redistribute it and/or modify it under the terms of the GNU General Public
+* License as published by the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM3 is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even
+* the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License along with ORB-SLAM3.
+* If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "UndistortionMap.h"
+
+#include <cmath>
+
+namespace ORB_SLAM3 {
+
+    UndistortionMap::UndistortionMap(Model model, const std::vector<float> &vK, const std::vector<float> &vDistortion,
+                                     const cv::Size &imSize, float cellSize, int nRefineIterations)
+        : mModel(model), fx(vK[0]), fy(vK[1]), cx(vK[2]), cy(vK[3]), invfx(1.0/vK[0]), invfy(1.0/vK[1]),
+          k1(0), k2(0), k3(0), k4(0), p1(0), p2(0), mvDistortion(vDistortion), mImSize(imSize),
+          mfCellSize(cellSize), mfInvCellSize(1.f/cellSize), mnRefineIterations(nRefineIterations)
+    {
+        if(mModel == RADIAL_TANGENTIAL)
+        {
+            CV_Assert(vDistortion.size() == 4 || vDistortion.size() == 5);
+            k1 = vDistortion[0];
+            k2 = vDistortion[1];
+            p1 = vDistortion[2];
+            p2 = vDistortion[3];
+            k3 = vDistortion.size() == 5 ? vDistortion[4] : 0.0;
+        }
+        else
+        {
+            CV_Assert(vDistortion.size() == 4);
+            k1 = vDistortion[0];
+            k2 = vDistortion[1];
+            k3 = vDistortion[2];
+            k4 = vDistortion[3];
+        }
+
+        // One extra cell on every side, so every pixel of the image falls inside a complete cell
+        mfMinX = -mfCellSize;
+        mfMinY = -mfCellSize;
+        mnCols = static_cast<int>(std::ceil((mImSize.width + 2*mfCellSize) * mfInvCellSize)) + 1;
+        mnRows = static_cast<int>(std::ceil((mImSize.height + 2*mfCellSize) * mfInvCellSize)) + 1;
+
+        mvNodes.resize(mnCols * mnRows);
+        for(int r=0; r<mnRows; r++)
+        {
+            for(int c=0; c<mnCols; c++)
+                mvNodes[r*mnCols + c] = UndistortExact(cv::Point2f(mfMinX + c*mfCellSize, mfMinY + r*mfCellSize));
+        }
+    }
+
+    void UndistortionMap::DistortNormalized(double x, double y, double &xd, double &yd, double* J) const
+    {
+        if(mModel == RADIAL_TANGENTIAL)
+        {
+            const double x2 = x*x, y2 = y*y, xy = x*y;
+            const double r2 = x2 + y2;
+            const double radial = 1 + r2*(k1 + r2*(k2 + r2*k3));
+            xd = x*radial + 2*p1*xy + p2*(r2 + 2*x2);
+            yd = y*radial + p1*(r2 + 2*y2) + 2*p2*xy;
+
+            if(J)
+            {
+                // d(radial)/d(r2)
+                const double dr = k1 + r2*(2*k2 + 3*k3*r2);
+                J[0] = radial + 2*x2*dr + 2*p1*y + 6*p2*x;
+                J[1] = 2*xy*dr + 2*p1*x + 2*p2*y;
+                J[2] = J[1];
+                J[3] = radial + 2*y2*dr + 6*p1*y + 2*p2*x;
+            }
+        }
+        else
+        {
+            const double r = std::sqrt(x*x + y*y);
+            if(r < 1e-12)
+            {
+                xd = x;
+                yd = y;
+                return;
+            }
+            const double theta = std::atan(r);
+            const double theta2 = theta*theta;
+            const double thetad = theta*(1 + theta2*(k1 + theta2*(k2 + theta2*(k3 + theta2*k4))));
+            xd = x*thetad/r;
+            yd = y*thetad/r;
+        }
+    }
+
+    void UndistortionMap::RefineNormalized(double xd, double yd, double &x, double &y) const
+    {
+        if(mModel == KANNALA_BRANDT)
+        {
+            // The model is radial: one Newton step on theta, which stays well conditioned towards 90 degrees
+            const double thetad = std::sqrt(xd*xd + yd*yd);
+            if(thetad < 1e-8 || thetad >= CV_PI/2)
+                return;
+            double theta = std::atan(std::sqrt(x*x + y*y));
+            const double theta2 = theta*theta;
+            theta -= (theta*(1 + theta2*(k1 + theta2*(k2 + theta2*(k3 + theta2*k4)))) - thetad) /
+                     (1 + theta2*(3*k1 + theta2*(5*k2 + theta2*(7*k3 + theta2*9*k4))));
+            const double scale = std::tan(theta) / thetad;
+            x = xd * scale;
+            y = yd * scale;
+            return;
+        }
+
+        double fxd, fyd, J[4];
+        DistortNormalized(x, y, fxd, fyd, J);
+        const double ex = xd - fxd, ey = yd - fyd;
+        const double det = J[0]*J[3] - J[1]*J[2];
+        if(std::fabs(det) < 1e-12)
+            return;
+        x += ( J[3]*ex - J[1]*ey) / det;
+        y += (-J[2]*ex + J[0]*ey) / det;
+    }
+
+    cv::Point2f UndistortionMap::UndistortExact(const cv::Point2f &p) const
+    {
+        const double xd = (p.x - cx) * invfx;
+        const double yd = (p.y - cy) * invfy;
+        double x = xd, y = yd;
+
+        if(mModel == RADIAL_TANGENTIAL)
+        {
+            // Fixed point iteration of cv::undistortPoints as a robust start, then Gauss-Newton to convergence
+            for(int j=0; j<20; j++)
+            {
+                const double r2 = x*x + y*y;
+                const double icdist = 1.0 / (1 + r2*(k1 + r2*(k2 + r2*k3)));
+                const double deltaX = 2*p1*x*y + p2*(r2 + 2*x*x);
+                const double deltaY = p1*(r2 + 2*y*y) + 2*p2*x*y;
+                x = (xd - deltaX) * icdist;
+                y = (yd - deltaY) * icdist;
+            }
+            for(int j=0; j<3; j++)
+                RefineNormalized(xd, yd, x, y);
+        }
+        else
+        {
+            // Newton on theta, as KannalaBrandt8::unproject
+            double thetad = std::sqrt(xd*xd + yd*yd);
+            thetad = std::min(std::max(-CV_PI/2, thetad), CV_PI/2);
+            if(thetad > 1e-8)
+            {
+                double theta = thetad;
+                for(int j=0; j<20; j++)
+                {
+                    const double theta2 = theta*theta;
+                    const double fix = (theta*(1 + theta2*(k1 + theta2*(k2 + theta2*(k3 + theta2*k4)))) - thetad) /
+                                       (1 + theta2*(3*k1 + theta2*(5*k2 + theta2*(7*k3 + theta2*9*k4))));
+                    theta -= fix;
+                    if(std::fabs(fix) < 1e-12)
+                        break;
+                }
+                const double scale = std::tan(theta) / thetad;
+                x = xd * scale;
+                y = yd * scale;
+            }
+        }
+
+        return cv::Point2f(static_cast<float>(fx*x + cx), static_cast<float>(fy*y + cy));
+    }
+
+    cv::Point2f UndistortionMap::Undistort(const cv::Point2f &p) const
+    {
+        const float gx = (p.x - mfMinX) * mfInvCellSize;
+        const float gy = (p.y - mfMinY) * mfInvCellSize;
+        // Written so that NaN also takes the slow path
+        if(!(gx >= 0.f && gy >= 0.f && gx < mnCols-1 && gy < mnRows-1))
+            return UndistortExact(p);
+
+        const int ix = static_cast<int>(gx);
+        const int iy = static_cast<int>(gy);
+        const float ax = gx - ix;
+        const float ay = gy - iy;
+
+        const cv::Point2f* n0 = &mvNodes[iy*mnCols + ix];
+        const cv::Point2f* n1 = n0 + mnCols;
+        const float w00 = (1.f-ax)*(1.f-ay), w01 = ax*(1.f-ay), w10 = (1.f-ax)*ay, w11 = ax*ay;
+        cv::Point2f res(w00*n0[0].x + w01*n0[1].x + w10*n1[0].x + w11*n1[1].x,
+                        w00*n0[0].y + w01*n0[1].y + w10*n1[0].y + w11*n1[1].y);
+
+        if(mnRefineIterations > 0)
+        {
+            const double xd = (p.x - cx) * invfx;
+            const double yd = (p.y - cy) * invfy;
+            double x = (res.x - cx) * invfx;
+            double y = (res.y - cy) * invfy;
+            for(int j=0; j<mnRefineIterations; j++)
+                RefineNormalized(xd, yd, x, y);
+            res.x = static_cast<float>(fx*x + cx);
+            res.y = static_cast<float>(fy*y + cy);
+        }
+
+        return res;
+    }
+
+    void UndistortionMap::Undistort(const cv::KeyPoint* in, cv::KeyPoint* out, size_t n) const
+    {
+        for(size_t i=0; i<n; i++)
+        {
+            const cv::Point2f pt = Undistort(in[i].pt);
+            if(out != in)
+                out[i] = in[i];
+            out[i].pt = pt;
+        }
+    }
+
+    cv::Point2f UndistortionMap::Distort(const cv::Point2f &p) const
+    {
+        double xd, yd;
+        DistortNormalized((p.x - cx) * invfx, (p.y - cy) * invfy, xd, yd, nullptr);
+        return cv::Point2f(static_cast<float>(fx*xd + cx), static_cast<float>(fy*yd + cy));
+    }
+
+    bool UndistortionMap::HasDistortion(const cv::Mat &distCoef) const
+    {
+        if(mModel != RADIAL_TANGENTIAL || distCoef.empty() || distCoef.type() != CV_32F)
+            return false;
+
+        const size_t n = distCoef.total();
+        if(n != 4 && n != 5)
+            return false;
+        const float* d = distCoef.ptr<float>(0);
+        for(size_t i=0; i<4; i++)
+        {
+            if(d[i] != mvDistortion[i])
+                return false;
+        }
+        const float k3Mat = n == 5 ? d[4] : 0.f;
+        const float k3Map = mvDistortion.size() == 5 ? mvDistortion[4] : 0.f;
+        return k3Mat == k3Map;
+    }
+
+}
@@ -0,0 +1,181 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* DescriptorDistance.cc - Selection of the descriptor distance kernels
+*/
+
+#include "DescriptorDistance.h"
+
+#include <sstream>
+
+namespace ORB_SLAM3
+{
+
+namespace
+{
+    float Hamming256Kernel(const uint8_t* a, const uint8_t* b)
+    {
+        return static_cast<float>(DescriptorKernels::Hamming256(a, b));
+    }
+
+    template<int N>
+    float L2SqrKernel(const uint8_t* a, const uint8_t* b)
+    {
+        return DescriptorKernels::L2Sqr<N>(reinterpret_cast<const float*>(a), reinterpret_cast<const float*>(b));
+    }
+
+    DescriptorMetric::Kernel SelectKernel(const NormType norm, const int length)
+    {
+        if(norm == NormType::HAMMING)
+            return length == 32 ? &Hamming256Kernel : nullptr;
+
+        switch(length)
+        {
+            case 128: return &L2SqrKernel<128>;
+            case 256: return &L2SqrKernel<256>;
+            default:  return nullptr;
+        }
+    }
+}
+
+DescriptorMetric::DescriptorMetric()
+    : DescriptorMetric(NormType::HAMMING, 32, false, 1.0f)
+{
+}
+
+DescriptorMetric::DescriptorMetric(NormType norm, int length, bool bSquared, float scale)
+    : mNorm(norm), mLength(length), mbSquared(bSquared), mfScale(scale)
+{
+    mKernel = SelectKernel(mNorm, mLength);
+
+    // No specialized kernel for this length: make sure operator() never takes the fast path
+    if(!mKernel)
+        mLength = -1;
+}
+
+DescriptorMetric DescriptorMetric::FromExtractor(const FeatureExtractor* pExtractor, const std::string& type)
+{
+    const NormType norm = pExtractor ? pExtractor->norm() : NormType::HAMMING;
+    const int length = pExtractor ? pExtractor->descriptorLength() : 32;
+
+    if(norm == NormType::HAMMING)
+        return DescriptorMetric(norm, length, false, 1.0f);
+
+    // Keep the distance ranges the matcher thresholds (TH_LOW/TH_HIGH) were tuned for
+    if(type == "SIFT")
+        return DescriptorMetric(norm, length, true, 1.0f);
+    else if(type == "Xfeat")
+        return DescriptorMetric(norm, length, true, 512.0f);
+    else
+        return DescriptorMetric(norm, length, false, 100.0f);
+}
+
+void DescriptorMetric::Distances(const cv::Mat &query, const uint8_t* block, size_t step, int n, float* out) const
+{
+    const uint8_t* q = query.data;
+    const int len = query.cols;
+
+    if(query.type() == CV_8U)
+    {
+        if(len == 32)
+        {
+            for(int i=0; i<n; i++)
+                out[i] = static_cast<float>(DescriptorKernels::Hamming256(q, block + i*step));
+        }
+        else
+        {
+            for(int i=0; i<n; i++)
+                out[i] = static_cast<float>(DescriptorKernels::HammingN(q, block + i*step, len));
+        }
+        return;
+    }
+
+    const float* qf = query.ptr<float>();
+    switch(len)
+    {
+        case 128:
+            for(int i=0; i<n; i++)
+                out[i] = DescriptorKernels::L2Sqr<128>(qf, reinterpret_cast<const float*>(block + i*step));
+            break;
+        case 256:
+            for(int i=0; i<n; i++)
+                out[i] = DescriptorKernels::L2Sqr<256>(qf, reinterpret_cast<const float*>(block + i*step));
+            break;
+        default:
+            for(int i=0; i<n; i++)
+                out[i] = DescriptorKernels::L2SqrN(qf, reinterpret_cast<const float*>(block + i*step), len);
+            break;
+    }
+
+    if(mbSquared)
+    {
+        for(int i=0; i<n; i++)
+            out[i] *= mfScale;
+    }
+    else
+    {
+        for(int i=0; i<n; i++)
+            out[i] = mfScale * std::sqrt(out[i]);
+    }
+}
+
+std::string DescriptorMetric::ToString() const
+{
+    std::stringstream ss;
+    if(mNorm == NormType::HAMMING)
+        ss << "HAMMING";
+    else
+        ss << (mbSquared ? "L2SQR" : "L2") << " x" << mfScale;
+    ss << " | length: " << (mLength > 0 ? std::to_string(mLength) : std::string("generic"));
+    return ss.str();
+}
+
+DescriptorBatch::DescriptorBatch() : mRowBytes(0)
+{
+}
+
+void DescriptorBatch::Clear(const cv::Mat &descriptors)
+{
+    mRowBytes = descriptors.cols * descriptors.elemSize();
+    mvIdx.clear();
+    mvLevel.clear();
+}
+
+DescriptorBatch::Result DescriptorBatch::Match(const DescriptorMetric &metric, const cv::Mat &query, const float maxDist)
+{
+    Result res;
+    res.bestDist = maxDist;
+    res.bestDist2 = maxDist;
+    res.bestIdx = -1;
+    res.bestLevel = -1;
+    res.bestLevel2 = -1;
+
+    const int n = static_cast<int>(mvIdx.size());
+    mvDist.resize(n);
+    if(n == 0 || query.empty())
+        return res;
+
+    metric.Distances(query, mBlock.data(), mRowBytes, n, mvDist.data());
+
+    for(int i=0; i<n; i++)
+    {
+        const float dist = mvDist[i];
+        if(dist < res.bestDist)
+        {
+            res.bestDist2 = res.bestDist;
+            res.bestLevel2 = res.bestLevel;
+            res.bestDist = dist;
+            res.bestLevel = mvLevel[i];
+            res.bestIdx = static_cast<int>(mvIdx[i]);
+        }
+        else if(dist < res.bestDist2)
+        {
+            res.bestDist2 = dist;
+            res.bestLevel2 = mvLevel[i];
+        }
+    }
+
+    return res;
+}
+
+} // namespace ORB_SLAM3
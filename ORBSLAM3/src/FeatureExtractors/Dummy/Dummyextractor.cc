@@ -50,6 +50,23 @@ DummyExtractor::DummyExtractor(int nfeatures, float scaleFactor, int nlevels,
 
     // Configure for specific extractor type
     configureForExtractorType();
+
+    // Use a packed feature cache next to the keypoint files if there is one
+    if(!keypointsDirectory.empty()) {
+        std::string kpDir = keypointsDirectory;
+        while(kpDir.size() > 1 && kpDir.back() == '/')
+            kpDir.pop_back();
+        size_t lastSlash = kpDir.find_last_of('/');
+        std::string parentDir = (lastSlash == std::string::npos) ? "." : kpDir.substr(0, lastSlash);
+
+        for(const std::string& dir : {kpDir, parentDir}) {
+            std::string cachePath = dir + "/" + FeatureCache::DEFAULT_FILENAME;
+            if(featureCache.Open(cachePath)) {
+                std::cout << "Using feature cache: " << cachePath << std::endl;
+                break;
+            }
+        }
+    }
 }
 
 void DummyExtractor::configureForExtractorType() 
@@ -110,6 +127,16 @@ int DummyExtractor::operator()(cv::InputArray _image, cv::InputArray _mask,
     
     // Extract base filename without directory or extension
     std::string baseFilename = getBaseFilename(imagePath);
+
+    if(featureCache.IsOpen()) {
+        cv::Mat descriptors;
+        if(!featureCache.Load(baseFilename, _keypoints, descriptors)) {
+            std::cerr << "Error: No features in cache for " << baseFilename << std::endl;
+            return 0;
+        }
+        descriptors.copyTo(_descriptors);
+        return _keypoints.size();
+    }
     
     // Load keypoints
     bool kptsLoaded = loadKeypoints(baseFilename, _keypoints);
@@ -0,0 +1,310 @@
+/**
+ * File: FeatureCache.cpp
+ * Date: April 2025
+ * Description: Implementation of the packed, memory-mapped feature cache
+ * License: see LICENSE.txt
+ */
+
+#include "FeatureExtractors/Dummy/FeatureCache.h"
+#include "FeatureExtractors/Dummy/FeatureIO.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ORB_SLAM3 {
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'O','R','B','F','C','A','C','H'};
+
+// Number of SoA columns stored per keypoint: x, y, size, angle, response, octave, class_id
+const size_t KEYPOINT_COLUMNS = 7;
+
+static_assert(sizeof(FeatureCache::Header) == 64, "FeatureCache::Header must stay 64 bytes");
+static_assert(sizeof(FeatureCache::FrameEntry) == 32, "FeatureCache::FrameEntry must stay 32 bytes");
+static_assert(sizeof(float) == 4 && sizeof(int) == 4, "FeatureCache stores 32-bit keypoint fields");
+
+uint64_t AlignUp(uint64_t offset)
+{
+    return (offset + FeatureCache::ALIGNMENT - 1) & ~static_cast<uint64_t>(FeatureCache::ALIGNMENT - 1);
+}
+
+void PadTo(std::ofstream& file, uint64_t offset)
+{
+    static const char zeros[FeatureCache::ALIGNMENT] = {0};
+    uint64_t current = static_cast<uint64_t>(file.tellp());
+    if (offset > current)
+        file.write(zeros, offset - current);
+}
+
+bool FileExists(const std::string& path)
+{
+    struct stat buffer;
+    return stat(path.c_str(), &buffer) == 0;
+}
+
+std::string WithSlash(const std::string& dir)
+{
+    return (dir.empty() || dir.back() == '/') ? dir : dir + "/";
+}
+
+} // namespace
+
+FeatureCache::FeatureCache()
+    : mpData(nullptr), mnSize(0), mpHeader(nullptr), mpFrames(nullptr)
+{
+}
+
+FeatureCache::~FeatureCache()
+{
+    Close();
+}
+
+void FeatureCache::Close()
+{
+    if (mpData)
+        munmap(const_cast<uint8_t*>(mpData), mnSize);
+    mpData = nullptr;
+    mnSize = 0;
+    mpHeader = nullptr;
+    mpFrames = nullptr;
+    mIndex.clear();
+}
+
+bool FeatureCache::Open(const std::string& filePath)
+{
+    Close();
+
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        close(fd);
+        std::cerr << "Invalid feature cache: " << filePath << std::endl;
+        return false;
+    }
+
+    void* pMap = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED) {
+        std::cerr << "Unable to map feature cache: " << filePath << std::endl;
+        return false;
+    }
+
+    // Frames are replayed in order, let the kernel read ahead
+    madvise(pMap, st.st_size, MADV_SEQUENTIAL);
+
+    mpData = static_cast<const uint8_t*>(pMap);
+    mnSize = static_cast<size_t>(st.st_size);
+    mpHeader = reinterpret_cast<const Header*>(mpData);
+
+    const Header& header = *mpHeader;
+    bool valid = std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 &&
+                 header.version == VERSION &&
+                 header.fileSize == mnSize &&
+                 header.descriptorRowBytes == CV_ELEM_SIZE(header.descriptorType) * header.descriptorCols &&
+                 header.tableOffset % alignof(FrameEntry) == 0 &&
+                 header.tableOffset <= mnSize &&
+                 header.nFrames <= (mnSize - header.tableOffset) / sizeof(FrameEntry) &&
+                 header.namesOffset <= mnSize;
+    if (!valid) {
+        std::cerr << "Invalid feature cache header: " << filePath << std::endl;
+        Close();
+        return false;
+    }
+
+    mpFrames = reinterpret_cast<const FrameEntry*>(mpData + header.tableOffset);
+    mIndex.reserve(header.nFrames);
+    for (uint32_t i = 0; i < header.nFrames; ++i) {
+        const FrameEntry& entry = mpFrames[i];
+        uint64_t keypointsEnd = entry.keypointsOffset + KEYPOINT_COLUMNS * sizeof(float) * entry.nKeypoints;
+        uint64_t descriptorsEnd = entry.descriptorsOffset + static_cast<uint64_t>(header.descriptorRowBytes) * entry.nKeypoints;
+        uint64_t nameEnd = header.namesOffset + entry.nameOffset + entry.nameLength;
+        if (keypointsEnd > mnSize || descriptorsEnd > mnSize || nameEnd > mnSize ||
+            entry.keypointsOffset % alignof(float) != 0) {
+            std::cerr << "Corrupted feature cache entry " << i << " in " << filePath << std::endl;
+            Close();
+            return false;
+        }
+        const char* name = reinterpret_cast<const char*>(mpData + header.namesOffset + entry.nameOffset);
+        mIndex.emplace(std::string(name, entry.nameLength), i);
+    }
+
+    return true;
+}
+
+bool FeatureCache::Load(const std::string& baseName,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::Mat& descriptors) const
+{
+    auto it = mIndex.find(baseName);
+    if (it == mIndex.end())
+        return false;
+
+    Load(mpFrames[it->second], keypoints, descriptors);
+    return true;
+}
+
+void FeatureCache::Load(const FrameEntry& entry,
+                        std::vector<cv::KeyPoint>& keypoints,
+                        cv::Mat& descriptors) const
+{
+    const size_t n = entry.nKeypoints;
+    const float* x = reinterpret_cast<const float*>(mpData + entry.keypointsOffset);
+    const float* y = x + n;
+    const float* size = y + n;
+    const float* angle = size + n;
+    const float* response = angle + n;
+    const int32_t* octave = reinterpret_cast<const int32_t*>(response + n);
+    const int32_t* classId = octave + n;
+
+    keypoints.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        cv::KeyPoint& kp = keypoints[i];
+        kp.pt.x = x[i];
+        kp.pt.y = y[i];
+        kp.size = size[i];
+        kp.angle = angle[i];
+        kp.response = response[i];
+        kp.octave = octave[i];
+        kp.class_id = classId[i];
+    }
+
+    // Copied out so the descriptors stay valid after the cache is closed
+    if (n == 0) {
+        descriptors = cv::Mat();
+        return;
+    }
+    descriptors.create(static_cast<int>(n), mpHeader->descriptorCols, mpHeader->descriptorType);
+    std::memcpy(descriptors.data, mpData + entry.descriptorsOffset, n * mpHeader->descriptorRowBytes);
+}
+
+bool FeatureCache::Write(const std::vector<std::string>& baseNames,
+                         const std::string& keypointsDir,
+                         const std::string& descriptorsDir,
+                         const std::string& outputPath)
+{
+    std::ofstream file(outputPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file for writing feature cache: " << outputPath << std::endl;
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = VERSION;
+    header.descriptorType = -1;
+
+    // Header is rewritten once the offsets are known
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<FrameEntry> entries;
+    std::string names;
+    entries.reserve(baseNames.size());
+
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    std::vector<float> column;
+    std::vector<int32_t> columnInt;
+
+    const std::string kpDir = WithSlash(keypointsDir);
+    const std::string descDir = WithSlash(descriptorsDir);
+
+    for (const std::string& baseName : baseNames) {
+        std::string kptsFilePath = kpDir + baseName + ".kp";
+        if (!FileExists(kptsFilePath))
+            kptsFilePath = kpDir + baseName + ".kpts";
+        std::string descFilePath = descDir + baseName + ".desc";
+
+        if (!FileExists(kptsFilePath) || !FileExists(descFilePath) ||
+            !FeatureIO::loadFeatures(keypoints, descriptors, kptsFilePath, descFilePath)) {
+            std::cerr << "Skipping " << baseName << ": missing keypoints or descriptors" << std::endl;
+            continue;
+        }
+
+        if (descriptors.rows != static_cast<int>(keypoints.size())) {
+            std::cerr << "Skipping " << baseName << ": " << keypoints.size() << " keypoints but "
+                      << descriptors.rows << " descriptors" << std::endl;
+            continue;
+        }
+
+        if (header.descriptorType < 0) {
+            header.descriptorType = descriptors.type();
+            header.descriptorCols = descriptors.cols;
+            header.descriptorRowBytes = static_cast<uint32_t>(descriptors.cols * descriptors.elemSize());
+        }
+        else if (descriptors.type() != header.descriptorType || descriptors.cols != header.descriptorCols) {
+            std::cerr << "Skipping " << baseName << ": descriptor layout differs from the first frame" << std::endl;
+            continue;
+        }
+
+        const size_t n = keypoints.size();
+        FrameEntry entry;
+        std::memset(&entry, 0, sizeof(entry));
+        entry.nKeypoints = static_cast<uint32_t>(n);
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint32_t>(baseName.size());
+        names += baseName;
+
+        entry.keypointsOffset = AlignUp(static_cast<uint64_t>(file.tellp()));
+        PadTo(file, entry.keypointsOffset);
+
+        column.resize(n);
+        columnInt.resize(n);
+        const size_t floatBytes = n * sizeof(float);
+        for (size_t i = 0; i < n; ++i) column[i] = keypoints[i].pt.x;
+        file.write(reinterpret_cast<const char*>(column.data()), floatBytes);
+        for (size_t i = 0; i < n; ++i) column[i] = keypoints[i].pt.y;
+        file.write(reinterpret_cast<const char*>(column.data()), floatBytes);
+        for (size_t i = 0; i < n; ++i) column[i] = keypoints[i].size;
+        file.write(reinterpret_cast<const char*>(column.data()), floatBytes);
+        for (size_t i = 0; i < n; ++i) column[i] = keypoints[i].angle;
+        file.write(reinterpret_cast<const char*>(column.data()), floatBytes);
+        for (size_t i = 0; i < n; ++i) column[i] = keypoints[i].response;
+        file.write(reinterpret_cast<const char*>(column.data()), floatBytes);
+        for (size_t i = 0; i < n; ++i) columnInt[i] = keypoints[i].octave;
+        file.write(reinterpret_cast<const char*>(columnInt.data()), floatBytes);
+        for (size_t i = 0; i < n; ++i) columnInt[i] = keypoints[i].class_id;
+        file.write(reinterpret_cast<const char*>(columnInt.data()), floatBytes);
+
+        entry.descriptorsOffset = AlignUp(static_cast<uint64_t>(file.tellp()));
+        PadTo(file, entry.descriptorsOffset);
+        for (int i = 0; i < descriptors.rows; ++i)
+            file.write(reinterpret_cast<const char*>(descriptors.ptr(i)), header.descriptorRowBytes);
+
+        entries.push_back(entry);
+    }
+
+    if (header.descriptorType < 0) {
+        std::cerr << "No frames could be packed into " << outputPath << std::endl;
+        return false;
+    }
+
+    header.nFrames = static_cast<uint32_t>(entries.size());
+    header.tableOffset = AlignUp(static_cast<uint64_t>(file.tellp()));
+    PadTo(file, header.tableOffset);
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(FrameEntry));
+
+    header.namesOffset = static_cast<uint64_t>(file.tellp());
+    file.write(names.data(), names.size());
+    header.fileSize = static_cast<uint64_t>(file.tellp());
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+
+    if (!file) {
+        std::cerr << "Error while writing feature cache: " << outputPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace ORB_SLAM3
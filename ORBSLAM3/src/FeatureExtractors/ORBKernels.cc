@@ -0,0 +1,335 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* ORBKernels.cc - Scalar and AVX2 / SSE4.1 orientation and rBRIEF descriptor kernels
+*
+* This file is built with -ffp-contract=off: the rotated sample positions must be rounded
+* from the same mul/add sequence in every version, or a fused multiply-add in one of them
+* could move a sample by one pixel and flip a descriptor bit.
+*/
+
+#include "ORBKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ORB_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace ORB_SLAM3
+{
+
+namespace ORBKernels
+{
+
+    const float factorPI = (float)(CV_PI/180.f);
+
+    ICAngleWeights::ICAngleWeights(const std::vector<int>& u_max) : umax(u_max)
+    {
+        std::memset(wu, 0, sizeof(wu));
+        std::memset(wv, 0, sizeof(wv));
+
+        // The center line is summed over the whole patch width
+        for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
+            wu[0][u + HALF_PATCH_SIZE] = (int16_t)u;
+
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+        {
+            const int d = umax[v];
+            for (int u = -d; u <= d; ++u)
+            {
+                wu[v][u + HALF_PATCH_SIZE] = (int16_t)u;
+                wv[v][u + HALF_PATCH_SIZE] = (int16_t)v;
+            }
+        }
+    }
+
+    DescriptorPattern::DescriptorPattern(const std::vector<cv::Point>& pattern) : points(pattern)
+    {
+        for (int i = 0; i < 2*DESCRIPTOR_PAIRS; i++)
+        {
+            x[i] = (float)points[i].x;
+            y[i] = (float)points[i].y;
+        }
+    }
+
+    static inline void RotationOf(float angle, float& a, float& b)
+    {
+        angle *= factorPI;
+        a = std::cos(angle);
+        b = std::sin(angle);
+    }
+
+    void ICMomentsScalar(const uint8_t* center, int step, const ICAngleWeights& w, int& m_01, int& m_10)
+    {
+        m_01 = 0;
+        m_10 = 0;
+
+        // Treat the center line differently, v=0
+        for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
+            m_10 += u * center[u];
+
+        // Go line by line in the circular patch
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+        {
+            // Proceed over the two lines
+            int v_sum = 0;
+            int d = w.umax[v];
+            for (int u = -d; u <= d; ++u)
+            {
+                int val_plus = center[u + v*step], val_minus = center[u - v*step];
+                v_sum += (val_plus - val_minus);
+                m_10 += u * (val_plus + val_minus);
+            }
+            m_01 += v * v_sum;
+        }
+    }
+
+    void DescribeScalar(const uint8_t* center, int step, float angle, const DescriptorPattern& pattern, uint8_t* desc)
+    {
+        float a, b;
+        RotationOf(angle, a, b);
+
+        const cv::Point* p = &pattern.points[0];
+
+#define GET_VALUE(idx) \
+        center[cvRound(p[idx].x*b + p[idx].y*a)*step + \
+               cvRound(p[idx].x*a - p[idx].y*b)]
+
+        for (int i = 0; i < 32; ++i, p += 16)
+        {
+            int t0, t1, val;
+            t0 = GET_VALUE(0); t1 = GET_VALUE(1);
+            val = t0 < t1;
+            t0 = GET_VALUE(2); t1 = GET_VALUE(3);
+            val |= (t0 < t1) << 1;
+            t0 = GET_VALUE(4); t1 = GET_VALUE(5);
+            val |= (t0 < t1) << 2;
+            t0 = GET_VALUE(6); t1 = GET_VALUE(7);
+            val |= (t0 < t1) << 3;
+            t0 = GET_VALUE(8); t1 = GET_VALUE(9);
+            val |= (t0 < t1) << 4;
+            t0 = GET_VALUE(10); t1 = GET_VALUE(11);
+            val |= (t0 < t1) << 5;
+            t0 = GET_VALUE(12); t1 = GET_VALUE(13);
+            val |= (t0 < t1) << 6;
+            t0 = GET_VALUE(14); t1 = GET_VALUE(15);
+            val |= (t0 < t1) << 7;
+
+            desc[i] = (uint8_t)val;
+        }
+
+#undef GET_VALUE
+    }
+
+#ifdef ORB_KERNELS_X86
+
+    // The vector descriptor kernels compute the 512 sample offsets with SIMD, gather the
+    // intensities of each pair into two arrays and compare 32 (or 16) pairs per instruction.
+    // Pair j of the descriptor is bit j%8 of byte j/8, which is exactly the movemask bit order.
+
+    __attribute__((target("avx2")))
+    static void ICMomentsAVX2(const uint8_t* center, int step, const ICAngleWeights& w, int& m_01, int& m_10)
+    {
+        const uint8_t* row = center - HALF_PATCH_SIZE;
+
+        __m256i acc10, acc01 = _mm256_setzero_si256();
+        {
+            const __m256i c = _mm256_loadu_si256((const __m256i*)row);
+            const __m256i c0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(c));
+            const __m256i c1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(c, 1));
+            acc10 = _mm256_add_epi32(_mm256_madd_epi16(c0, _mm256_load_si256((const __m256i*)&w.wu[0][0])),
+                                     _mm256_madd_epi16(c1, _mm256_load_si256((const __m256i*)&w.wu[0][16])));
+        }
+
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+        {
+            const __m256i P = _mm256_loadu_si256((const __m256i*)(row + v*step));
+            const __m256i M = _mm256_loadu_si256((const __m256i*)(row - v*step));
+            const __m256i P0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(P));
+            const __m256i P1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(P, 1));
+            const __m256i M0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(M));
+            const __m256i M1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(M, 1));
+
+            const __m256i wu0 = _mm256_load_si256((const __m256i*)&w.wu[v][0]);
+            const __m256i wu1 = _mm256_load_si256((const __m256i*)&w.wu[v][16]);
+            const __m256i wv0 = _mm256_load_si256((const __m256i*)&w.wv[v][0]);
+            const __m256i wv1 = _mm256_load_si256((const __m256i*)&w.wv[v][16]);
+
+            acc10 = _mm256_add_epi32(acc10, _mm256_madd_epi16(_mm256_add_epi16(P0, M0), wu0));
+            acc10 = _mm256_add_epi32(acc10, _mm256_madd_epi16(_mm256_add_epi16(P1, M1), wu1));
+            acc01 = _mm256_add_epi32(acc01, _mm256_madd_epi16(_mm256_sub_epi16(P0, M0), wv0));
+            acc01 = _mm256_add_epi32(acc01, _mm256_madd_epi16(_mm256_sub_epi16(P1, M1), wv1));
+        }
+
+        // Horizontal sums: [m_10 x4 | m_01 x4] -> scalars
+        __m128i s10 = _mm_add_epi32(_mm256_castsi256_si128(acc10), _mm256_extracti128_si256(acc10, 1));
+        __m128i s01 = _mm_add_epi32(_mm256_castsi256_si128(acc01), _mm256_extracti128_si256(acc01, 1));
+        __m128i s = _mm_hadd_epi32(s10, s01);
+        s = _mm_hadd_epi32(s, s);
+        m_10 = _mm_cvtsi128_si32(s);
+        m_01 = _mm_extract_epi32(s, 1);
+    }
+
+    __attribute__((target("avx2")))
+    static void DescribeAVX2(const uint8_t* center, int step, float angle, const DescriptorPattern& pattern, uint8_t* desc)
+    {
+        float a, b;
+        RotationOf(angle, a, b);
+
+        const __m256 va = _mm256_set1_ps(a);
+        const __m256 vb = _mm256_set1_ps(b);
+        const __m256i vstep = _mm256_set1_epi32(step);
+
+        alignas(32) int32_t offsets[2*DESCRIPTOR_PAIRS];
+        for (int i = 0; i < 2*DESCRIPTOR_PAIRS; i += 8)
+        {
+            const __m256 x = _mm256_load_ps(pattern.x + i);
+            const __m256 y = _mm256_load_ps(pattern.y + i);
+            const __m256i r = _mm256_cvtps_epi32(_mm256_add_ps(_mm256_mul_ps(x, vb), _mm256_mul_ps(y, va)));
+            const __m256i c = _mm256_cvtps_epi32(_mm256_sub_ps(_mm256_mul_ps(x, va), _mm256_mul_ps(y, vb)));
+            _mm256_store_si256((__m256i*)(offsets + i), _mm256_add_epi32(_mm256_mullo_epi32(r, vstep), c));
+        }
+
+        alignas(32) uint8_t t0[DESCRIPTOR_PAIRS], t1[DESCRIPTOR_PAIRS];
+        for (int j = 0; j < DESCRIPTOR_PAIRS; j++)
+        {
+            t0[j] = center[offsets[2*j]];
+            t1[j] = center[offsets[2*j+1]];
+        }
+
+        // Unsigned t0 < t1 as a signed compare on sign-flipped bytes
+        const __m256i bias = _mm256_set1_epi8((char)0x80);
+        for (int j = 0; j < DESCRIPTOR_PAIRS; j += 32)
+        {
+            const __m256i v0 = _mm256_xor_si256(_mm256_load_si256((const __m256i*)(t0 + j)), bias);
+            const __m256i v1 = _mm256_xor_si256(_mm256_load_si256((const __m256i*)(t1 + j)), bias);
+            const uint32_t bits = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(v1, v0));
+            std::memcpy(desc + j/8, &bits, 4);
+        }
+    }
+
+    __attribute__((target("sse4.1")))
+    static void ICMomentsSSE41(const uint8_t* center, int step, const ICAngleWeights& w, int& m_01, int& m_10)
+    {
+        const uint8_t* row = center - HALF_PATCH_SIZE;
+
+        __m128i acc10 = _mm_setzero_si128(), acc01 = _mm_setzero_si128();
+        {
+            const __m128i c0 = _mm_loadu_si128((const __m128i*)row);
+            const __m128i c1 = _mm_loadu_si128((const __m128i*)(row + 16));
+            acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(_mm_cvtepu8_epi16(c0), _mm_load_si128((const __m128i*)&w.wu[0][0])));
+            acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(c0, 8)), _mm_load_si128((const __m128i*)&w.wu[0][8])));
+            acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(_mm_cvtepu8_epi16(c1), _mm_load_si128((const __m128i*)&w.wu[0][16])));
+            acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(c1, 8)), _mm_load_si128((const __m128i*)&w.wu[0][24])));
+        }
+
+        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
+        {
+            for (int k = 0; k < 32; k += 16)
+            {
+                const __m128i P = _mm_loadu_si128((const __m128i*)(row + v*step + k));
+                const __m128i M = _mm_loadu_si128((const __m128i*)(row - v*step + k));
+                const __m128i P0 = _mm_cvtepu8_epi16(P), P1 = _mm_cvtepu8_epi16(_mm_srli_si128(P, 8));
+                const __m128i M0 = _mm_cvtepu8_epi16(M), M1 = _mm_cvtepu8_epi16(_mm_srli_si128(M, 8));
+
+                acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(_mm_add_epi16(P0, M0), _mm_load_si128((const __m128i*)&w.wu[v][k])));
+                acc10 = _mm_add_epi32(acc10, _mm_madd_epi16(_mm_add_epi16(P1, M1), _mm_load_si128((const __m128i*)&w.wu[v][k+8])));
+                acc01 = _mm_add_epi32(acc01, _mm_madd_epi16(_mm_sub_epi16(P0, M0), _mm_load_si128((const __m128i*)&w.wv[v][k])));
+                acc01 = _mm_add_epi32(acc01, _mm_madd_epi16(_mm_sub_epi16(P1, M1), _mm_load_si128((const __m128i*)&w.wv[v][k+8])));
+            }
+        }
+
+        __m128i s = _mm_hadd_epi32(acc10, acc01);
+        s = _mm_hadd_epi32(s, s);
+        m_10 = _mm_cvtsi128_si32(s);
+        m_01 = _mm_extract_epi32(s, 1);
+    }
+
+    __attribute__((target("sse4.1")))
+    static void DescribeSSE41(const uint8_t* center, int step, float angle, const DescriptorPattern& pattern, uint8_t* desc)
+    {
+        float a, b;
+        RotationOf(angle, a, b);
+
+        const __m128 va = _mm_set1_ps(a);
+        const __m128 vb = _mm_set1_ps(b);
+        const __m128i vstep = _mm_set1_epi32(step);
+
+        alignas(16) int32_t offsets[2*DESCRIPTOR_PAIRS];
+        for (int i = 0; i < 2*DESCRIPTOR_PAIRS; i += 4)
+        {
+            const __m128 x = _mm_load_ps(pattern.x + i);
+            const __m128 y = _mm_load_ps(pattern.y + i);
+            const __m128i r = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(x, vb), _mm_mul_ps(y, va)));
+            const __m128i c = _mm_cvtps_epi32(_mm_sub_ps(_mm_mul_ps(x, va), _mm_mul_ps(y, vb)));
+            _mm_store_si128((__m128i*)(offsets + i), _mm_add_epi32(_mm_mullo_epi32(r, vstep), c));
+        }
+
+        alignas(16) uint8_t t0[DESCRIPTOR_PAIRS], t1[DESCRIPTOR_PAIRS];
+        for (int j = 0; j < DESCRIPTOR_PAIRS; j++)
+        {
+            t0[j] = center[offsets[2*j]];
+            t1[j] = center[offsets[2*j+1]];
+        }
+
+        const __m128i bias = _mm_set1_epi8((char)0x80);
+        for (int j = 0; j < DESCRIPTOR_PAIRS; j += 16)
+        {
+            const __m128i v0 = _mm_xor_si128(_mm_load_si128((const __m128i*)(t0 + j)), bias);
+            const __m128i v1 = _mm_xor_si128(_mm_load_si128((const __m128i*)(t1 + j)), bias);
+            const uint16_t bits = (uint16_t)_mm_movemask_epi8(_mm_cmpgt_epi8(v1, v0));
+            std::memcpy(desc + j/8, &bits, 2);
+        }
+    }
+
+#endif // ORB_KERNELS_X86
+
+    namespace
+    {
+        struct Dispatch
+        {
+            void (*moments)(const uint8_t*, int, const ICAngleWeights&, int&, int&);
+            void (*describe)(const uint8_t*, int, float, const DescriptorPattern&, uint8_t*);
+            const char* isa;
+        };
+
+        Dispatch Resolve()
+        {
+#ifdef ORB_KERNELS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return {&ICMomentsAVX2, &DescribeAVX2, "AVX2"};
+            if (__builtin_cpu_supports("sse4.1"))
+                return {&ICMomentsSSE41, &DescribeSSE41, "SSE4.1"};
+#endif
+            return {&ICMomentsScalar, &DescribeScalar, "scalar"};
+        }
+
+        const Dispatch& Kernels()
+        {
+            static const Dispatch dispatch = Resolve();
+            return dispatch;
+        }
+    }
+
+    void ICMoments(const uint8_t* center, int step, const ICAngleWeights& w, int& m_01, int& m_10)
+    {
+        Kernels().moments(center, step, w, m_01, m_10);
+    }
+
+    void Describe(const uint8_t* center, int step, float angle, const DescriptorPattern& pattern, uint8_t* desc)
+    {
+        Kernels().describe(center, step, angle, pattern, desc);
+    }
+
+    const char* ActiveISA()
+    {
+        return Kernels().isa;
+    }
+
+} // namespace ORBKernels
+
+} // namespace ORB_SLAM3
@@ -73,76 +73,19 @@ namespace ORB_SLAM3
     const int EDGE_THRESHOLD = 19;
 
 
-    static float IC_Angle(const Mat& image, Point2f pt,  const vector<int> & u_max)
+    static float IC_Angle(const Mat& image, Point2f pt, const ORBKernels::ICAngleWeights& weights)
     {
-        int m_01 = 0, m_10 = 0;
-
-        const uchar* center = &image.at<uchar> (cvRound(pt.y), cvRound(pt.x));
-
-        // Treat the center line differently, v=0
-        for (int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
-            m_10 += u * center[u];
-
-        // Go line by line in the circuI853lar patch
-        int step = (int)image.step1();
-        for (int v = 1; v <= HALF_PATCH_SIZE; ++v)
-        {
-            // Proceed over the two lines
-            int v_sum = 0;
-            int d = u_max[v];
-            for (int u = -d; u <= d; ++u)
-            {
-                int val_plus = center[u + v*step], val_minus = center[u - v*step];
-                v_sum += (val_plus - val_minus);
-                m_10 += u * (val_plus + val_minus);
-            }
-            m_01 += v * v_sum;
-        }
-
+        int m_01, m_10;
+        ORBKernels::ICMoments(&image.at<uchar>(cvRound(pt.y), cvRound(pt.x)), (int)image.step1(), weights, m_01, m_10);
         return fastAtan2((float)m_01, (float)m_10);
     }
 
 
-    const float factorPI = (float)(CV_PI/180.f);
-    static void computeOrbDescriptor(const KeyPoint& kpt,
-                                     const Mat& img, const Point* pattern,
-                                     uchar* desc)
+    static void computeOrbDescriptor(const KeyPoint& kpt, const Mat& img,
+                                     const ORBKernels::DescriptorPattern& pattern, uchar* desc)
     {
-        float angle = (float)kpt.angle*factorPI;
-        float a = (float)cos(angle), b = (float)sin(angle);
-
-        const uchar* center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
-        const int step = (int)img.step;
-
-#define GET_VALUE(idx) \
-        center[cvRound(pattern[idx].x*b + pattern[idx].y*a)*step + \
-               cvRound(pattern[idx].x*a - pattern[idx].y*b)]
-
-
-        for (int i = 0; i < 32; ++i, pattern += 16)
-        {
-            int t0, t1, val;
-            t0 = GET_VALUE(0); t1 = GET_VALUE(1);
-            val = t0 < t1;
-            t0 = GET_VALUE(2); t1 = GET_VALUE(3);
-            val |= (t0 < t1) << 1;
-            t0 = GET_VALUE(4); t1 = GET_VALUE(5);
-            val |= (t0 < t1) << 2;
-            t0 = GET_VALUE(6); t1 = GET_VALUE(7);
-            val |= (t0 < t1) << 3;
-            t0 = GET_VALUE(8); t1 = GET_VALUE(9);
-            val |= (t0 < t1) << 4;
-            t0 = GET_VALUE(10); t1 = GET_VALUE(11);
-            val |= (t0 < t1) << 5;
-            t0 = GET_VALUE(12); t1 = GET_VALUE(13);
-            val |= (t0 < t1) << 6;
-            t0 = GET_VALUE(14); t1 = GET_VALUE(15);
-            val |= (t0 < t1) << 7;
-
-            desc[i] = (uchar)val;
-        }
-
-#undef GET_VALUE
+        ORBKernels::Describe(&img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x)), (int)img.step,
+                             kpt.angle, pattern, desc);
     }
 
 
@@ -407,7 +350,7 @@ namespace ORB_SLAM3
             };
 
     ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels,
-                               int _iniThFAST, int _minThFAST):
+                               int _iniThFAST, int _minThFAST, int _nThreads):
             nfeatures(_nfeatures), scaleFactor(_scaleFactor), nlevels(_nlevels),
             iniThFAST(_iniThFAST), minThFAST(_minThFAST)
     {
@@ -430,6 +373,17 @@ namespace ORB_SLAM3
         }
 
         mvImagePyramid.resize(nlevels);
+        mvPyramidBorder.resize(nlevels);
+        mvBlurredPyramid.resize(nlevels);
+        mvAllKeypoints.resize(nlevels);
+        mvToDistributeKeys.resize(nlevels);
+        mvDstIdx.resize(nlevels);
+        for(int i=0; i<nlevels; i++)
+            mvToDistributeKeys[i].reserve(nfeatures*10);
+
+        // The calling thread takes one level itself, so the pool only needs the remaining workers
+        if(_nThreads > 1)
+            mpThreadPool.reset(new ThreadPool(_nThreads-1));
 
         mnFeaturesPerLevel.resize(nlevels);
         float factor = 1.0f / scaleFactor;
@@ -466,14 +420,17 @@ namespace ORB_SLAM3
             umax[v] = v0;
             ++v0;
         }
+
+        mpAngleWeights.reset(new ORBKernels::ICAngleWeights(umax));
+        mpDescriptorPattern.reset(new ORBKernels::DescriptorPattern(pattern));
     }
 
-    static void computeOrientation(const Mat& image, vector<KeyPoint>& keypoints, const vector<int>& umax)
+    static void computeOrientation(const Mat& image, vector<KeyPoint>& keypoints, const ORBKernels::ICAngleWeights& weights)
     {
         for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
                      keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint)
         {
-            keypoint->angle = IC_Angle(image, keypoint->pt, umax);
+            keypoint->angle = IC_Angle(image, keypoint->pt, weights);
         }
     }
 
@@ -782,117 +739,118 @@ namespace ORB_SLAM3
     {
         allKeypoints.resize(nlevels);
 
+        for (int level = 0; level < nlevels; ++level)
+            ComputeKeyPointsOctTreeLevel(level, allKeypoints[level]);
+    }
+
+    void ORBextractor::ComputeKeyPointsOctTreeLevel(const int level, vector<KeyPoint>& keypoints)
+    {
         const float W = 35;
 
-        for (int level = 0; level < nlevels; ++level)
-        {
-            const int minBorderX = EDGE_THRESHOLD-3;
-            const int minBorderY = minBorderX;
-            const int maxBorderX = mvImagePyramid[level].cols-EDGE_THRESHOLD+3;
-            const int maxBorderY = mvImagePyramid[level].rows-EDGE_THRESHOLD+3;
+        const int minBorderX = EDGE_THRESHOLD-3;
+        const int minBorderY = minBorderX;
+        const int maxBorderX = mvImagePyramid[level].cols-EDGE_THRESHOLD+3;
+        const int maxBorderY = mvImagePyramid[level].rows-EDGE_THRESHOLD+3;
 
-            vector<cv::KeyPoint> vToDistributeKeys;
-            vToDistributeKeys.reserve(nfeatures*10);
+        vector<cv::KeyPoint> &vToDistributeKeys = mvToDistributeKeys[level];
+        vToDistributeKeys.clear();
 
-            const float width = (maxBorderX-minBorderX);
-            const float height = (maxBorderY-minBorderY);
+        vector<cv::KeyPoint> vKeysCell;
 
-            const int nCols = width/W;
-            const int nRows = height/W;
-            const int wCell = ceil(width/nCols);
-            const int hCell = ceil(height/nRows);
+        const float width = (maxBorderX-minBorderX);
+        const float height = (maxBorderY-minBorderY);
 
-            for(int i=0; i<nRows; i++)
-            {
-                const float iniY =minBorderY+i*hCell;
-                float maxY = iniY+hCell+6;
+        const int nCols = width/W;
+        const int nRows = height/W;
+        const int wCell = ceil(width/nCols);
+        const int hCell = ceil(height/nRows);
 
-                if(iniY>=maxBorderY-3)
+        for(int i=0; i<nRows; i++)
+        {
+            const float iniY =minBorderY+i*hCell;
+            float maxY = iniY+hCell+6;
+
+            if(iniY>=maxBorderY-3)
+                continue;
+            if(maxY>maxBorderY)
+                maxY = maxBorderY;
+
+            for(int j=0; j<nCols; j++)
+            {
+                const float iniX =minBorderX+j*wCell;
+                float maxX = iniX+wCell+6;
+                if(iniX>=maxBorderX-6)
                     continue;
-                if(maxY>maxBorderY)
-                    maxY = maxBorderY;
+                if(maxX>maxBorderX)
+                    maxX = maxBorderX;
 
-                for(int j=0; j<nCols; j++)
-                {
-                    const float iniX =minBorderX+j*wCell;
-                    float maxX = iniX+wCell+6;
-                    if(iniX>=maxBorderX-6)
-                        continue;
-                    if(maxX>maxBorderX)
-                        maxX = maxBorderX;
+                vKeysCell.clear();
 
-                    vector<cv::KeyPoint> vKeysCell;
+                FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
+                     vKeysCell,iniThFAST,true);
 
+                /*if(bRight && j <= 13){
+                    FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
+                         vKeysCell,10,true);
+                }
+                else if(!bRight && j >= 16){
+                    FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
+                         vKeysCell,10,true);
+                }
+                else{
                     FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
                          vKeysCell,iniThFAST,true);
+                }*/
+
 
+                if(vKeysCell.empty())
+                {
+                    FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
+                         vKeysCell,minThFAST,true);
                     /*if(bRight && j <= 13){
                         FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,10,true);
+                             vKeysCell,5,true);
                     }
                     else if(!bRight && j >= 16){
                         FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,10,true);
+                             vKeysCell,5,true);
                     }
                     else{
-                        FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                             vKeysCell,iniThFAST,true);
-                    }*/
-
-
-                    if(vKeysCell.empty())
-                    {
                         FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
                              vKeysCell,minThFAST,true);
-                        /*if(bRight && j <= 13){
-                            FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                                 vKeysCell,5,true);
-                        }
-                        else if(!bRight && j >= 16){
-                            FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                                 vKeysCell,5,true);
-                        }
-                        else{
-                            FAST(mvImagePyramid[level].rowRange(iniY,maxY).colRange(iniX,maxX),
-                                 vKeysCell,minThFAST,true);
-                        }*/
-                    }
+                    }*/
+                }
 
-                    if(!vKeysCell.empty())
+                if(!vKeysCell.empty())
+                {
+                    for(vector<cv::KeyPoint>::iterator vit=vKeysCell.begin(); vit!=vKeysCell.end();vit++)
                     {
-                        for(vector<cv::KeyPoint>::iterator vit=vKeysCell.begin(); vit!=vKeysCell.end();vit++)
-                        {
-                            (*vit).pt.x+=j*wCell;
-                            (*vit).pt.y+=i*hCell;
-                            vToDistributeKeys.push_back(*vit);
-                        }
+                        (*vit).pt.x+=j*wCell;
+                        (*vit).pt.y+=i*hCell;
+                        vToDistributeKeys.push_back(*vit);
                     }
-
                 }
-            }
 
-            vector<KeyPoint> & keypoints = allKeypoints[level];
-            keypoints.reserve(nfeatures);
+            }
+        }
 
-            keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
-                                          minBorderY, maxBorderY,mnFeaturesPerLevel[level], level);
+        keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX,
+                                      minBorderY, maxBorderY,mnFeaturesPerLevel[level], level);
 
-            const int scaledPatchSize = PATCH_SIZE*mvScaleFactor[level];
+        const int scaledPatchSize = PATCH_SIZE*mvScaleFactor[level];
 
-            // Add border to coordinates and scale information
-            const int nkps = keypoints.size();
-            for(int i=0; i<nkps ; i++)
-            {
-                keypoints[i].pt.x+=minBorderX;
-                keypoints[i].pt.y+=minBorderY;
-                keypoints[i].octave=level;
-                keypoints[i].size = scaledPatchSize;
-            }
+        // Add border to coordinates and scale information
+        const int nkps = keypoints.size();
+        for(int i=0; i<nkps ; i++)
+        {
+            keypoints[i].pt.x+=minBorderX;
+            keypoints[i].pt.y+=minBorderY;
+            keypoints[i].octave=level;
+            keypoints[i].size = scaledPatchSize;
         }
 
         // compute orientations
-        for (int level = 0; level < nlevels; ++level)
-            computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+        computeOrientation(mvImagePyramid[level], keypoints, *mpAngleWeights);
     }
 
     void ORBextractor::ComputeKeyPointsOld(std::vector<std::vector<KeyPoint> > &allKeypoints)
@@ -1071,16 +1029,33 @@ namespace ORB_SLAM3
 
         // and compute orientations
         for (int level = 0; level < nlevels; ++level)
-            computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+            computeOrientation(mvImagePyramid[level], allKeypoints[level], *mpAngleWeights);
     }
 
-    static void computeDescriptors(const Mat& image, vector<KeyPoint>& keypoints, Mat& descriptors,
-                                   const vector<Point>& pattern)
+    void ORBextractor::ComputeDescriptorsLevel(const int level, vector<KeyPoint>& keypoints,
+                                               const vector<int>& vDstIdx, Mat& descriptors)
     {
-        descriptors = Mat::zeros((int)keypoints.size(), 32, CV_8UC1);
+        if(keypoints.empty())
+            return;
+
+        // preprocess the resized image, the level is a view into the bordered buffer so keep the blur inside it
+        GaussianBlur(mvImagePyramid[level], mvBlurredPyramid[level], Size(7, 7), 2, 2, BORDER_REFLECT_101+BORDER_ISOLATED);
 
+        // Compute the descriptors straight into their output rows
         for (size_t i = 0; i < keypoints.size(); i++)
-            computeOrbDescriptor(keypoints[i], image, &pattern[0], descriptors.ptr((int)i));
+            computeOrbDescriptor(keypoints[i], mvBlurredPyramid[level], *mpDescriptorPattern, descriptors.ptr(vDstIdx[i]));
+    }
+
+    template<typename F>
+    void ORBextractor::ForEachLevel(F&& f)
+    {
+        if(mpThreadPool)
+            mpThreadPool->ParallelFor(nlevels, f);
+        else
+        {
+            for (int level = 0; level < nlevels; ++level)
+                f(level);
+        }
     }
 
     int ORBextractor::operator()( const cv::Mat& image, cv::InputArray _mask, vector<KeyPoint>& _keypoints,
@@ -1090,79 +1065,61 @@ namespace ORB_SLAM3
         if(image.empty())
             return -1;
 
-        Mat image_copy = image.clone();
-        assert(image_copy.type() == CV_8UC1 );
+        assert(image.type() == CV_8UC1 );
 
-        // Pre-compute the scale pyramid
-        ComputePyramid(image_copy);
+        // Pre-compute the scale pyramid. It is copied into the bordered buffers, so the input needs no clone
+        ComputePyramid(image);
 
-        vector < vector<KeyPoint> > allKeypoints;
-        ComputeKeyPointsOctTree(allKeypoints);
-        //ComputeKeyPointsOld(allKeypoints);
-
-        Mat descriptors_temp;
+        // Detect, distribute and orient each level independently
+        ForEachLevel([this](int level) { ComputeKeyPointsOctTreeLevel(level, mvAllKeypoints[level]); });
 
         int nkeypoints = 0;
         for (int level = 0; level < nlevels; ++level)
-            nkeypoints += (int)allKeypoints[level].size();
+            nkeypoints += (int)mvAllKeypoints[level].size();
         if( nkeypoints == 0 )
             descriptors = cv::Mat();
         else
-        {
             descriptors.create(nkeypoints, 32, CV_8U);
-            descriptors_temp = descriptors;
-        }
 
-        //_keypoints.clear();
-        //_keypoints.reserve(nkeypoints);
-        _keypoints = vector<cv::KeyPoint>(nkeypoints);
+        _keypoints.resize(nkeypoints);
 
-        int offset = 0;
         //Modified for speeding up stereo fisheye matching
+        //Output rows are assigned in level order: mono keypoints from the front, lapping area ones from the back
         int monoIndex = 0, stereoIndex = nkeypoints-1;
         for (int level = 0; level < nlevels; ++level)
         {
-            vector<KeyPoint>& keypoints = allKeypoints[level];
-            int nkeypointsLevel = (int)keypoints.size();
-
-            if(nkeypointsLevel==0)
-                continue;
-
-            // preprocess the resized image
-            Mat workingMat = mvImagePyramid[level].clone();
-            GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
-
-            // Compute the descriptors
-            //Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-            Mat desc = cv::Mat(nkeypointsLevel, 32, CV_8U);
-            computeDescriptors(workingMat, keypoints, desc, pattern);
-
-            offset += nkeypointsLevel;
+            const vector<KeyPoint>& keypoints = mvAllKeypoints[level];
+            vector<int>& vDstIdx = mvDstIdx[level];
+            vDstIdx.resize(keypoints.size());
 
+            const float scale = mvScaleFactor[level]; //getScale(level, firstLevel, scaleFactor);
+            for (size_t i = 0; i < keypoints.size(); i++)
+            {
+                const float x = (level != 0) ? keypoints[i].pt.x*scale : keypoints[i].pt.x;
+                if(x >= vLappingArea[0] && x <= vLappingArea[1])
+                    vDstIdx[i] = stereoIndex--;
+                else
+                    vDstIdx[i] = monoIndex++;
+            }
+        }
 
-            float scale = mvScaleFactor[level]; //getScale(level, firstLevel, scaleFactor);
-            int i = 0;
-            for (vector<KeyPoint>::iterator keypoint = keypoints.begin(),
-                         keypointEnd = keypoints.end(); keypoint != keypointEnd; ++keypoint){
+        // Describe each level on its own blurred copy and scatter the results to their rows
+        ForEachLevel([&](int level) {
+            vector<KeyPoint>& keypoints = mvAllKeypoints[level];
+            const vector<int>& vDstIdx = mvDstIdx[level];
 
-                // Scale keypoint coordinates
-                if (level != 0){
-                    keypoint->pt *= scale;
-                }
+            ComputeDescriptorsLevel(level, keypoints, vDstIdx, descriptors);
 
-                if(keypoint->pt.x >= vLappingArea[0] && keypoint->pt.x <= vLappingArea[1]){
-                    _keypoints.at(stereoIndex) = (*keypoint);
-                    desc.row(i).copyTo(descriptors.row(stereoIndex));
-                    stereoIndex--;
-                }
-                else{
-                    _keypoints.at(monoIndex) = (*keypoint);
-                    desc.row(i).copyTo(descriptors.row(monoIndex));
-                    monoIndex++;
-                }
-                i++;
+            // Scale keypoint coordinates
+            const float scale = mvScaleFactor[level];
+            for (size_t i = 0; i < keypoints.size(); i++)
+            {
+                if (level != 0)
+                    keypoints[i].pt *= scale;
+                _keypoints[vDstIdx[i]] = keypoints[i];
             }
-        }
+        });
+
         //cout << "[ORBextractor]: extracted " << _keypoints.size() << " KeyPoints" << endl;
         return monoIndex;
     }
@@ -1174,7 +1131,9 @@ namespace ORB_SLAM3
             float scale = mvInvScaleFactor[level];
             Size sz(cvRound((float)image.cols*scale), cvRound((float)image.rows*scale));
             Size wholeSize(sz.width + EDGE_THRESHOLD*2, sz.height + EDGE_THRESHOLD*2);
-            Mat temp(wholeSize, image.type()), masktemp;
+            // create() only reallocates when the image size changes
+            mvPyramidBorder[level].create(wholeSize, image.type());
+            Mat &temp = mvPyramidBorder[level];
             mvImagePyramid[level] = temp(Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
 
             // Compute the resized image
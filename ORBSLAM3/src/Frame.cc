@@ -27,6 +27,12 @@
 #include "GeometricCamera.h"
 
 #include <thread>
+#include <cstring>
+#include <exception>
+#include <future>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include <include/CameraModels/Pinhole.h>
 #include <include/CameraModels/KannalaBrandt8.h>
 
@@ -42,7 +48,8 @@ float Frame::mfGridElementWidthInv, Frame::mfGridElementHeightInv;
 //For stereo fisheye matching
 cv::BFMatcher Frame::BFmatcher = cv::BFMatcher(cv::NORM_HAMMING);
 
-Frame::Frame(): mpcpi(NULL), mpImuPreintegrated(NULL), mpPrevFrame(NULL), mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbIsSet(false), mbImuPreintegrated(false), mbHasPose(false), mbHasVelocity(false)
+Frame::Frame(): mpcpi(NULL), mpImuPreintegrated(NULL), mpPrevFrame(NULL), mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbIsSet(false), mbImuPreintegrated(false), mbHasPose(false), mbHasVelocity(false),
+     mpFeatures(std::make_shared<FrameFeatures>())
 {
 #ifdef REGISTER_TIMES
     mTimeStereoMatch = 0;
@@ -55,10 +62,7 @@ Frame::Frame(): mpcpi(NULL), mpImuPreintegrated(NULL), mpPrevFrame(NULL), mpImuP
 Frame::Frame(const Frame &frame)
     :mpcpi(frame.mpcpi),mpORBvocabulary(frame.mpORBvocabulary), mpORBextractorLeft(frame.mpORBextractorLeft), mpORBextractorRight(frame.mpORBextractorRight),
      mTimeStamp(frame.mTimeStamp), mK(frame.mK.clone()), mK_(Converter::toMatrix3f(frame.mK)), mDistCoef(frame.mDistCoef.clone()),
-     mbf(frame.mbf), mb(frame.mb), mThDepth(frame.mThDepth), N(frame.N), mvKeys(frame.mvKeys),
-     mvKeysRight(frame.mvKeysRight), mvKeysUn(frame.mvKeysUn), mvuRight(frame.mvuRight),
-     mvDepth(frame.mvDepth), mBowVec(frame.mBowVec), mFeatVec(frame.mFeatVec),
-     mDescriptors(frame.mDescriptors.clone()), mDescriptorsRight(frame.mDescriptorsRight.clone()),
+     mbf(frame.mbf), mb(frame.mb), mThDepth(frame.mThDepth), N(frame.N), mpFeatures(frame.mpFeatures),
      mvpMapPoints(frame.mvpMapPoints), mvbOutlier(frame.mvbOutlier), mImuCalib(frame.mImuCalib), mnCloseMPs(frame.mnCloseMPs),
      mpImuPreintegrated(frame.mpImuPreintegrated), mpImuPreintegratedFrame(frame.mpImuPreintegratedFrame), mImuBias(frame.mImuBias),
      mnId(frame.mnId), mpReferenceKF(frame.mpReferenceKF), mnScaleLevels(frame.mnScaleLevels),
@@ -67,19 +71,11 @@ Frame::Frame(const Frame &frame)
      mvLevelSigma2(frame.mvLevelSigma2), mvInvLevelSigma2(frame.mvInvLevelSigma2), mpPrevFrame(frame.mpPrevFrame), mpLastKeyFrame(frame.mpLastKeyFrame),
      mbIsSet(frame.mbIsSet), mbImuPreintegrated(frame.mbImuPreintegrated), mpMutexImu(frame.mpMutexImu),
      mpCamera(frame.mpCamera), mpCamera2(frame.mpCamera2), Nleft(frame.Nleft), Nright(frame.Nright),
-     monoLeft(frame.monoLeft), monoRight(frame.monoRight), mvLeftToRightMatch(frame.mvLeftToRightMatch),
-     mvRightToLeftMatch(frame.mvRightToLeftMatch), mvStereo3Dpoints(frame.mvStereo3Dpoints),
+     monoLeft(frame.monoLeft), monoRight(frame.monoRight),
      mTlr(frame.mTlr), mRlr(frame.mRlr), mtlr(frame.mtlr), mTrl(frame.mTrl),
      mTcw(frame.mTcw), mbHasPose(false), mbHasVelocity(false)
 {
     image = frame.image;
-    for(int i=0;i<FRAME_GRID_COLS;i++)
-        for(int j=0; j<FRAME_GRID_ROWS; j++){
-            mGrid[i][j]=frame.mGrid[i][j];
-            if(frame.Nleft > 0){
-                mGridRight[i][j] = frame.mGridRight[i][j];
-            }
-        }
 
     if(frame.mbHasPose)
         SetPose(frame.GetPose());
@@ -99,10 +95,11 @@ Frame::Frame(const Frame &frame)
 }
 
 
-Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera, Frame* pPrevF, const IMU::Calib &ImuCalib)
+Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera, Frame* pPrevF, const IMU::Calib &ImuCalib, StereoExtractorWorkers* pWorkers)
     :mpcpi(NULL), mpORBvocabulary(voc),mpORBextractorLeft(extractorLeft),mpORBextractorRight(extractorRight), mTimeStamp(timeStamp), mK(K.clone()), mK_(Converter::toMatrix3f(K)), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
      mImuCalib(ImuCalib), mpImuPreintegrated(NULL), mpPrevFrame(pPrevF),mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbIsSet(false), mbImuPreintegrated(false),
-     mpCamera(pCamera) ,mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false)
+     mpCamera(pCamera) ,mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false),
+     mpFeatures(std::make_shared<FrameFeatures>())
 {
     // Frame ID
     mnId=nNextId++;
@@ -120,26 +117,25 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartExtORB = std::chrono::steady_clock::now();
 #endif
-    thread threadLeft(&Frame::ExtractORB,this,0,imLeft,0,0);
-    thread threadRight(&Frame::ExtractORB,this,1,imRight,0,0);
-    threadLeft.join();
-    threadRight.join();
+    // The left keypoints are undistorted while the right image is still being extracted
+    ExtractStereoORB(imLeft,imRight,0,0,0,0,pWorkers,[this]() {
+        N = mpFeatures->mvKeys.size();
+        if(!mpFeatures->mvKeys.empty())
+            UndistortKeyPoints();
+    });
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_EndExtORB = std::chrono::steady_clock::now();
 
     mTimeORB_Ext = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndExtORB - time_StartExtORB).count();
 #endif
 
-    N = mvKeys.size();
-    if(mvKeys.empty())
+    if(mpFeatures->mvKeys.empty())
         return;
 
-    UndistortKeyPoints();
-
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartStereoMatches = std::chrono::steady_clock::now();
 #endif
-    ComputeStereoMatches();
+    ComputeStereoMatches(pWorkers);
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_EndStereoMatches = std::chrono::steady_clock::now();
 
@@ -189,9 +185,9 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
     //Set no stereo fisheye information
     Nleft = -1;
     Nright = -1;
-    mvLeftToRightMatch = vector<int>(0);
-    mvRightToLeftMatch = vector<int>(0);
-    mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
+    mpFeatures->mvLeftToRightMatch = vector<int>(0);
+    mpFeatures->mvRightToLeftMatch = vector<int>(0);
+    mpFeatures->mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
     monoLeft = -1;
     monoRight = -1;
 
@@ -202,7 +198,8 @@ Frame::Frame(const cv::Mat &imGray, const cv::Mat &imDepth, const double &timeSt
     :mpcpi(NULL),mpORBvocabulary(voc),mpORBextractorLeft(extractor),mpORBextractorRight(static_cast<FeatureExtractor*>(NULL)),
      mTimeStamp(timeStamp), mK(K.clone()), mK_(Converter::toMatrix3f(K)),mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
      mImuCalib(ImuCalib), mpImuPreintegrated(NULL), mpPrevFrame(pPrevF), mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbIsSet(false), mbImuPreintegrated(false),
-     mpCamera(pCamera),mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false)
+     mpCamera(pCamera),mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false),
+     mpFeatures(std::make_shared<FrameFeatures>())
 {
     // Frame ID
     mnId=nNextId++;
@@ -228,9 +225,9 @@ Frame::Frame(const cv::Mat &imGray, const cv::Mat &imDepth, const double &timeSt
 #endif
 
 
-    N = mvKeys.size();
+    N = mpFeatures->mvKeys.size();
 
-    if(mvKeys.empty())
+    if(mpFeatures->mvKeys.empty())
         return;
 
     UndistortKeyPoints();
@@ -277,9 +274,9 @@ Frame::Frame(const cv::Mat &imGray, const cv::Mat &imDepth, const double &timeSt
     //Set no stereo fisheye information
     Nleft = -1;
     Nright = -1;
-    mvLeftToRightMatch = vector<int>(0);
-    mvRightToLeftMatch = vector<int>(0);
-    mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
+    mpFeatures->mvLeftToRightMatch = vector<int>(0);
+    mpFeatures->mvRightToLeftMatch = vector<int>(0);
+    mpFeatures->mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
     monoLeft = -1;
     monoRight = -1;
 
@@ -292,7 +289,8 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, FeatureExtractor* e
     :mpcpi(NULL),mpORBvocabulary(voc),mpORBextractorLeft(extractor),mpORBextractorRight(static_cast<FeatureExtractor*>(NULL)),
      mTimeStamp(timeStamp), mK(static_cast<Pinhole*>(pCamera)->toK()), mK_(static_cast<Pinhole*>(pCamera)->toK_()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
      mImuCalib(ImuCalib), mpImuPreintegrated(NULL),mpPrevFrame(pPrevF),mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbIsSet(false), mbImuPreintegrated(false), mpCamera(pCamera),
-     mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false)
+     mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false),
+     mpFeatures(std::make_shared<FrameFeatures>())
 {
     // Frame ID
     mnId=nNextId++;
@@ -320,15 +318,15 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, FeatureExtractor* e
 #endif
 
 
-    N = mvKeys.size();
-    if(mvKeys.empty())
+    N = mpFeatures->mvKeys.size();
+    if(mpFeatures->mvKeys.empty())
         return;
 
     UndistortKeyPoints();
 
     // Set no stereo information
-    mvuRight = vector<float>(N,-1);
-    mvDepth = vector<float>(N,-1);
+    mpFeatures->mvuRight = vector<float>(N,-1);
+    mpFeatures->mvDepth = vector<float>(N,-1);
     mnCloseMPs = 0;
 
     mvpMapPoints = vector<MapPoint*>(N,static_cast<MapPoint*>(NULL));
@@ -362,9 +360,9 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, FeatureExtractor* e
     //Set no stereo fisheye information
     Nleft = -1;
     Nright = -1;
-    mvLeftToRightMatch = vector<int>(0);
-    mvRightToLeftMatch = vector<int>(0);
-    mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
+    mpFeatures->mvLeftToRightMatch = vector<int>(0);
+    mpFeatures->mvRightToLeftMatch = vector<int>(0);
+    mpFeatures->mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
     monoLeft = -1;
     monoRight = -1;
 
@@ -387,11 +385,12 @@ Frame::Frame(const cv::Mat &imGray, const double &timeStamp, FeatureExtractor* e
 
 //Pipelined version
 //This constructor is used for monocular cameras - Piplined case
-Frame::Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabulary* voc, GeometricCamera* pCamera, cv::Mat &distCoef, const float &bf, const float &thDepth, Frame* pPrevF, const IMU::Calib &ImuCalib)
+Frame::Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabulary* voc, GeometricCamera* pCamera, cv::Mat &distCoef, const float &bf, const float &thDepth, Frame* pPrevF, const IMU::Calib &ImuCalib, PrecomputedBoW* pBoW)
     :mpcpi(NULL),mpORBvocabulary(voc),mpORBextractorLeft(extractor),mpORBextractorRight(static_cast<FeatureExtractor*>(NULL)),
      mTimeStamp(Input.timestamp), mK(static_cast<Pinhole*>(pCamera)->toK()), mK_(static_cast<Pinhole*>(pCamera)->toK_()), mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
      mImuCalib(ImuCalib), mpImuPreintegrated(NULL),mpPrevFrame(pPrevF),mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbIsSet(false), mbImuPreintegrated(false), mpCamera(pCamera),
-     mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false)
+     mpCamera2(nullptr), mbHasPose(false), mbHasVelocity(false),
+     mpFeatures(std::make_shared<FrameFeatures>())
 {
     // Frame ID
     mnId=nNextId++;
@@ -412,8 +411,15 @@ Frame::Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabu
     std::chrono::steady_clock::time_point time_StartExtORB = std::chrono::steady_clock::now();
 #endif
     // ExtractORB(0,imGray,0,1000);
-    mvKeys = Input.keypoints;
-    mDescriptors = Input.descriptors;
+    mpFeatures->mvKeys = Input.keypoints;
+    mpFeatures->mDescriptors = Input.descriptors;
+
+    // BoW computed by the pipeline from these same descriptors
+    if(pBoW)
+    {
+        mpFeatures->mBowVec.swap(pBoW->mBowVec);
+        mpFeatures->mFeatVec.swap(pBoW->mFeatVec);
+    }
 
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_EndExtORB = std::chrono::steady_clock::now();
@@ -422,15 +428,15 @@ Frame::Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabu
 #endif
 
 
-    N = mvKeys.size();
-    if(mvKeys.empty())
+    N = mpFeatures->mvKeys.size();
+    if(mpFeatures->mvKeys.empty())
         return;
 
     UndistortKeyPoints();
 
     // Set no stereo information
-    mvuRight = vector<float>(N,-1);
-    mvDepth = vector<float>(N,-1);
+    mpFeatures->mvuRight = vector<float>(N,-1);
+    mpFeatures->mvDepth = vector<float>(N,-1);
     mnCloseMPs = 0;
 
     mvpMapPoints = vector<MapPoint*>(N,static_cast<MapPoint*>(NULL));
@@ -464,9 +470,9 @@ Frame::Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabu
     //Set no stereo fisheye information
     Nleft = -1;
     Nright = -1;
-    mvLeftToRightMatch = vector<int>(0);
-    mvRightToLeftMatch = vector<int>(0);
-    mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
+    mpFeatures->mvLeftToRightMatch = vector<int>(0);
+    mpFeatures->mvRightToLeftMatch = vector<int>(0);
+    mpFeatures->mvStereo3Dpoints = vector<Eigen::Vector3f>(0);
     monoLeft = -1;
     monoRight = -1;
 
@@ -489,34 +495,20 @@ Frame::Frame(const ResultQueueItem& Input, FeatureExtractor* extractor,ORBVocabu
 
 void Frame::AssignFeaturesToGrid()
 {
-    // Fill matrix with points
-    const int nCells = FRAME_GRID_COLS*FRAME_GRID_ROWS;
-
-    int nReserve = 0.5f*N/(nCells);
-
-    for(unsigned int i=0; i<FRAME_GRID_COLS;i++)
-        for (unsigned int j=0; j<FRAME_GRID_ROWS;j++){
-            mGrid[i][j].reserve(nReserve);
-            if(Nleft != -1){
-                mGridRight[i][j].reserve(nReserve);
-            }
-        }
-
-
+    // Fill the flat cell index with points
+    auto posInGrid = [this](const cv::KeyPoint &kp, int &posX, int &posY){ return PosInGrid(kp,posX,posY); };
 
-    for(int i=0;i<N;i++)
+    if(Nleft == -1)
     {
-        const cv::KeyPoint &kp = (Nleft == -1) ? mvKeysUn[i]
-                                                 : (i < Nleft) ? mvKeys[i]
-                                                                 : mvKeysRight[i - Nleft];
-
-        int nGridPosX, nGridPosY;
-        if(PosInGrid(kp,nGridPosX,nGridPosY)){
-            if(Nleft == -1 || i < Nleft)
-                mGrid[nGridPosX][nGridPosY].push_back(i);
-            else
-                mGridRight[nGridPosX][nGridPosY].push_back(i - Nleft);
-        }
+        mpFeatures->mGrid.Build(mpFeatures->mvKeysUn, N, FRAME_GRID_COLS, FRAME_GRID_ROWS, mnMinX, mnMinY,
+                    mfGridElementWidthInv, mfGridElementHeightInv, posInGrid);
+    }
+    else
+    {
+        mpFeatures->mGrid.Build(mpFeatures->mvKeys, Nleft, FRAME_GRID_COLS, FRAME_GRID_ROWS, mnMinX, mnMinY,
+                    mfGridElementWidthInv, mfGridElementHeightInv, posInGrid);
+        mpFeatures->mGridRight.Build(mpFeatures->mvKeysRight, N - Nleft, FRAME_GRID_COLS, FRAME_GRID_ROWS, mnMinX, mnMinY,
+                         mfGridElementWidthInv, mfGridElementHeightInv, posInGrid);
     }
 }
 
@@ -524,17 +516,54 @@ void Frame::ExtractORB(int flag, const cv::Mat &im, const int x0, const int x1)
 {
     vector<int> vLapping = {x0,x1};
     if(flag==0){
-        monoLeft = (*mpORBextractorLeft)(im,cv::Mat(),mvKeys,mDescriptors,vLapping);
+        monoLeft = (*mpORBextractorLeft)(im,cv::Mat(),mpFeatures->mvKeys,mpFeatures->mDescriptors,vLapping);
 #ifdef DEBUG_PRINT
         // Check if DEBUG_SLAM environment variable is set
         if(std::getenv("DEBUG_SLAM") != nullptr)
         {
-            std::cout << "Frame: "<< this->mnId << " | # of features detected: " << mvKeys.size() << std::endl;
+            std::cout << "Frame: "<< this->mnId << " | # of features detected: " << mpFeatures->mvKeys.size() << std::endl;
         }
 #endif
     }
     else
-        monoRight = (*mpORBextractorRight)(im,cv::Mat(),mvKeysRight,mDescriptorsRight,vLapping);
+        monoRight = (*mpORBextractorRight)(im,cv::Mat(),mpFeatures->mvKeysRight,mpFeatures->mDescriptorsRight,vLapping);
+}
+
+void Frame::ExtractStereoORB(const cv::Mat &imLeft, const cv::Mat &imRight, const int x0Left, const int x1Left,
+                             const int x0Right, const int x1Right, StereoExtractorWorkers* pWorkers,
+                             const std::function<void()> &afterLeft)
+{
+    if(!pWorkers)
+    {
+        thread threadLeft(&Frame::ExtractORB,this,0,imLeft,x0Left,x1Left);
+        thread threadRight(&Frame::ExtractORB,this,1,imRight,x0Right,x1Right);
+        threadLeft.join();
+        threadRight.join();
+        if(afterLeft)
+            afterLeft();
+        return;
+    }
+
+    std::future<void> right = pWorkers->right.Submit([&]() { ExtractORB(1,imRight,x0Right,x1Right); });
+    std::future<void> left = pWorkers->left.Submit([&]() { ExtractORB(0,imLeft,x0Left,x1Left); });
+
+    // The right worker writes into this frame, so it is always waited for before anything is rethrown
+    std::exception_ptr eptr;
+    try
+    {
+        left.get();
+        if(afterLeft)
+            afterLeft();
+    }
+    catch(...)
+    {
+        eptr = std::current_exception();
+    }
+    try { right.get(); }
+    catch(...) { if(!eptr) eptr = std::current_exception(); }
+
+    if(eptr)
+        std::rethrow_exception(eptr);
 }
 
 bool Frame::isSet() const {
@@ -770,71 +799,15 @@ Eigen::Vector3f Frame::inRefCoordinates(Eigen::Vector3f pCw)
 vector<size_t> Frame::GetFeaturesInArea(const float &x, const float  &y, const float  &r, const int minLevel, const int maxLevel, const bool bRight) const
 {
     vector<size_t> vIndices;
-    vIndices.reserve(N);
-
-    float factorX = r;
-    float factorY = r;
-
-    const int nMinCellX = max(0,(int)floor((x-mnMinX-factorX)*mfGridElementWidthInv));
-    if(nMinCellX>=FRAME_GRID_COLS)
-    {
-        return vIndices;
-    }
-
-    const int nMaxCellX = min((int)FRAME_GRID_COLS-1,(int)ceil((x-mnMinX+factorX)*mfGridElementWidthInv));
-    if(nMaxCellX<0)
-    {
-        return vIndices;
-    }
-
-    const int nMinCellY = max(0,(int)floor((y-mnMinY-factorY)*mfGridElementHeightInv));
-    if(nMinCellY>=FRAME_GRID_ROWS)
-    {
-        return vIndices;
-    }
-
-    const int nMaxCellY = min((int)FRAME_GRID_ROWS-1,(int)ceil((y-mnMinY+factorY)*mfGridElementHeightInv));
-    if(nMaxCellY<0)
-    {
-        return vIndices;
-    }
-
-    const bool bCheckLevels = (minLevel>0) || (maxLevel>=0);
-
-    for(int ix = nMinCellX; ix<=nMaxCellX; ix++)
-    {
-        for(int iy = nMinCellY; iy<=nMaxCellY; iy++)
-        {
-            const vector<size_t> vCell = (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
-            if(vCell.empty())
-                continue;
-
-            for(size_t j=0, jend=vCell.size(); j<jend; j++)
-            {
-                const cv::KeyPoint &kpUn = (Nleft == -1) ? mvKeysUn[vCell[j]]
-                                                         : (!bRight) ? mvKeys[vCell[j]]
-                                                                     : mvKeysRight[vCell[j]];
-                if(bCheckLevels)
-                {
-                    if(kpUn.octave<minLevel)
-                        continue;
-                    if(maxLevel>=0)
-                        if(kpUn.octave>maxLevel)
-                            continue;
-                }
-
-                const float distx = kpUn.pt.x-x;
-                const float disty = kpUn.pt.y-y;
-
-                if(fabs(distx)<factorX && fabs(disty)<factorY)
-                    vIndices.push_back(vCell[j]);
-            }
-        }
-    }
-
+    GetFeaturesInArea(vIndices, x, y, r, minLevel, maxLevel, bRight);
     return vIndices;
 }
 
+size_t Frame::GetFeaturesInArea(vector<size_t> &vIndices, const float &x, const float  &y, const float  &r, const int minLevel, const int maxLevel, const bool bRight) const
+{
+    return (!bRight ? mpFeatures->mGrid : mpFeatures->mGridRight).GetFeaturesInArea(x, y, r, minLevel, maxLevel, vIndices);
+}
+
 bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY)
 {
     posX = round((kp.pt.x-mnMinX)*mfGridElementWidthInv);
@@ -850,10 +823,10 @@ bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY)
 
 void Frame::ComputeBoW()
 {
-    if(mBowVec.empty())
+    if(mpFeatures->mBowVec.empty())
     {
         // vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
-        mpORBvocabulary->transform(mDescriptors,4,mBowVec,mFeatVec);
+        mpORBvocabulary->transform(mpFeatures->mDescriptors,4,mpFeatures->mBowVec,mpFeatures->mFeatVec);
     }
 }
 
@@ -861,7 +834,16 @@ void Frame::UndistortKeyPoints()
 {
     if(mDistCoef.at<float>(0)==0.0)
     {
-        mvKeysUn=mvKeys;
+        mpFeatures->mvKeysUn=mpFeatures->mvKeys;
+        return;
+    }
+
+    // Lookup built once for the camera, when it matches this frame's calibration
+    const UndistortionMap* pUndistortionMap = mpCamera->GetUndistortionMap();
+    if(pUndistortionMap && pUndistortionMap->HasDistortion(mDistCoef))
+    {
+        mpFeatures->mvKeysUn.resize(N);
+        pUndistortionMap->Undistort(mpFeatures->mvKeys.data(),mpFeatures->mvKeysUn.data(),N);
         return;
     }
 
@@ -870,8 +852,8 @@ void Frame::UndistortKeyPoints()
 
     for(int i=0; i<N; i++)
     {
-        mat.at<float>(i,0)=mvKeys[i].pt.x;
-        mat.at<float>(i,1)=mvKeys[i].pt.y;
+        mat.at<float>(i,0)=mpFeatures->mvKeys[i].pt.x;
+        mat.at<float>(i,1)=mpFeatures->mvKeys[i].pt.y;
     }
 
     // Undistort points
@@ -881,13 +863,13 @@ void Frame::UndistortKeyPoints()
 
 
     // Fill undistorted keypoint vector
-    mvKeysUn.resize(N);
+    mpFeatures->mvKeysUn.resize(N);
     for(int i=0; i<N; i++)
     {
-        cv::KeyPoint kp = mvKeys[i];
+        cv::KeyPoint kp = mpFeatures->mvKeys[i];
         kp.pt.x=mat.at<float>(i,0);
         kp.pt.y=mat.at<float>(i,1);
-        mvKeysUn[i]=kp;
+        mpFeatures->mvKeysUn[i]=kp;
     }
 
 }
@@ -921,162 +903,261 @@ void Frame::ComputeImageBounds(const cv::Mat &imLeft)
     }
 }
 
-void Frame::ComputeStereoMatches()
-{
-    mvuRight = vector<float>(N,-1.0f);
-    mvDepth = vector<float>(N,-1.0f);
-    //correct here
-    const float thOrbDist = (GlobalFeatureExtractorInfo::GetTH_HIGH()+GlobalFeatureExtractorInfo::GetTH_LOW())/2;
+// Half size of the correlation window and of the search range of Frame::ComputeStereoMatches
+static const int STEREO_SAD_W = 5;
+static const int STEREO_SAD_L = 5;
+// Below this number of left keypoints the matching is not split across the stereo workers
+static const int STEREO_PARALLEL_MIN_KEYS = 300;
 
-    const int nRows = mpORBextractorLeft->GetImagePyramid()[0].rows;
+// SAD between the (2w+1)x(2w+1) patch of imL centred at (uL,v) and the patches of imR centred at (uR0+incR,v)
+// for incR in [-L,L], written to vDists[L+incR]. Same sums as cv::norm(IL,IR,cv::NORM_L1) on 8 bit images.
+// The caller guarantees that every patch lies inside its image.
+static void StereoPatchSAD(const cv::Mat &imL, const cv::Mat &imR, const int uL, const int uR0, const int v, float* vDists)
+{
+    const int w = STEREO_SAD_W;
+    const int L = STEREO_SAD_L;
+    const int W = 2*w+1;
+
+#if defined(__SSE2__)
+    // Rows are staged in zero padded buffers so the 16 byte loads never leave the images
+    const __m128i mask = _mm_setr_epi8(-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,0,0,0,0,0);
+    alignas(16) uint8_t bufL[16] = {0};
+    alignas(16) uint8_t bufR[48] = {0};
+    __m128i acc[2*L+1];
+    for(int k=0; k<=2*L; k++)
+        acc[k] = _mm_setzero_si128();
+
+    for(int r=-w; r<=w; r++)
+    {
+        std::memcpy(bufL, imL.ptr<uchar>(v+r)+uL-w, W);
+        std::memcpy(bufR, imR.ptr<uchar>(v+r)+uR0-L-w, 2*L+W);
+        const __m128i rowL = _mm_load_si128(reinterpret_cast<const __m128i*>(bufL));
+        for(int k=0; k<=2*L; k++)
+        {
+            const __m128i rowR = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bufR+k)), mask);
+            acc[k] = _mm_add_epi64(acc[k], _mm_sad_epu8(rowL, rowR));
+        }
+    }
 
-    //Assign keypoints to row table
-    vector<vector<size_t> > vRowIndices(nRows,vector<size_t>());
+    for(int k=0; k<=2*L; k++)
+        vDists[k] = static_cast<float>(_mm_cvtsi128_si32(acc[k]) + _mm_cvtsi128_si32(_mm_srli_si128(acc[k], 8)));
+#else
+    int sums[2*L+1] = {0};
+    for(int r=-w; r<=w; r++)
+    {
+        const uchar* pL = imL.ptr<uchar>(v+r)+uL-w;
+        const uchar* pR = imR.ptr<uchar>(v+r)+uR0-L-w;
+        for(int k=0; k<=2*L; k++)
+            for(int c=0; c<W; c++)
+                sums[k] += std::abs(static_cast<int>(pL[c]) - static_cast<int>(pR[k+c]));
+    }
+    for(int k=0; k<=2*L; k++)
+        vDists[k] = static_cast<float>(sums[k]);
+#endif
+}
 
-    for(int i=0; i<nRows; i++)
-        vRowIndices[i].reserve(200);
+void Frame::ComputeStereoMatches(StereoExtractorWorkers* pWorkers)
+{
+    mpFeatures->mvuRight = vector<float>(N,-1.0f);
+    mpFeatures->mvDepth = vector<float>(N,-1.0f);
+    //correct here
+    const float thOrbDist = (GlobalFeatureExtractorInfo::GetTH_HIGH()+GlobalFeatureExtractorInfo::GetTH_LOW())/2;
 
-    const int Nr = mvKeysRight.size();
+    const vector<cv::Mat> &vPyramidLeft = mpORBextractorLeft->GetImagePyramid();
+    const vector<cv::Mat> &vPyramidRight = mpORBextractorRight->GetImagePyramid();
+    const int nRows = vPyramidLeft[0].rows;
+    const bool bFastSAD = vPyramidLeft[0].type()==CV_8UC1 && vPyramidRight[0].type()==CV_8UC1;
 
-    for(int iR=0; iR<Nr; iR++)
-    {
-        const cv::KeyPoint &kp = mvKeysRight[iR];
-        const float &kpY = kp.pt.y;
-        const float r = 2.0f*mvScaleFactors[mvKeysRight[iR].octave];
-        const int maxr = ceil(kpY+r);
-        const int minr = floor(kpY-r);
-
-        for(int yi=minr;yi<=maxr;yi++)
-            vRowIndices[yi].push_back(iR);
-    }
+    //Assign keypoints to row table. Only the tracking thread builds it, so its buffers are kept between frames.
+    //The ranges running on the workers must reach it through this reference: inside the lambda the thread_local
+    //itself would name the worker's own, never built, index.
+    static thread_local StereoRowIndex tlRowIndex;
+    StereoRowIndex &rowIndex = tlRowIndex;
+    rowIndex.Build(mpFeatures->mvKeysRight, nRows, mvScaleFactors);
 
     // Set limits for search
     const float minZ = mb;
     const float minD = 0;
     const float maxD = mbf/minZ;
 
-    // For each left keypoint search a match in the right image
-    vector<pair<float, int> > vDistIdx;
-    vDistIdx.reserve(N);
+    const DescriptorMetric &metric = ORBmatcher::GetDescriptorMetric();
 
-    for(int iL=0; iL<N; iL++)
+    // For each left keypoint in [iBegin,iEnd) search a match in the right image.
+    // Keypoints only write their own entries of mvuRight/mvDepth, so ranges can run concurrently.
+    auto matchRange = [&](const int iBegin, const int iEnd, vector<pair<float, int> > &vDistIdx)
     {
-        const cv::KeyPoint &kpL = mvKeys[iL];
-        const int &levelL = kpL.octave;
-        const float &vL = kpL.pt.y;
-        const float &uL = kpL.pt.x;
-
-        const vector<size_t> &vCandidates = vRowIndices[vL];
+        const int w = STEREO_SAD_W;
+        const int L = STEREO_SAD_L;
+        float vDists[2*STEREO_SAD_L+1];
 
-        if(vCandidates.empty())
-            continue;
-
-        const float minU = uL-maxD;
-        const float maxU = uL-minD;
+        for(int iL=iBegin; iL<iEnd; iL++)
+        {
+            const cv::KeyPoint &kpL = mpFeatures->mvKeys[iL];
+            const int &levelL = kpL.octave;
+            const float &vL = kpL.pt.y;
+            const float &uL = kpL.pt.x;
 
-        if(maxU<0)
-            continue;
+            if(vL<0 || vL>=nRows)
+                continue;
 
-        float bestDist = GlobalFeatureExtractorInfo::GetTH_HIGH();
-        size_t bestIdxR = 0;
+            const size_t kBegin = rowIndex.RowBegin(static_cast<int>(vL));
+            const size_t kEnd = rowIndex.RowEnd(static_cast<int>(vL));
 
-        const cv::Mat &dL = mDescriptors.row(iL);
+            if(kBegin==kEnd)
+                continue;
 
-        // Compare descriptor to right keypoints
-        for(size_t iC=0; iC<vCandidates.size(); iC++)
-        {
-            const size_t iR = vCandidates[iC];
-            const cv::KeyPoint &kpR = mvKeysRight[iR];
+            const float minU = uL-maxD;
+            const float maxU = uL-minD;
 
-            if(kpR.octave<levelL-1 || kpR.octave>levelL+1)
+            if(maxU<0)
                 continue;
 
-            const float &uR = kpR.pt.x;
+            float bestDist = GlobalFeatureExtractorInfo::GetTH_HIGH();
+            size_t bestIdxR = 0;
 
-            if(uR>=minU && uR<=maxU)
+            const cv::Mat &dL = mpFeatures->mDescriptors.row(iL);
+
+            // Compare descriptor to right keypoints
+            for(size_t k=kBegin; k<kEnd; k++)
             {
-                const cv::Mat &dR = mDescriptorsRight.row(iR);
-                const float dist = ORBmatcher::DescriptorDistance(dL,dR);
+                const int octaveR = rowIndex.Octave(k);
+                if(octaveR<levelL-1 || octaveR>levelL+1)
+                    continue;
+
+                const float uR = rowIndex.X(k);
 
-                if(dist<bestDist)
+                if(uR>=minU && uR<=maxU)
                 {
-                    bestDist = dist;
-                    bestIdxR = iR;
+                    const size_t iR = rowIndex.Index(k);
+                    const float dist = metric(dL,mpFeatures->mDescriptorsRight.row(iR));
+
+                    if(dist<bestDist)
+                    {
+                        bestDist = dist;
+                        bestIdxR = iR;
+                    }
                 }
             }
-        }
 
-        // Subpixel match by correlation
-        if(bestDist<thOrbDist)
-        {
-            // coordinates in image pyramid at keypoint scale
-            const float uR0 = mvKeysRight[bestIdxR].pt.x;
-            const float scaleFactor = mvInvScaleFactors[kpL.octave];
-            const float scaleduL = round(kpL.pt.x*scaleFactor);
-            const float scaledvL = round(kpL.pt.y*scaleFactor);
-            const float scaleduR0 = round(uR0*scaleFactor);
-
-            // sliding window search
-            const int w = 5;
-            cv::Mat IL = mpORBextractorLeft->GetImagePyramid()[kpL.octave].rowRange(scaledvL-w,scaledvL+w+1).colRange(scaleduL-w,scaleduL+w+1);
-
-            int bestDist = INT_MAX;
-            int bestincR = 0;
-            const int L = 5;
-            vector<float> vDists;
-            vDists.resize(2*L+1);
-
-            const float iniu = scaleduR0+L-w;
-            const float endu = scaleduR0+L+w+1;
-            if(iniu<0 || endu >= mpORBextractorRight->GetImagePyramid()[kpL.octave].cols)
-                continue;
-
-            for(int incR=-L; incR<=+L; incR++)
+            // Subpixel match by correlation
+            if(bestDist<thOrbDist)
             {
-                cv::Mat IR = mpORBextractorRight->GetImagePyramid()[kpL.octave].rowRange(scaledvL-w,scaledvL+w+1).colRange(scaleduR0+incR-w,scaleduR0+incR+w+1);
-
-                float dist = cv::norm(IL,IR,cv::NORM_L1);
-                if(dist<bestDist)
+                // coordinates in image pyramid at keypoint scale
+                const float uR0 = mpFeatures->mvKeysRight[bestIdxR].pt.x;
+                const float scaleFactor = mvInvScaleFactors[kpL.octave];
+                const float scaleduL = round(kpL.pt.x*scaleFactor);
+                const float scaledvL = round(kpL.pt.y*scaleFactor);
+                const float scaleduR0 = round(uR0*scaleFactor);
+
+                const cv::Mat &imL = vPyramidLeft[kpL.octave];
+                const cv::Mat &imR = vPyramidRight[kpL.octave];
+
+                const float iniu = scaleduR0+L-w;
+                const float endu = scaleduR0+L+w+1;
+                if(iniu<0 || endu >= imR.cols)
+                    continue;
+
+                // Windows crossing the image border, which cv::Mat::rowRange/colRange would reject
+                if(scaledvL-w<0 || scaledvL+w>=imL.rows || scaledvL+w>=imR.rows ||
+                   scaleduL-w<0 || scaleduL+w>=imL.cols || scaleduR0-L-w<0)
+                    continue;
+
+                // sliding window search
+                if(bFastSAD)
+                    StereoPatchSAD(imL, imR, scaleduL, scaleduR0, scaledvL, vDists);
+                else
                 {
-                    bestDist =  dist;
-                    bestincR = incR;
+                    cv::Mat IL = imL.rowRange(scaledvL-w,scaledvL+w+1).colRange(scaleduL-w,scaleduL+w+1);
+                    for(int incR=-L; incR<=+L; incR++)
+                    {
+                        cv::Mat IR = imR.rowRange(scaledvL-w,scaledvL+w+1).colRange(scaleduR0+incR-w,scaleduR0+incR+w+1);
+                        vDists[L+incR] = cv::norm(IL,IR,cv::NORM_L1);
+                    }
                 }
 
-                vDists[L+incR] = dist;
-            }
+                int bestDist = INT_MAX;
+                int bestincR = 0;
+                for(int incR=-L; incR<=+L; incR++)
+                {
+                    const float dist = vDists[L+incR];
+                    if(dist<bestDist)
+                    {
+                        bestDist =  dist;
+                        bestincR = incR;
+                    }
+                }
 
-            if(bestincR==-L || bestincR==L)
-                continue;
+                if(bestincR==-L || bestincR==L)
+                    continue;
 
-            // Sub-pixel match (Parabola fitting)
-            const float dist1 = vDists[L+bestincR-1];
-            const float dist2 = vDists[L+bestincR];
-            const float dist3 = vDists[L+bestincR+1];
+                // Sub-pixel match (Parabola fitting)
+                const float dist1 = vDists[L+bestincR-1];
+                const float dist2 = vDists[L+bestincR];
+                const float dist3 = vDists[L+bestincR+1];
 
-            const float deltaR = (dist1-dist3)/(2.0f*(dist1+dist3-2.0f*dist2));
+                const float deltaR = (dist1-dist3)/(2.0f*(dist1+dist3-2.0f*dist2));
 
-            if(deltaR<-1 || deltaR>1)
-                continue;
+                if(deltaR<-1 || deltaR>1)
+                    continue;
 
-            // Re-scaled coordinate
-            float bestuR = mvScaleFactors[kpL.octave]*((float)scaleduR0+(float)bestincR+deltaR);
+                // Re-scaled coordinate
+                float bestuR = mvScaleFactors[kpL.octave]*((float)scaleduR0+(float)bestincR+deltaR);
 
-            float disparity = (uL-bestuR);
+                float disparity = (uL-bestuR);
 
-            if(disparity>=minD && disparity<maxD)
-            {
-                if(disparity<=0)
+                if(disparity>=minD && disparity<maxD)
                 {
-                    disparity=0.01;
-                    bestuR = uL-0.01;
+                    if(disparity<=0)
+                    {
+                        disparity=0.01;
+                        bestuR = uL-0.01;
+                    }
+                    mpFeatures->mvDepth[iL]=mbf/disparity;
+                    mpFeatures->mvuRight[iL] = bestuR;
+                    vDistIdx.push_back(pair<float,int>(bestDist,iL));
                 }
-                mvDepth[iL]=mbf/disparity;
-                mvuRight[iL] = bestuR;
-                vDistIdx.push_back(pair<float,int>(bestDist,iL));
             }
         }
+    };
+
+    vector<pair<float, int> > vDistIdx;
+    vDistIdx.reserve(N);
+
+    if(!pWorkers || N<STEREO_PARALLEL_MIN_KEYS)
+        matchRange(0, N, vDistIdx);
+    else
+    {
+        // Split the left keypoints in three contiguous ranges: the calling thread and the two extraction
+        // workers, which are idle once both images are extracted
+        const int n1 = N/3;
+        const int n2 = 2*N/3;
+        vector<pair<float, int> > vDistIdxL, vDistIdxR;
+        vDistIdxL.reserve(n2-n1);
+        vDistIdxR.reserve(N-n2);
+
+        std::future<void> left = pWorkers->left.Submit([&]() { matchRange(n1, n2, vDistIdxL); });
+        std::future<void> right = pWorkers->right.Submit([&]() { matchRange(n2, N, vDistIdxR); });
+
+        // The workers write into this frame, so both are always waited for before anything is rethrown
+        std::exception_ptr eptr;
+        try { matchRange(0, n1, vDistIdx); }
+        catch(...) { eptr = std::current_exception(); }
+        try { left.get(); }
+        catch(...) { if(!eptr) eptr = std::current_exception(); }
+        try { right.get(); }
+        catch(...) { if(!eptr) eptr = std::current_exception(); }
+
+        if(eptr)
+            std::rethrow_exception(eptr);
+
+        vDistIdx.insert(vDistIdx.end(), vDistIdxL.begin(), vDistIdxL.end());
+        vDistIdx.insert(vDistIdx.end(), vDistIdxR.begin(), vDistIdxR.end());
     }
 
+    if(vDistIdx.empty())
+        return;
+
+    // Pairs are totally ordered, so the result does not depend on how the ranges were split
     sort(vDistIdx.begin(),vDistIdx.end());
     const float median = vDistIdx[vDistIdx.size()/2].first;
     const float thDist = 1.5f*1.4f*median;
@@ -1087,21 +1168,21 @@ void Frame::ComputeStereoMatches()
             break;
         else
         {
-            mvuRight[vDistIdx[i].second]=-1;
-            mvDepth[vDistIdx[i].second]=-1;
+            mpFeatures->mvuRight[vDistIdx[i].second]=-1;
+            mpFeatures->mvDepth[vDistIdx[i].second]=-1;
         }
     }
 }
 
 void Frame::ComputeStereoFromRGBD(const cv::Mat &imDepth)
 {
-    mvuRight = vector<float>(N,-1);
-    mvDepth = vector<float>(N,-1);
+    mpFeatures->mvuRight = vector<float>(N,-1);
+    mpFeatures->mvDepth = vector<float>(N,-1);
 
     for(int i=0; i<N; i++)
     {
-        const cv::KeyPoint &kp = mvKeys[i];
-        const cv::KeyPoint &kpU = mvKeysUn[i];
+        const cv::KeyPoint &kp = mpFeatures->mvKeys[i];
+        const cv::KeyPoint &kpU = mpFeatures->mvKeysUn[i];
 
         const float &v = kp.pt.y;
         const float &u = kp.pt.x;
@@ -1110,18 +1191,18 @@ void Frame::ComputeStereoFromRGBD(const cv::Mat &imDepth)
 
         if(d>0)
         {
-            mvDepth[i] = d;
-            mvuRight[i] = kpU.pt.x-mbf/d;
+            mpFeatures->mvDepth[i] = d;
+            mpFeatures->mvuRight[i] = kpU.pt.x-mbf/d;
         }
     }
 }
 
 bool Frame::UnprojectStereo(const int &i, Eigen::Vector3f &x3D)
 {
-    const float z = mvDepth[i];
+    const float z = mpFeatures->mvDepth[i];
     if(z>0) {
-        const float u = mvKeysUn[i].pt.x;
-        const float v = mvKeysUn[i].pt.y;
+        const float u = mpFeatures->mvKeysUn[i].pt.x;
+        const float v = mpFeatures->mvKeysUn[i].pt.y;
         const float x = (u-cx)*z*invfx;
         const float y = (v-cy)*z*invfy;
         Eigen::Vector3f x3Dc(x, y, z);
@@ -1143,10 +1224,10 @@ void Frame::setIntegrated()
     mbImuPreintegrated = true;
 }
 
-Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera, GeometricCamera* pCamera2, Sophus::SE3f& Tlr,Frame* pPrevF, const IMU::Calib &ImuCalib)
+Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeStamp, FeatureExtractor* extractorLeft, FeatureExtractor* extractorRight, ORBVocabulary* voc, cv::Mat &K, cv::Mat &distCoef, const float &bf, const float &thDepth, GeometricCamera* pCamera, GeometricCamera* pCamera2, Sophus::SE3f& Tlr,Frame* pPrevF, const IMU::Calib &ImuCalib, StereoExtractorWorkers* pWorkers)
         :mpcpi(NULL), mpORBvocabulary(voc),mpORBextractorLeft(extractorLeft),mpORBextractorRight(extractorRight), mTimeStamp(timeStamp), mK(K.clone()), mK_(Converter::toMatrix3f(K)),  mDistCoef(distCoef.clone()), mbf(bf), mThDepth(thDepth),
          mImuCalib(ImuCalib), mpImuPreintegrated(NULL), mpPrevFrame(pPrevF),mpImuPreintegratedFrame(NULL), mpReferenceKF(static_cast<KeyFrame*>(NULL)), mbImuPreintegrated(false), mpCamera(pCamera), mpCamera2(pCamera2),
-         mbHasPose(false), mbHasVelocity(false)
+         mbHasPose(false), mbHasVelocity(false), mpFeatures(std::make_shared<FrameFeatures>())
 
 {
     imgLeft = imLeft.clone();
@@ -1168,18 +1249,18 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartExtORB = std::chrono::steady_clock::now();
 #endif
-    thread threadLeft(&Frame::ExtractORB,this,0,imLeft,static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[1]);
-    thread threadRight(&Frame::ExtractORB,this,1,imRight,static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[1]);
-    threadLeft.join();
-    threadRight.join();
+    ExtractStereoORB(imLeft,imRight,
+                     static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera)->mvLappingArea[1],
+                     static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[0],static_cast<KannalaBrandt8*>(mpCamera2)->mvLappingArea[1],
+                     pWorkers);
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_EndExtORB = std::chrono::steady_clock::now();
 
     mTimeORB_Ext = std::chrono::duration_cast<std::chrono::duration<double,std::milli> >(time_EndExtORB - time_StartExtORB).count();
 #endif
 
-    Nleft = mvKeys.size();
-    Nright = mvKeysRight.size();
+    Nleft = mpFeatures->mvKeys.size();
+    Nright = mpFeatures->mvKeysRight.size();
     N = Nleft + Nright;
 
     if(N == 0)
@@ -1222,7 +1303,7 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
 #endif
 
     //Put all descriptors in the same matrix
-    cv::vconcat(mDescriptors,mDescriptorsRight,mDescriptors);
+    cv::vconcat(mpFeatures->mDescriptors,mpFeatures->mDescriptorsRight,mpFeatures->mDescriptors);
 
     mvpMapPoints = vector<MapPoint*>(N,static_cast<MapPoint*>(nullptr));
     mvbOutlier = vector<bool>(N,false);
@@ -1237,17 +1318,17 @@ Frame::Frame(const cv::Mat &imLeft, const cv::Mat &imRight, const double &timeSt
 
 void Frame::ComputeStereoFishEyeMatches() {
     //Speed it up by matching keypoints in the lapping area
-    vector<cv::KeyPoint> stereoLeft(mvKeys.begin() + monoLeft, mvKeys.end());
-    vector<cv::KeyPoint> stereoRight(mvKeysRight.begin() + monoRight, mvKeysRight.end());
+    vector<cv::KeyPoint> stereoLeft(mpFeatures->mvKeys.begin() + monoLeft, mpFeatures->mvKeys.end());
+    vector<cv::KeyPoint> stereoRight(mpFeatures->mvKeysRight.begin() + monoRight, mpFeatures->mvKeysRight.end());
 
-    cv::Mat stereoDescLeft = mDescriptors.rowRange(monoLeft, mDescriptors.rows);
-    cv::Mat stereoDescRight = mDescriptorsRight.rowRange(monoRight, mDescriptorsRight.rows);
+    cv::Mat stereoDescLeft = mpFeatures->mDescriptors.rowRange(monoLeft, mpFeatures->mDescriptors.rows);
+    cv::Mat stereoDescRight = mpFeatures->mDescriptorsRight.rowRange(monoRight, mpFeatures->mDescriptorsRight.rows);
 
-    mvLeftToRightMatch = vector<int>(Nleft,-1);
-    mvRightToLeftMatch = vector<int>(Nright,-1);
-    mvDepth = vector<float>(Nleft,-1.0f);
-    mvuRight = vector<float>(Nleft,-1);
-    mvStereo3Dpoints = vector<Eigen::Vector3f>(Nleft);
+    mpFeatures->mvLeftToRightMatch = vector<int>(Nleft,-1);
+    mpFeatures->mvRightToLeftMatch = vector<int>(Nright,-1);
+    mpFeatures->mvDepth = vector<float>(Nleft,-1.0f);
+    mpFeatures->mvuRight = vector<float>(Nleft,-1);
+    mpFeatures->mvStereo3Dpoints = vector<Eigen::Vector3f>(Nleft);
     mnCloseMPs = 0;
 
     //Perform a brute force between Keypoint in the left and right image
@@ -1264,13 +1345,13 @@ void Frame::ComputeStereoFishEyeMatches() {
             //For every good match, check parallax and reprojection error to discard spurious matches
             Eigen::Vector3f p3D;
             descMatches++;
-            float sigma1 = mvLevelSigma2[mvKeys[(*it)[0].queryIdx + monoLeft].octave], sigma2 = mvLevelSigma2[mvKeysRight[(*it)[0].trainIdx + monoRight].octave];
-            float depth = static_cast<KannalaBrandt8*>(mpCamera)->TriangulateMatches(mpCamera2,mvKeys[(*it)[0].queryIdx + monoLeft],mvKeysRight[(*it)[0].trainIdx + monoRight],mRlr,mtlr,sigma1,sigma2,p3D);
+            float sigma1 = mvLevelSigma2[mpFeatures->mvKeys[(*it)[0].queryIdx + monoLeft].octave], sigma2 = mvLevelSigma2[mpFeatures->mvKeysRight[(*it)[0].trainIdx + monoRight].octave];
+            float depth = static_cast<KannalaBrandt8*>(mpCamera)->TriangulateMatches(mpCamera2,mpFeatures->mvKeys[(*it)[0].queryIdx + monoLeft],mpFeatures->mvKeysRight[(*it)[0].trainIdx + monoRight],mRlr,mtlr,sigma1,sigma2,p3D);
             if(depth > 0.0001f){
-                mvLeftToRightMatch[(*it)[0].queryIdx + monoLeft] = (*it)[0].trainIdx + monoRight;
-                mvRightToLeftMatch[(*it)[0].trainIdx + monoRight] = (*it)[0].queryIdx + monoLeft;
-                mvStereo3Dpoints[(*it)[0].queryIdx + monoLeft] = p3D;
-                mvDepth[(*it)[0].queryIdx + monoLeft] = depth;
+                mpFeatures->mvLeftToRightMatch[(*it)[0].queryIdx + monoLeft] = (*it)[0].trainIdx + monoRight;
+                mpFeatures->mvRightToLeftMatch[(*it)[0].trainIdx + monoRight] = (*it)[0].queryIdx + monoLeft;
+                mpFeatures->mvStereo3Dpoints[(*it)[0].queryIdx + monoLeft] = p3D;
+                mpFeatures->mvDepth[(*it)[0].queryIdx + monoLeft] = depth;
                 nMatches++;
             }
         }
@@ -1354,7 +1435,7 @@ bool Frame::isInFrustumChecks(MapPoint *pMP, float viewingCosLimit, bool bRight)
 }
 
 Eigen::Vector3f Frame::UnprojectStereoFishEye(const int &i){
-    return mRwc * mvStereo3Dpoints[i] + mOw;
+    return mRwc * mpFeatures->mvStereo3Dpoints[i] + mOw;
 }
 
 } //namespace ORB_SLAM
@@ -0,0 +1,285 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* FrustumCuller.cc - Data-parallel visibility test of the local map points against a frame
+*/
+
+#include "FrustumCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Frame.h"
+#include "MapPoint.h"
+#include "GeometricCamera.h"
+#include "utils/ThreadPool.h"
+
+namespace ORB_SLAM3
+{
+
+namespace
+{
+    // Points per task when the test is split across the pool
+    const size_t MIN_POINTS_PER_TASK = 512;
+
+    // Pinhole::project, inlined so the test loop can be vectorized
+    struct PinholeProjection
+    {
+        float fx, fy, cx, cy;
+        inline void operator()(const float x, const float y, const float z, float &u, float &v) const
+        {
+            u = fx * x / z + cx;
+            v = fy * y / z + cy;
+        }
+    };
+
+    struct CameraProjection
+    {
+        GeometricCamera* pCamera;
+        inline void operator()(const float x, const float y, const float z, float &u, float &v) const
+        {
+            const Eigen::Vector2f uv = pCamera->project(Eigen::Vector3f(x, y, z));
+            u = uv(0);
+            v = uv(1);
+        }
+    };
+}
+
+void FrustumCuller::ViewResult::resize(size_t n)
+{
+    vFlags.resize(n);
+    vU.resize(n);
+    vV.resize(n);
+    vInvZ.resize(n);
+    vDepth.resize(n);
+    vViewCos.resize(n);
+    vLevel.resize(n);
+}
+
+template<typename Projection>
+void FrustumCuller::TestRange(const Frame &F, const View &view, const Projection &project, const float viewingCosLimit,
+                              const size_t begin, const size_t end, ViewResult &res) const
+{
+    const Eigen::Matrix3f &R = view.Rcw;
+    const float r00 = R(0,0), r01 = R(0,1), r02 = R(0,2);
+    const float r10 = R(1,0), r11 = R(1,1), r12 = R(1,2);
+    const float r20 = R(2,0), r21 = R(2,1), r22 = R(2,2);
+    const float t0 = view.tcw(0), t1 = view.tcw(1), t2 = view.tcw(2);
+    const float o0 = view.Ow(0), o1 = view.Ow(1), o2 = view.Ow(2);
+    const float minX = Frame::mnMinX, maxX = Frame::mnMaxX, minY = Frame::mnMinY, maxY = Frame::mnMaxY;
+
+    // Branch-free pass over the snapshot: every check is evaluated and folded into the flags
+    for(size_t i=begin; i<end; i++)
+    {
+        const float px = mvX[i], py = mvY[i], pz = mvZ[i];
+
+        // 3D in camera coordinates
+        const float xc = r00*px + r01*py + r02*pz + t0;
+        const float yc = r10*px + r11*py + r12*pz + t1;
+        const float zc = r20*px + r21*py + r22*pz + t2;
+
+        float u, v;
+        project(xc, yc, zc, u, v);
+
+        // Distance and viewing angle from the camera center
+        const float dx = px - o0, dy = py - o1, dz = pz - o2;
+        const float dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+        const float viewCos = (dx*mvNx[i] + dy*mvNy[i] + dz*mvNz[i]) / dist;
+
+        const bool bProjected = mvValid[i] & (zc >= 0.0f) & (u >= minX) & (u <= maxX) & (v >= minY) & (v <= maxY);
+        const bool bInView = bProjected & (dist >= 0.8f*mvMinDist[i]) & (dist <= 1.2f*mvMaxDist[i]) &
+                             (viewCos >= viewingCosLimit);
+
+        res.vFlags[i] = (bProjected ? PROJECTED : 0) | (bInView ? IN_VIEW : 0);
+        res.vU[i] = u;
+        res.vV[i] = v;
+        res.vInvZ[i] = 1.0f/zc;
+        res.vDepth[i] = std::sqrt(xc*xc + yc*yc + zc*zc);
+        res.vViewCos[i] = viewCos;
+        res.vLevel[i] = 0;
+    }
+
+    // Predicted scale, as MapPoint::PredictScale, only for the points in view
+    for(size_t i=begin; i<end; i++)
+    {
+        if(!(res.vFlags[i] & IN_VIEW))
+            continue;
+
+        const float dx = mvX[i] - o0, dy = mvY[i] - o1, dz = mvZ[i] - o2;
+        const float ratio = mvMaxDist[i] / std::sqrt(dx*dx + dy*dy + dz*dz);
+        int nScale = std::ceil(std::log(ratio)/F.mfLogScaleFactor);
+        if(nScale<0)
+            nScale = 0;
+        else if(nScale>=F.mnScaleLevels)
+            nScale = F.mnScaleLevels-1;
+        res.vLevel[i] = nScale;
+    }
+}
+
+void FrustumCuller::ProcessRange(const Frame &F, const std::vector<MapPoint*> &vpMapPoints, const float viewingCosLimit,
+                                 const size_t begin, const size_t end)
+{
+    // Snapshot, one lock of the point for position, normal and distance bounds
+    for(size_t i=begin; i<end; i++)
+    {
+        MapPoint* pMP = vpMapPoints[i];
+        mvValid[i] = 0;
+        if(pMP->mnLastFrameSeen == F.mnId || pMP->isBad())
+        {
+            mvX[i] = mvY[i] = mvZ[i] = 0.f;
+            mvNx[i] = mvNy[i] = mvNz[i] = 0.f;
+            mvMinDist[i] = mvMaxDist[i] = 0.f;
+            continue;
+        }
+
+        Eigen::Vector3f P, Pn;
+        pMP->GetFrustumData(P, Pn, mvMinDist[i], mvMaxDist[i]);
+        mvX[i] = P(0);
+        mvY[i] = P(1);
+        mvZ[i] = P(2);
+        mvNx[i] = Pn(0);
+        mvNy[i] = Pn(1);
+        mvNz[i] = Pn(2);
+        mvValid[i] = 1;
+    }
+
+    const View* views[2] = {&mLeft, &mRight};
+    ViewResult* results[2] = {&mResLeft, &mResRight};
+    for(int c=0; c<(mbStereoFishEye ? 2 : 1); c++)
+    {
+        const View &view = *views[c];
+        if(view.bPinhole)
+            TestRange(F, view, PinholeProjection{view.fx, view.fy, view.cx, view.cy}, viewingCosLimit, begin, end, *results[c]);
+        else
+            TestRange(F, view, CameraProjection{view.pCamera}, viewingCosLimit, begin, end, *results[c]);
+    }
+}
+
+int FrustumCuller::Run(Frame &F, const std::vector<MapPoint*> &vpMapPoints, const float viewingCosLimit, ThreadPool* pPool)
+{
+    const size_t n = vpMapPoints.size();
+    if(n == 0)
+        return 0;
+
+    mbStereoFishEye = F.Nleft != -1;
+
+    auto setView = [](View &view, const Eigen::Matrix3f &Rcw, const Eigen::Vector3f &tcw, const Eigen::Vector3f &Ow,
+                      GeometricCamera* pCamera)
+    {
+        view.Rcw = Rcw;
+        view.tcw = tcw;
+        view.Ow = Ow;
+        view.pCamera = pCamera;
+        view.bPinhole = pCamera->GetType() == GeometricCamera::CAM_PINHOLE;
+        view.fx = pCamera->getParameter(0);
+        view.fy = pCamera->getParameter(1);
+        view.cx = pCamera->getParameter(2);
+        view.cy = pCamera->getParameter(3);
+    };
+
+    const Sophus::SE3f Tcw = F.GetPose();
+    setView(mLeft, Tcw.rotationMatrix(), Tcw.translation(), F.GetOw(), F.mpCamera);
+    if(mbStereoFishEye)
+    {
+        // Same right camera pose as Frame::isInFrustumChecks
+        const Sophus::SE3f Trl = F.GetRelativePoseTrl();
+        const Eigen::Matrix3f Rrl = Trl.rotationMatrix();
+        setView(mRight, Rrl * Tcw.rotationMatrix(), Rrl * Tcw.translation() + Trl.translation(),
+                F.GetRwc() * F.GetRelativePoseTlr().translation() + F.GetOw(), F.mpCamera2);
+    }
+
+    mvValid.resize(n);
+    mvX.resize(n); mvY.resize(n); mvZ.resize(n);
+    mvNx.resize(n); mvNy.resize(n); mvNz.resize(n);
+    mvMinDist.resize(n); mvMaxDist.resize(n);
+    mResLeft.resize(n);
+    if(mbStereoFishEye)
+        mResRight.resize(n);
+
+    // Contiguous ranges, each task writes only its own slice of the buffers
+    const int nTasks = pPool ? static_cast<int>(std::min<size_t>(pPool->Size() + 1, (n + MIN_POINTS_PER_TASK - 1) / MIN_POINTS_PER_TASK)) : 1;
+    if(nTasks <= 1)
+        ProcessRange(F, vpMapPoints, viewingCosLimit, 0, n);
+    else
+    {
+        const size_t chunk = (n + nTasks - 1) / nTasks;
+        pPool->ParallelFor(nTasks, [&](int t) {
+            const size_t begin = std::min(n, t * chunk);
+            const size_t end = std::min(n, begin + chunk);
+            ProcessRange(F, vpMapPoints, viewingCosLimit, begin, end);
+        });
+    }
+
+    // Write back in order, with the side effects of Frame::isInFrustum
+    int nInView = 0;
+    for(size_t i=0; i<n; i++)
+    {
+        if(!mvValid[i])
+            continue;
+
+        MapPoint* pMP = vpMapPoints[i];
+        const uint8_t flagsL = mResLeft.vFlags[i];
+        bool bInView;
+
+        if(!mbStereoFishEye)
+        {
+            pMP->mbTrackInView = false;
+            pMP->mTrackProjX = -1;
+            pMP->mTrackProjY = -1;
+
+            if(flagsL & PROJECTED)
+            {
+                pMP->mTrackProjX = mResLeft.vU[i];
+                pMP->mTrackProjY = mResLeft.vV[i];
+            }
+
+            if(flagsL & IN_VIEW)
+            {
+                pMP->mbTrackInView = true;
+                pMP->mTrackProjXR = mResLeft.vU[i] - F.mbf*mResLeft.vInvZ[i];
+                pMP->mTrackDepth = mResLeft.vDepth[i];
+                pMP->mnTrackScaleLevel = mResLeft.vLevel[i];
+                pMP->mTrackViewCos = mResLeft.vViewCos[i];
+            }
+            bInView = pMP->mbTrackInView;
+        }
+        else
+        {
+            const uint8_t flagsR = mResRight.vFlags[i];
+            pMP->mnTrackScaleLevel = -1;
+            pMP->mnTrackScaleLevelR = -1;
+            pMP->mbTrackInView = flagsL & IN_VIEW;
+            pMP->mbTrackInViewR = flagsR & IN_VIEW;
+
+            if(pMP->mbTrackInView)
+            {
+                pMP->mTrackProjX = mResLeft.vU[i];
+                pMP->mTrackProjY = mResLeft.vV[i];
+                pMP->mnTrackScaleLevel = mResLeft.vLevel[i];
+                pMP->mTrackViewCos = mResLeft.vViewCos[i];
+                pMP->mTrackDepth = mResLeft.vDepth[i];
+            }
+            if(pMP->mbTrackInViewR)
+            {
+                pMP->mTrackProjXR = mResRight.vU[i];
+                pMP->mTrackProjYR = mResRight.vV[i];
+                pMP->mnTrackScaleLevelR = mResRight.vLevel[i];
+                pMP->mTrackViewCosR = mResRight.vViewCos[i];
+                pMP->mTrackDepthR = mResRight.vDepth[i];
+            }
+            bInView = pMP->mbTrackInView || pMP->mbTrackInViewR;
+        }
+
+        if(bInView)
+        {
+            pMP->IncreaseVisible();
+            nInView++;
+        }
+        if(pMP->mbTrackInView)
+            F.mmProjectPoints[pMP->mnId] = cv::Point2f(pMP->mTrackProjX, pMP->mTrackProjY);
+    }
+
+    return nInView;
+}
+
+} // namespace ORB_SLAM3
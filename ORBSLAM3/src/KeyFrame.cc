@@ -20,16 +20,43 @@
 #include "Converter.h"
 #include "ImuTypes.h"
 #include<mutex>
+#include<algorithm>
+#include<cstring>
 
 namespace ORB_SLAM3
 {
 
 long unsigned int KeyFrame::nNextId=0;
 
+namespace
+{
+    // Never destroyed, so the keyframes deleted during static destruction still find it
+    SlabPool<KeyFrame>& KeyFramePool()
+    {
+        static SlabPool<KeyFrame>* pPool = new SlabPool<KeyFrame>();
+        return *pPool;
+    }
+}
+
+void* KeyFrame::operator new(std::size_t size)
+{
+    return KeyFramePool().Allocate(size);
+}
+
+void KeyFrame::operator delete(void* p)
+{
+    KeyFramePool().Release(p);
+}
+
+void KeyFrame::operator delete(void* p, std::size_t)
+{
+    KeyFramePool().Release(p);
+}
+
 KeyFrame::KeyFrame():
         mnFrameId(0),  mTimeStamp(0), mnGridCols(FRAME_GRID_COLS), mnGridRows(FRAME_GRID_ROWS),
         mfGridElementWidthInv(0), mfGridElementHeightInv(0),
-        mnTrackReferenceForFrame(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0), mnBALocalForMerge(0),
+        mnTrackReferenceForFrame(0), mnLocalMapEpoch(0), mnLocalMapVotes(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0), mnMappingQueuedNs(0), mnBALocalForMerge(0),
         mnLoopQuery(0), mnLoopWords(0), mnRelocQuery(0), mnRelocWords(0), mnMergeQuery(0), mnMergeWords(0), mnBAGlobalForKF(0),
         fx(0), fy(0), cx(0), cy(0), invfx(0), invfy(0), mnPlaceRecognitionQuery(0), mnPlaceRecognitionWords(0), mPlaceRecognitionScore(0),
         mbf(0), mb(0), mThDepth(0), N(0), mvKeys(), mvKeysUn(),
@@ -45,12 +72,12 @@ KeyFrame::KeyFrame():
 KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB):
     bImu(pMap->isImuInitialized()), mnFrameId(F.mnId),  mTimeStamp(F.mTimeStamp), mnGridCols(FRAME_GRID_COLS), mnGridRows(FRAME_GRID_ROWS),
     mfGridElementWidthInv(F.mfGridElementWidthInv), mfGridElementHeightInv(F.mfGridElementHeightInv),
-    mnTrackReferenceForFrame(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0), mnBALocalForMerge(0),
+    mnTrackReferenceForFrame(0), mnLocalMapEpoch(0), mnLocalMapVotes(0), mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0), mnMappingQueuedNs(0), mnBALocalForMerge(0),
     mnLoopQuery(0), mnLoopWords(0), mnRelocQuery(0), mnRelocWords(0), mnBAGlobalForKF(0), mnPlaceRecognitionQuery(0), mnPlaceRecognitionWords(0), mPlaceRecognitionScore(0),
     fx(F.fx), fy(F.fy), cx(F.cx), cy(F.cy), invfx(F.invfx), invfy(F.invfy),
-    mbf(F.mbf), mb(F.mb), mThDepth(F.mThDepth), N(F.N), mvKeys(F.mvKeys), mvKeysUn(F.mvKeysUn),
-    mvuRight(F.mvuRight), mvDepth(F.mvDepth), mDescriptors(F.mDescriptors.clone()),
-    mBowVec(F.mBowVec), mFeatVec(F.mFeatVec), mnScaleLevels(F.mnScaleLevels), mfScaleFactor(F.mfScaleFactor),
+    mbf(F.mbf), mb(F.mb), mThDepth(F.mThDepth), N(F.N), mvKeys(F.mpFeatures->mvKeys), mvKeysUn(F.mpFeatures->mvKeysUn),
+    mvuRight(F.mpFeatures->mvuRight), mvDepth(F.mpFeatures->mvDepth), mDescriptors(F.mpFeatures->mDescriptors.clone()),
+    mBowVec(F.mpFeatures->mBowVec), mFeatVec(F.mpFeatures->mFeatVec), mnScaleLevels(F.mnScaleLevels), mfScaleFactor(F.mfScaleFactor),
     mfLogScaleFactor(F.mfLogScaleFactor), mvScaleFactors(F.mvScaleFactors), mvLevelSigma2(F.mvLevelSigma2),
     mvInvLevelSigma2(F.mvInvLevelSigma2), mnMinX(F.mnMinX), mnMinY(F.mnMinY), mnMaxX(F.mnMaxX),
     mnMaxY(F.mnMaxY), mK_(F.mK_), mPrevKF(NULL), mNextKF(NULL), mpImuPreintegrated(F.mpImuPreintegrated),
@@ -58,8 +85,8 @@ KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB):
     mpORBvocabulary(F.mpORBvocabulary), mbFirstConnection(true), mpParent(NULL), mDistCoef(F.mDistCoef), mbNotErase(false), mnDataset(F.mnDataset),
     mbToBeErased(false), mbBad(false), mHalfBaseline(F.mb/2), mpMap(pMap), mbCurrentPlaceRecognition(false), mNameFile(F.mNameFile), mnMergeCorrectedForKF(0),
     mpCamera(F.mpCamera), mpCamera2(F.mpCamera2),
-    mvLeftToRightMatch(F.mvLeftToRightMatch),mvRightToLeftMatch(F.mvRightToLeftMatch), mTlr(F.GetRelativePoseTlr()),
-    mvKeysRight(F.mvKeysRight), NLeft(F.Nleft), NRight(F.Nright), mTrl(F.GetRelativePoseTrl()), mnNumberOfOpt(0), mbHasVelocity(false)
+    mvLeftToRightMatch(F.mpFeatures->mvLeftToRightMatch),mvRightToLeftMatch(F.mpFeatures->mvRightToLeftMatch), mTlr(F.GetRelativePoseTlr()),
+    mvKeysRight(F.mpFeatures->mvKeysRight), NLeft(F.Nleft), NRight(F.Nright), mTrl(F.GetRelativePoseTrl()), mnNumberOfOpt(0), mbHasVelocity(false)
 {
     mnId=nNextId++;
     image = F.image;
@@ -70,9 +97,9 @@ KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB):
         mGrid[i].resize(mnGridRows);
         if(F.Nleft != -1) mGridRight[i].resize(mnGridRows);
         for(int j=0; j<mnGridRows; j++){
-            mGrid[i][j] = F.mGrid[i][j];
+            mGrid[i][j].assign(F.mpFeatures->mGrid.CellBegin(i,j), F.mpFeatures->mGrid.CellEnd(i,j));
             if(F.Nleft != -1){
-                mGridRight[i][j] = F.mGridRight[i][j];
+                mGridRight[i][j].assign(F.mpFeatures->mGridRight.CellBegin(i,j), F.mpFeatures->mGridRight.CellEnd(i,j));
             }
         }
     }
@@ -92,6 +119,13 @@ KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB):
     mImuBias = F.mImuBias;
     SetPose(F.GetPose());
 
+    // The points copied from the frame are not observed yet, register as their holder until they are
+    for(size_t i=0; i<mvpMapPoints.size(); i++)
+    {
+        if(mvpMapPoints[i] && !mvpMapPoints[i]->AddHolder(this, i))
+            mvpMapPoints[i] = static_cast<MapPoint*>(NULL);
+    }
+
     mnOriginMapId = pMap->GetId();
 }
 
@@ -115,6 +149,11 @@ void KeyFrame::SetPose(const Sophus::SE3f &Tcw)
     mTwc = mTcw.inverse();
     mRwc = mTwc.rotationMatrix();
 
+    PoseSnapshot snapshot;
+    std::memcpy(snapshot.Tcw, mTcw.data(), sizeof(snapshot.Tcw));
+    std::memcpy(snapshot.Twc, mTwc.data(), sizeof(snapshot.Twc));
+    mPoseSnapshot.Store(snapshot);
+
     if (mImuCalib.mbIsSet) // TODO Use a flag instead of the OpenCV matrix
     {
         mOwb = mRwc * mImuCalib.mTcb.translation() + mTwc.translation();
@@ -130,19 +169,19 @@ void KeyFrame::SetVelocity(const Eigen::Vector3f &Vw)
 
 Sophus::SE3f KeyFrame::GetPose()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTcw;
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Sophus::SE3f(Eigen::Map<const Sophus::SE3f>(snapshot.Tcw));
 }
 
 Sophus::SE3f KeyFrame::GetPoseInverse()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTwc;
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Sophus::SE3f(Eigen::Map<const Sophus::SE3f>(snapshot.Twc));
 }
 
 Eigen::Vector3f KeyFrame::GetCameraCenter(){
-    unique_lock<mutex> lock(mMutexPose);
-    return mTwc.translation();
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Eigen::Vector3f(snapshot.Twc[4], snapshot.Twc[5], snapshot.Twc[6]);
 }
 
 Eigen::Vector3f KeyFrame::GetImuPosition()
@@ -164,14 +203,13 @@ Sophus::SE3f KeyFrame::GetImuPose()
 }
 
 Eigen::Matrix3f KeyFrame::GetRotation(){
-    unique_lock<mutex> lock(mMutexPose);
-    return mRcw;
+    return GetPose().rotationMatrix();
 }
 
 Eigen::Vector3f KeyFrame::GetTranslation()
 {
-    unique_lock<mutex> lock(mMutexPose);
-    return mTcw.translation();
+    const PoseSnapshot snapshot = mPoseSnapshot.Load();
+    return Eigen::Vector3f(snapshot.Tcw[4], snapshot.Tcw[5], snapshot.Tcw[6]);
 }
 
 Eigen::Vector3f KeyFrame::GetVelocity()
@@ -296,8 +334,13 @@ int KeyFrame::GetNumberMPs()
 
 void KeyFrame::AddMapPoint(MapPoint *pMP, const size_t &idx)
 {
-    unique_lock<mutex> lock(mMutexFeatures);
-    mvpMapPoints[idx]=pMP;
+    // A bad point may be reclaimed and is not linked again; checked again after, as it may turn bad meanwhile
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        mvpMapPoints[idx] = pMP->isBad() ? static_cast<MapPoint*>(NULL) : pMP;
+    }
+    if(pMP->isBad())
+        ReleaseMapPointMatch(idx, pMP);
 }
 
 void KeyFrame::EraseMapPointMatch(const int &idx)
@@ -319,7 +362,16 @@ void KeyFrame::EraseMapPointMatch(MapPoint* pMP)
 
 void KeyFrame::ReplaceMapPointMatch(const int &idx, MapPoint* pMP)
 {
-    mvpMapPoints[idx]=pMP;
+    mvpMapPoints[idx] = pMP->isBad() ? static_cast<MapPoint*>(NULL) : pMP;
+    if(pMP->isBad())
+        ReleaseMapPointMatch(idx, pMP);
+}
+
+void KeyFrame::ReleaseMapPointMatch(const size_t &idx, MapPoint* pMP)
+{
+    unique_lock<mutex> lock(mMutexFeatures);
+    if(mvpMapPoints[idx]==pMP)
+        mvpMapPoints[idx]=static_cast<MapPoint*>(NULL);
 }
 
 set<MapPoint*> KeyFrame::GetMapPoints()
@@ -370,6 +422,12 @@ vector<MapPoint*> KeyFrame::GetMapPointMatches()
     return mvpMapPoints;
 }
 
+void KeyFrame::GetMapPointMatches(vector<MapPoint*> &vpMapPoints)
+{
+    unique_lock<mutex> lock(mMutexFeatures);
+    vpMapPoints.assign(mvpMapPoints.begin(), mvpMapPoints.end());
+}
+
 MapPoint* KeyFrame::GetMapPoint(const size_t &idx)
 {
     unique_lock<mutex> lock(mMutexFeatures);
@@ -378,7 +436,10 @@ MapPoint* KeyFrame::GetMapPoint(const size_t &idx)
 
 void KeyFrame::UpdateConnections(bool upParent)
 {
-    map<KeyFrame*,int> KFcounter;
+    // Covisible keyframes are counted in an array indexed by their dense map index rather than in a map keyed by
+    // pointer, one instance per thread since UpdateConnections runs in local mapping and loop closing
+    thread_local DenseMap<KeyFrame,int> tlKFcounter;
+    DenseMap<KeyFrame,int> &KFcounter = tlKFcounter;
 
     vector<MapPoint*> vpMP;
 
@@ -403,17 +464,27 @@ void KeyFrame::UpdateConnections(bool upParent)
 
         for(map<KeyFrame*,tuple<int,int>>::iterator mit=observations.begin(), mend=observations.end(); mit!=mend; mit++)
         {
-            if(mit->first->mnId==mnId || mit->first->isBad() || mit->first->GetMap() != mpMap)
+            if(mit->first->mnId==mnId)
                 continue;
             KFcounter[mit->first]++;
-
         }
     }
 
+    vector<pair<KeyFrame*,int> > vCounts;
+    KFcounter.Extract(vCounts);
+
+    // Once per covisible keyframe rather than once per shared point
+    vCounts.erase(remove_if(vCounts.begin(), vCounts.end(),
+                            [this](const pair<KeyFrame*,int> &count) { return count.first->isBad() || count.first->GetMap() != mpMap; }),
+                  vCounts.end());
+
     // This should not happen
-    if(KFcounter.empty())
+    if(vCounts.empty())
         return;
 
+    // Visit them in pointer order, as the map did, so ties are broken the same way
+    sort(vCounts.begin(), vCounts.end());
+
     //If the counter is greater than threshold add connection
     //In case no keyframe counter is over threshold add the one with maximum counter
     int nmax=0;
@@ -421,22 +492,22 @@ void KeyFrame::UpdateConnections(bool upParent)
     int th = 15;
 
     vector<pair<int,KeyFrame*> > vPairs;
-    vPairs.reserve(KFcounter.size());
+    vPairs.reserve(vCounts.size());
     if(!upParent)
         cout << "UPDATE_CONN: current KF " << mnId << endl;
-    for(map<KeyFrame*,int>::iterator mit=KFcounter.begin(), mend=KFcounter.end(); mit!=mend; mit++)
+    for(vector<pair<KeyFrame*,int> >::iterator vit=vCounts.begin(), vend=vCounts.end(); vit!=vend; vit++)
     {
         if(!upParent)
-            cout << "  UPDATE_CONN: KF " << mit->first->mnId << " ; num matches: " << mit->second << endl;
-        if(mit->second>nmax)
+            cout << "  UPDATE_CONN: KF " << vit->first->mnId << " ; num matches: " << vit->second << endl;
+        if(vit->second>nmax)
         {
-            nmax=mit->second;
-            pKFmax=mit->first;
+            nmax=vit->second;
+            pKFmax=vit->first;
         }
-        if(mit->second>=th)
+        if(vit->second>=th)
         {
-            vPairs.push_back(make_pair(mit->second,mit->first));
-            (mit->first)->AddConnection(this,mit->second);
+            vPairs.push_back(make_pair(vit->second,vit->first));
+            (vit->first)->AddConnection(this,vit->second);
         }
     }
 
@@ -458,7 +529,8 @@ void KeyFrame::UpdateConnections(bool upParent)
     {
         unique_lock<mutex> lockCon(mMutexConnections);
 
-        mConnectedKeyFrameWeights = KFcounter;
+        // Built from the sorted range in linear time
+        mConnectedKeyFrameWeights = map<KeyFrame*,int>(vCounts.begin(), vCounts.end());
         mvpOrderedConnectedKeyFrames = vector<KeyFrame*>(lKFs.begin(),lKFs.end());
         mvOrderedWeights = vector<int>(lWs.begin(), lWs.end());
 
@@ -704,32 +776,38 @@ void KeyFrame::EraseConnection(KeyFrame* pKF)
 vector<size_t> KeyFrame::GetFeaturesInArea(const float &x, const float &y, const float &r, const bool bRight) const
 {
     vector<size_t> vIndices;
-    vIndices.reserve(N);
+    GetFeaturesInArea(vIndices, x, y, r, bRight);
+    return vIndices;
+}
+
+size_t KeyFrame::GetFeaturesInArea(vector<size_t> &vIndices, const float &x, const float &y, const float &r, const bool bRight) const
+{
+    vIndices.clear();
 
     float factorX = r;
     float factorY = r;
 
     const int nMinCellX = max(0,(int)floor((x-mnMinX-factorX)*mfGridElementWidthInv));
     if(nMinCellX>=mnGridCols)
-        return vIndices;
+        return 0;
 
     const int nMaxCellX = min((int)mnGridCols-1,(int)ceil((x-mnMinX+factorX)*mfGridElementWidthInv));
     if(nMaxCellX<0)
-        return vIndices;
+        return 0;
 
     const int nMinCellY = max(0,(int)floor((y-mnMinY-factorY)*mfGridElementHeightInv));
     if(nMinCellY>=mnGridRows)
-        return vIndices;
+        return 0;
 
     const int nMaxCellY = min((int)mnGridRows-1,(int)ceil((y-mnMinY+factorY)*mfGridElementHeightInv));
     if(nMaxCellY<0)
-        return vIndices;
+        return 0;
 
     for(int ix = nMinCellX; ix<=nMaxCellX; ix++)
     {
         for(int iy = nMinCellY; iy<=nMaxCellY; iy++)
         {
-            const vector<size_t> vCell = (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
+            const vector<size_t> &vCell = (!bRight) ? mGrid[ix][iy] : mGridRight[ix][iy];
             for(size_t j=0, jend=vCell.size(); j<jend; j++)
             {
                 const cv::KeyPoint &kpUn = (NLeft == -1) ? mvKeysUn[vCell[j]]
@@ -744,7 +822,7 @@ vector<size_t> KeyFrame::GetFeaturesInArea(const float &x, const float &y, const
         }
     }
 
-    return vIndices;
+    return vIndices.size();
 }
 
 bool KeyFrame::IsInImage(const float &x, const float &y) const
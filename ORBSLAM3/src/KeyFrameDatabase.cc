@@ -764,7 +764,7 @@ vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F, Map
     {
         unique_lock<mutex> lock(mMutex);
 
-        for(fbow::BoWVector::const_iterator vit=F->mBowVec.begin(), vend=F->mBowVec.end(); vit != vend; vit++)
+        for(fbow::BoWVector::const_iterator vit=F->mpFeatures->mBowVec.begin(), vend=F->mpFeatures->mBowVec.end(); vit != vend; vit++)
         {
             list<KeyFrame*> &lKFs =   mvInvertedFile[vit->first];
 
@@ -807,7 +807,7 @@ vector<KeyFrame*> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F, Map
         {
             nscores++;
             // float si = mpVoc->score(F->mBowVec,pKFi->mBowVec);
-            float si = score(F->mBowVec,pKFi->mBowVec);
+            float si = score(F->mpFeatures->mBowVec,pKFi->mBowVec);
             pKFi->mRelocScore=si;
             lScoreAndMatch.push_back(make_pair(si,pKFi));
         }
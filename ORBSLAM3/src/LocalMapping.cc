@@ -23,13 +23,22 @@
 #include "Optimizer.h"
 #include "Converter.h"
 #include "GeometricTools.h"
+#include "Tracer.h"
 
 #include<mutex>
 #include<chrono>
+#include<algorithm>
+#include<functional>
 
 namespace ORB_SLAM3
 {
 
+namespace
+{
+    // Fewer candidates or points than this per task are not worth a hand-off to the mapping pool
+    const size_t MIN_FUSE_ITEMS_PER_TASK = 64;
+}
+
 LocalMapping::LocalMapping(System* pSys, Atlas *pAtlas, const float bMonocular, bool bInertial, const string &_strSeqName):
     mpSystem(pSys), mbMonocular(bMonocular), mbInertial(bInertial), mbResetRequested(false), mbResetRequestedActiveMap(false), mbFinishRequested(false), mbFinished(true), mpAtlas(pAtlas), bInitializing(false),
     mbAbortBA(false), mbStopped(false), mbStopRequested(false), mbNotStop(false), mbAcceptKeyFrames(true),
@@ -61,9 +70,20 @@ void LocalMapping::SetTracker(Tracking *pTracker)
     mpTracker=pTracker;
 }
 
+void LocalMapping::SetThreads(int nThreads)
+{
+    // The mapping thread takes part in the work, so the pool has one thread less
+    if(nThreads > 1)
+        mpMappingPool.reset(new ThreadPool(nThreads - 1));
+    else
+        mpMappingPool.reset();
+}
+
 void LocalMapping::Run()
 {
     mbFinished = false;
+    Tracer::SetThreadName("LocalMapping");
+    QuiescenceScope quiescence(MapPoint::Reclamation());
 
     while(1)
     {
@@ -79,8 +99,15 @@ void LocalMapping::Run()
 
             std::chrono::steady_clock::time_point time_StartProcessKF = std::chrono::steady_clock::now();
 #endif
+            TraceScope traceLM("LocalMapping");
+            TraceScope traceStage("ProcessNewKeyFrame");
+
             // BoW conversion and insertion in Map
             ProcessNewKeyFrame();
+            const long nKFId = mpCurrentKeyFrame->mnId;
+            traceLM.SetId(nKFId);
+            traceStage.SetId(nKFId);
+            traceStage.Stop();
 #ifdef REGISTER_TIMES
             std::chrono::steady_clock::time_point time_EndProcessKF = std::chrono::steady_clock::now();
 
@@ -89,7 +116,9 @@ void LocalMapping::Run()
 #endif
 
             // Check recent MapPoints
+            TraceScope traceCulling("MapPointCulling", nKFId);
             MapPointCulling();
+            traceCulling.Stop();
 #ifdef REGISTER_TIMES
             std::chrono::steady_clock::time_point time_EndMPCulling = std::chrono::steady_clock::now();
 
@@ -98,13 +127,16 @@ void LocalMapping::Run()
 #endif
 
             // Triangulate new MapPoints
+            TraceScope traceCreation("CreateNewMapPoints", nKFId);
             CreateNewMapPoints();
+            traceCreation.Stop();
 
             mbAbortBA = false;
 
             if(!CheckNewKeyFrames())
             {
                 // Find more matches in neighbor keyframes and fuse point duplications
+                TraceScope traceFusion("SearchInNeighbors", nKFId);
                 SearchInNeighbors();
             }
 
@@ -123,6 +155,7 @@ void LocalMapping::Run()
 
             if(!CheckNewKeyFrames() && !stopRequested())
             {
+                TraceScope traceLBA("LocalBA", nKFId);
                 if(mpAtlas->KeyFramesInMap()>2)
                 {
 
@@ -156,6 +189,7 @@ void LocalMapping::Run()
                     }
 
                 }
+                traceLBA.Stop();
 #ifdef REGISTER_TIMES
                 std::chrono::steady_clock::time_point time_EndLBA = std::chrono::steady_clock::now();
 
@@ -188,7 +222,9 @@ void LocalMapping::Run()
 
 
                 // Check redundant local Keyframes
+                TraceScope traceKFCulling("KeyFrameCulling", nKFId);
                 KeyFrameCulling();
+                traceKFCulling.Stop();
 
 #ifdef REGISTER_TIMES
                 std::chrono::steady_clock::time_point time_EndKFCulling = std::chrono::steady_clock::now();
@@ -258,11 +294,8 @@ void LocalMapping::Run()
         }
         else if(Stop() && !mbBadImu)
         {
-            // Safe area to stop
-            while(isStopped() && !CheckFinish())
-            {
-                usleep(3000);
-            }
+            // Safe area to stop, until Release or RequestFinish
+            mStateSignal.Wait([this]() { return !isStopped() || CheckFinish(); });
             if(CheckFinish())
                 break;
         }
@@ -272,10 +305,17 @@ void LocalMapping::Run()
         // Tracking will see that Local Mapping is busy
         SetAcceptKeyFrames(true);
 
+        // Between keyframes only the recently added points are kept; then free the bad points no thread reaches
+        quiescence.Quiesce([this]() {
+            mlpRecentAddedMapPoints.remove_if([](MapPoint* pMP) { return pMP->isBad(); });
+        });
+        MapPoint::ReclaimRetired(mpAtlas->GetAllMaps());
+
         if(CheckFinish())
             break;
 
-        usleep(3000);
+        // Idle until a keyframe or a stop, reset or finish request arrives
+        mStateSignal.Wait([this]() { return HasWork(); });
     }
 
     SetFinish();
@@ -283,9 +323,13 @@ void LocalMapping::Run()
 
 void LocalMapping::InsertKeyFrame(KeyFrame *pKF)
 {
-    unique_lock<mutex> lock(mMutexNewKFs);
-    mlNewKeyFrames.push_back(pKF);
-    mbAbortBA=true;
+    {
+        unique_lock<mutex> lock(mMutexNewKFs);
+        pKF->mnMappingQueuedNs = Tracer::NowNs();
+        mlNewKeyFrames.push_back(pKF);
+        mbAbortBA=true;
+    }
+    mStateSignal.Notify();
 }
 
 
@@ -295,6 +339,21 @@ bool LocalMapping::CheckNewKeyFrames()
     return(!mlNewKeyFrames.empty());
 }
 
+bool LocalMapping::HasWork()
+{
+    if(CheckNewKeyFrames() && !mbBadImu)
+        return true;
+    if(CheckFinish())
+        return true;
+    {
+        unique_lock<mutex> lock(mMutexStop);
+        if(mbStopRequested && !mbNotStop && !mbStopped)
+            return true;
+    }
+    unique_lock<mutex> lock(mMutexReset);
+    return mbResetRequested || mbResetRequestedActiveMap;
+}
+
 void LocalMapping::ProcessNewKeyFrame()
 {
     {
@@ -303,6 +362,10 @@ void LocalMapping::ProcessNewKeyFrame()
         mlNewKeyFrames.pop_front();
     }
 
+    // Keyframe insert to mapping start latency
+    if(Tracer::IsEnabled() && mpCurrentKeyFrame->mnMappingQueuedNs)
+        Tracer::Record("KeyFrameQueueWait", mpCurrentKeyFrame->mnId, mpCurrentKeyFrame->mnMappingQueuedNs, Tracer::NowNs());
+
     // Compute Bags of Words structures
     mpCurrentKeyFrame->ComputeBoW();
 
@@ -415,6 +478,51 @@ void LocalMapping::CreateNewMapPoints()
         }
     }
 
+    // Inertial mode: use coarse matching if recently lost and after 2nd inertial BA
+    const bool bCoarse = mbInertial && mpTracker->mState==Tracking::RECENTLY_LOST && mpCurrentKeyFrame->GetMap()->GetIniertialBA2();
+
+    // Step 2: Search matches with epipolar restriction and triangulate them with every neighbor
+    const int nNeighs = vpNeighKFs.size();
+    if(!mpMappingPool)
+    {
+        for(int i=0; i<nNeighs; i++)
+        {
+            // If a new keyframe arrives, process it first (this is time-consuming)
+            if(i>0 && CheckNewKeyFrames())
+                return;
+
+            vector<TriangulatedPoint> vPoints;
+            TriangulateWithNeighbor(vpNeighKFs[i], bCoarse, vPoints);
+            CreateTriangulatedPoints(vpNeighKFs[i], vPoints);
+        }
+        return;
+    }
+
+    // The neighbors only read the keyframes, so they are triangulated concurrently. The map points are then created
+    // in neighbor order, as the sequential loop does, skipping the keypoints an earlier neighbor already took.
+    vector<vector<TriangulatedPoint> > vvPoints(nNeighs);
+    vector<char> vbAborted(nNeighs, false);
+    mpMappingPool->ParallelFor(nNeighs, [&](int i)
+    {
+        if(i>0 && CheckNewKeyFrames())
+        {
+            vbAborted[i] = true;
+            return;
+        }
+
+        TriangulateWithNeighbor(vpNeighKFs[i], bCoarse, vvPoints[i]);
+    });
+
+    for(int i=0; i<nNeighs; i++)
+    {
+        if(vbAborted[i])
+            return;
+        CreateTriangulatedPoints(vpNeighKFs[i], vvPoints[i]);
+    }
+}
+
+void LocalMapping::TriangulateWithNeighbor(KeyFrame* pKF2, const bool bCoarse, vector<TriangulatedPoint> &vPoints)
+{
     float th = 0.6f;
     // Feature matching configuration: only accept matches where min dist < 0.6 * second min dist (strict). No rotation check.
     string featureExtractorType = GlobalFeatureExtractorInfo::GetFeatureExtractorType();
@@ -439,288 +547,281 @@ void LocalMapping::CreateNewMapPoints()
     // Used for later depth validation; 1.5 is an empirical value
     const float ratioFactor = 1.5f*mpCurrentKeyFrame->mfScaleFactor;
 
-    // The following are for statistics only
-    int countStereo = 0;
-    int countStereoGoodProj = 0;
-    int countStereoAttempt = 0;
-    int totalStereoPts = 0;
-    // Step 2: Iterate through neighboring keyframes (Search matches with epipolar restriction and triangulate)
-    for(size_t i=0; i<vpNeighKFs.size(); i++)
+    GeometricCamera* pCamera1 = mpCurrentKeyFrame->mpCamera, *pCamera2 = pKF2->mpCamera;
+
+    // Step 3: Check if the baseline between cameras is long enough
+    Eigen::Vector3f Ow2 = pKF2->GetCameraCenter();
+    Eigen::Vector3f vBaseline = Ow2-Ow1;
+    const float baseline = vBaseline.norm();
+
+    if(!mbMonocular)
     {
-        // If a new keyframe arrives, process it first (this is time-consuming)
-        if(i>0 && CheckNewKeyFrames())
+        // For stereo: skip if baseline is shorter than the stereo baseline (unstable triangulation)
+        if(baseline<pKF2->mb)
             return;
+    }
+    else
+    {
+        // For monocular: check baseline-to-depth ratio
+        const float medianDepthKF2 = pKF2->ComputeSceneMedianDepth(2);
+        const float ratioBaselineDepth = baseline/medianDepthKF2;
+        // If ratio is too small, skip (triangulation would be unreliable)
+        if(ratioBaselineDepth<0.01)
+            return;
+    }
+
+    // Step 4: Find feature matches between the two keyframes using epipolar constraint
+    vector<pair<size_t,size_t> > vMatchedIndices;
+    matcher.SearchForTriangulation(mpCurrentKeyFrame,pKF2,vMatchedIndices,false,bCoarse);
+
+    // Get pose and intrinsics of the neighbor keyframe
+    Sophus::SE3<float> sophTcw2 = pKF2->GetPose();
+    Eigen::Matrix<float,3,4> eigTcw2 = sophTcw2.matrix3x4();
+    Eigen::Matrix<float,3,3> Rcw2 = eigTcw2.block<3,3>(0,0);
+    Eigen::Matrix<float,3,3> Rwc2 = Rcw2.transpose();
+    Eigen::Vector3f tcw2 = sophTcw2.translation();
+
+    const float &fx2 = pKF2->fx;
+    const float &fy2 = pKF2->fy;
+    const float &cx2 = pKF2->cx;
+    const float &cy2 = pKF2->cy;
+    const float &invfx2 = pKF2->invfx;
+    const float &invfy2 = pKF2->invfy;
+
+    // Step 5: For each match, attempt to triangulate a 3D point
+    const int nmatches = vMatchedIndices.size();
+    for(int ikp=0; ikp<nmatches; ikp++)
+    {
+        // 5.0: Indices of the match in the current and neighbor keyframes
+        const int &idx1 = vMatchedIndices[ikp].first;
+        const int &idx2 = vMatchedIndices[ikp].second;
+
+        // 5.1: Get the keypoints in both keyframes
+        const cv::KeyPoint &kp1 = (mpCurrentKeyFrame -> NLeft == -1) ? mpCurrentKeyFrame->mvKeysUn[idx1]
+                                                                     : (idx1 < mpCurrentKeyFrame -> NLeft) ? mpCurrentKeyFrame -> mvKeys[idx1]
+                                                                                                           : mpCurrentKeyFrame -> mvKeysRight[idx1 - mpCurrentKeyFrame -> NLeft];
+        const float kp1_ur=mpCurrentKeyFrame->mvuRight[idx1];
+        bool bStereo1 = (!mpCurrentKeyFrame->mpCamera2 && kp1_ur>=0);
+        const bool bRight1 = (mpCurrentKeyFrame -> NLeft == -1 || idx1 < mpCurrentKeyFrame -> NLeft) ? false : true;
+
+        const cv::KeyPoint &kp2 = (pKF2 -> NLeft == -1) ? pKF2->mvKeysUn[idx2]
+                                                        : (idx2 < pKF2 -> NLeft) ? pKF2 -> mvKeys[idx2]
+                                                                                 : pKF2 -> mvKeysRight[idx2 - pKF2 -> NLeft];
+        const float kp2_ur = pKF2->mvuRight[idx2];
+        bool bStereo2 = (!pKF2->mpCamera2 && kp2_ur>=0);
+        const bool bRight2 = (pKF2 -> NLeft == -1 || idx2 < pKF2 -> NLeft) ? false : true;
+
+        // 5.3: For stereo, determine which camera and pose to use for each keypoint
+        if(mpCurrentKeyFrame->mpCamera2 && pKF2->mpCamera2){
+            if(bRight1 && bRight2){
+                sophTcw1 = mpCurrentKeyFrame->GetRightPose();
+                Ow1 = mpCurrentKeyFrame->GetRightCameraCenter();
+
+                sophTcw2 = pKF2->GetRightPose();
+                Ow2 = pKF2->GetRightCameraCenter();
+
+                pCamera1 = mpCurrentKeyFrame->mpCamera2;
+                pCamera2 = pKF2->mpCamera2;
+            }
+            else if(bRight1 && !bRight2){
+                sophTcw1 = mpCurrentKeyFrame->GetRightPose();
+                Ow1 = mpCurrentKeyFrame->GetRightCameraCenter();
 
-        KeyFrame* pKF2 = vpNeighKFs[i];
+                sophTcw2 = pKF2->GetPose();
+                Ow2 = pKF2->GetCameraCenter();
 
-        GeometricCamera* pCamera1 = mpCurrentKeyFrame->mpCamera, *pCamera2 = pKF2->mpCamera;
+                pCamera1 = mpCurrentKeyFrame->mpCamera2;
+                pCamera2 = pKF2->mpCamera;
+            }
+            else if(!bRight1 && bRight2){
+                sophTcw1 = mpCurrentKeyFrame->GetPose();
+                Ow1 = mpCurrentKeyFrame->GetCameraCenter();
+
+                sophTcw2 = pKF2->GetRightPose();
+                Ow2 = pKF2->GetRightCameraCenter();
+
+                pCamera1 = mpCurrentKeyFrame->mpCamera;
+                pCamera2 = pKF2->mpCamera2;
+            }
+            else{
+                sophTcw1 = mpCurrentKeyFrame->GetPose();
+                Ow1 = mpCurrentKeyFrame->GetCameraCenter();
+
+                sophTcw2 = pKF2->GetPose();
+                Ow2 = pKF2->GetCameraCenter();
 
-        // Step 3: Check if the baseline between cameras is long enough
-        Eigen::Vector3f Ow2 = pKF2->GetCameraCenter();
-        Eigen::Vector3f vBaseline = Ow2-Ow1;
-        const float baseline = vBaseline.norm();
+                pCamera1 = mpCurrentKeyFrame->mpCamera;
+                pCamera2 = pKF2->mpCamera;
+            }
+            eigTcw1 = sophTcw1.matrix3x4();
+            Rcw1 = eigTcw1.block<3,3>(0,0);
+            Rwc1 = Rcw1.transpose();
+            tcw1 = sophTcw1.translation();
+
+            eigTcw2 = sophTcw2.matrix3x4();
+            Rcw2 = eigTcw2.block<3,3>(0,0);
+            Rwc2 = Rcw2.transpose();
+            tcw2 = sophTcw2.translation();
+        }
 
-        if(!mbMonocular)
+        // Step 5.4: Compute parallax angle between rays
+        Eigen::Vector3f xn1 = pCamera1->unprojectEig(kp1.pt);
+        Eigen::Vector3f xn2 = pCamera2->unprojectEig(kp2.pt);
+        Eigen::Vector3f ray1 = Rwc1 * xn1;
+        Eigen::Vector3f ray2 = Rwc2 * xn2;
+        const float cosParallaxRays = ray1.dot(ray2)/(ray1.norm() * ray2.norm());
+
+        float cosParallaxStereo = cosParallaxRays+1;
+        float cosParallaxStereo1 = cosParallaxStereo;
+        float cosParallaxStereo2 = cosParallaxStereo;
+
+        // Step 5.5: For stereo, use stereo baseline to compute parallax; monocular does nothing special
+        if(bStereo1)
+            cosParallaxStereo1 = cos(2*atan2(mpCurrentKeyFrame->mb/2,mpCurrentKeyFrame->mvDepth[idx1]));
+        else if(bStereo2)
+            cosParallaxStereo2 = cos(2*atan2(pKF2->mb/2,pKF2->mvDepth[idx2]));
+
+        cosParallaxStereo = min(cosParallaxStereo1,cosParallaxStereo2);
+
+        // Step 5.6: Triangulate the 3D point
+        Eigen::Vector3f x3D;
+        bool goodProj = false;
+        // Use triangulation if parallax is sufficient, otherwise use stereo if available
+        if(cosParallaxRays<cosParallaxStereo && cosParallaxRays>0 && (bStereo1 || bStereo2 || (cosParallaxRays<0.9996 && mbInertial) || (cosParallaxRays<0.9998 && !mbInertial)))
         {
-            // For stereo: skip if baseline is shorter than the stereo baseline (unstable triangulation)
-            if(baseline<pKF2->mb)
+            goodProj = GeometricTools::Triangulate(xn1, xn2, eigTcw1, eigTcw2, x3D);
+            if(!goodProj)
                 continue;
         }
-        else
+        else if(bStereo1 && cosParallaxStereo1<cosParallaxStereo2)
         {
-            // For monocular: check baseline-to-depth ratio
-            const float medianDepthKF2 = pKF2->ComputeSceneMedianDepth(2);
-            const float ratioBaselineDepth = baseline/medianDepthKF2;
-            // If ratio is too small, skip (triangulation would be unreliable)
-            if(ratioBaselineDepth<0.01)
-                continue;
+            // For stereo, use the observation with the larger parallax
+            goodProj = mpCurrentKeyFrame->UnprojectStereo(idx1, x3D);
         }
-
-        // Step 4: Find feature matches between the two keyframes using epipolar constraint
-        vector<pair<size_t,size_t> > vMatchedIndices;
-        // Inertial mode: use coarse matching if recently lost and after 2nd inertial BA
-        bool bCoarse = mbInertial && mpTracker->mState==Tracking::RECENTLY_LOST && mpCurrentKeyFrame->GetMap()->GetIniertialBA2();
-        matcher.SearchForTriangulation(mpCurrentKeyFrame,pKF2,vMatchedIndices,false,bCoarse);
-
-        // Get pose and intrinsics of the neighbor keyframe
-        Sophus::SE3<float> sophTcw2 = pKF2->GetPose();
-        Eigen::Matrix<float,3,4> eigTcw2 = sophTcw2.matrix3x4();
-        Eigen::Matrix<float,3,3> Rcw2 = eigTcw2.block<3,3>(0,0);
-        Eigen::Matrix<float,3,3> Rwc2 = Rcw2.transpose();
-        Eigen::Vector3f tcw2 = sophTcw2.translation();
-
-        const float &fx2 = pKF2->fx;
-        const float &fy2 = pKF2->fy;
-        const float &cx2 = pKF2->cx;
-        const float &cy2 = pKF2->cy;
-        const float &invfx2 = pKF2->invfx;
-        const float &invfy2 = pKF2->invfy;
-
-        // Step 5: For each match, attempt to triangulate a 3D point
-        const int nmatches = vMatchedIndices.size();
-        for(int ikp=0; ikp<nmatches; ikp++)
+        else if(bStereo2 && cosParallaxStereo2<cosParallaxStereo1)
         {
-            // 5.0: Indices of the match in the current and neighbor keyframes
-            const int &idx1 = vMatchedIndices[ikp].first;
-            const int &idx2 = vMatchedIndices[ikp].second;
-
-            // 5.1: Get the keypoints in both keyframes
-            const cv::KeyPoint &kp1 = (mpCurrentKeyFrame -> NLeft == -1) ? mpCurrentKeyFrame->mvKeysUn[idx1]
-                                                                         : (idx1 < mpCurrentKeyFrame -> NLeft) ? mpCurrentKeyFrame -> mvKeys[idx1]
-                                                                                                               : mpCurrentKeyFrame -> mvKeysRight[idx1 - mpCurrentKeyFrame -> NLeft];
-            const float kp1_ur=mpCurrentKeyFrame->mvuRight[idx1];
-            bool bStereo1 = (!mpCurrentKeyFrame->mpCamera2 && kp1_ur>=0);
-            const bool bRight1 = (mpCurrentKeyFrame -> NLeft == -1 || idx1 < mpCurrentKeyFrame -> NLeft) ? false : true;
-
-            const cv::KeyPoint &kp2 = (pKF2 -> NLeft == -1) ? pKF2->mvKeysUn[idx2]
-                                                            : (idx2 < pKF2 -> NLeft) ? pKF2 -> mvKeys[idx2]
-                                                                                     : pKF2 -> mvKeysRight[idx2 - pKF2 -> NLeft];
-            const float kp2_ur = pKF2->mvuRight[idx2];
-            bool bStereo2 = (!pKF2->mpCamera2 && kp2_ur>=0);
-            const bool bRight2 = (pKF2 -> NLeft == -1 || idx2 < pKF2 -> NLeft) ? false : true;
-
-            // 5.3: For stereo, determine which camera and pose to use for each keypoint
-            if(mpCurrentKeyFrame->mpCamera2 && pKF2->mpCamera2){
-                if(bRight1 && bRight2){
-                    sophTcw1 = mpCurrentKeyFrame->GetRightPose();
-                    Ow1 = mpCurrentKeyFrame->GetRightCameraCenter();
-
-                    sophTcw2 = pKF2->GetRightPose();
-                    Ow2 = pKF2->GetRightCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera2;
-                    pCamera2 = pKF2->mpCamera2;
-                }
-                else if(bRight1 && !bRight2){
-                    sophTcw1 = mpCurrentKeyFrame->GetRightPose();
-                    Ow1 = mpCurrentKeyFrame->GetRightCameraCenter();
-
-                    sophTcw2 = pKF2->GetPose();
-                    Ow2 = pKF2->GetCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera2;
-                    pCamera2 = pKF2->mpCamera;
-                }
-                else if(!bRight1 && bRight2){
-                    sophTcw1 = mpCurrentKeyFrame->GetPose();
-                    Ow1 = mpCurrentKeyFrame->GetCameraCenter();
-
-                    sophTcw2 = pKF2->GetRightPose();
-                    Ow2 = pKF2->GetRightCameraCenter();
-
-                    pCamera1 = mpCurrentKeyFrame->mpCamera;
-                    pCamera2 = pKF2->mpCamera2;
-                }
-                else{
-                    sophTcw1 = mpCurrentKeyFrame->GetPose();
-                    Ow1 = mpCurrentKeyFrame->GetCameraCenter();
+            goodProj = pKF2->UnprojectStereo(idx2, x3D);
+        }
+        else
+        {
+            continue; // No stereo and very low parallax
+        }
 
-                    sophTcw2 = pKF2->GetPose();
-                    Ow2 = pKF2->GetCameraCenter();
+        if(!goodProj)
+            continue;
 
-                    pCamera1 = mpCurrentKeyFrame->mpCamera;
-                    pCamera2 = pKF2->mpCamera;
-                }
-                eigTcw1 = sophTcw1.matrix3x4();
-                Rcw1 = eigTcw1.block<3,3>(0,0);
-                Rwc1 = Rcw1.transpose();
-                tcw1 = sophTcw1.translation();
-
-                eigTcw2 = sophTcw2.matrix3x4();
-                Rcw2 = eigTcw2.block<3,3>(0,0);
-                Rwc2 = Rcw2.transpose();
-                tcw2 = sophTcw2.translation();
-            }
+        // Step 5.7: Check if the triangulated point is in front of both cameras
+        float z1 = Rcw1.row(2).dot(x3D) + tcw1(2);
+        if(z1<=0)
+            continue;
 
-            // Step 5.4: Compute parallax angle between rays
-            Eigen::Vector3f xn1 = pCamera1->unprojectEig(kp1.pt);
-            Eigen::Vector3f xn2 = pCamera2->unprojectEig(kp2.pt);
-            Eigen::Vector3f ray1 = Rwc1 * xn1;
-            Eigen::Vector3f ray2 = Rwc2 * xn2;
-            const float cosParallaxRays = ray1.dot(ray2)/(ray1.norm() * ray2.norm());
-
-            float cosParallaxStereo = cosParallaxRays+1;
-            float cosParallaxStereo1 = cosParallaxStereo;
-            float cosParallaxStereo2 = cosParallaxStereo;
-
-            // Step 5.5: For stereo, use stereo baseline to compute parallax; monocular does nothing special
-            if(bStereo1)
-                cosParallaxStereo1 = cos(2*atan2(mpCurrentKeyFrame->mb/2,mpCurrentKeyFrame->mvDepth[idx1]));
-            else if(bStereo2)
-                cosParallaxStereo2 = cos(2*atan2(pKF2->mb/2,pKF2->mvDepth[idx2]));
-
-            if (bStereo1 || bStereo2) totalStereoPts++;
-            cosParallaxStereo = min(cosParallaxStereo1,cosParallaxStereo2);
-
-            // Step 5.6: Triangulate the 3D point
-            Eigen::Vector3f x3D;
-            bool goodProj = false;
-            bool bPointStereo = false;
-            // Use triangulation if parallax is sufficient, otherwise use stereo if available
-            if(cosParallaxRays<cosParallaxStereo && cosParallaxRays>0 && (bStereo1 || bStereo2 || (cosParallaxRays<0.9996 && mbInertial) || (cosParallaxRays<0.9998 && !mbInertial)))
-            {
-                goodProj = GeometricTools::Triangulate(xn1, xn2, eigTcw1, eigTcw2, x3D);
-                if(!goodProj)
-                    continue;
-            }
-            else if(bStereo1 && cosParallaxStereo1<cosParallaxStereo2)
-            {
-                countStereoAttempt++;
-                bPointStereo = true;
-                // For stereo, use the observation with the larger parallax
-                goodProj = mpCurrentKeyFrame->UnprojectStereo(idx1, x3D);
-            }
-            else if(bStereo2 && cosParallaxStereo2<cosParallaxStereo1)
-            {
-                countStereoAttempt++;
-                bPointStereo = true;
-                goodProj = pKF2->UnprojectStereo(idx2, x3D);
-            }
-            else
-            {
-                continue; // No stereo and very low parallax
-            }
+        float z2 = Rcw2.row(2).dot(x3D) + tcw2(2);
+        if(z2<=0)
+            continue;
 
-            // If triangulation was successful and stereo, count it
-            if(goodProj && bPointStereo)
-                countStereoGoodProj++;
+        // Step 5.7: Check reprojection error in the current keyframe
+        const float &sigmaSquare1 = mpCurrentKeyFrame->mvLevelSigma2[kp1.octave];
+        const float x1 = Rcw1.row(0).dot(x3D)+tcw1(0);
+        const float y1 = Rcw1.row(1).dot(x3D)+tcw1(1);
+        const float invz1 = 1.0/z1;
 
-            if(!goodProj)
+        if(!bStereo1)
+        {
+            // Monocular: check reprojection error (2 DoF chi2 threshold 5.991)
+            cv::Point2f uv1 = pCamera1->project(cv::Point3f(x1,y1,z1));
+            float errX1 = uv1.x - kp1.pt.x;
+            float errY1 = uv1.y - kp1.pt.y;
+            if((errX1*errX1+errY1*errY1)>5.991*sigmaSquare1)
                 continue;
-
-            // Step 5.7: Check if the triangulated point is in front of both cameras
-            float z1 = Rcw1.row(2).dot(x3D) + tcw1(2);
-            if(z1<=0)
+        }
+        else
+        {
+            // Stereo: check reprojection error (3 DoF chi2 threshold 7.8)
+            float u1 = fx1*x1*invz1+cx1;
+            float u1_r = u1 - mpCurrentKeyFrame->mbf*invz1;
+            float v1 = fy1*y1*invz1+cy1;
+            float errX1 = u1 - kp1.pt.x;
+            float errY1 = v1 - kp1.pt.y;
+            float errX1_r = u1_r - kp1_ur;
+            if((errX1*errX1+errY1*errY1+errX1_r*errX1_r)>7.8*sigmaSquare1)
                 continue;
+        }
 
-            float z2 = Rcw2.row(2).dot(x3D) + tcw2(2);
-            if(z2<=0)
+        // Step 5.7: Check reprojection error in the neighbor keyframe
+        const float sigmaSquare2 = pKF2->mvLevelSigma2[kp2.octave];
+        const float x2 = Rcw2.row(0).dot(x3D)+tcw2(0);
+        const float y2 = Rcw2.row(1).dot(x3D)+tcw2(1);
+        const float invz2 = 1.0/z2;
+        if(!bStereo2)
+        {
+            cv::Point2f uv2 = pCamera2->project(cv::Point3f(x2,y2,z2));
+            float errX2 = uv2.x - kp2.pt.x;
+            float errY2 = uv2.y - kp2.pt.y;
+            if((errX2*errX2+errY2*errY2)>5.991*sigmaSquare2)
+                continue;
+        }
+        else
+        {
+            float u2 = fx2*x2*invz2+cx2;
+            float u2_r = u2 - mpCurrentKeyFrame->mbf*invz2;
+            float v2 = fy2*y2*invz2+cy2;
+            float errX2 = u2 - kp2.pt.x;
+            float errY2 = v2 - kp2.pt.y;
+            float errX2_r = u2_r - kp2_ur;
+            if((errX2*errX2+errY2*errY2+errX2_r*errX2_r)>7.8*sigmaSquare2)
                 continue;
+        }
 
-            // Step 5.7: Check reprojection error in the current keyframe
-            const float &sigmaSquare1 = mpCurrentKeyFrame->mvLevelSigma2[kp1.octave];
-            const float x1 = Rcw1.row(0).dot(x3D)+tcw1(0);
-            const float y1 = Rcw1.row(1).dot(x3D)+tcw1(1);
-            const float invz1 = 1.0/z1;
+        // Step 5.8: Check scale consistency between the two keyframes
+        Eigen::Vector3f normal1 = x3D - Ow1;
+        float dist1 = normal1.norm();
+        Eigen::Vector3f normal2 = x3D - Ow2;
+        float dist2 = normal2.norm();
+        if(dist1==0 || dist2==0)
+            continue;
+        if(mbFarPoints && (dist1>=mThFarPoints||dist2>=mThFarPoints))
+            continue;
+        const float ratioDist = dist2/dist1;
+        const float ratioOctave = mpCurrentKeyFrame->mvScaleFactors[kp1.octave]/pKF2->mvScaleFactors[kp2.octave];
+        // The ratio of distances and pyramid scale factors should not differ too much
+        if(ratioDist*ratioFactor<ratioOctave || ratioDist>ratioOctave*ratioFactor)
+            continue;
 
-            if(!bStereo1)
-            {
-                // Monocular: check reprojection error (2 DoF chi2 threshold 5.991)
-                cv::Point2f uv1 = pCamera1->project(cv::Point3f(x1,y1,z1));
-                float errX1 = uv1.x - kp1.pt.x;
-                float errY1 = uv1.y - kp1.pt.y;
-                if((errX1*errX1+errY1*errY1)>5.991*sigmaSquare1)
-                    continue;
-            }
-            else
-            {
-                // Stereo: check reprojection error (3 DoF chi2 threshold 7.8)
-                float u1 = fx1*x1*invz1+cx1;
-                float u1_r = u1 - mpCurrentKeyFrame->mbf*invz1;
-                float v1 = fy1*y1*invz1+cy1;
-                float errX1 = u1 - kp1.pt.x;
-                float errY1 = v1 - kp1.pt.y;
-                float errX1_r = u1_r - kp1_ur;
-                if((errX1*errX1+errY1*errY1+errX1_r*errX1_r)>7.8*sigmaSquare1)
-                    continue;
-            }
+        // Step 6: Triangulation successful, the map point is created by CreateTriangulatedPoints
+        TriangulatedPoint point;
+        point.x3D = x3D;
+        point.idx1 = idx1;
+        point.idx2 = idx2;
+        vPoints.push_back(point);
+    }
+}
 
-            // Step 5.7: Check reprojection error in the neighbor keyframe
-            const float sigmaSquare2 = pKF2->mvLevelSigma2[kp2.octave];
-            const float x2 = Rcw2.row(0).dot(x3D)+tcw2(0);
-            const float y2 = Rcw2.row(1).dot(x3D)+tcw2(1);
-            const float invz2 = 1.0/z2;
-            if(!bStereo2)
-            {
-                cv::Point2f uv2 = pCamera2->project(cv::Point3f(x2,y2,z2));
-                float errX2 = uv2.x - kp2.pt.x;
-                float errY2 = uv2.y - kp2.pt.y;
-                if((errX2*errX2+errY2*errY2)>5.991*sigmaSquare2)
-                    continue;
-            }
-            else
-            {
-                float u2 = fx2*x2*invz2+cx2;
-                float u2_r = u2 - mpCurrentKeyFrame->mbf*invz2;
-                float v2 = fy2*y2*invz2+cy2;
-                float errX2 = u2 - kp2.pt.x;
-                float errY2 = v2 - kp2.pt.y;
-                float errX2_r = u2_r - kp2_ur;
-                if((errX2*errX2+errY2*errY2+errX2_r*errX2_r)>7.8*sigmaSquare2)
-                    continue;
-            }
+void LocalMapping::CreateTriangulatedPoints(KeyFrame* pKF2, const vector<TriangulatedPoint> &vPoints)
+{
+    if(vPoints.empty())
+        return;
 
-            // Step 5.8: Check scale consistency between the two keyframes
-            Eigen::Vector3f normal1 = x3D - Ow1;
-            float dist1 = normal1.norm();
-            Eigen::Vector3f normal2 = x3D - Ow2;
-            float dist2 = normal2.norm();
-            if(dist1==0 || dist2==0)
-                continue;
-            if(mbFarPoints && (dist1>=mThFarPoints||dist2>=mThFarPoints))
-                continue;
-            const float ratioDist = dist2/dist1;
-            const float ratioOctave = mpCurrentKeyFrame->mvScaleFactors[kp1.octave]/pKF2->mvScaleFactors[kp2.octave];
-            // The ratio of distances and pyramid scale factors should not differ too much
-            if(ratioDist*ratioFactor<ratioOctave || ratioDist>ratioOctave*ratioFactor)
-                continue;
+    Map* pMap = mpAtlas->GetCurrentMap();
+    unique_lock<mutex> lock(pMap->mMutexMapUpdate);
 
-            // Step 6: Triangulation successful, create a new MapPoint
-            MapPoint* pMP = new MapPoint(x3D, mpCurrentKeyFrame, mpAtlas->GetCurrentMap());
-            if (bPointStereo)
-                countStereo++;
-            // Step 6.1: Add observations and update MapPoint properties
-            pMP->AddObservation(mpCurrentKeyFrame,idx1);
-            pMP->AddObservation(pKF2,idx2);
-            mpCurrentKeyFrame->AddMapPoint(pMP,idx1);
-            pKF2->AddMapPoint(pMP,idx2);
-            pMP->ComputeDistinctiveDescriptors();
-            pMP->UpdateNormalAndDepth();
-            mpAtlas->AddMapPoint(pMP);
-            // Step 7: Add the new MapPoint to the recent-added queue for culling
-            mlpRecentAddedMapPoints.push_back(pMP);
-        }
-    }    
+    for(const TriangulatedPoint &point : vPoints)
+    {
+        // Taken by a map point of an earlier neighbor
+        if(mpCurrentKeyFrame->GetMapPoint(point.idx1) || pKF2->GetMapPoint(point.idx2))
+            continue;
+
+        // Step 6.1: Create the MapPoint, add observations and update its properties
+        MapPoint* pMP = new MapPoint(point.x3D, mpCurrentKeyFrame, pMap);
+        pMP->AddObservation(mpCurrentKeyFrame,point.idx1);
+        pMP->AddObservation(pKF2,point.idx2);
+        mpCurrentKeyFrame->AddMapPoint(pMP,point.idx1);
+        pKF2->AddMapPoint(pMP,point.idx2);
+        pMP->ComputeDistinctiveDescriptors();
+        pMP->UpdateNormalAndDepth();
+        mpAtlas->AddMapPoint(pMP);
+        // Step 7: Add the new MapPoint to the recent-added queue for culling
+        mlpRecentAddedMapPoints.push_back(pMP);
+    }
 }
 
 void LocalMapping::SearchInNeighbors()
@@ -774,15 +875,44 @@ void LocalMapping::SearchInNeighbors()
         }
     }
 
+    // Points are fused (MapPoint::Replace) and updated many times below; recompute each descriptor once
+    DescriptorUpdateBatch descriptorBatch;
+
+    // The fusion runs in two phases: the matches are searched concurrently, on the points and keyframes as they
+    // are before fusing, then applied in the order the sequential search would have found them. ApplyFuse skips
+    // the matches of the points an earlier one replaced or brought into the keyframe.
+    ThreadPool* pPool = mpMappingPool.get();
+    auto forEachTask = [pPool](int n, const std::function<void(int)> &f)
+    {
+        if(pPool)
+            pPool->ParallelFor(n, f);
+        else
+            for(int i=0; i<n; i++)
+                f(i);
+    };
+    // Contiguous ranges of n items, one per thread
+    auto tasksFor = [pPool](size_t n)
+    {
+        return pPool ? std::max(1, static_cast<int>(std::min<size_t>(pPool->Size() + 1, (n + MIN_FUSE_ITEMS_PER_TASK - 1) / MIN_FUSE_ITEMS_PER_TASK))) : 1;
+    };
+
     // Search matches by projection from current KF in target KFs
-    ORBmatcher matcher;
     vector<MapPoint*> vpMapPointMatches = mpCurrentKeyFrame->GetMapPointMatches();
-    for(vector<KeyFrame*>::iterator vit=vpTargetKFs.begin(), vend=vpTargetKFs.end(); vit!=vend; vit++)
+    const int nTargets = vpTargetKFs.size();
+    vector<vector<pair<MapPoint*,int> > > vvFuseMatches(nTargets), vvFuseMatchesRight(nTargets);
+    forEachTask(nTargets, [&](int i)
     {
-        KeyFrame* pKFi = *vit;
+        KeyFrame* pKFi = vpTargetKFs[i];
 
-        matcher.Fuse(pKFi,vpMapPointMatches);
-        if(pKFi->NLeft != -1) matcher.Fuse(pKFi,vpMapPointMatches,true);
+        ORBmatcher matcher;
+        matcher.SearchFuse(pKFi,vpMapPointMatches,vvFuseMatches[i]);
+        if(pKFi->NLeft != -1) matcher.SearchFuse(pKFi,vpMapPointMatches,vvFuseMatchesRight[i],true);
+    });
+
+    for(int i=0; i<nTargets; i++)
+    {
+        ORBmatcher::ApplyFuse(vpTargetKFs[i],vvFuseMatches[i]);
+        ORBmatcher::ApplyFuse(vpTargetKFs[i],vvFuseMatchesRight[i]);
     }
 
 
@@ -811,12 +941,32 @@ void LocalMapping::SearchInNeighbors()
         }
     }
 
-    matcher.Fuse(mpCurrentKeyFrame,vpFuseCandidates);
-    if(mpCurrentKeyFrame->NLeft != -1) matcher.Fuse(mpCurrentKeyFrame,vpFuseCandidates,true);
+    // Every candidate projects into the same keyframe, so the candidates are split in ranges instead
+    const size_t nCandidates = vpFuseCandidates.size();
+    const int nCandidateTasks = tasksFor(nCandidates);
+    const size_t candidateChunk = (nCandidates + nCandidateTasks - 1) / nCandidateTasks;
+    vector<vector<pair<MapPoint*,int> > > vvCandidateMatches(nCandidateTasks), vvCandidateMatchesRight(nCandidateTasks);
+    forEachTask(nCandidateTasks, [&](int t)
+    {
+        const size_t begin = std::min(nCandidates, t * candidateChunk);
+        const size_t end = std::min(nCandidates, begin + candidateChunk);
+        const vector<MapPoint*> vpRange(vpFuseCandidates.begin() + begin, vpFuseCandidates.begin() + end);
+
+        ORBmatcher matcher;
+        matcher.SearchFuse(mpCurrentKeyFrame,vpRange,vvCandidateMatches[t]);
+        if(mpCurrentKeyFrame->NLeft != -1) matcher.SearchFuse(mpCurrentKeyFrame,vpRange,vvCandidateMatchesRight[t],true);
+    });
+
+    for(int t=0; t<nCandidateTasks; t++)
+        ORBmatcher::ApplyFuse(mpCurrentKeyFrame,vvCandidateMatches[t]);
+    for(int t=0; t<nCandidateTasks; t++)
+        ORBmatcher::ApplyFuse(mpCurrentKeyFrame,vvCandidateMatchesRight[t]);
 
 
-    // Update points
+    // Update points, once each: the descriptors together with the ones deferred by the fusion, then the normals
     vpMapPointMatches = mpCurrentKeyFrame->GetMapPointMatches();
+    vector<MapPoint*> vpUpdatePoints;
+    vpUpdatePoints.reserve(vpMapPointMatches.size());
     for(size_t i=0, iend=vpMapPointMatches.size(); i<iend; i++)
     {
         MapPoint* pMP=vpMapPointMatches[i];
@@ -825,10 +975,24 @@ void LocalMapping::SearchInNeighbors()
             if(!pMP->isBad())
             {
                 pMP->ComputeDistinctiveDescriptors();
-                pMP->UpdateNormalAndDepth();
+                vpUpdatePoints.push_back(pMP);
             }
         }
     }
+    descriptorBatch.Flush(pPool);
+
+    sort(vpUpdatePoints.begin(), vpUpdatePoints.end());
+    vpUpdatePoints.erase(unique(vpUpdatePoints.begin(), vpUpdatePoints.end()), vpUpdatePoints.end());
+    const size_t nUpdatePoints = vpUpdatePoints.size();
+    const int nUpdateTasks = tasksFor(nUpdatePoints);
+    const size_t updateChunk = (nUpdatePoints + nUpdateTasks - 1) / nUpdateTasks;
+    forEachTask(nUpdateTasks, [&](int t)
+    {
+        const size_t begin = std::min(nUpdatePoints, t * updateChunk);
+        const size_t end = std::min(nUpdatePoints, begin + updateChunk);
+        for(size_t i=begin; i<end; i++)
+            vpUpdatePoints[i]->UpdateNormalAndDepth();
+    });
 
     // Update connections in covisibility graph
     mpCurrentKeyFrame->UpdateConnections();
@@ -836,23 +1000,26 @@ void LocalMapping::SearchInNeighbors()
 
 void LocalMapping::RequestStop()
 {
-    unique_lock<mutex> lock(mMutexStop);
-    mbStopRequested = true;
-    unique_lock<mutex> lock2(mMutexNewKFs);
-    mbAbortBA = true;
+    {
+        unique_lock<mutex> lock(mMutexStop);
+        mbStopRequested = true;
+        unique_lock<mutex> lock2(mMutexNewKFs);
+        mbAbortBA = true;
+    }
+    mStateSignal.Notify();
 }
 
 bool LocalMapping::Stop()
 {
-    unique_lock<mutex> lock(mMutexStop);
-    if(mbStopRequested && !mbNotStop)
     {
+        unique_lock<mutex> lock(mMutexStop);
+        if(!mbStopRequested || mbNotStop)
+            return false;
         mbStopped = true;
-        cout << "Local Mapping STOP" << endl;
-        return true;
     }
-
-    return false;
+    cout << "Local Mapping STOP" << endl;
+    mStateSignal.Notify();
+    return true;
 }
 
 bool LocalMapping::isStopped()
@@ -867,17 +1034,28 @@ bool LocalMapping::stopRequested()
     return mbStopRequested;
 }
 
+void LocalMapping::WaitUntilStopped()
+{
+    // SetFinish also marks the thread as stopped
+    mStateSignal.Wait([this]() { return isStopped(); });
+}
+
 void LocalMapping::Release()
 {
-    unique_lock<mutex> lock(mMutexStop);
-    unique_lock<mutex> lock2(mMutexFinish);
-    if(mbFinished)
-        return;
-    mbStopped = false;
-    mbStopRequested = false;
-    for(list<KeyFrame*>::iterator lit = mlNewKeyFrames.begin(), lend=mlNewKeyFrames.end(); lit!=lend; lit++)
-        delete *lit;
-    mlNewKeyFrames.clear();
+    {
+        unique_lock<mutex> lock(mMutexStop);
+        unique_lock<mutex> lock2(mMutexFinish);
+        if(mbFinished)
+            return;
+        mbStopped = false;
+        mbStopRequested = false;
+        // Queued keyframes already observe map points and Tracking may still reference them, so they are detached
+        // from the map rather than deleted
+        for(list<KeyFrame*>::iterator lit = mlNewKeyFrames.begin(), lend=mlNewKeyFrames.end(); lit!=lend; lit++)
+            (*lit)->SetBadFlag();
+        mlNewKeyFrames.clear();
+    }
+    mStateSignal.Notify();
 
     cout << "Local Mapping RELEASE" << endl;
 }
@@ -896,12 +1074,17 @@ void LocalMapping::SetAcceptKeyFrames(bool flag)
 
 bool LocalMapping::SetNotStop(bool flag)
 {
-    unique_lock<mutex> lock(mMutexStop);
+    {
+        unique_lock<mutex> lock(mMutexStop);
 
-    if(flag && mbStopped)
-        return false;
+        if(flag && mbStopped)
+            return false;
 
-    mbNotStop = flag;
+        mbNotStop = flag;
+    }
+    // A stop request held back by mbNotStop can now be served
+    if(!flag)
+        mStateSignal.Notify();
 
     return true;
 }
@@ -1072,17 +1255,13 @@ void LocalMapping::RequestReset()
         cout << "LM: Map reset recieved" << endl;
         mbResetRequested = true;
     }
+    mStateSignal.Notify();
     cout << "LM: Map reset, waiting..." << endl;
 
-    while(1)
-    {
-        {
-            unique_lock<mutex> lock2(mMutexReset);
-            if(!mbResetRequested)
-                break;
-        }
-        usleep(3000);
-    }
+    mStateSignal.Wait([this]() {
+        unique_lock<mutex> lock(mMutexReset);
+        return !mbResetRequested;
+    });
     cout << "LM: Map reset, Done!!!" << endl;
 }
 
@@ -1094,17 +1273,13 @@ void LocalMapping::RequestResetActiveMap(Map* pMap)
         mbResetRequestedActiveMap = true;
         mpMapToReset = pMap;
     }
+    mStateSignal.Notify();
     cout << "LM: Active map reset, waiting..." << endl;
 
-    while(1)
-    {
-        {
-            unique_lock<mutex> lock2(mMutexReset);
-            if(!mbResetRequestedActiveMap)
-                break;
-        }
-        usleep(3000);
-    }
+    mStateSignal.Wait([this]() {
+        unique_lock<mutex> lock(mMutexReset);
+        return !mbResetRequestedActiveMap;
+    });
     cout << "LM: Active map reset, Done!!!" << endl;
 }
 
@@ -1152,14 +1327,20 @@ void LocalMapping::ResetIfRequested()
         }
     }
     if(executed_reset)
+    {
         cout << "LM: Reset free the mutex" << endl;
+        mStateSignal.Notify();
+    }
 
 }
 
 void LocalMapping::RequestFinish()
 {
-    unique_lock<mutex> lock(mMutexFinish);
-    mbFinishRequested = true;
+    {
+        unique_lock<mutex> lock(mMutexFinish);
+        mbFinishRequested = true;
+    }
+    mStateSignal.Notify();
 }
 
 bool LocalMapping::CheckFinish()
@@ -1170,10 +1351,13 @@ bool LocalMapping::CheckFinish()
 
 void LocalMapping::SetFinish()
 {
-    unique_lock<mutex> lock(mMutexFinish);
-    mbFinished = true;    
-    unique_lock<mutex> lock2(mMutexStop);
-    mbStopped = true;
+    {
+        unique_lock<mutex> lock(mMutexFinish);
+        mbFinished = true;
+        unique_lock<mutex> lock2(mMutexStop);
+        mbStopped = true;
+    }
+    mStateSignal.Notify();
 }
 
 bool LocalMapping::isFinished()
@@ -1424,10 +1608,7 @@ void LocalMapping::InitializeIMU(float priorG, float priorA, bool bFIBA)
     mIdxInit++;
 
     for(list<KeyFrame*>::iterator lit = mlNewKeyFrames.begin(), lend=mlNewKeyFrames.end(); lit!=lend; lit++)
-    {
         (*lit)->SetBadFlag();
-        delete *lit;
-    }
     mlNewKeyFrames.clear();
 
     mpTracker->mState=Tracking::OK;
@@ -1493,10 +1674,7 @@ void LocalMapping::ScaleRefinement()
     std::chrono::steady_clock::time_point t3 = std::chrono::steady_clock::now();
 
     for(list<KeyFrame*>::iterator lit = mlNewKeyFrames.begin(), lend=mlNewKeyFrames.end(); lit!=lend; lit++)
-    {
         (*lit)->SetBadFlag();
-        delete *lit;
-    }
     mlNewKeyFrames.clear();
 
     double t_inertial_only = std::chrono::duration_cast<std::chrono::duration<double> >(t1 - t0).count();
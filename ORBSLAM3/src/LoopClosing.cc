@@ -24,6 +24,7 @@
 #include "Optimizer.h"
 #include "ORBmatcher.h"
 #include "G2oTypes.h"
+#include "Tracer.h"
 
 #include<mutex>
 #include<thread>
@@ -90,6 +91,8 @@ void LoopClosing::SetLocalMapper(LocalMapping *pLocalMapper)
 void LoopClosing::Run()
 {
     mbFinished =false;
+    Tracer::SetThreadName("LoopClosing");
+    QuiescenceScope quiescence(MapPoint::Reclamation());
 
     while(1)
     {
@@ -108,9 +111,13 @@ void LoopClosing::Run()
 #ifdef REGISTER_TIMES
             std::chrono::steady_clock::time_point time_StartPR = std::chrono::steady_clock::now();
 #endif
+            TraceScope tracePR("PlaceRecognition");
 
             bool bFindedRegion = NewDetectCommonRegions();
 
+            tracePR.SetId(mpCurrentKF ? static_cast<long>(mpCurrentKF->mnId) : -1);
+            tracePR.Stop();
+
 #ifdef REGISTER_TIMES
             std::chrono::steady_clock::time_point time_EndPR = std::chrono::steady_clock::now();
 
@@ -176,11 +183,13 @@ void LoopClosing::Run()
 
                         nMerges += 1;
 #endif
+                        TraceScope traceMerge("MergeMaps", mpCurrentKF->mnId);
                         // TODO UNCOMMENT
                         if (mpTracker->mSensor==System::IMU_MONOCULAR ||mpTracker->mSensor==System::IMU_STEREO || mpTracker->mSensor==System::IMU_RGBD)
                             MergeLocal2();
                         else
                             MergeLocal();
+                        traceMerge.Stop();
 
 #ifdef REGISTER_TIMES
                         std::chrono::steady_clock::time_point time_EndMerge = std::chrono::steady_clock::now();
@@ -271,7 +280,9 @@ void LoopClosing::Run()
                         nLoop += 1;
 
 #endif
+                        TraceScope traceLoop("CorrectLoop", mpCurrentKF->mnId);
                         CorrectLoop();
+                        traceLoop.Stop();
 #ifdef REGISTER_TIMES
                         std::chrono::steady_clock::time_point time_EndLoop = std::chrono::steady_clock::now();
 
@@ -298,11 +309,24 @@ void LoopClosing::Run()
 
         ResetIfRequested();
 
+        // Map points are only kept to the next keyframe while a loop or merge candidate is being confirmed
+        if(mnLoopNumCoincidences==0 && mnMergeNumCoincidences==0 && !mbLoopDetected && !mbMergeDetected)
+        {
+            quiescence.Quiesce([this]() {
+                mvpLoopMPs.clear();
+                mvpLoopMatchedMPs.clear();
+                mvpMergeMPs.clear();
+                mvpMergeMatchedMPs.clear();
+                mvpLoopMapPoints.clear();
+            });
+        }
+
         if(CheckFinish()){
             break;
         }
 
-        usleep(5000);
+        // Idle until a keyframe or a reset or finish request arrives
+        mStateSignal.Wait([this]() { return HasWork(); });
     }
 
     SetFinish();
@@ -310,9 +334,13 @@ void LoopClosing::Run()
 
 void LoopClosing::InsertKeyFrame(KeyFrame *pKF)
 {
-    unique_lock<mutex> lock(mMutexLoopQueue);
-    if(pKF->mnId!=0)
+    if(pKF->mnId==0)
+        return;
+    {
+        unique_lock<mutex> lock(mMutexLoopQueue);
         mlpLoopKeyFrameQueue.push_back(pKF);
+    }
+    mStateSignal.Notify();
 }
 
 bool LoopClosing::CheckNewKeyFrames()
@@ -321,6 +349,14 @@ bool LoopClosing::CheckNewKeyFrames()
     return(!mlpLoopKeyFrameQueue.empty());
 }
 
+bool LoopClosing::HasWork()
+{
+    if(CheckNewKeyFrames() || CheckFinish())
+        return true;
+    unique_lock<mutex> lock(mMutexReset);
+    return mbResetRequested || mbResetActiveMapRequested;
+}
+
 bool LoopClosing::NewDetectCommonRegions()
 {
     // To deactivate placerecognition. No loopclosing nor merging will be performed
@@ -993,10 +1029,7 @@ void LoopClosing::CorrectLoop()
     }
 
     // Wait until Local Mapping has effectively stopped
-    while(!mpLocalMapper->isStopped())
-    {
-        usleep(1000);
-    }
+    mpLocalMapper->WaitUntilStopped();
 
     // Ensure current keyframe is updated
     //cout << "Start updating connections" << endl;
@@ -1247,10 +1280,7 @@ void LoopClosing::MergeLocal()
     //cout << "Request Stop Local Mapping" << endl;
     mpLocalMapper->RequestStop();
     // Wait until Local Mapping has effectively stopped
-    while(!mpLocalMapper->isStopped())
-    {
-        usleep(1000);
-    }
+    mpLocalMapper->WaitUntilStopped();
     //cout << "Local Map stopped" << endl;
 
     mpLocalMapper->EmptyQueue();
@@ -1706,10 +1736,7 @@ void LoopClosing::MergeLocal()
 
         mpLocalMapper->RequestStop();
         // Wait until Local Mapping has effectively stopped
-        while(!mpLocalMapper->isStopped())
-        {
-            usleep(1000);
-        }
+        mpLocalMapper->WaitUntilStopped();
 
         // Optimize graph (and update the loop position for each element form the begining to the end)
         if(mpTracker->mSensor != System::MONOCULAR)
@@ -1820,10 +1847,7 @@ void LoopClosing::MergeLocal2()
     //cout << "Request Stop Local Mapping" << endl;
     mpLocalMapper->RequestStop();
     // Wait until Local Mapping has effectively stopped
-    while(!mpLocalMapper->isStopped())
-    {
-        usleep(1000);
-    }
+    mpLocalMapper->WaitUntilStopped();
     //cout << "Local Map stopped" << endl;
 
     Map* pCurrentMap = mpCurrentKF->GetMap();
@@ -2203,16 +2227,12 @@ void LoopClosing::RequestReset()
         unique_lock<mutex> lock(mMutexReset);
         mbResetRequested = true;
     }
+    mStateSignal.Notify();
 
-    while(1)
-    {
-        {
-        unique_lock<mutex> lock2(mMutexReset);
-        if(!mbResetRequested)
-            break;
-        }
-        usleep(5000);
-    }
+    mStateSignal.Wait([this]() {
+        unique_lock<mutex> lock(mMutexReset);
+        return !mbResetRequested;
+    });
 }
 
 void LoopClosing::RequestResetActiveMap(Map *pMap)
@@ -2222,52 +2242,57 @@ void LoopClosing::RequestResetActiveMap(Map *pMap)
         mbResetActiveMapRequested = true;
         mpMapToReset = pMap;
     }
+    mStateSignal.Notify();
 
-    while(1)
-    {
-        {
-            unique_lock<mutex> lock2(mMutexReset);
-            if(!mbResetActiveMapRequested)
-                break;
-        }
-        usleep(3000);
-    }
+    mStateSignal.Wait([this]() {
+        unique_lock<mutex> lock(mMutexReset);
+        return !mbResetActiveMapRequested;
+    });
 }
 
 void LoopClosing::ResetIfRequested()
 {
-    unique_lock<mutex> lock(mMutexReset);
-    if(mbResetRequested)
     {
-        cout << "Loop closer reset requested..." << endl;
-        mlpLoopKeyFrameQueue.clear();
-        mLastLoopKFid=0;  //TODO old variable, it is not use in the new algorithm
-        mbResetRequested=false;
-        mbResetActiveMapRequested = false;
-    }
-    else if(mbResetActiveMapRequested)
-    {
-
-        for (list<KeyFrame*>::const_iterator it=mlpLoopKeyFrameQueue.begin(); it != mlpLoopKeyFrameQueue.end();)
+        unique_lock<mutex> lock(mMutexReset);
+        if(!mbResetRequested && !mbResetActiveMapRequested)
+            return;
+        if(mbResetRequested)
+        {
+            cout << "Loop closer reset requested..." << endl;
+            mlpLoopKeyFrameQueue.clear();
+            mLastLoopKFid=0;  //TODO old variable, it is not use in the new algorithm
+            mbResetRequested=false;
+            mbResetActiveMapRequested = false;
+        }
+        else if(mbResetActiveMapRequested)
         {
-            KeyFrame* pKFi = *it;
-            if(pKFi->GetMap() == mpMapToReset)
+
+            for (list<KeyFrame*>::const_iterator it=mlpLoopKeyFrameQueue.begin(); it != mlpLoopKeyFrameQueue.end();)
             {
-                it = mlpLoopKeyFrameQueue.erase(it);
+                KeyFrame* pKFi = *it;
+                if(pKFi->GetMap() == mpMapToReset)
+                {
+                    it = mlpLoopKeyFrameQueue.erase(it);
+                }
+                else
+                    ++it;
             }
-            else
-                ++it;
-        }
 
-        mLastLoopKFid=mpAtlas->GetLastInitKFid(); //TODO old variable, it is not use in the new algorithm
-        mbResetActiveMapRequested=false;
+            mLastLoopKFid=mpAtlas->GetLastInitKFid(); //TODO old variable, it is not use in the new algorithm
+            mbResetActiveMapRequested=false;
 
+        }
     }
+    mStateSignal.Notify();
 }
 
 void LoopClosing::RunGlobalBundleAdjustment(Map* pActiveMap, unsigned long nLoopKF)
 {  
     Verbose::PrintMess("Starting Global Bundle Adjustment", Verbose::VERBOSITY_NORMAL);
+    Tracer::SetThreadName("GlobalBA");
+    // Holds map points until it returns
+    QuiescenceScope quiescence(MapPoint::Reclamation());
+    TraceScope traceGBA("GlobalBA", nLoopKF);
 
 #ifdef REGISTER_TIMES
     std::chrono::steady_clock::time_point time_StartFGBA = std::chrono::steady_clock::now();
@@ -2319,11 +2344,7 @@ void LoopClosing::RunGlobalBundleAdjustment(Map* pActiveMap, unsigned long nLoop
 
             mpLocalMapper->RequestStop();
             // Wait until Local Mapping has effectively stopped
-
-            while(!mpLocalMapper->isStopped() && !mpLocalMapper->isFinished())
-            {
-                usleep(1000);
-            }
+            mpLocalMapper->WaitUntilStopped();
 
             // Get Map Mutex
             unique_lock<mutex> lock(pActiveMap->mMutexMapUpdate);
@@ -2512,9 +2533,12 @@ void LoopClosing::RunGlobalBundleAdjustment(Map* pActiveMap, unsigned long nLoop
 
 void LoopClosing::RequestFinish()
 {
-    unique_lock<mutex> lock(mMutexFinish);
-    // cout << "LC: Finish requested" << endl;
-    mbFinishRequested = true;
+    {
+        unique_lock<mutex> lock(mMutexFinish);
+        // cout << "LC: Finish requested" << endl;
+        mbFinishRequested = true;
+    }
+    mStateSignal.Notify();
 }
 
 bool LoopClosing::CheckFinish()
@@ -20,6 +20,7 @@
 #include "Map.h"
 
 #include<mutex>
+#include<algorithm>
 
 namespace ORB_SLAM3
 {
@@ -66,7 +67,8 @@ void Map::AddKeyFrame(KeyFrame *pKF)
         mpKFinitial = pKF;
         mpKFlowerID = pKF;
     }
-    mspKeyFrames.insert(pKF);
+    if(mspKeyFrames.insert(pKF).second)
+        pKF->mnMapIndex = mKeyFrameIndex.Insert(pKF);
     if(pKF->mnId>mnMaxKFid)
     {
         mnMaxKFid=pKF->mnId;
@@ -79,8 +81,13 @@ void Map::AddKeyFrame(KeyFrame *pKF)
 
 void Map::AddMapPoint(MapPoint *pMP)
 {
+    // A bad point may be reclaimed and is not linked again
+    if(pMP->isBad())
+        return;
+
     unique_lock<mutex> lock(mMutexMap);
-    mspMapPoints.insert(pMP);
+    if(mspMapPoints.insert(pMP).second)
+        pMP->mnMapIndex = mMapPointIndex.Insert(pMP);
 }
 
 void Map::SetImuInitialized()
@@ -98,16 +105,32 @@ bool Map::isImuInitialized()
 void Map::EraseMapPoint(MapPoint *pMP)
 {
     unique_lock<mutex> lock(mMutexMap);
-    mspMapPoints.erase(pMP);
+    if(mspMapPoints.erase(pMP))
+        mMapPointIndex.Erase(pMP->mnMapIndex, pMP);
 
     // TODO: This only erase the pointer.
     // Delete the MapPoint
 }
 
+void Map::EraseRetiredMapPoints(const vector<MapPoint*> &vpMPs)
+{
+    unique_lock<mutex> lock(mMutexMap);
+    for(MapPoint* pMP : vpMPs)
+    {
+        if(mspMapPoints.erase(pMP))
+            mMapPointIndex.Erase(pMP->mnMapIndex, pMP);
+    }
+
+    mvpReferenceMapPoints.erase(remove_if(mvpReferenceMapPoints.begin(), mvpReferenceMapPoints.end(),
+                                          [](MapPoint* pMP) { return pMP && pMP->isBad(); }),
+                                mvpReferenceMapPoints.end());
+}
+
 void Map::EraseKeyFrame(KeyFrame *pKF)
 {
     unique_lock<mutex> lock(mMutexMap);
-    mspKeyFrames.erase(pKF);
+    if(mspKeyFrames.erase(pKF))
+        mKeyFrameIndex.Erase(pKF->mnMapIndex, pKF);
     if(mspKeyFrames.size()>0)
     {
         if(pKF->mnId == mpKFlowerID->mnId)
@@ -225,6 +248,8 @@ void Map::clear()
 
     mspMapPoints.clear();
     mspKeyFrames.clear();
+    mMapPointIndex.Clear();
+    mKeyFrameIndex.Clear();
     mnMaxKFid = mnInitKFid;
     mbImuInitialized = false;
     mvpReferenceMapPoints.clear();
@@ -429,6 +454,16 @@ void Map::PostLoad(KeyFrameDatabase* pKFDB, ORBVocabulary* pORBVoc/*, map<long u
     std::copy(mvpBackupMapPoints.begin(), mvpBackupMapPoints.end(), std::inserter(mspMapPoints, mspMapPoints.begin()));
     std::copy(mvpBackupKeyFrames.begin(), mvpBackupKeyFrames.end(), std::inserter(mspKeyFrames, mspKeyFrames.begin()));
 
+    // The dense indices are not saved
+    mMapPointIndex.Clear();
+    for(MapPoint* pMPi : mspMapPoints)
+        if(pMPi)
+            pMPi->mnMapIndex = mMapPointIndex.Insert(pMPi);
+    mKeyFrameIndex.Clear();
+    for(KeyFrame* pKFi : mspKeyFrames)
+        if(pKFi)
+            pKFi->mnMapIndex = mKeyFrameIndex.Insert(pKFi);
+
     map<long unsigned int,MapPoint*> mpMapPointId;
     for(MapPoint* pMPi : mspMapPoints)
     {
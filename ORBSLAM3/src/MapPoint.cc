@@ -18,8 +18,11 @@
 
 #include "MapPoint.h"
 #include "ORBmatcher.h"
+#include "utils/ThreadPool.h"
 
 #include<mutex>
+#include<algorithm>
+#include<cfloat>
 
 namespace ORB_SLAM3
 {
@@ -27,6 +30,53 @@ namespace ORB_SLAM3
 long unsigned int MapPoint::nNextId=0;
 mutex MapPoint::mGlobalMutex;
 
+namespace
+{
+    // Never destroyed, so the points deleted during static destruction still find it
+    SlabPool<MapPoint>& MapPointPool()
+    {
+        static SlabPool<MapPoint>* pPool = new SlabPool<MapPoint>();
+        return *pPool;
+    }
+
+    // Bad points waiting to be freed, with the epoch they were queued at
+    struct RetiredMapPoints
+    {
+        std::mutex mMutex;
+        // Still possibly linked from keyframe slots and maps
+        std::vector<std::pair<MapPoint*,uint64_t>> mvRetired;
+        // Unlinked, only held by the participants that have not quiesced since
+        std::vector<std::pair<MapPoint*,uint64_t>> mvDetached;
+    };
+
+    RetiredMapPoints& RetiredList()
+    {
+        static RetiredMapPoints* pList = new RetiredMapPoints();
+        return *pList;
+    }
+}
+
+QuiescenceDomain& MapPoint::Reclamation()
+{
+    static QuiescenceDomain* pDomain = new QuiescenceDomain();
+    return *pDomain;
+}
+
+void* MapPoint::operator new(std::size_t size)
+{
+    return MapPointPool().Allocate(size);
+}
+
+void MapPoint::operator delete(void* p)
+{
+    MapPointPool().Release(p);
+}
+
+void MapPoint::operator delete(void* p, std::size_t)
+{
+    MapPointPool().Release(p);
+}
+
 MapPoint::MapPoint():
     mnFirstKFid(0), mnFirstFrame(0), nObs(0), mnTrackReferenceForFrame(0),
     mnLastFrameSeen(0), mnBALocalForKF(0), mnFuseCandidateForKF(0), mnLoopPointForKF(0), mnCorrectedByKF(0),
@@ -43,9 +93,8 @@ MapPoint::MapPoint(const Eigen::Vector3f &Pos, KeyFrame *pRefKF, Map* pMap):
     mpReplaced(static_cast<MapPoint*>(NULL)), mfMinDistance(0), mfMaxDistance(0), mpMap(pMap),
     mnOriginMapId(pMap->GetId())
 {
-    SetWorldPos(Pos);
-
     mNormalVector.setZero();
+    SetWorldPos(Pos);
 
     mbTrackInViewR = false;
     mbTrackInView = false;
@@ -81,7 +130,7 @@ MapPoint::MapPoint(const Eigen::Vector3f &Pos, Map* pMap, Frame* pFrame, const i
     mnCorrectedReference(0), mnBAGlobalForKF(0), mpRefKF(static_cast<KeyFrame*>(NULL)), mnVisible(1),
     mnFound(1), mbBad(false), mpReplaced(NULL), mpMap(pMap), mnOriginMapId(pMap->GetId())
 {
-    SetWorldPos(Pos);
+    mWorldPos = Pos;
 
     Eigen::Vector3f Ow;
     if(pFrame -> Nleft == -1 || idxF < pFrame -> Nleft){
@@ -99,16 +148,19 @@ MapPoint::MapPoint(const Eigen::Vector3f &Pos, Map* pMap, Frame* pFrame, const i
 
     Eigen::Vector3f PC = mWorldPos - Ow;
     const float dist = PC.norm();
-    const int level = (pFrame -> Nleft == -1) ? pFrame->mvKeysUn[idxF].octave
-                                              : (idxF < pFrame -> Nleft) ? pFrame->mvKeys[idxF].octave
-                                                                         : pFrame -> mvKeysRight[idxF].octave;
+    const int level = (pFrame -> Nleft == -1) ? pFrame->mpFeatures->mvKeysUn[idxF].octave
+                                              : (idxF < pFrame -> Nleft) ? pFrame->mpFeatures->mvKeys[idxF].octave
+                                                                         : pFrame->mpFeatures->mvKeysRight[idxF].octave;
     const float levelScaleFactor =  pFrame->mvScaleFactors[level];
     const int nLevels = pFrame->mnScaleLevels;
 
     mfMaxDistance = dist*levelScaleFactor;
     mfMinDistance = mfMaxDistance/pFrame->mvScaleFactors[nLevels-1];
 
-    pFrame->mDescriptors.row(idxF).copyTo(mDescriptor);
+    pFrame->mpFeatures->mDescriptors.row(idxF).copyTo(mDescriptor);
+
+    PublishGeometry();
+    PublishDescriptor();
 
     // MapPoints can be created from Tracking and Local Mapping. This mutex avoid conflicts with id.
     unique_lock<mutex> lock(mpMap->mMutexPointCreation);
@@ -119,16 +171,48 @@ void MapPoint::SetWorldPos(const Eigen::Vector3f &Pos) {
     unique_lock<mutex> lock2(mGlobalMutex);
     unique_lock<mutex> lock(mMutexPos);
     mWorldPos = Pos;
+    PublishGeometry();
 }
 
 Eigen::Vector3f MapPoint::GetWorldPos() {
-    unique_lock<mutex> lock(mMutexPos);
-    return mWorldPos;
+    const GeometrySnapshot g = mGeometry.Load();
+    return Eigen::Vector3f(g.pos[0], g.pos[1], g.pos[2]);
 }
 
 Eigen::Vector3f MapPoint::GetNormal() {
-    unique_lock<mutex> lock(mMutexPos);
-    return mNormalVector;
+    const GeometrySnapshot g = mGeometry.Load();
+    return Eigen::Vector3f(g.normal[0], g.normal[1], g.normal[2]);
+}
+
+void MapPoint::PublishGeometry()
+{
+    GeometrySnapshot g;
+    for(int i=0; i<3; i++)
+    {
+        g.pos[i] = mWorldPos(i);
+        g.normal[i] = mNormalVector(i);
+    }
+    g.minDistance = mfMinDistance;
+    g.maxDistance = mfMaxDistance;
+    mGeometry.Store(g);
+}
+
+void MapPoint::PublishDescriptor()
+{
+    if(mDescriptor.empty())
+        return;
+
+    const cv::Mat desc = mDescriptor.isContinuous() ? mDescriptor : mDescriptor.clone();
+    const size_t bytes = desc.total() * desc.elemSize();
+    const DescriptorSnapshot* pSnapshot = mpDescriptorSnapshot.load(std::memory_order_relaxed);
+    if(!pSnapshot || pSnapshot->cols != desc.cols || pSnapshot->type != desc.type() || pSnapshot->data.Size() != bytes)
+    {
+        mvpDescriptorSnapshots.push_back(std::unique_ptr<DescriptorSnapshot>(new DescriptorSnapshot(desc.cols, desc.type(), bytes)));
+        mvpDescriptorSnapshots.back()->data.Store(desc.data);
+        mpDescriptorSnapshot.store(mvpDescriptorSnapshots.back().get(), std::memory_order_release);
+    }
+    else
+        mvpDescriptorSnapshots.back()->data.Store(desc.data);
 }
 
 
@@ -141,6 +225,17 @@ KeyFrame* MapPoint::GetReferenceKeyFrame()
 void MapPoint::AddObservation(KeyFrame* pKF, int idx)
 {
     unique_lock<mutex> lock(mMutexFeatures);
+    if(mbBad)
+    {
+        // The point is being reclaimed, the keyframe must not keep it
+        lock.unlock();
+        pKF->ReleaseMapPointMatch(idx, this);
+        return;
+    }
+
+    // The slot is tracked by the observation from now on
+    mvHolders.erase(remove(mvHolders.begin(), mvHolders.end(), make_pair(pKF,idx)), mvHolders.end());
+
     tuple<int,int> indexes;
 
     if(mObservations.count(pKF)){
@@ -168,12 +263,13 @@ void MapPoint::AddObservation(KeyFrame* pKF, int idx)
 void MapPoint::EraseObservation(KeyFrame* pKF)
 {
     bool bBad=false;
+    int leftIndex = -1, rightIndex = -1;
     {
         unique_lock<mutex> lock(mMutexFeatures);
         if(mObservations.count(pKF))
         {
             tuple<int,int> indexes = mObservations[pKF];
-            int leftIndex = get<0>(indexes), rightIndex = get<1>(indexes);
+            leftIndex = get<0>(indexes), rightIndex = get<1>(indexes);
 
             if(leftIndex != -1){
                 if(!pKF->mpCamera2 && pKF->mvuRight[leftIndex]>=0)
@@ -196,6 +292,13 @@ void MapPoint::EraseObservation(KeyFrame* pKF)
         }
     }
 
+    // Callers usually erase the match first; a keyframe still keeping the point (one turning bad) becomes a holder
+    for(const int idx : {leftIndex, rightIndex})
+    {
+        if(idx != -1 && pKF->GetMapPoint(idx) == this && !AddHolder(pKF, idx))
+            pKF->ReleaseMapPointMatch(idx, this);
+    }
+
     if(bBad)
         SetBadFlag();
 }
@@ -220,6 +323,7 @@ void MapPoint::SetBadFlag()
         unique_lock<mutex> lock1(mMutexFeatures);
         unique_lock<mutex> lock2(mMutexPos);
         mbBad=true;
+        mbBadSnapshot.store(true, std::memory_order_release);
         obs = mObservations;
         mObservations.clear();
     }
@@ -235,7 +339,9 @@ void MapPoint::SetBadFlag()
         }
     }
 
+    ReleaseDescriptorCache();
     mpMap->EraseMapPoint(this);
+    Retire();
 }
 
 MapPoint* MapPoint::GetReplaced()
@@ -258,6 +364,7 @@ void MapPoint::Replace(MapPoint* pMP)
         obs=mObservations;
         mObservations.clear();
         mbBad=true;
+        mbBadSnapshot.store(true, std::memory_order_release);
         nvisible = mnVisible;
         nfound = mnFound;
         mpReplaced = pMP;
@@ -296,16 +403,111 @@ void MapPoint::Replace(MapPoint* pMP)
     pMP->IncreaseVisible(nvisible);
     pMP->ComputeDistinctiveDescriptors();
 
+    ReleaseDescriptorCache();
     mpMap->EraseMapPoint(this);
+    Retire();
 }
 
 bool MapPoint::isBad()
 {
-    unique_lock<mutex> lock1(mMutexFeatures,std::defer_lock);
-    unique_lock<mutex> lock2(mMutexPos,std::defer_lock);
-    lock(lock1, lock2);
+    return mbBadSnapshot.load(std::memory_order_acquire);
+}
 
-    return mbBad;
+bool MapPoint::AddHolder(KeyFrame* pKF, int idx)
+{
+    unique_lock<mutex> lock(mMutexFeatures);
+    if(mbBad)
+        return false;
+    mvHolders.push_back(make_pair(pKF,idx));
+    return true;
+}
+
+void MapPoint::Retire()
+{
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        if(mbRetired)
+            return;
+        mbRetired = true;
+    }
+
+    // Read after the bad flag was set: a participant that picked the point up before has not quiesced since
+    const uint64_t nEpoch = Reclamation().Epoch();
+    RetiredMapPoints& retired = RetiredList();
+    unique_lock<mutex> lock(retired.mMutex);
+    retired.mvRetired.push_back(make_pair(this,nEpoch));
+}
+
+size_t MapPoint::ReclaimRetired(const vector<Map*> &vpMaps)
+{
+    QuiescenceDomain& domain = Reclamation();
+    RetiredMapPoints& retired = RetiredList();
+    const uint64_t nSafe = domain.SafeEpoch();
+
+    // Free the unlinked points every participant has quiesced since, except the replacements of listed points,
+    // which Tracking may still look up through GetReplaced
+    vector<MapPoint*> vpFree;
+    {
+        unique_lock<mutex> lock(retired.mMutex);
+        set<MapPoint*> spReplacements;
+        for(const vector<pair<MapPoint*,uint64_t>> *pvList : {&retired.mvRetired, &retired.mvDetached})
+        {
+            for(const pair<MapPoint*,uint64_t> &entry : *pvList)
+            {
+                if(MapPoint* pRep = entry.first->GetReplaced())
+                    spReplacements.insert(pRep);
+            }
+        }
+
+        vector<pair<MapPoint*,uint64_t>> &vDetached = retired.mvDetached;
+        vector<pair<MapPoint*,uint64_t>>::iterator itKeep = stable_partition(vDetached.begin(), vDetached.end(),
+            [&](const pair<MapPoint*,uint64_t> &entry) {
+                return entry.second >= nSafe || spReplacements.count(entry.first);
+            });
+        for(vector<pair<MapPoint*,uint64_t>>::iterator it=itKeep; it!=vDetached.end(); it++)
+            vpFree.push_back(it->first);
+        vDetached.erase(itKeep, vDetached.end());
+    }
+
+    for(MapPoint* pMP : vpFree)
+        delete pMP;
+
+    // Unlink the retired points every participant has quiesced since, so no thread can pick them up again
+    vector<MapPoint*> vpDetach;
+    {
+        unique_lock<mutex> lock(retired.mMutex);
+        vector<pair<MapPoint*,uint64_t>> &vRetired = retired.mvRetired;
+        vector<pair<MapPoint*,uint64_t>>::iterator itKeep = stable_partition(vRetired.begin(), vRetired.end(),
+            [&](const pair<MapPoint*,uint64_t> &entry) { return entry.second >= nSafe; });
+        for(vector<pair<MapPoint*,uint64_t>>::iterator it=itKeep; it!=vRetired.end(); it++)
+            vpDetach.push_back(it->first);
+        vRetired.erase(itKeep, vRetired.end());
+    }
+
+    if(vpDetach.empty())
+        return vpFree.size();
+
+    for(MapPoint* pMP : vpDetach)
+    {
+        vector<pair<KeyFrame*,int>> vHolders;
+        {
+            unique_lock<mutex> lock(pMP->mMutexFeatures);
+            vHolders.swap(pMP->mvHolders);
+        }
+        for(const pair<KeyFrame*,int> &holder : vHolders)
+            holder.first->ReleaseMapPointMatch(holder.second, pMP);
+    }
+
+    for(Map* pMap : vpMaps)
+        pMap->EraseRetiredMapPoints(vpDetach);
+
+    // Threads may have picked the points up until now, they are freed once all of them have quiesced again
+    const uint64_t nEpoch = domain.Epoch();
+    unique_lock<mutex> lock(retired.mMutex);
+    for(MapPoint* pMP : vpDetach)
+        retired.mvDetached.push_back(make_pair(pMP,nEpoch));
+
+    return vpFree.size();
 }
 
 void MapPoint::IncreaseVisible(int n)
@@ -326,97 +528,213 @@ float MapPoint::GetFoundRatio()
     return static_cast<float>(mnFound)/mnVisible;
 }
 
+namespace
+{
+    // Batch collecting the descriptor updates of the calling thread, if any
+    thread_local DescriptorUpdateBatch* tlpDescriptorBatch = nullptr;
+
+    inline float ObservedDescriptorDistance(const cv::Mat &a, const cv::Mat &b)
+    {
+        if(a.type() == CV_8U)
+            return ORBmatcher::DescriptorDistance(a, b);    // Hamming
+        return DescriptorMetric::FloatL2Sqr(a.ptr<float>(), b.ptr<float>(), a.cols);   // squared L2, no sqrt
+    }
+}
+
+DescriptorUpdateBatch::DescriptorUpdateBatch() : mpPrevious(tlpDescriptorBatch)
+{
+    tlpDescriptorBatch = this;
+}
+
+DescriptorUpdateBatch::~DescriptorUpdateBatch()
+{
+    Flush();
+    tlpDescriptorBatch = mpPrevious;
+}
+
+void DescriptorUpdateBatch::Flush(ThreadPool* pPool)
+{
+    std::vector<MapPoint*> vpPending;
+    vpPending.swap(mvpPending);
+    std::sort(vpPending.begin(), vpPending.end());
+    vpPending.erase(std::unique(vpPending.begin(), vpPending.end()), vpPending.end());
+
+    // Each point only takes its own locks, so distinct points are updated concurrently
+    const size_t n = vpPending.size();
+    const int nTasks = pPool ? static_cast<int>(std::min<size_t>(pPool->Size() + 1, n)) : 1;
+    if(nTasks <= 1)
+    {
+        for(MapPoint* pMP : vpPending)
+            pMP->UpdateDistinctiveDescriptor();
+        return;
+    }
+
+    const size_t chunk = (n + nTasks - 1) / nTasks;
+    pPool->ParallelFor(nTasks, [&](int t) {
+        const size_t begin = std::min(n, t * chunk);
+        const size_t end = std::min(n, begin + chunk);
+        for(size_t i=begin; i<end; i++)
+            vpPending[i]->UpdateDistinctiveDescriptor();
+    });
+}
+
 void MapPoint::ComputeDistinctiveDescriptors()
 {
-    // 1. Gather all valid observed descriptors
-    std::vector<cv::Mat> vDescriptors;
-    std::map<KeyFrame*, std::tuple<int,int>> observations;
+    if(tlpDescriptorBatch)
+        tlpDescriptorBatch->mvpPending.push_back(this);
+    else
+        UpdateDistinctiveDescriptor();
+}
+
+void MapPoint::UpdateDistinctiveDescriptor()
+{
+    std::unique_lock<std::mutex> lockCache(mMutexDescriptorCache);
+
+    // 1. Observed descriptors, keyed by (keyframe, keypoint index) in observation order, which is sorted
+    //    since mObservations is ordered by keyframe and right indices follow the left ones
+    std::vector<std::pair<KeyFrame*,int>> vKeys;
     {
         std::unique_lock<std::mutex> lock(mMutexFeatures);
-        if(mbBad) return;
-        observations = mObservations;
+        if(mbBad)
+        {
+            lockCache.unlock();
+            ReleaseDescriptorCache();
+            return;
+        }
+        vKeys.reserve(mObservations.size()*2);
+        for(const std::pair<KeyFrame* const, std::tuple<int,int>> &obs : mObservations)
+        {
+            const int idxL = std::get<0>(obs.second);
+            const int idxR = std::get<1>(obs.second);
+            if(idxL >= 0) vKeys.emplace_back(obs.first, idxL);
+            if(idxR >= 0) vKeys.emplace_back(obs.first, idxR);
+        }
     }
-    if(observations.empty()) return;
+    vKeys.erase(std::remove_if(vKeys.begin(), vKeys.end(),
+                               [](const std::pair<KeyFrame*,int> &key) { return key.first->isBad(); }),
+                vKeys.end());
+    if(vKeys.empty())
+        return;
 
-    vDescriptors.reserve(observations.size()*2);
-    for(auto& it : observations)
+    // 2. Drop the cached descriptors no longer observed, O(N) each
+    for(size_t i=mvDescriptorKeys.size(); i-- > 0;)
     {
-        KeyFrame* pKF = it.first;
-        if(pKF->isBad()) continue;
-        int idxL = std::get<0>(it.second);
-        int idxR = std::get<1>(it.second);
-        if(idxL >= 0) vDescriptors.push_back(pKF->mDescriptors.row(idxL));
-        if(idxR >= 0) vDescriptors.push_back(pKF->mDescriptors.row(idxR));
+        if(std::binary_search(vKeys.begin(), vKeys.end(), mvDescriptorKeys[i]))
+            continue;
+
+        const size_t last = mvDescriptorKeys.size()-1;
+        for(size_t r=0; r<=last; r++)
+        {
+            std::vector<float> &row = mvDescriptorDist[r];
+            mvDescriptorDistSum[r] -= row[i];
+            row[i] = row[last];
+            row.pop_back();
+        }
+        mvDescriptorKeys[i] = mvDescriptorKeys[last];
+        mvDescriptorRows[i] = mvDescriptorRows[last];
+        mvDescriptorDist[i].swap(mvDescriptorDist[last]);
+        mvDescriptorDistSum[i] = mvDescriptorDistSum[last];
+        mvDescriptorKeys.pop_back();
+        mvDescriptorRows.pop_back();
+        mvDescriptorDist.pop_back();
+        mvDescriptorDistSum.pop_back();
     }
-    if(vDescriptors.empty()) return;
 
-    // 2. Compute pairwise distances
-    const size_t N = vDescriptors.size();
-    // We'll store distances in a flat 2D array
-    std::vector<float> distMat(N*N, 0.0f);
-    for(size_t i = 0; i < N; ++i)
+    // 3. Add the new ones, measuring only their distances to the cached descriptors, O(N) each
+    if(mvDescriptorKeys.size() != vKeys.size())
     {
-        for(size_t j = i+1; j < N; ++j)
+        std::vector<std::pair<KeyFrame*,int>> vCached(mvDescriptorKeys);
+        std::sort(vCached.begin(), vCached.end());
+        for(const std::pair<KeyFrame*,int> &key : vKeys)
         {
-            float d;
-            if(vDescriptors[i].type() == CV_8U)
-            {
-                // Hamming distance via ORBmatcher
-                d = ORBmatcher::DescriptorDistance(vDescriptors[i],
-                                                 vDescriptors[j]);
-            }
-            else
+            if(std::binary_search(vCached.begin(), vCached.end(), key))
+                continue;
+
+            const cv::Mat desc = key.first->mDescriptors.row(key.second);
+            const size_t n = mvDescriptorKeys.size();
+            std::vector<float> newRow(n+1, 0.0f);
+            double newSum = 0.0;
+            for(size_t r=0; r<n; r++)
             {
-                // Squared L2 distance for float descriptors
-                d = cv::norm(vDescriptors[i],
-                           vDescriptors[j],
-                           cv::NORM_L2SQR);  // no sqrt :contentReference[oaicite:0]{index=0}
-                // d = ORBmatcher::DescriptorDistance(vDescriptors[i], vDescriptors[j]);
+                const float d = ObservedDescriptorDistance(mvDescriptorRows[r], desc);
+                mvDescriptorDist[r].push_back(d);
+                mvDescriptorDistSum[r] += d;
+                newRow[r] = d;
+                newSum += d;
             }
-            distMat[i*N + j] = distMat[j*N + i] = d;
+            mvDescriptorKeys.push_back(key);
+            mvDescriptorRows.push_back(desc);
+            mvDescriptorDist.push_back(std::move(newRow));
+            mvDescriptorDistSum.push_back(newSum);
         }
     }
 
-    // 3. Select the "most central" descriptor
-    int bestIdx    = 0;
-    float bestCost = FLT_MAX;
-    for(size_t i = 0; i < N; ++i)
+    // 4. Select the "most central" descriptor. Ties go to the first in observation order.
+    const size_t N = mvDescriptorKeys.size();
+    const bool bBinary = mvDescriptorRows[0].type() == CV_8U;
+    size_t bestIdx = 0;
+    double bestCost = DBL_MAX;
+    std::vector<float> dists;
+    for(size_t i=0; i<N; i++)
     {
-        // Gather distances from i to all others
-        std::vector<float> dists;
-        dists.reserve(N);
-        for(size_t j = 0; j < N; ++j)
-            dists.push_back(distMat[i*N + j]);
-
-        if(vDescriptors[0].type() == CV_8U)
+        double cost;
+        if(bBinary)
         {
-            // ORB: pick by median distance (Hamming)
-            std::nth_element(dists.begin(),
-                             dists.begin() + N/2,
-                             dists.end());
-            float med = dists[N/2];
-            if(med < bestCost) { bestCost = med; bestIdx = i; }
+            // ORB: median distance (Hamming)
+            dists.assign(mvDescriptorDist[i].begin(), mvDescriptorDist[i].end());
+            std::nth_element(dists.begin(), dists.begin() + N/2, dists.end());
+            cost = dists[N/2];
         }
         else
         {
-            // SIFT/float: pick by sum of L2 distances
-            float sum = 0;
-            for(float dv : dists) sum += dv;
-            if(sum < bestCost) { bestCost = sum; bestIdx = i; }
+            // SIFT/float: sum of L2 distances
+            cost = mvDescriptorDistSum[i];
+        }
+
+        if(cost < bestCost || (cost == bestCost && mvDescriptorKeys[i] < mvDescriptorKeys[bestIdx]))
+        {
+            bestCost = cost;
+            bestIdx = i;
         }
     }
 
-    // 4. Store the chosen descriptor
+    // 5. Store the chosen descriptor
     {
         std::unique_lock<std::mutex> lock(mMutexFeatures);
-        mDescriptor = vDescriptors[bestIdx].clone();
+        mDescriptor = mvDescriptorRows[bestIdx].clone();
+        PublishDescriptor();
     }
 }
 
+void MapPoint::ReleaseDescriptorCache()
+{
+    std::unique_lock<std::mutex> lock(mMutexDescriptorCache);
+    std::vector<std::pair<KeyFrame*,int>>().swap(mvDescriptorKeys);
+    std::vector<cv::Mat>().swap(mvDescriptorRows);
+    std::vector<std::vector<float>>().swap(mvDescriptorDist);
+    std::vector<double>().swap(mvDescriptorDistSum);
+}
+
 cv::Mat MapPoint::GetDescriptor()
 {
-    unique_lock<mutex> lock(mMutexFeatures);
-    return mDescriptor.clone();
+    cv::Mat descriptor;
+    GetDescriptor(descriptor);
+    return descriptor;
+}
+
+void MapPoint::GetDescriptor(cv::Mat &descriptor)
+{
+    const DescriptorSnapshot* pSnapshot = mpDescriptorSnapshot.load(std::memory_order_acquire);
+    if(!pSnapshot)
+    {
+        // Not computed yet
+        unique_lock<mutex> lock(mMutexFeatures);
+        mDescriptor.copyTo(descriptor);
+        return;
+    }
+
+    descriptor.create(1, pSnapshot->cols, pSnapshot->type);
+    pSnapshot->data.Load(descriptor.data);
 }
 
 tuple<int,int> MapPoint::GetIndexInKeyFrame(KeyFrame *pKF)
@@ -501,6 +819,7 @@ void MapPoint::UpdateNormalAndDepth()
         mfMaxDistance = dist*levelScaleFactor;
         mfMinDistance = mfMaxDistance/pRefKF->mvScaleFactors[nLevels-1];
         mNormalVector = normal/n;
+        PublishGeometry();
     }
 }
 
@@ -508,27 +827,31 @@ void MapPoint::SetNormalVector(const Eigen::Vector3f& normal)
 {
     unique_lock<mutex> lock3(mMutexPos);
     mNormalVector = normal;
+    PublishGeometry();
 }
 
 float MapPoint::GetMinDistanceInvariance()
 {
-    unique_lock<mutex> lock(mMutexPos);
-    return 0.8f * mfMinDistance;
+    return 0.8f * mGeometry.Load().minDistance;
 }
 
 float MapPoint::GetMaxDistanceInvariance()
 {
-    unique_lock<mutex> lock(mMutexPos);
-    return 1.2f * mfMaxDistance;
+    return 1.2f * mGeometry.Load().maxDistance;
+}
+
+void MapPoint::GetFrustumData(Eigen::Vector3f &pos, Eigen::Vector3f &normal, float &minDistance, float &maxDistance)
+{
+    const GeometrySnapshot g = mGeometry.Load();
+    pos = Eigen::Vector3f(g.pos[0], g.pos[1], g.pos[2]);
+    normal = Eigen::Vector3f(g.normal[0], g.normal[1], g.normal[2]);
+    minDistance = g.minDistance;
+    maxDistance = g.maxDistance;
 }
 
 int MapPoint::PredictScale(const float &currentDist, KeyFrame* pKF)
 {
-    float ratio;
-    {
-        unique_lock<mutex> lock(mMutexPos);
-        ratio = mfMaxDistance/currentDist;
-    }
+    const float ratio = mGeometry.Load().maxDistance/currentDist;
 
     int nScale = ceil(log(ratio)/pKF->mfLogScaleFactor);
     if(nScale<0)
@@ -541,11 +864,7 @@ int MapPoint::PredictScale(const float &currentDist, KeyFrame* pKF)
 
 int MapPoint::PredictScale(const float &currentDist, Frame* pF)
 {
-    float ratio;
-    {
-        unique_lock<mutex> lock(mMutexPos);
-        ratio = mfMaxDistance/currentDist;
-    }
+    const float ratio = mGeometry.Load().maxDistance/currentDist;
 
     int nScale = ceil(log(ratio)/pF->mfLogScaleFactor);
     if(nScale<0)
@@ -640,6 +959,17 @@ void MapPoint::PostLoad(map<long unsigned int, KeyFrame*>& mpKFid, map<long unsi
 
     mBackupObservationsId1.clear();
     mBackupObservationsId2.clear();
+
+    // Fields restored by the serialization
+    {
+        unique_lock<mutex> lock(mMutexPos);
+        PublishGeometry();
+    }
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        mbBadSnapshot.store(mbBad, std::memory_order_release);
+        PublishDescriptor();
+    }
 }
 
 } //namespace ORB_SLAM
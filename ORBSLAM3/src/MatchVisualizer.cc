@@ -326,8 +326,8 @@ void MatchVisualizer::ShowFrameMatches(
     // Draw the matches
     cv::Mat outImg;
     cv::drawMatches(
-        lastFrame.image, lastFrame.mvKeysUn, 
-        currentFrame.image, currentFrame.mvKeysUn, 
+        lastFrame.image, lastFrame.mpFeatures->mvKeysUn, 
+        currentFrame.image, currentFrame.mpFeatures->mvKeysUn, 
         matches, 
         outImg,
         cv::Scalar_<int>::all(-1) ,   // Match color (random)
@@ -73,20 +73,13 @@ namespace ORB_SLAM3
                 if (bFactor)
                     r *= th;
 
-                const vector<size_t> vIndices =
-                    F.GetFeaturesInArea(pMP->mTrackProjX, pMP->mTrackProjY, r * F.mvScaleFactors[nPredictedLevel], nPredictedLevel - 1, nPredictedLevel);
+                F.GetFeaturesInArea(mvAreaIndices, pMP->mTrackProjX, pMP->mTrackProjY, r * F.mvScaleFactors[nPredictedLevel], nPredictedLevel - 1, nPredictedLevel);
+                const vector<size_t> &vIndices = mvAreaIndices;
 
                 if (!vIndices.empty())
                 {
-                    const cv::Mat MPdescriptor = pMP->GetDescriptor();
-
-                    float bestDist = std::numeric_limits<float>::max();
-                    int bestLevel = -1;
-                    float bestDist2 = std::numeric_limits<float>::max();
-                    int bestLevel2 = -1;
-                    int bestIdx = -1;
-
-                    // Get best and second matches with near keypoints
+                    // Gather the candidate descriptors with near keypoints
+                    mBatch.Clear(F.mpFeatures->mDescriptors);
                     for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
                     {
                         const size_t idx = *vit;
@@ -95,35 +88,28 @@ namespace ORB_SLAM3
                             if (F.mvpMapPoints[idx]->Observations() > 0)
                                 continue;
 
-                        if (F.Nleft == -1 && F.mvuRight[idx] > 0)
+                        if (F.Nleft == -1 && F.mpFeatures->mvuRight[idx] > 0)
                         {
-                            const float er = fabs(pMP->mTrackProjXR - F.mvuRight[idx]);
+                            const float er = fabs(pMP->mTrackProjXR - F.mpFeatures->mvuRight[idx]);
                             if (er > r * F.mvScaleFactors[nPredictedLevel])
                                 continue;
                         }
 
-                        const cv::Mat &d = F.mDescriptors.row(idx);
+                        const int octave = (F.Nleft == -1)   ? F.mpFeatures->mvKeysUn[idx].octave
+                                           : (idx < F.Nleft) ? F.mpFeatures->mvKeys[idx].octave
+                                                             : F.mpFeatures->mvKeysRight[idx - F.Nleft].octave;
+                        mBatch.Add(F.mpFeatures->mDescriptors, idx, idx, octave);
+                    }
 
-                        const float dist = DescriptorDistance(MPdescriptor, d);
+                    // Get best and second matches
+                    pMP->GetDescriptor(mQueryDescriptor);
+                    const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor);
 
-                        if (dist < bestDist)
-                        {
-                            bestDist2 = bestDist;
-                            bestDist = dist;
-                            bestLevel2 = bestLevel;
-                            bestLevel = (F.Nleft == -1)   ? F.mvKeysUn[idx].octave
-                                        : (idx < F.Nleft) ? F.mvKeys[idx].octave
-                                                        : F.mvKeysRight[idx - F.Nleft].octave;
-                            bestIdx = idx;
-                        }
-                        else if (dist < bestDist2)
-                        {
-                            bestLevel2 = (F.Nleft == -1)   ? F.mvKeysUn[idx].octave
-                                        : (idx < F.Nleft) ? F.mvKeys[idx].octave
-                                                          : F.mvKeysRight[idx - F.Nleft].octave;
-                            bestDist2 = dist;
-                        }
-                    }
+                    const float bestDist = res.bestDist;
+                    const int bestLevel = res.bestLevel;
+                    const float bestDist2 = res.bestDist2;
+                    const int bestLevel2 = res.bestLevel2;
+                    const int bestIdx = res.bestIdx;
 
                     // Apply ratio to second match (only if best and second are in the same scale level)
                     if (bestDist <= TH_HIGH)
@@ -135,9 +121,9 @@ namespace ORB_SLAM3
                         {
                             F.mvpMapPoints[bestIdx] = pMP;
 
-                            if (F.Nleft != -1 && F.mvLeftToRightMatch[bestIdx] != -1)
+                            if (F.Nleft != -1 && F.mpFeatures->mvLeftToRightMatch[bestIdx] != -1)
                             { // Also match with the stereo observation at right camera
-                                F.mvpMapPoints[F.mvLeftToRightMatch[bestIdx] + F.Nleft] = pMP;
+                                F.mvpMapPoints[F.mpFeatures->mvLeftToRightMatch[bestIdx] + F.Nleft] = pMP;
                                 nmatches++;
                                 right++;
                             }
@@ -156,21 +142,14 @@ namespace ORB_SLAM3
                 {
                     float r = RadiusByViewingCos(pMP->mTrackViewCosR);
 
-                    const vector<size_t> vIndices =
-                        F.GetFeaturesInArea(pMP->mTrackProjXR, pMP->mTrackProjYR, r * F.mvScaleFactors[nPredictedLevel], nPredictedLevel - 1, nPredictedLevel, true);
+                    F.GetFeaturesInArea(mvAreaIndices, pMP->mTrackProjXR, pMP->mTrackProjYR, r * F.mvScaleFactors[nPredictedLevel], nPredictedLevel - 1, nPredictedLevel, true);
+                    const vector<size_t> &vIndices = mvAreaIndices;
 
                     if (vIndices.empty())
                         continue;
 
-                    const cv::Mat MPdescriptor = pMP->GetDescriptor();
-
-                    float bestDist = 256.0f;
-                    int bestLevel = -1;
-                    float bestDist2 = 256.0f;
-                    int bestLevel2 = -1;
-                    int bestIdx = -1;
-
-                    // Get best and second matches with near keypoints
+                    // Gather the candidate descriptors with near keypoints
+                    mBatch.Clear(F.mpFeatures->mDescriptors);
                     for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
                     {
                         const size_t idx = *vit;
@@ -179,24 +158,18 @@ namespace ORB_SLAM3
                             if (F.mvpMapPoints[idx + F.Nleft]->Observations() > 0)
                                 continue;
 
-                        const cv::Mat &d = F.mDescriptors.row(idx + F.Nleft);
+                        mBatch.Add(F.mpFeatures->mDescriptors, idx + F.Nleft, idx, F.mpFeatures->mvKeysRight[idx].octave);
+                    }
 
-                        const float dist = DescriptorDistance(MPdescriptor, d);
+                    // Get best and second matches
+                    pMP->GetDescriptor(mQueryDescriptor);
+                    const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor, 256.0f);
 
-                        if (dist < bestDist)
-                        {
-                            bestDist2 = bestDist;
-                            bestDist = dist;
-                            bestLevel2 = bestLevel;
-                            bestLevel = F.mvKeysRight[idx].octave;
-                            bestIdx = idx;
-                        }
-                        else if (dist < bestDist2)
-                        {
-                            bestLevel2 = F.mvKeysRight[idx].octave;
-                            bestDist2 = dist;
-                        }
-                    }
+                    const float bestDist = res.bestDist;
+                    const int bestLevel = res.bestLevel;
+                    const float bestDist2 = res.bestDist2;
+                    const int bestLevel2 = res.bestLevel2;
+                    const int bestIdx = res.bestIdx;
 
                     // Apply ratio to second match (only if best and second are in the same scale level)
                     if (bestDist <= TH_HIGH)
@@ -204,9 +177,9 @@ namespace ORB_SLAM3
                         if (bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
                             continue;
 
-                        if (F.Nleft != -1 && F.mvRightToLeftMatch[bestIdx] != -1)
+                        if (F.Nleft != -1 && F.mpFeatures->mvRightToLeftMatch[bestIdx] != -1)
                         { // Also match with the stereo observation at right camera
-                            F.mvpMapPoints[F.mvRightToLeftMatch[bestIdx]] = pMP;
+                            F.mvpMapPoints[F.mpFeatures->mvRightToLeftMatch[bestIdx]] = pMP;
                             nmatches++;
                             left++;
                         }
@@ -228,7 +201,7 @@ namespace ORB_SLAM3
             std::vector<int> matchedIndices;
             
             // Get all keypoints from frame
-            keypoints = F.mvKeysUn;
+            keypoints = F.mpFeatures->mvKeysUn;
             
             // Mark which keypoints have matches
             for(size_t i = 0; i < F.mvpMapPoints.size(); i++) {
@@ -284,9 +257,9 @@ namespace ORB_SLAM3
 
         // We perform the matching over ORB that belong to the same vocabulary node (at a certain level)
         fbow::BoWFeatVector::const_iterator KFit = vFeatVecKF.begin();
-        fbow::BoWFeatVector::const_iterator Fit = F.mFeatVec.begin();
+        fbow::BoWFeatVector::const_iterator Fit = F.mpFeatures->mFeatVec.begin();
         fbow::BoWFeatVector::const_iterator KFend = vFeatVecKF.end();
-        fbow::BoWFeatVector::const_iterator Fend = F.mFeatVec.end();
+        fbow::BoWFeatVector::const_iterator Fend = F.mpFeatures->mFeatVec.end();
 
         while (KFit != KFend && Fit != Fend)
         {
@@ -326,7 +299,7 @@ namespace ORB_SLAM3
                             if (vpMapPointMatches[realIdxF])
                                 continue;
 
-                            const cv::Mat &dF = F.mDescriptors.row(realIdxF);
+                            const cv::Mat &dF = F.mpFeatures->mDescriptors.row(realIdxF);
 
                             const float dist = DescriptorDistance(dKF, dF);
 
@@ -348,7 +321,7 @@ namespace ORB_SLAM3
                             if (vpMapPointMatches[realIdxF])
                                 continue;
 
-                            const cv::Mat &dF = F.mDescriptors.row(realIdxF);
+                            const cv::Mat &dF = F.mpFeatures->mDescriptors.row(realIdxF);
 
                             const float dist = DescriptorDistance(dKF, dF);
 
@@ -389,8 +362,8 @@ namespace ORB_SLAM3
                             if (mbCheckOrientation)
                             {
                                 cv::KeyPoint &Fkp =
-                                    (!pKF->mpCamera2 || F.Nleft == -1) ? F.mvKeys[bestIdxF] : (bestIdxF >= F.Nleft) ? F.mvKeysRight[bestIdxF - F.Nleft]
-                                                                                                                    : F.mvKeys[bestIdxF];
+                                    (!pKF->mpCamera2 || F.Nleft == -1) ? F.mpFeatures->mvKeys[bestIdxF] : (bestIdxF >= F.Nleft) ? F.mpFeatures->mvKeysRight[bestIdxF - F.Nleft]
+                                                                                                                    : F.mpFeatures->mvKeys[bestIdxF];
 
                                 float rot = kp.angle - Fkp.angle;
                                 if (rot < 0.0)
@@ -417,8 +390,8 @@ namespace ORB_SLAM3
                                 if (mbCheckOrientation)
                                 {
                                     cv::KeyPoint &Fkp =
-                                        (!F.mpCamera2) ? F.mvKeys[bestIdxFR] : (bestIdxFR >= F.Nleft) ? F.mvKeysRight[bestIdxFR - F.Nleft]
-                                                                                                      : F.mvKeys[bestIdxFR];
+                                        (!F.mpCamera2) ? F.mpFeatures->mvKeys[bestIdxFR] : (bestIdxFR >= F.Nleft) ? F.mpFeatures->mvKeysRight[bestIdxFR - F.Nleft]
+                                                                                                      : F.mpFeatures->mvKeys[bestIdxFR];
 
                                     float rot = kp.angle - Fkp.angle;
                                     if (rot < 0.0)
@@ -444,7 +417,7 @@ namespace ORB_SLAM3
             }
             else
             {
-                Fit = F.mFeatVec.lower_bound(KFit->first);
+                Fit = F.mpFeatures->mFeatVec.lower_bound(KFit->first);
             }
         }
 
@@ -492,9 +465,11 @@ namespace ORB_SLAM3
         Sophus::SE3f Tcw = Sophus::SE3f(Scw.rotationMatrix(), Scw.translation() / Scw.scale());
         Eigen::Vector3f Ow = Tcw.inverse().translation();
 
-        // Set of MapPoints already found in the KeyFrame
-        set<MapPoint *> spAlreadyFound(vpMatched.begin(), vpMatched.end());
-        spAlreadyFound.erase(static_cast<MapPoint *>(NULL));
+        // MapPoints already found in the KeyFrame
+        mAlreadyFound.Clear();
+        for (MapPoint *pMPi : vpMatched)
+            if (pMPi)
+                mAlreadyFound[pMPi] = true;
 
         int nmatches = 0;
 
@@ -504,7 +479,7 @@ namespace ORB_SLAM3
             MapPoint *pMP = vpPoints[iMP];
 
             // Discard Bad MapPoints and already found
-            if (pMP->isBad() || spAlreadyFound.count(pMP))
+            if (pMP->isBad() || mAlreadyFound.Find(pMP))
                 continue;
 
             // Get 3D Coords.
@@ -544,16 +519,14 @@ namespace ORB_SLAM3
             // Search in a radius
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(uv(0), uv(1), radius);
+            pKF->GetFeaturesInArea(mvAreaIndices, uv(0), uv(1), radius);
+            const vector<size_t> &vIndices = mvAreaIndices;
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
-            const cv::Mat dMP = pMP->GetDescriptor();
-
-            int bestDist = 256;
-            int bestIdx = -1;
+            mBatch.Clear(pKF->mDescriptors);
             for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
             {
                 const size_t idx = *vit;
@@ -565,16 +538,14 @@ namespace ORB_SLAM3
                 if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                     continue;
 
-                const cv::Mat &dKF = pKF->mDescriptors.row(idx);
+                mBatch.Add(pKF->mDescriptors, idx, idx, kpLevel);
+            }
 
-                const int dist = DescriptorDistance(dMP, dKF);
+            pMP->GetDescriptor(mQueryDescriptor);
+            const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor, 256.0f);
 
-                if (dist < bestDist)
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
-            }
+            const int bestDist = static_cast<int>(res.bestDist);
+            const int bestIdx = res.bestIdx;
 
             if (bestDist <= TH_LOW * ratioHamming)
             {
@@ -607,9 +578,11 @@ namespace ORB_SLAM3
         Sophus::SE3f Tcw = Sophus::SE3f(Scw.rotationMatrix(), Scw.translation() / Scw.scale());
         Eigen::Vector3f Ow = Tcw.inverse().translation();
 
-        // Set of MapPoints already found in the KeyFrame
-        set<MapPoint *> spAlreadyFound(vpMatched.begin(), vpMatched.end());
-        spAlreadyFound.erase(static_cast<MapPoint *>(NULL));
+        // MapPoints already found in the KeyFrame
+        mAlreadyFound.Clear();
+        for (MapPoint *pMPi : vpMatched)
+            if (pMPi)
+                mAlreadyFound[pMPi] = true;
 
         int nmatches = 0;
 
@@ -620,7 +593,7 @@ namespace ORB_SLAM3
             KeyFrame *pKFi = vpPointsKFs[iMP];
 
             // Discard Bad MapPoints and already found
-            if (pMP->isBad() || spAlreadyFound.count(pMP))
+            if (pMP->isBad() || mAlreadyFound.Find(pMP))
                 continue;
 
             // Get 3D Coords.
@@ -665,16 +638,14 @@ namespace ORB_SLAM3
             // Search in a radius
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+            pKF->GetFeaturesInArea(mvAreaIndices, u, v, radius);
+            const vector<size_t> &vIndices = mvAreaIndices;
 
             if (vIndices.empty())
                 continue;
 
             // Match to the most similar keypoint in the radius
-            const cv::Mat dMP = pMP->GetDescriptor();
-
-            int bestDist = 256;
-            int bestIdx = -1;
+            mBatch.Clear(pKF->mDescriptors);
             for (vector<size_t>::const_iterator vit = vIndices.begin(), vend = vIndices.end(); vit != vend; vit++)
             {
                 const size_t idx = *vit;
@@ -686,16 +657,14 @@ namespace ORB_SLAM3
                 if (kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
                     continue;
 
-                const cv::Mat &dKF = pKF->mDescriptors.row(idx);
+                mBatch.Add(pKF->mDescriptors, idx, idx, kpLevel);
+            }
 
-                const int dist = DescriptorDistance(dMP, dKF);
+            pMP->GetDescriptor(mQueryDescriptor);
+            const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor, 256.0f);
 
-                if (dist < bestDist)
-                {
-                    bestDist = dist;
-                    bestIdx = idx;
-                }
-            }
+            const int bestDist = static_cast<int>(res.bestDist);
+            const int bestIdx = res.bestIdx;
 
             if (bestDist <= TH_LOW * ratioHamming)
             {
@@ -720,15 +689,15 @@ namespace ORB_SLAM3
     int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f> &vbPrevMatched, vector<int> &vnMatches12, int windowSize)
     {
         int nmatches = 0;
-        vnMatches12 = vector<int>(F1.mvKeysUn.size(), -1);
+        vnMatches12 = vector<int>(F1.mpFeatures->mvKeysUn.size(), -1);
 
         vector<int> rotHist[HISTO_LENGTH];
         for (int i = 0; i < HISTO_LENGTH; i++)
             rotHist[i].reserve(500);
         const float factor = 1.0f / HISTO_LENGTH;
 
-        vector<float> vMatchedDistance(F2.mvKeysUn.size(), std::numeric_limits<float>::max());
-        vector<int> vnMatches21(F2.mvKeysUn.size(), -1);
+        vector<float> vMatchedDistance(F2.mpFeatures->mvKeysUn.size(), std::numeric_limits<float>::max());
+        vector<int> vnMatches21(F2.mpFeatures->mvKeysUn.size(), -1);
 
         // For collecting stats on descriptor distances
         const int NUM_DIST_BINS = 20;
@@ -739,29 +708,30 @@ namespace ORB_SLAM3
         int discardedRatio = 0;
         int discardedThreshold = 0;
 
-        for (size_t i1 = 0, iend1 = F1.mvKeysUn.size(); i1 < iend1; i1++)
+        for (size_t i1 = 0, iend1 = F1.mpFeatures->mvKeysUn.size(); i1 < iend1; i1++)
         {
-            cv::KeyPoint kp1 = F1.mvKeysUn[i1];
+            cv::KeyPoint kp1 = F1.mpFeatures->mvKeysUn[i1];
             int level1 = kp1.octave;
             if (level1 > 0)
                 continue;
 
-            vector<size_t> vIndices2 = F2.GetFeaturesInArea(vbPrevMatched[i1].x, vbPrevMatched[i1].y, windowSize, level1, level1);
+            F2.GetFeaturesInArea(mvAreaIndices, vbPrevMatched[i1].x, vbPrevMatched[i1].y, windowSize, level1, level1);
+            const vector<size_t> &vIndices2 = mvAreaIndices;
 
             if (vIndices2.empty())
                 continue;
 
-            cv::Mat d1 = F1.mDescriptors.row(i1);
+            cv::Mat d1 = F1.mpFeatures->mDescriptors.row(i1);
 
             float bestDist = std::numeric_limits<float>::max();
             float bestDist2 = std::numeric_limits<float>::max();
             int bestIdx2 = -1;
 
-            for (vector<size_t>::iterator vit = vIndices2.begin(); vit != vIndices2.end(); vit++)
+            for (vector<size_t>::const_iterator vit = vIndices2.begin(); vit != vIndices2.end(); vit++)
             {
                 size_t i2 = *vit;
 
-                cv::Mat d2 = F2.mDescriptors.row(i2);
+                cv::Mat d2 = F2.mpFeatures->mDescriptors.row(i2);
 
                 float dist = DescriptorDistance(d1, d2);
 
@@ -803,7 +773,7 @@ namespace ORB_SLAM3
 
                     if (mbCheckOrientation)
                     {
-                        float rot = F1.mvKeysUn[i1].angle - F2.mvKeysUn[bestIdx2].angle;
+                        float rot = F1.mpFeatures->mvKeysUn[i1].angle - F2.mpFeatures->mvKeysUn[bestIdx2].angle;
                         if (rot < 0.0)
                             rot += 360.0f;
                         int bin = round(rot * factor);
@@ -863,7 +833,7 @@ namespace ORB_SLAM3
         // Update prev matched
         for (size_t i1 = 0, iend1 = vnMatches12.size(); i1 < iend1; i1++)
             if (vnMatches12[i1] >= 0)
-                vbPrevMatched[i1] = F2.mvKeysUn[vnMatches12[i1]].pt;
+                vbPrevMatched[i1] = F2.mpFeatures->mvKeysUn[vnMatches12[i1]].pt;
 
 #ifdef DEBUG_PRINT
         if (std::getenv("DEBUG_SearchForInitialization"))
@@ -1302,6 +1272,25 @@ namespace ORB_SLAM3
     }
 
     int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const float th, const bool bRight)
+    {
+        vector<pair<MapPoint *, int>> vMatches;
+        SearchFuse(pKF, vpMapPoints, vMatches, th, bRight);
+        const int nFused = ApplyFuse(pKF, vMatches);
+
+#ifdef DEBUG_PRINT
+        if (std::getenv("DEBUG_Fuse"))
+        {
+            std::cout << "[DEBUG] Fuse  KF id=" << pKF->mnId
+                      << "  tried=" << vpMapPoints.size()
+                      << "  fused=" << nFused
+                      << std::endl;
+        }
+#endif
+        return nFused;
+    }
+
+    int ORBmatcher::SearchFuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, vector<pair<MapPoint *, int>> &vMatches,
+                               const float th, const bool bRight)
     {
         GeometricCamera *pCamera;
         Sophus::SE3f Tcw;
@@ -1326,7 +1315,7 @@ namespace ORB_SLAM3
         const float &cy = pKF->cy;
         const float &bf = pKF->mbf;
 
-        int nFused = 0;
+        vMatches.clear();
 
         const int nMPs = vpMapPoints.size();
 
@@ -1402,7 +1391,8 @@ namespace ORB_SLAM3
             // Search in a radius
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(uv(0), uv(1), radius, bRight);
+            pKF->GetFeaturesInArea(mvAreaIndices, uv(0), uv(1), radius, bRight);
+            const vector<size_t> &vIndices = mvAreaIndices;
 
             if (vIndices.empty())
             {
@@ -1468,40 +1458,47 @@ namespace ORB_SLAM3
                 }
             }
 
-            // If there is already a MapPoint replace otherwise add new measurement
             if (bestDist <= TH_LOW)
+                vMatches.push_back(make_pair(pMP, bestIdx));
+            else
+                count_thcheck++;
+        }
+
+        return vMatches.size();
+    }
+
+    int ORBmatcher::ApplyFuse(KeyFrame *pKF, const vector<pair<MapPoint *, int>> &vMatches)
+    {
+        int nFused = 0;
+        for (const pair<MapPoint *, int> &match : vMatches)
+        {
+            MapPoint *pMP = match.first;
+            const int bestIdx = match.second;
+
+            // Replaced, or brought into the keyframe by the replacement of another point, since it was matched
+            if (pMP->isBad() || pMP->IsInKeyFrame(pKF))
+                continue;
+
+            // If there is already a MapPoint replace otherwise add new measurement
+            MapPoint *pMPinKF = pKF->GetMapPoint(bestIdx);
+            if (pMPinKF)
             {
-                MapPoint *pMPinKF = pKF->GetMapPoint(bestIdx);
-                if (pMPinKF)
-                {
-                    if (!pMPinKF->isBad())
-                    {
-                        if (pMPinKF->Observations() > pMP->Observations())
-                            pMP->Replace(pMPinKF);
-                        else
-                            pMPinKF->Replace(pMP);
-                    }
-                }
-                else
+                if (!pMPinKF->isBad())
                 {
-                    pMP->AddObservation(pKF, bestIdx);
-                    pKF->AddMapPoint(pMP, bestIdx);
+                    if (pMPinKF->Observations() > pMP->Observations())
+                        pMP->Replace(pMPinKF);
+                    else
+                        pMPinKF->Replace(pMP);
                 }
-                nFused++;
             }
             else
-                count_thcheck++;
+            {
+                pMP->AddObservation(pKF, bestIdx);
+                pKF->AddMapPoint(pMP, bestIdx);
+            }
+            nFused++;
         }
 
-#ifdef DEBUG_PRINT
-        if (std::getenv("DEBUG_Fuse"))
-        {
-            std::cout << "[DEBUG] Fuse  KF id=" << pKF->mnId
-                      << "  tried=" << vpMapPoints.size()
-                      << "  fused=" << nFused
-                      << std::endl;
-        }
-#endif
         return nFused;
     }
 
@@ -1517,8 +1514,11 @@ namespace ORB_SLAM3
         Sophus::SE3f Tcw = Sophus::SE3f(Scw.rotationMatrix(), Scw.translation() / Scw.scale());
         Eigen::Vector3f Ow = Tcw.inverse().translation();
 
-        // Set of MapPoints already found in the KeyFrame
-        const set<MapPoint *> spAlreadyFound = pKF->GetMapPoints();
+        // MapPoints already found in the KeyFrame
+        mAlreadyFound.Clear();
+        for (MapPoint *pMPi : pKF->GetMapPointMatches())
+            if (pMPi)
+                mAlreadyFound[pMPi] = true;
 
         int nFused = 0;
 
@@ -1530,7 +1530,7 @@ namespace ORB_SLAM3
             MapPoint *pMP = vpPoints[iMP];
 
             // Discard Bad MapPoints and already found
-            if (pMP->isBad() || spAlreadyFound.count(pMP))
+            if (pMP->isBad() || mAlreadyFound.Find(pMP))
                 continue;
 
             // Get 3D Coords.
@@ -1571,7 +1571,8 @@ namespace ORB_SLAM3
             // Search in a radius
             const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF->GetFeaturesInArea(uv(0), uv(1), radius);
+            pKF->GetFeaturesInArea(mvAreaIndices, uv(0), uv(1), radius);
+            const vector<size_t> &vIndices = mvAreaIndices;
 
             if (vIndices.empty())
                 continue;
@@ -1713,7 +1714,8 @@ namespace ORB_SLAM3
             // Search in a radius
             const float radius = th * pKF2->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF2->GetFeaturesInArea(u, v, radius);
+            pKF2->GetFeaturesInArea(mvAreaIndices, u, v, radius);
+            const vector<size_t> &vIndices = mvAreaIndices;
 
             if (vIndices.empty())
                 continue;
@@ -1793,7 +1795,8 @@ namespace ORB_SLAM3
             // Search in a radius of 2.5*sigma(ScaleLevel)
             const float radius = th * pKF1->mvScaleFactors[nPredictedLevel];
 
-            const vector<size_t> vIndices = pKF1->GetFeaturesInArea(u, v, radius);
+            pKF1->GetFeaturesInArea(mvAreaIndices, u, v, radius);
+            const vector<size_t> &vIndices = mvAreaIndices;
 
             if (vIndices.empty())
                 continue;
@@ -1905,29 +1908,25 @@ namespace ORB_SLAM3
                     if (uv(1) < CurrentFrame.mnMinY || uv(1) > CurrentFrame.mnMaxY)
                         continue;
 
-                    int nLastOctave = (LastFrame.Nleft == -1 || i < LastFrame.Nleft) ? LastFrame.mvKeys[i].octave
-                                                                                     : LastFrame.mvKeysRight[i - LastFrame.Nleft].octave;
+                    int nLastOctave = (LastFrame.Nleft == -1 || i < LastFrame.Nleft) ? LastFrame.mpFeatures->mvKeys[i].octave
+                                                                                     : LastFrame.mpFeatures->mvKeysRight[i - LastFrame.Nleft].octave;
 
                     // Search in a window. Size depends on scale
                     float radius = th * CurrentFrame.mvScaleFactors[nLastOctave];
 
-                    vector<size_t> vIndices2;
+                    vector<size_t> &vIndices2 = mvAreaIndices;
 
                     if (bForward)
-                        vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, nLastOctave);
+                        CurrentFrame.GetFeaturesInArea(vIndices2, uv(0), uv(1), radius, nLastOctave);
                     else if (bBackward)
-                        vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, 0, nLastOctave);
+                        CurrentFrame.GetFeaturesInArea(vIndices2, uv(0), uv(1), radius, 0, nLastOctave);
                     else
-                        vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, nLastOctave - 1, nLastOctave + 1);
+                        CurrentFrame.GetFeaturesInArea(vIndices2, uv(0), uv(1), radius, nLastOctave - 1, nLastOctave + 1);
 
                     if (vIndices2.empty())
                         continue;
 
-                    const cv::Mat dMP = pMP->GetDescriptor();
-
-                    int bestDist = 256;
-                    int bestIdx2 = -1;
-
+                    mBatch.Clear(CurrentFrame.mpFeatures->mDescriptors);
                     for (vector<size_t>::const_iterator vit = vIndices2.begin(), vend = vIndices2.end(); vit != vend; vit++)
                     {
                         const size_t i2 = *vit;
@@ -1936,24 +1935,22 @@ namespace ORB_SLAM3
                             if (CurrentFrame.mvpMapPoints[i2]->Observations() > 0)
                                 continue;
 
-                        if (CurrentFrame.Nleft == -1 && CurrentFrame.mvuRight[i2] > 0)
+                        if (CurrentFrame.Nleft == -1 && CurrentFrame.mpFeatures->mvuRight[i2] > 0)
                         {
                             const float ur = uv(0) - CurrentFrame.mbf * invzc;
-                            const float er = fabs(ur - CurrentFrame.mvuRight[i2]);
+                            const float er = fabs(ur - CurrentFrame.mpFeatures->mvuRight[i2]);
                             if (er > radius)
                                 continue;
                         }
 
-                        const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
+                        mBatch.Add(CurrentFrame.mpFeatures->mDescriptors, i2, i2, -1);
+                    }
 
-                        const int dist = DescriptorDistance(dMP, d);
+                    pMP->GetDescriptor(mQueryDescriptor);
+                    const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor, 256.0f);
 
-                        if (dist < bestDist)
-                        {
-                            bestDist = dist;
-                            bestIdx2 = i2;
-                        }
-                    }
+                    const int bestDist = static_cast<int>(res.bestDist);
+                    const int bestIdx2 = res.bestIdx;
 
                     if (bestDist <= TH_HIGH)
                     {
@@ -1962,13 +1959,13 @@ namespace ORB_SLAM3
 
                         if (mbCheckOrientation)
                         {
-                            cv::KeyPoint kpLF = (LastFrame.Nleft == -1) ? LastFrame.mvKeysUn[i]
-                                                : (i < LastFrame.Nleft) ? LastFrame.mvKeys[i]
-                                                                        : LastFrame.mvKeysRight[i - LastFrame.Nleft];
+                            cv::KeyPoint kpLF = (LastFrame.Nleft == -1) ? LastFrame.mpFeatures->mvKeysUn[i]
+                                                : (i < LastFrame.Nleft) ? LastFrame.mpFeatures->mvKeys[i]
+                                                                        : LastFrame.mpFeatures->mvKeysRight[i - LastFrame.Nleft];
 
-                            cv::KeyPoint kpCF = (CurrentFrame.Nleft == -1)        ? CurrentFrame.mvKeysUn[bestIdx2]
-                                                : (bestIdx2 < CurrentFrame.Nleft) ? CurrentFrame.mvKeys[bestIdx2]
-                                                                                  : CurrentFrame.mvKeysRight[bestIdx2 - CurrentFrame.Nleft];
+                            cv::KeyPoint kpCF = (CurrentFrame.Nleft == -1)        ? CurrentFrame.mpFeatures->mvKeysUn[bestIdx2]
+                                                : (bestIdx2 < CurrentFrame.Nleft) ? CurrentFrame.mpFeatures->mvKeys[bestIdx2]
+                                                                                  : CurrentFrame.mpFeatures->mvKeysRight[bestIdx2 - CurrentFrame.Nleft];
                             float rot = kpLF.angle - kpCF.angle;
                             if (rot < 0.0)
                                 rot += 360.0f;
@@ -1984,26 +1981,22 @@ namespace ORB_SLAM3
                         Eigen::Vector3f x3Dr = CurrentFrame.GetRelativePoseTrl() * x3Dc;
                         Eigen::Vector2f uv = CurrentFrame.mpCamera->project(x3Dr);
 
-                        int nLastOctave = (LastFrame.Nleft == -1 || i < LastFrame.Nleft) ? LastFrame.mvKeys[i].octave
-                                                                                         : LastFrame.mvKeysRight[i - LastFrame.Nleft].octave;
+                        int nLastOctave = (LastFrame.Nleft == -1 || i < LastFrame.Nleft) ? LastFrame.mpFeatures->mvKeys[i].octave
+                                                                                         : LastFrame.mpFeatures->mvKeysRight[i - LastFrame.Nleft].octave;
 
                         // Search in a window. Size depends on scale
                         float radius = th * CurrentFrame.mvScaleFactors[nLastOctave];
 
-                        vector<size_t> vIndices2;
+                        vector<size_t> &vIndices2 = mvAreaIndices;
 
                         if (bForward)
-                            vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, nLastOctave, -1, true);
+                            CurrentFrame.GetFeaturesInArea(vIndices2, uv(0), uv(1), radius, nLastOctave, -1, true);
                         else if (bBackward)
-                            vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, 0, nLastOctave, true);
+                            CurrentFrame.GetFeaturesInArea(vIndices2, uv(0), uv(1), radius, 0, nLastOctave, true);
                         else
-                            vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, nLastOctave - 1, nLastOctave + 1, true);
-
-                        const cv::Mat dMP = pMP->GetDescriptor();
-
-                        int bestDist = 256;
-                        int bestIdx2 = -1;
+                            CurrentFrame.GetFeaturesInArea(vIndices2, uv(0), uv(1), radius, nLastOctave - 1, nLastOctave + 1, true);
 
+                        mBatch.Clear(CurrentFrame.mpFeatures->mDescriptors);
                         for (vector<size_t>::const_iterator vit = vIndices2.begin(), vend = vIndices2.end(); vit != vend; vit++)
                         {
                             const size_t i2 = *vit;
@@ -2011,16 +2004,14 @@ namespace ORB_SLAM3
                                 if (CurrentFrame.mvpMapPoints[i2 + CurrentFrame.Nleft]->Observations() > 0)
                                     continue;
 
-                            const cv::Mat &d = CurrentFrame.mDescriptors.row(i2 + CurrentFrame.Nleft);
+                            mBatch.Add(CurrentFrame.mpFeatures->mDescriptors, i2 + CurrentFrame.Nleft, i2, -1);
+                        }
 
-                            const int dist = DescriptorDistance(dMP, d);
+                        pMP->GetDescriptor(mQueryDescriptor);
+                        const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor, 256.0f);
 
-                            if (dist < bestDist)
-                            {
-                                bestDist = dist;
-                                bestIdx2 = i2;
-                            }
-                        }
+                        const int bestDist = static_cast<int>(res.bestDist);
+                        const int bestIdx2 = res.bestIdx;
 
                         if (bestDist <= TH_HIGH)
                         {
@@ -2028,11 +2019,11 @@ namespace ORB_SLAM3
                             nmatches++;
                             if (mbCheckOrientation)
                             {
-                                cv::KeyPoint kpLF = (LastFrame.Nleft == -1) ? LastFrame.mvKeysUn[i]
-                                                    : (i < LastFrame.Nleft) ? LastFrame.mvKeys[i]
-                                                                            : LastFrame.mvKeysRight[i - LastFrame.Nleft];
+                                cv::KeyPoint kpLF = (LastFrame.Nleft == -1) ? LastFrame.mpFeatures->mvKeysUn[i]
+                                                    : (i < LastFrame.Nleft) ? LastFrame.mpFeatures->mvKeys[i]
+                                                                            : LastFrame.mpFeatures->mvKeysRight[i - LastFrame.Nleft];
 
-                                cv::KeyPoint kpCF = CurrentFrame.mvKeysRight[bestIdx2];
+                                cv::KeyPoint kpCF = CurrentFrame.mpFeatures->mvKeysRight[bestIdx2];
 
                                 float rot = kpLF.angle - kpCF.angle;
                                 if (rot < 0.0)
@@ -2167,32 +2158,27 @@ namespace ORB_SLAM3
                     // Search in a window
                     const float radius = th * CurrentFrame.mvScaleFactors[nPredictedLevel];
 
-                    const vector<size_t> vIndices2 = CurrentFrame.GetFeaturesInArea(uv(0), uv(1), radius, nPredictedLevel - 1, nPredictedLevel + 1);
+                    CurrentFrame.GetFeaturesInArea(mvAreaIndices, uv(0), uv(1), radius, nPredictedLevel - 1, nPredictedLevel + 1);
+                    const vector<size_t> &vIndices2 = mvAreaIndices;
 
                     if (vIndices2.empty())
                         continue;
 
-                    const cv::Mat dMP = pMP->GetDescriptor();
-
-                    int bestDist = 256;
-                    int bestIdx2 = -1;
-
+                    mBatch.Clear(CurrentFrame.mpFeatures->mDescriptors);
                     for (vector<size_t>::const_iterator vit = vIndices2.begin(); vit != vIndices2.end(); vit++)
                     {
                         const size_t i2 = *vit;
                         if (CurrentFrame.mvpMapPoints[i2])
                             continue;
 
-                        const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
+                        mBatch.Add(CurrentFrame.mpFeatures->mDescriptors, i2, i2, -1);
+                    }
 
-                        const int dist = DescriptorDistance(dMP, d);
+                    pMP->GetDescriptor(mQueryDescriptor);
+                    const DescriptorBatch::Result res = mBatch.Match(msDescriptorMetric, mQueryDescriptor, 256.0f);
 
-                        if (dist < bestDist)
-                        {
-                            bestDist = dist;
-                            bestIdx2 = i2;
-                        }
-                    }
+                    const int bestDist = static_cast<int>(res.bestDist);
+                    const int bestIdx2 = res.bestIdx;
 
                     if (bestDist <= ORBdist)
                     {
@@ -2201,7 +2187,7 @@ namespace ORB_SLAM3
 
                         if (mbCheckOrientation)
                         {
-                            float rot = pKF->mvKeysUn[i].angle - CurrentFrame.mvKeysUn[bestIdx2].angle;
+                            float rot = pKF->mvKeysUn[i].angle - CurrentFrame.mpFeatures->mvKeysUn[bestIdx2].angle;
                             if (rot < 0.0)
                                 rot += 360.0f;
                             int bin = round(rot * factor);
@@ -2300,48 +2286,25 @@ namespace ORB_SLAM3
 #endif
     }
 
+    DescriptorMetric ORBmatcher::msDescriptorMetric;
+
+    void ORBmatcher::SetDescriptorMetric(const DescriptorMetric &metric)
+    {
+        msDescriptorMetric = metric;
+    }
+
+    const DescriptorMetric& ORBmatcher::GetDescriptorMetric()
+    {
+        return msDescriptorMetric;
+    }
+
     // updated for floating point descriptors as well
     float ORBmatcher::DescriptorDistance(const cv::Mat &a, const cv::Mat &b)
     {
-        float dist = 0;
-        if (a.type() == CV_8U)
-        { // ORB
-            dist = cv::norm(a, b, cv::NORM_HAMMING);
-            // const int *pa = a.ptr<int32_t>();
-            // const int *pb = b.ptr<int32_t>();
-
-            // int disti=0;
-            // for(int i=0; i<8; i++, pa++, pb++)
-            // {
-            //     unsigned  int v = *pa ^ *pb;
-            //     v = v - ((v >> 1) & 0x55555555);
-            //     v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
-            //     disti += (((v + (v >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
-            // }
-            // // std::cout << "CV dist=" << dist << " custom dist=" << disti << std::endl;
-            // dist = (float)disti;
-        }
-        else
-        {
-            if (GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "SIFT")
-            {
-                dist = (cv::norm(a, b, cv::NORM_L2SQR));
-            }
-            else if (GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "Xfeat")
-            {
-                dist = 512 * (cv::norm(a, b, cv::NORM_L2SQR));
-            }
-            else
-            {
-                // For any other floating-point descriptor (e.g., SuperPoint, Dummy, etc.)
-                // fall back to standard L2-squared distance. This prevents runtime errors
-                // when using custom extractors that produce CV_32F descriptors but have
-                // not been explicitly handled here.
-                dist = cv::norm(a, b, cv::NORM_L2) * 100;
-            }
-        }
+        const float dist = msDescriptorMetric(a, b);
 #ifdef DEBUG_PRINT
-        if (std::getenv("DEBUG_DescriptorDistance") != nullptr)
+        static const bool bDebug = std::getenv("DEBUG_DescriptorDistance") != nullptr;
+        if (bDebug)
         {
             std::cout << "[DEBUG] DescriptorDistance "
                       << ((a.type() == CV_8U) ? "HAMMING" : "L2²")
@@ -863,13 +863,13 @@ int Optimizer::PoseOptimization(Frame *pFrame)
             //Conventional SLAM
             if(!pFrame->mpCamera2){
                 // Monocular observation
-                if(pFrame->mvuRight[i]<0)
+                if(pFrame->mpFeatures->mvuRight[i]<0)
                 {
                     nInitialCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
 
                     Eigen::Matrix<double,2,1> obs;
-                    const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
+                    const cv::KeyPoint &kpUn = pFrame->mpFeatures->mvKeysUn[i];
                     obs << kpUn.pt.x, kpUn.pt.y;
 
                     ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose* e = new ORB_SLAM3::EdgeSE3ProjectXYZOnlyPose();
@@ -897,8 +897,8 @@ int Optimizer::PoseOptimization(Frame *pFrame)
                     pFrame->mvbOutlier[i] = false;
 
                     Eigen::Matrix<double,3,1> obs;
-                    const cv::KeyPoint &kpUn = pFrame->mvKeysUn[i];
-                    const float &kp_ur = pFrame->mvuRight[i];
+                    const cv::KeyPoint &kpUn = pFrame->mpFeatures->mvKeysUn[i];
+                    const float &kp_ur = pFrame->mpFeatures->mvuRight[i];
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
                     g2o::EdgeStereoSE3ProjectXYZOnlyPose* e = new g2o::EdgeStereoSE3ProjectXYZOnlyPose();
@@ -933,7 +933,7 @@ int Optimizer::PoseOptimization(Frame *pFrame)
                 cv::KeyPoint kpUn;
 
                 if (i < pFrame->Nleft) {    //Left camera observation
-                    kpUn = pFrame->mvKeys[i];
+                    kpUn = pFrame->mpFeatures->mvKeys[i];
 
                     pFrame->mvbOutlier[i] = false;
 
@@ -960,7 +960,7 @@ int Optimizer::PoseOptimization(Frame *pFrame)
                     vnIndexEdgeMono.push_back(i);
                 }
                 else {
-                    kpUn = pFrame->mvKeysRight[i - pFrame->Nleft];
+                    kpUn = pFrame->mpFeatures->mvKeysRight[i - pFrame->Nleft];
 
                     Eigen::Matrix<double, 2, 1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
@@ -4552,12 +4552,12 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
                 cv::KeyPoint kpUn;
 
                 // Left monocular observation
-                if((!bRight && pFrame->mvuRight[i]<0) || i < Nleft)
+                if((!bRight && pFrame->mpFeatures->mvuRight[i]<0) || i < Nleft)
                 {
                     if(i < Nleft) // pair left-right
-                        kpUn = pFrame->mvKeys[i];
+                        kpUn = pFrame->mpFeatures->mvKeys[i];
                     else
-                        kpUn = pFrame->mvKeysUn[i];
+                        kpUn = pFrame->mpFeatures->mvKeysUn[i];
 
                     nInitialMonoCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
@@ -4591,8 +4591,8 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
                     nInitialStereoCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
 
-                    kpUn = pFrame->mvKeysUn[i];
-                    const float kp_ur = pFrame->mvuRight[i];
+                    kpUn = pFrame->mpFeatures->mvKeysUn[i];
+                    const float kp_ur = pFrame->mpFeatures->mvuRight[i];
                     Eigen::Matrix<double,3,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
@@ -4623,7 +4623,7 @@ int Optimizer::PoseInertialOptimizationLastKeyFrame(Frame *pFrame, bool bRecInit
                     nInitialMonoCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
 
-                    kpUn = pFrame->mvKeysRight[i - Nleft];
+                    kpUn = pFrame->mpFeatures->mvKeysRight[i - Nleft];
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
@@ -4935,12 +4935,12 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
             {
                 cv::KeyPoint kpUn;
                 // Left monocular observation
-                if((!bRight && pFrame->mvuRight[i]<0) || i < Nleft)
+                if((!bRight && pFrame->mpFeatures->mvuRight[i]<0) || i < Nleft)
                 {
                     if(i < Nleft) // pair left-right
-                        kpUn = pFrame->mvKeys[i];
+                        kpUn = pFrame->mpFeatures->mvKeys[i];
                     else
-                        kpUn = pFrame->mvKeysUn[i];
+                        kpUn = pFrame->mpFeatures->mvKeysUn[i];
 
                     nInitialMonoCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
@@ -4974,8 +4974,8 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
                     nInitialStereoCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
 
-                    kpUn = pFrame->mvKeysUn[i];
-                    const float kp_ur = pFrame->mvuRight[i];
+                    kpUn = pFrame->mpFeatures->mvKeysUn[i];
+                    const float kp_ur = pFrame->mpFeatures->mvuRight[i];
                     Eigen::Matrix<double,3,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y, kp_ur;
 
@@ -5006,7 +5006,7 @@ int Optimizer::PoseInertialOptimizationLastFrame(Frame *pFrame, bool bRecInit)
                     nInitialMonoCorrespondences++;
                     pFrame->mvbOutlier[i] = false;
 
-                    kpUn = pFrame->mvKeysRight[i - Nleft];
+                    kpUn = pFrame->mpFeatures->mvKeysRight[i - Nleft];
                     Eigen::Matrix<double,2,1> obs;
                     obs << kpUn.pt.x, kpUn.pt.y;
 
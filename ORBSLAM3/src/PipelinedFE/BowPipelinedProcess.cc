@@ -0,0 +1,75 @@
+#include "PipelinedFE/BowPipelinedProcess.h"
+#include "Tracer.h"
+#include <chrono>
+#include <iostream>
+
+namespace ORB_SLAM3
+{
+
+BowPipelinedProcess::BowPipelinedProcess(
+    PipelineQueue<ResultQueueItem>& inputQueue,
+    PipelineQueue<BowResultQueueItem>& outputQueue,
+    ORBVocabulary* voc)
+    : mInputQueue(inputQueue), mOutputQueue(outputQueue), mpVocabulary(voc), mbRunning(false)
+{
+    std::cout << "[BowPipelinedProcess] BoW computed ahead of tracking" << std::endl;
+}
+
+BowPipelinedProcess::~BowPipelinedProcess()
+{
+    if (mbRunning)
+    {
+        Stop();
+    }
+}
+
+void BowPipelinedProcess::StartProcessing()
+{
+    if (!mbRunning)
+    {
+        mbRunning = true;
+        mProcessThread = std::thread(&BowPipelinedProcess::Run, this);
+    }
+}
+
+void BowPipelinedProcess::Stop()
+{
+    if (mbRunning)
+    {
+        mbRunning = false;
+        if (mProcessThread.joinable())
+        {
+            mProcessThread.join();
+        }
+    }
+}
+
+void BowPipelinedProcess::Run()
+{
+    Tracer::SetThreadName("BoW");
+    BowResultQueueItem item;
+    while (mbRunning)
+    {
+        if (!mInputQueue.try_dequeue_for(item.result, std::chrono::milliseconds(100)))
+        {
+            if (mInputQueue.is_shutdown())
+                break;
+            continue;
+        }
+
+        TraceScope trace("BoW", item.result.index);
+
+        // Same transform as Frame::ComputeBoW, which then finds the vectors already filled
+        item.bow.mBowVec.clear();
+        item.bow.mFeatVec.clear();
+        if (!item.result.descriptors.empty())
+            mpVocabulary->transform(item.result.descriptors, FEAT_VEC_LEVELS_UP, item.bow.mBowVec, item.bow.mFeatVec);
+
+        mOutputQueue.enqueue(std::move(item));
+    }
+
+    // Signal that we're done processing
+    mOutputQueue.shutdown();
+}
+
+} // namespace ORB_SLAM3
@@ -1,14 +1,16 @@
 #include "PipelinedFE/DummyPipelinedProcess.h"
 #include "FeatureExtractors/Dummy/FeatureIO.h"
+#include "Tracer.h"
 #include <chrono>
 #include <iostream>
+#include <sys/stat.h>
 
 namespace ORB_SLAM3
 {
 
 DummyPipelinedProcess::DummyPipelinedProcess(
-    ThreadSafeQueue<InputQueueItem>& inputQueue, 
-    ThreadSafeQueue<ResultQueueItem>& outputQueue,
+    PipelineQueue<InputQueueItem>& inputQueue, 
+    PipelineQueue<ResultQueueItem>& outputQueue,
     const std::string& featuresDir,
     const std::string& extractorType,
     int descriptorType,
@@ -19,8 +21,19 @@ DummyPipelinedProcess::DummyPipelinedProcess(
       mDescriptorType(descriptorType),
       mDescriptorSize(descriptorSize)
 {
-    // Print the features directory for debugging
-    std::cout << "Using features from: " << mFeaturesDir << std::endl;
+    // Prefer a packed cache: either featuresDir itself or the default cache file inside it
+    std::string cachePath = mFeaturesDir;
+    struct stat st;
+    if (stat(cachePath.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        cachePath = (mFeaturesDir.empty() || mFeaturesDir.back() == '/' ? mFeaturesDir : mFeaturesDir + "/") + FeatureCache::DEFAULT_FILENAME;
+
+    if (mFeatureCache.Open(cachePath)) {
+        std::cout << "Using feature cache: " << cachePath << " (" << mFeatureCache.Size() << " frames)" << std::endl;
+    }
+    else {
+        // Print the features directory for debugging
+        std::cout << "Using features from: " << mFeaturesDir << std::endl;
+    }
 }
 
 DummyPipelinedProcess::~DummyPipelinedProcess()
@@ -30,6 +43,7 @@ DummyPipelinedProcess::~DummyPipelinedProcess()
 
 void DummyPipelinedProcess::Run()
 {
+    Tracer::SetThreadName("LoadFeatures");
     InputQueueItem input;
     while (mbRunning && !mInputQueue.is_shutdown())
     {
@@ -47,12 +61,13 @@ void DummyPipelinedProcess::Run()
 ResultQueueItem DummyPipelinedProcess::ProcessItem(const InputQueueItem& input)
 {
     std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    TraceScope trace("LoadFeatures", input.index);
     
     ResultQueueItem result;
     result.index = input.index;
     result.timestamp = input.timestamp;
     result.filename = input.filename;
-    result.image = input.image.clone();
+    result.image = input.image;
     
     // Load features directly using our helper method
     bool success = LoadFeatures(input.filename, result.keypoints, result.descriptors);
@@ -102,6 +117,14 @@ bool DummyPipelinedProcess::LoadFeatures(const std::string& imageFilename,
 {
     // Extract base filename without directory or extension
     std::string baseFilename = GetBaseFilename(imageFilename);
+
+    if (mFeatureCache.IsOpen()) {
+        if (!mFeatureCache.Load(baseFilename, keypoints, descriptors)) {
+            std::cerr << "No features in cache for: " << baseFilename << std::endl;
+            return false;
+        }
+        return true;
+    }
     
     // Ensure directories have trailing slashes if not empty
     std::string keypointsDir = mFeaturesDir.empty() ? "" : 
@@ -1,5 +1,7 @@
 #include "PipelinedFE/ORBPipelinedProcess.h"
 #include "FeatureExtractors/ORBextractor.h"
+#include "Tracer.h"
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 
@@ -7,55 +9,142 @@ namespace ORB_SLAM3
 {
 
 ORBPipelinedProcess::ORBPipelinedProcess(
-    ThreadSafeQueue<InputQueueItem>& inputQueue, 
-    ThreadSafeQueue<ResultQueueItem>& outputQueue)
-    : BasePipelinedProcess(inputQueue, outputQueue)
+    PipelineQueue<InputQueueItem>& inputQueue, 
+    PipelineQueue<ResultQueueItem>& outputQueue,
+    const ORBPipelineParams& params)
+    : BasePipelinedProcess(inputQueue, outputQueue), mbDispatchDone(false), mnNextEmitted(0)
 {
-    // Initialize ORB extractor with default parameters
-    int nFeatures = 1000;
-    float scaleFactor = 1.2f;
-    int nLevels = 8;
-    int iniThFAST = 20;
-    int minThFAST = 7;
-    
-    mpORBextractor = std::make_unique<ORBextractor>(
-        nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+    const int nWorkers = std::max(params.nWorkers, 1);
+
+    // Initialize one ORB extractor per worker
+    for (int i = 0; i < nWorkers; i++)
+    {
+        mvpORBextractors.push_back(std::make_unique<ORBextractor>(
+            params.nFeatures, params.scaleFactor, params.nLevels, params.iniThFAST, params.minThFAST));
+    }
+
+    std::cout << "[ORBPipelinedProcess] " << nWorkers << " worker(s), nFeatures: " << params.nFeatures
+              << ", nLevels: " << params.nLevels << std::endl;
 }
 
 ORBPipelinedProcess::~ORBPipelinedProcess()
 {
-    // Smart pointer will handle cleanup
+    // Smart pointers will handle cleanup
 }
 
 void ORBPipelinedProcess::Run()
 {
     InputQueueItem input;
-    while (mbRunning && !mInputQueue.is_shutdown())
+
+    if (mvpORBextractors.size() == 1)
+    {
+        // Nothing to reorder, the only worker takes the items straight from the input queue
+        Tracer::SetThreadName("ORBExtract 0");
+        while (Receive(input))
+            mOutputQueue.enqueue(ProcessItem(input, *mvpORBextractors[0]));
+
+        mOutputQueue.shutdown();
+        return;
+    }
+
+    std::vector<std::thread> vWorkers;
+    for (size_t i = 0; i < mvpORBextractors.size(); i++)
+        vWorkers.emplace_back(&ORBPipelinedProcess::WorkerLoop, this, (int)i);
+
+    // This thread is the only consumer of the input queue, so no lock is held while waiting on it
+    Tracer::SetThreadName("ORBDispatch");
+    unsigned long seq = 0;
+    while (Receive(input))
+    {
+        std::unique_lock<std::mutex> lock(mMutexDispatch);
+        // At most one item waiting per worker, so the input queue still bounds the frames in flight
+        mCondDispatch.wait(lock, [&]() { return mDispatched.size() < mvpORBextractors.size(); });
+        mDispatched.emplace_back(seq++, std::move(input));
+        lock.unlock();
+        mCondDispatch.notify_all();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mMutexDispatch);
+        mbDispatchDone = true;
+    }
+    mCondDispatch.notify_all();
+
+    for (std::thread& worker : vWorkers)
+        worker.join();
+
+    // Signal that we're done processing
+    mOutputQueue.shutdown();
+}
+
+bool ORBPipelinedProcess::Receive(InputQueueItem& input)
+{
+    while (mbRunning)
     {
         if (mInputQueue.try_dequeue_for(input, std::chrono::milliseconds(100)))
+            return true;
+        if (mInputQueue.is_shutdown())
+            return false;
+    }
+    return false;
+}
+
+void ORBPipelinedProcess::WorkerLoop(int worker)
+{
+    ORBextractor& extractor = *mvpORBextractors[worker];
+    Tracer::SetThreadName("ORBExtract " + std::to_string(worker));
+
+    while (true)
+    {
+        std::pair<unsigned long, InputQueueItem> item;
         {
-            ResultQueueItem result = ProcessItem(input);
-            mOutputQueue.enqueue(std::move(result));
+            std::unique_lock<std::mutex> lock(mMutexDispatch);
+            mCondDispatch.wait(lock, [&]() { return !mDispatched.empty() || mbDispatchDone; });
+            if (mDispatched.empty())
+                break;
+            item = std::move(mDispatched.front());
+            mDispatched.pop_front();
         }
+        mCondDispatch.notify_all();
+
+        Emit(item.first, ProcessItem(item.second, extractor));
+    }
+}
+
+void ORBPipelinedProcess::Emit(unsigned long seq, ResultQueueItem&& result)
+{
+    std::unique_lock<std::mutex> lock(mMutexReorder);
+    mPendingResults.emplace(seq, std::move(result));
+
+    // Forward under the lock, so results leave in order even if several workers emit at once
+    std::map<unsigned long, ResultQueueItem>::iterator it = mPendingResults.begin();
+    while (it != mPendingResults.end() && it->first == mnNextEmitted)
+    {
+        mOutputQueue.enqueue(std::move(it->second));
+        it = mPendingResults.erase(it);
+        mnNextEmitted++;
     }
-    
-    // Signal that we're done processing
-    mOutputQueue.shutdown();
 }
 
 ResultQueueItem ORBPipelinedProcess::ProcessItem(const InputQueueItem& input)
+{
+    return ProcessItem(input, *mvpORBextractors[0]);
+}
+
+ResultQueueItem ORBPipelinedProcess::ProcessItem(const InputQueueItem& input, ORBextractor& extractor)
 {
     std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    TraceScope trace("ORBExtract", input.index);
     
     ResultQueueItem result;
     result.index = input.index;
     result.timestamp = input.timestamp;
     result.filename = input.filename;
-    result.image = input.image.clone();
+    result.image = input.image;
     
     // Extract ORB features
     result.lappingArea = {0, 1000};  // Default lapping area
-    (*mpORBextractor)(result.image, cv::Mat(), result.keypoints, result.descriptors, result.lappingArea);
+    extractor(result.image, cv::Mat(), result.keypoints, result.descriptors, result.lappingArea);
     
     std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
     double ttrack = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1).count();
@@ -71,4 +160,4 @@ ResultQueueItem ORBPipelinedProcess::ProcessItem(const InputQueueItem& input)
     return result;
 }
 
-} // namespace ORB_SLAM3 
\ No newline at end of file
+} // namespace ORB_SLAM3 
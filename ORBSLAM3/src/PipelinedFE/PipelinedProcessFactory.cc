@@ -7,6 +7,7 @@
 #include "PipelinedFE/PipelinedProcessFactory.h"
 #include "PipelinedFE/ORBPipelinedProcess.h"
 #include "PipelinedFE/DummyPipelinedProcess.h"
+#include "Settings.h"
 
 // Include the SuperPoint implementation only if enabled
 #ifdef BUILD_SP_DPU
@@ -18,8 +19,8 @@ namespace ORB_SLAM3
 
 std::unique_ptr<BasePipelinedProcess> PipelinedProcessFactory::CreatePipelinedProcess(
     FeatureExtractorType type,
-    ThreadSafeQueue<InputQueueItem>& inputQueue,
-    ThreadSafeQueue<ResultQueueItem>& outputQueue,
+    PipelineQueue<InputQueueItem>& inputQueue,
+    PipelineQueue<ResultQueueItem>& outputQueue,
     const std::string& featureDir,
     const std::string& modelName,
     int numThreads)
@@ -69,4 +70,27 @@ std::unique_ptr<BasePipelinedProcess> PipelinedProcessFactory::CreatePipelinedPr
     }
 }
 
+std::unique_ptr<BasePipelinedProcess> PipelinedProcessFactory::CreatePipelinedProcess(
+    FeatureExtractorType type,
+    PipelineQueue<InputQueueItem>& inputQueue,
+    PipelineQueue<ResultQueueItem>& outputQueue,
+    Settings* settings)
+{
+    if (type != FeatureExtractorType::ORB || !settings)
+        return CreatePipelinedProcess(type, inputQueue, outputQueue);
+
+    ORBPipelineParams params;
+    if (settings->featureExtractorType() == "ORB")
+    {
+        params.nFeatures = settings->nFeatures();
+        params.scaleFactor = settings->scaleFactor();
+        params.nLevels = settings->nLevels();
+        params.iniThFAST = settings->initThFAST();
+        params.minThFAST = settings->minThFAST();
+    }
+    params.nWorkers = settings->pipelineWorkers();
+
+    return std::make_unique<ORBPipelinedProcess>(inputQueue, outputQueue, params);
+}
+
 } // namespace ORB_SLAM3 
\ No newline at end of file
@@ -13,8 +13,8 @@ namespace ORB_SLAM3
 {
 
 SuperPointPipelinedProcess::SuperPointPipelinedProcess(
-    ThreadSafeQueue<InputQueueItem>& inputQueue, 
-    ThreadSafeQueue<ResultQueueItem>& outputQueue,
+    PipelineQueue<InputQueueItem>& inputQueue, 
+    PipelineQueue<ResultQueueItem>& outputQueue,
     const std::string& modelName,
     int numThreads)
     : BasePipelinedProcess(inputQueue, outputQueue),
@@ -449,6 +449,24 @@ namespace ORB_SLAM3 {
             featureExtractorType_ = "ORB";
             std::cout << "Feature extractor type not specified, defaulting to ORB" << std::endl;
         }
+
+        // Optional: number of extraction workers used by the pipelined front end
+        pipelineWorkers_ = readParameter<int>(fSettings,"FeatureExtractor.nWorkers", found, false);
+        if (!found || pipelineWorkers_ < 1)
+            pipelineWorkers_ = 1;
+
+        // Optional: compute the BoW of each frame in a pipeline stage after extraction (off by default)
+        pipelineBoW_ = readParameter<int>(fSettings,"FeatureExtractor.pipelinedBoW", found, false) != 0;
+        if (!found)
+            pipelineBoW_ = false;
+
+        // Optional: CPUs the stereo left/right extraction workers are pinned to (unpinned by default)
+        extractorCpuLeft_ = readParameter<int>(fSettings,"FeatureExtractor.leftCpu", found, false);
+        if (!found || extractorCpuLeft_ < 0)
+            extractorCpuLeft_ = -1;
+        extractorCpuRight_ = readParameter<int>(fSettings,"FeatureExtractor.rightCpu", found, false);
+        if (!found || extractorCpuRight_ < 0)
+            extractorCpuRight_ = -1;
         
         TH_HIGH = readParameter<float>(fSettings,"Matcher.TH_HIGH",found);
         TH_LOW = readParameter<float>(fSettings,"Matcher.TH_LOW",found);
@@ -459,12 +477,18 @@ namespace ORB_SLAM3 {
             nLevels_ = readParameter<int>(fSettings,"ORBextractor.nLevels",found);
             initThFAST_ = readParameter<int>(fSettings,"ORBextractor.iniThFAST",found);
             minThFAST_ = readParameter<int>(fSettings,"ORBextractor.minThFAST",found);
+
+            // Optional: > 1 extracts the pyramid levels in parallel
+            extractorThreads_ = readParameter<int>(fSettings,"ORBextractor.nThreads",found,false);
+            if(!found || extractorThreads_ < 1)
+                extractorThreads_ = 1;
         }else if (featureExtractorType_ == "SIFT") {
             nFeatures_ = readParameter<int>(fSettings,"SIFTextractor.nFeatures",found);
             scaleFactor_ = readParameter<float>(fSettings,"SIFTextractor.scaleFactor",found);
             nLevels_ = readParameter<int>(fSettings,"SIFTextractor.nLevels",found);
             initThFAST_ = 0;
             minThFAST_ = 0;
+            extractorThreads_ = 1;
         }
         else{
             nFeatures_ = 1000;
@@ -472,6 +496,7 @@ namespace ORB_SLAM3 {
             nLevels_ = 1;
             initThFAST_ = 0;
             minThFAST_ = 0;
+            extractorThreads_ = 1;
             std::cout << "Extractor: " << featureExtractorType_ << " is initialized with default values" << std::endl;
         }
     }
@@ -500,12 +525,36 @@ namespace ORB_SLAM3 {
 
         sLoadFrom_ = readParameter<string>(fSettings,"System.LoadAtlasFromFile",found,false);
         sSaveto_ = readParameter<string>(fSettings,"System.SaveAtlasToFile",found,false);
+
+        // Optional tracing of the per-frame/keyframe spans of every thread (on by default)
+        tracing_ = readParameter<int>(fSettings,"System.Tracing",found,false) != 0;
+        if(!found)
+            tracing_ = true;
+        traceFile_ = readParameter<string>(fSettings,"System.TraceFile",found,false);
+        traceSummaryPeriod_ = readParameter<float>(fSettings,"System.TraceSummaryPeriod",found,false);
+        if(!found || traceSummaryPeriod_ < 0.f)
+            traceSummaryPeriod_ = 0.f;
     }
 
     void Settings::readOtherParameters(cv::FileStorage& fSettings) {
         bool found;
 
         thFarPoints_ = readParameter<float>(fSettings,"System.thFarPoints",found,false);
+
+        // Optional: > 1 splits the features of a frame/keyframe across threads when computing its BoW
+        bowThreads_ = readParameter<int>(fSettings,"Vocabulary.nThreads",found,false);
+        if(!found || bowThreads_ < 1)
+            bowThreads_ = 1;
+
+        // Optional: > 1 splits the frustum test of the local map points and relocalization across threads
+        trackingThreads_ = readParameter<int>(fSettings,"Tracking.nThreads",found,false);
+        if(!found || trackingThreads_ < 1)
+            trackingThreads_ = 1;
+
+        // Optional: > 1 splits the new map point triangulation and the fusion with the neighbors across threads
+        mappingThreads_ = readParameter<int>(fSettings,"LocalMapping.nThreads",found,false);
+        if(!found || mappingThreads_ < 1)
+            mappingThreads_ = 1;
     }
 
     void Settings::precomputeRectificationMaps() {
@@ -658,6 +707,21 @@ namespace ORB_SLAM3 {
         output << "\t-ORB number of scales: " << settings.nLevels_ << endl;
         output << "\t-Initial FAST threshold: " << settings.initThFAST_ << endl;
         output << "\t-Min FAST threshold: " << settings.minThFAST_ << endl;
+        output << "\t-Extractor threads: " << settings.extractorThreads_ << endl;
+        output << "\t-Pipelined extraction workers: " << settings.pipelineWorkers_ << endl;
+        output << "\t-Pipelined BoW stage: " << (settings.pipelineBoW_ ? "on" : "off") << endl;
+        if(settings.sensor_ == System::STEREO || settings.sensor_ == System::IMU_STEREO){
+            output << "\t-Stereo extraction worker CPUs: " << settings.extractorCpuLeft_ << ", " << settings.extractorCpuRight_ << endl;
+        }
+        output << "\t-BoW transform threads: " << settings.bowThreads_ << endl;
+        output << "\t-Tracking threads: " << settings.trackingThreads_ << endl;
+        output << "\t-Local mapping threads: " << settings.mappingThreads_ << endl;
+        output << "\t-Tracing: " << (settings.tracing_ ? "on" : "off");
+        if(settings.tracing_ && settings.traceSummaryPeriod_ > 0.f)
+            output << ", summary every " << settings.traceSummaryPeriod_ << " s";
+        if(settings.tracing_ && !settings.traceFile_.empty())
+            output << ", Chrome trace to " << settings.traceFile_;
+        output << endl;
 
         return output;
     }
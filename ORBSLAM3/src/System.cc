@@ -20,6 +20,7 @@
 
 #include "System.h"
 #include "Converter.h"
+#include "Tracer.h"
 #include <thread>
 #include <pangolin/pangolin.h>
 #include <iomanip>
@@ -82,6 +83,10 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
         mStrSaveAtlasToFile = settings_->atlasSaveFile();
 
         cout << (*settings_) << endl;
+
+        Tracer::SetEnabled(settings_->tracing());
+        if(settings_->tracing())
+            Tracer::StartReporter(settings_->traceSummaryPeriod());
     }
     else{
         settings_ = nullptr;
@@ -116,6 +121,8 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
 
         mpVocabulary = new ORBVocabulary();
         mpVocabulary->readFromFile(strVocFile);
+        if(settings_)
+            mpVocabulary->setNumThreads(settings_->bowThreads());
         cout << "Vocabulary loaded!" << endl << endl;
 
         //Create KeyFrame Database
@@ -132,6 +139,8 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
 
         mpVocabulary = new ORBVocabulary();
         mpVocabulary->readFromFile(strVocFile);
+        if(settings_)
+            mpVocabulary->setNumThreads(settings_->bowThreads());
         cout << "Vocabulary loaded!" << endl << endl;
 
         //Create KeyFrame Database
@@ -178,10 +187,13 @@ System::System(const string &strVocFile, const string &strSettingsFile, const eS
     cout << "Seq. Name: " << strSequence << endl;
     mpTracker = new Tracking(this, mpVocabulary, mpFrameDrawer, mpMapDrawer,
                              mpAtlas, mpKeyFrameDatabase, strSettingsFile, mSensor, settings_, strSequence);
+    Tracer::SetThreadName("Tracking");
 
     //Initialize the Local Mapping thread and launch
     mpLocalMapper = new LocalMapping(this, mpAtlas, mSensor==MONOCULAR || mSensor==IMU_MONOCULAR,
                                      mSensor==IMU_MONOCULAR || mSensor==IMU_STEREO || mSensor==IMU_RGBD, strSequence);
+    if(settings_)
+        mpLocalMapper->SetThreads(settings_->mappingThreads());
     mptLocalMapping = new thread(&ORB_SLAM3::LocalMapping::Run,mpLocalMapper);
     mpLocalMapper->mInitFr = initFr;
     if(settings_)
@@ -264,10 +276,7 @@ Sophus::SE3f System::TrackStereo(const cv::Mat &imLeft, const cv::Mat &imRight,
             mpLocalMapper->RequestStop();
 
             // Wait until Local Mapping has effectively stopped
-            while(!mpLocalMapper->isStopped())
-            {
-                usleep(1000);
-            }
+            mpLocalMapper->WaitUntilStopped();
 
             mpTracker->InformOnlyTracking(true);
             mbActivateLocalizationMode = false;
@@ -308,7 +317,7 @@ Sophus::SE3f System::TrackStereo(const cv::Mat &imLeft, const cv::Mat &imRight,
     unique_lock<mutex> lock2(mMutexState);
     mTrackingState = mpTracker->mState;
     mTrackedMapPoints = mpTracker->mCurrentFrame.mvpMapPoints;
-    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mpFeatures->mvKeysUn;
 
     return Tcw;
 }
@@ -339,10 +348,7 @@ Sophus::SE3f System::TrackRGBD(const cv::Mat &im, const cv::Mat &depthmap, const
             mpLocalMapper->RequestStop();
 
             // Wait until Local Mapping has effectively stopped
-            while(!mpLocalMapper->isStopped())
-            {
-                usleep(1000);
-            }
+            mpLocalMapper->WaitUntilStopped();
 
             mpTracker->InformOnlyTracking(true);
             mbActivateLocalizationMode = false;
@@ -380,7 +386,7 @@ Sophus::SE3f System::TrackRGBD(const cv::Mat &im, const cv::Mat &depthmap, const
     unique_lock<mutex> lock2(mMutexState);
     mTrackingState = mpTracker->mState;
     mTrackedMapPoints = mpTracker->mCurrentFrame.mvpMapPoints;
-    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mpFeatures->mvKeysUn;
     return Tcw;
 }
 
@@ -415,10 +421,7 @@ Sophus::SE3f System::TrackMonocular(const cv::Mat &im, const double &timestamp,
             mpLocalMapper->RequestStop();
 
             // Wait until Local Mapping has effectively stopped
-            while(!mpLocalMapper->isStopped())
-            {
-                usleep(1000);
-            }
+            mpLocalMapper->WaitUntilStopped();
 
             mpTracker->InformOnlyTracking(true);
             mbActivateLocalizationMode = false;
@@ -457,13 +460,13 @@ Sophus::SE3f System::TrackMonocular(const cv::Mat &im, const double &timestamp,
     unique_lock<mutex> lock2(mMutexState);
     mTrackingState = mpTracker->mState;
     mTrackedMapPoints = mpTracker->mCurrentFrame.mvpMapPoints;
-    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+    mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mpFeatures->mvKeysUn;
 
     return Tcw;
 }
 
 // Pipelined Version
-Sophus::SE3f System::TrackMonocular(const ResultQueueItem& Input){
+Sophus::SE3f System::TrackMonocular(const ResultQueueItem& Input, PrecomputedBoW* pBoW){
 
     {
             unique_lock<mutex> lock(mMutexReset);
@@ -492,10 +495,7 @@ Sophus::SE3f System::TrackMonocular(const ResultQueueItem& Input){
                 mpLocalMapper->RequestStop();
     
                 // Wait until Local Mapping has effectively stopped
-                while(!mpLocalMapper->isStopped())
-                {
-                    usleep(1000);
-                }
+                mpLocalMapper->WaitUntilStopped();
     
                 mpTracker->InformOnlyTracking(true);
                 mbActivateLocalizationMode = false;
@@ -525,12 +525,12 @@ Sophus::SE3f System::TrackMonocular(const ResultQueueItem& Input){
             }
         }
     
-        Sophus::SE3f Tcw = mpTracker->GrabImageMonocular(Input);
+        Sophus::SE3f Tcw = mpTracker->GrabImageMonocular(Input, pBoW);
     
         unique_lock<mutex> lock2(mMutexState);
         mTrackingState = mpTracker->mState;
         mTrackedMapPoints = mpTracker->mCurrentFrame.mvpMapPoints;
-        mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+        mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mpFeatures->mvKeysUn;
     
         return Tcw;
     
@@ -619,6 +619,21 @@ void System::Shutdown()
     mpTracker->PrintTimeStats();
 #endif
 
+    Tracer::StopReporter();
+    if(Tracer::IsEnabled())
+    {
+        cout << endl << "Span durations (last " << Tracer::BUFFER_CAPACITY << " spans of each thread):" << endl;
+        Tracer::PrintSummary(cout);
+
+        if(settings_ && !settings_->traceFile().empty())
+        {
+            if(Tracer::WriteChromeTrace(settings_->traceFile()))
+                cout << "Trace saved to " << settings_->traceFile() << endl;
+            else
+                cerr << "Cannot write the trace to " << settings_->traceFile() << endl;
+        }
+    }
+
 
 }
 
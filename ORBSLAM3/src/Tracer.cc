@@ -0,0 +1,373 @@
+/**
+* This file is part of ORB-SLAM3
+*
+* Tracer.cc - Low overhead tracing of scoped spans across the threads of the system
+*/
+
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <unistd.h>
+
+namespace ORB_SLAM3
+{
+
+std::atomic<bool> Tracer::sbEnabled(true);
+
+namespace
+{
+    const size_t BUFFER_MASK = Tracer::BUFFER_CAPACITY - 1;
+    static_assert((Tracer::BUFFER_CAPACITY & BUFFER_MASK) == 0, "The tracer buffer capacity must be a power of two");
+
+    const std::chrono::steady_clock::time_point TRACE_EPOCH = std::chrono::steady_clock::now();
+
+    struct SpanRecord
+    {
+        const char* name;
+        long id;
+        uint64_t startNs, endNs;
+        int tid;
+    };
+
+    // Ring buffer written by a single thread. The fields are relaxed atomics so concurrent readers are well defined.
+    // The writer first claims an index (mnClaimed), then fills the slot and publishes it (mnPublished); a reader
+    // keeps only the entries copied from slots no writer had claimed again by the end of the copy.
+    struct ThreadBuffer
+    {
+        struct Slot
+        {
+            std::atomic<const char*> name;
+            std::atomic<long> id;
+            std::atomic<uint64_t> startNs, endNs;
+        };
+
+        explicit ThreadBuffer(int tid) : mnTid(tid), mvSlots(new Slot[Tracer::BUFFER_CAPACITY]), mnClaimed(0), mnPublished(0) {}
+
+        void Push(const char* name, long id, uint64_t startNs, uint64_t endNs)
+        {
+            const uint64_t h = mnPublished.load(std::memory_order_relaxed);
+            mnClaimed.store(h + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            Slot &slot = mvSlots[h & BUFFER_MASK];
+            slot.name.store(name, std::memory_order_relaxed);
+            slot.id.store(id, std::memory_order_relaxed);
+            slot.startNs.store(startNs, std::memory_order_relaxed);
+            slot.endNs.store(endNs, std::memory_order_relaxed);
+
+            mnPublished.store(h + 1, std::memory_order_release);
+        }
+
+        void Copy(std::vector<SpanRecord> &vSpans, uint64_t sinceNs) const
+        {
+            const uint64_t published = mnPublished.load(std::memory_order_acquire);
+            const uint64_t first = published > Tracer::BUFFER_CAPACITY ? published - Tracer::BUFFER_CAPACITY : 0;
+
+            const size_t nBefore = vSpans.size();
+            for(uint64_t i=first; i<published; i++)
+            {
+                const Slot &slot = mvSlots[i & BUFFER_MASK];
+                SpanRecord span;
+                span.name = slot.name.load(std::memory_order_relaxed);
+                span.id = slot.id.load(std::memory_order_relaxed);
+                span.startNs = slot.startNs.load(std::memory_order_relaxed);
+                span.endNs = slot.endNs.load(std::memory_order_relaxed);
+                span.tid = mnTid;
+                vSpans.push_back(span);
+            }
+
+            // Entries below claimed - capacity may have been overwritten while copying
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint64_t claimed = mnClaimed.load(std::memory_order_relaxed);
+            const uint64_t valid = claimed > Tracer::BUFFER_CAPACITY ? claimed - Tracer::BUFFER_CAPACITY : 0;
+            const size_t nStale = valid > first ? std::min<uint64_t>(valid - first, published - first) : 0;
+            vSpans.erase(vSpans.begin() + nBefore, vSpans.begin() + nBefore + nStale);
+
+            vSpans.erase(std::remove_if(vSpans.begin() + nBefore, vSpans.end(),
+                                        [sinceNs](const SpanRecord &span) { return span.endNs < sinceNs; }),
+                         vSpans.end());
+        }
+
+        const int mnTid;
+        std::string mName;   // guarded by the registry mutex
+        std::unique_ptr<Slot[]> mvSlots;
+        std::atomic<uint64_t> mnClaimed, mnPublished;
+    };
+
+    // Buffers of every thread that recorded a span. Buffers of finished threads are kept, so their spans can
+    // still be exported, and handed to the next new thread, so short lived threads do not accumulate buffers.
+    struct Registry
+    {
+        std::mutex mMutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> mvpBuffers;
+        std::vector<std::shared_ptr<ThreadBuffer>> mvpRetired;
+
+        static Registry& Get()
+        {
+            static Registry* pRegistry = new Registry();  // never destroyed, threads may record until exit
+            return *pRegistry;
+        }
+
+        std::shared_ptr<ThreadBuffer> Acquire()
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            if(!mvpRetired.empty())
+            {
+                std::shared_ptr<ThreadBuffer> pBuffer = mvpRetired.back();
+                mvpRetired.pop_back();
+                return pBuffer;
+            }
+            mvpBuffers.push_back(std::make_shared<ThreadBuffer>(static_cast<int>(mvpBuffers.size())));
+            mvpBuffers.back()->mName = "Thread " + std::to_string(mvpBuffers.back()->mnTid);
+            return mvpBuffers.back();
+        }
+
+        void Retire(const std::shared_ptr<ThreadBuffer> &pBuffer)
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mvpRetired.push_back(pBuffer);
+        }
+    };
+
+    struct LocalBuffer
+    {
+        std::shared_ptr<ThreadBuffer> mpBuffer;
+
+        ThreadBuffer& Get()
+        {
+            if(!mpBuffer)
+                mpBuffer = Registry::Get().Acquire();
+            return *mpBuffer;
+        }
+
+        ~LocalBuffer()
+        {
+            if(mpBuffer)
+                Registry::Get().Retire(mpBuffer);
+        }
+    };
+
+    thread_local LocalBuffer tlBuffer;
+
+    // Spans of every buffer, with the thread names by tid
+    void CollectSpans(std::vector<SpanRecord> &vSpans, std::vector<std::string> &vThreadNames, uint64_t sinceNs)
+    {
+        Registry &registry = Registry::Get();
+        std::vector<std::shared_ptr<ThreadBuffer>> vpBuffers;
+        {
+            std::unique_lock<std::mutex> lock(registry.mMutex);
+            vpBuffers = registry.mvpBuffers;
+            vThreadNames.resize(vpBuffers.size());
+            for(const std::shared_ptr<ThreadBuffer> &pBuffer : vpBuffers)
+                vThreadNames[pBuffer->mnTid] = pBuffer->mName;
+        }
+
+        for(const std::shared_ptr<ThreadBuffer> &pBuffer : vpBuffers)
+            pBuffer->Copy(vSpans, sinceNs);
+    }
+
+    // Nearest-rank percentile of sorted durations
+    double Percentile(const std::vector<double> &vSorted, double p)
+    {
+        const size_t rank = static_cast<size_t>(std::ceil(p * vSorted.size()));
+        return vSorted[std::min(std::max<size_t>(rank, 1), vSorted.size()) - 1];
+    }
+
+    void WriteJsonString(std::ostream &out, const std::string &s)
+    {
+        out << '"';
+        for(const char c : s)
+        {
+            if(c == '"' || c == '\\')
+                out << '\\' << c;
+            else if(static_cast<unsigned char>(c) < 0x20)
+                out << ' ';
+            else
+                out << c;
+        }
+        out << '"';
+    }
+
+    // Periodic summary thread
+    struct Reporter
+    {
+        std::mutex mMutex;
+        std::condition_variable mCond;
+        std::thread mThread;
+        bool mbStop = false;
+    };
+
+    Reporter& GetReporter()
+    {
+        static Reporter reporter;
+        return reporter;
+    }
+}
+
+void Tracer::SetThreadName(const std::string &name)
+{
+    ThreadBuffer &buffer = tlBuffer.Get();
+    Registry &registry = Registry::Get();
+    std::unique_lock<std::mutex> lock(registry.mMutex);
+    buffer.mName = name;
+}
+
+uint64_t Tracer::NowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - TRACE_EPOCH).count();
+}
+
+void Tracer::Record(const char* name, long id, uint64_t startNs, uint64_t endNs)
+{
+    tlBuffer.Get().Push(name, id, startNs, endNs);
+}
+
+std::vector<Tracer::SpanStats> Tracer::Summarize(uint64_t sinceNs)
+{
+    std::vector<SpanRecord> vSpans;
+    std::vector<std::string> vThreadNames;
+    CollectSpans(vSpans, vThreadNames, sinceNs);
+
+    // The same literal may have a different address in each library, so spans are grouped by content
+    std::map<std::string, std::vector<double>> mDurations;
+    for(const SpanRecord &span : vSpans)
+        mDurations[span.name].push_back((span.endNs - span.startNs) * 1e-6);
+
+    std::vector<SpanStats> vStats;
+    vStats.reserve(mDurations.size());
+    for(std::pair<const std::string, std::vector<double>> &entry : mDurations)
+    {
+        std::vector<double> &vDurations = entry.second;
+        std::sort(vDurations.begin(), vDurations.end());
+
+        SpanStats stats;
+        stats.name = entry.first;
+        stats.count = vDurations.size();
+        double sum = 0.0;
+        for(const double d : vDurations)
+            sum += d;
+        stats.meanMs = sum / vDurations.size();
+        stats.p50Ms = Percentile(vDurations, 0.5);
+        stats.p90Ms = Percentile(vDurations, 0.9);
+        stats.p99Ms = Percentile(vDurations, 0.99);
+        stats.maxMs = vDurations.back();
+        vStats.push_back(stats);
+    }
+
+    return vStats;
+}
+
+void Tracer::PrintSummary(std::ostream &out, uint64_t sinceNs)
+{
+    const std::vector<SpanStats> vStats = Summarize(sinceNs);
+    if(vStats.empty())
+        return;
+
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+
+    out << std::left << std::setw(28) << "Span" << std::right << std::setw(8) << "count"
+        << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90"
+        << std::setw(10) << "p99" << std::setw(10) << "max" << "  (ms)" << std::endl;
+    out << std::fixed << std::setprecision(3);
+    for(const SpanStats &stats : vStats)
+    {
+        out << std::left << std::setw(28) << stats.name << std::right << std::setw(8) << stats.count
+            << std::setw(10) << stats.meanMs << std::setw(10) << stats.p50Ms << std::setw(10) << stats.p90Ms
+            << std::setw(10) << stats.p99Ms << std::setw(10) << stats.maxMs << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool Tracer::WriteChromeTrace(const std::string &filename)
+{
+    std::vector<SpanRecord> vSpans;
+    std::vector<std::string> vThreadNames;
+    CollectSpans(vSpans, vThreadNames, 0);
+
+    std::ofstream f(filename);
+    if(!f.is_open())
+        return false;
+
+    const int pid = static_cast<int>(getpid());
+    f << std::fixed << std::setprecision(3);
+    f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+
+    bool bFirst = true;
+    for(size_t tid=0; tid<vThreadNames.size(); tid++)
+    {
+        f << (bFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << tid
+          << ",\"args\":{\"name\":";
+        WriteJsonString(f, vThreadNames[tid]);
+        f << "}}";
+        bFirst = false;
+    }
+
+    for(const SpanRecord &span : vSpans)
+    {
+        f << (bFirst ? "" : ",\n") << "{\"name\":";
+        WriteJsonString(f, span.name);
+        f << ",\"cat\":\"orbslam3\",\"ph\":\"X\",\"pid\":" << pid << ",\"tid\":" << span.tid
+          << ",\"ts\":" << span.startNs * 1e-3 << ",\"dur\":" << (span.endNs - span.startNs) * 1e-3;
+        if(span.id >= 0)
+            f << ",\"args\":{\"id\":" << span.id << "}";
+        f << "}";
+        bFirst = false;
+    }
+
+    f << "\n]}" << std::endl;
+    return f.good();
+}
+
+void Tracer::StartReporter(double periodSeconds)
+{
+    if(periodSeconds <= 0.0)
+        return;
+
+    Reporter &reporter = GetReporter();
+    std::unique_lock<std::mutex> lock(reporter.mMutex);
+    if(reporter.mThread.joinable())
+        return;
+
+    reporter.mbStop = false;
+    const std::chrono::duration<double> period(periodSeconds);
+    reporter.mThread = std::thread([&reporter, period]() {
+        std::unique_lock<std::mutex> lock(reporter.mMutex);
+        while(!reporter.mCond.wait_for(lock, period, [&reporter]() { return reporter.mbStop; }))
+        {
+            const uint64_t windowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+            const uint64_t now = NowNs();
+            std::cout << "[Tracer] Last " << period.count() << " s:" << std::endl;
+            PrintSummary(std::cout, now > windowNs ? now - windowNs : 0);
+        }
+    });
+}
+
+void Tracer::StopReporter()
+{
+    Reporter &reporter = GetReporter();
+    std::thread thread;
+    {
+        std::unique_lock<std::mutex> lock(reporter.mMutex);
+        reporter.mbStop = true;
+        thread = std::move(reporter.mThread);
+    }
+    reporter.mCond.notify_all();
+    if(thread.joinable())
+        thread.join();
+}
+
+} // namespace ORB_SLAM3
@@ -27,9 +27,13 @@
 #include "KannalaBrandt8.h"
 #include "MLPnPsolver.h"
 #include "GeometricTools.h"
+#include "Tracer.h"
 
 #include <iostream>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <mutex>
 #include <chrono>
 
@@ -42,7 +46,7 @@ namespace ORB_SLAM3
                                                                                                                                                                                                                                                   mbOnlyTracking(false), mbMapUpdated(false), mbVO(false), mpORBVocabulary(pVoc), mpKeyFrameDB(pKFDB),
                                                                                                                                                                                                                                                   mbReadyToInitializate(false), mpSystem(pSys), mpViewer(NULL), bStepByStep(false),
                                                                                                                                                                                                                                                   mpFrameDrawer(pFrameDrawer), mpMapDrawer(pMapDrawer), mpAtlas(pAtlas), mnLastRelocFrameId(0), time_recently_lost(5.0),
-                                                                                                                                                                                                                                                  mnInitialFrameId(0), mbCreatedMap(false), mnFirstFrameId(0), mpCamera2(nullptr), mpLastKeyFrame(static_cast<KeyFrame *>(NULL))
+                                                                                                                                                                                                                                                  mnInitialFrameId(0), mbCreatedMap(false), mnFirstFrameId(0), mpCamera2(nullptr), mpLastKeyFrame(static_cast<KeyFrame *>(NULL)), mnLocalMapEpoch(0)
     {
         this->strSettingPath = strSettingPath;
         // Load camera parameters from settings file
@@ -92,6 +96,18 @@ namespace ORB_SLAM3
             }
         }
 
+        if (sensor == System::STEREO || sensor == System::IMU_STEREO)
+        {
+            int leftCpu = settings ? settings->extractorCpuLeft() : -1;
+            int rightCpu = settings ? settings->extractorCpuRight() : -1;
+            mpStereoWorkers.reset(new StereoExtractorWorkers(leftCpu, rightCpu));
+        }
+
+        // The calling thread takes part in the work, so the pool has one thread less
+        const int nTrackingThreads = settings ? settings->trackingThreads() : 1;
+        if (nTrackingThreads > 1)
+            mpTrackingPool.reset(new ThreadPool(nTrackingThreads - 1));
+
         initID = 0;
         lastID = 0;
         mbInitWith3KFs = false;
@@ -127,6 +143,8 @@ namespace ORB_SLAM3
         vdNewKF_ms.clear();
         vdTrackTotal_ms.clear();
 #endif
+
+        mnQuiescenceId = MapPoint::Reclamation().Register();
     }
 
 #ifdef REGISTER_TIMES
@@ -555,6 +573,7 @@ namespace ORB_SLAM3
     Tracking::~Tracking()
     {
         // f_track_stats.close();
+        MapPoint::Reclamation().Unregister(mnQuiescenceId);
     }
 
     void Tracking::newParameterLoader(Settings *settings)
@@ -597,6 +616,24 @@ namespace ORB_SLAM3
             mpFrameDrawer->both = true;
         }
 
+        // Keypoint undistortion lookups, shared by every Frame and KeyFrame of each camera
+        if (mpCamera->GetType() == GeometricCamera::CAM_PINHOLE && settings->needToUndistort() &&
+            (mDistCoef.total() == 4 || mDistCoef.total() == 5))
+        {
+            vector<float> vK = {mpCamera->getParameter(0), mpCamera->getParameter(1), mpCamera->getParameter(2), mpCamera->getParameter(3)};
+            vector<float> vDist(mDistCoef.begin<float>(), mDistCoef.end<float>());
+            mpCamera->SetUndistortionMap(make_shared<UndistortionMap>(UndistortionMap::RADIAL_TANGENTIAL, vK, vDist, settings->newImSize()));
+        }
+        for (GeometricCamera *pCam : {mpCamera, mpCamera2})
+        {
+            if (pCam && pCam->GetType() == GeometricCamera::CAM_FISHEYE)
+            {
+                vector<float> vK = {pCam->getParameter(0), pCam->getParameter(1), pCam->getParameter(2), pCam->getParameter(3)};
+                vector<float> vDist = {pCam->getParameter(4), pCam->getParameter(5), pCam->getParameter(6), pCam->getParameter(7)};
+                pCam->SetUndistortionMap(make_shared<UndistortionMap>(UndistortionMap::KANNALA_BRANDT, vK, vDist, settings->newImSize()));
+            }
+        }
+
         if (mSensor == System::STEREO || mSensor == System::RGBD || mSensor == System::IMU_STEREO || mSensor == System::IMU_RGBD)
         {
             mbf = settings->bf();
@@ -622,6 +659,7 @@ namespace ORB_SLAM3
         int fIniThFAST = settings->initThFAST();
         int fMinThFAST = settings->minThFAST();
         float fScaleFactor = settings->scaleFactor();
+        int nExtractorThreads = settings->extractorThreads();
 
         // Read matcher threshold parameters from the configuration file
         float th_high = settings->thHigh();
@@ -634,15 +672,15 @@ namespace ORB_SLAM3
         // In Tracking::newParameterLoader
         std::string extractorType = settings->featureExtractorType();
         mpORBextractorLeft = CreateFeatureExtractor(nFeatures, fScaleFactor, nLevels,
-                                                    fIniThFAST, fMinThFAST, extractorType);
+                                                    fIniThFAST, fMinThFAST, extractorType, nExtractorThreads);
 
         if (mSensor == System::STEREO || mSensor == System::IMU_STEREO)
             mpORBextractorRight = CreateFeatureExtractor(nFeatures, fScaleFactor, nLevels,
-                                                         fIniThFAST, fMinThFAST, extractorType);
+                                                         fIniThFAST, fMinThFAST, extractorType, nExtractorThreads);
 
         if (mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR)
             mpIniORBextractor = CreateFeatureExtractor(5 * nFeatures, fScaleFactor, nLevels,
-                                                       fIniThFAST, fMinThFAST, extractorType);
+                                                       fIniThFAST, fMinThFAST, extractorType, nExtractorThreads);
 
         std::cout << "- Matcher TH_HIGH: " << th_high << std::endl;
         std::cout << "- Matcher TH_LOW: " << th_low << std::endl;
@@ -1263,6 +1301,7 @@ namespace ORB_SLAM3
     {
         bool b_miss_params = false;
         int nFeatures, nLevels, fIniThFAST, fMinThFAST;
+        int nExtractorThreads = 1;
         float fScaleFactor;
         string extractorType;
 
@@ -1333,6 +1372,12 @@ namespace ORB_SLAM3
                 std::cerr << "*ORBextractor.minThFAST parameter doesn't exist or is not an integer*" << std::endl;
                 b_miss_params = true;
             }
+
+            node = fSettings["ORBextractor.nThreads"];
+            if (!node.empty() && node.isInt())
+            {
+                nExtractorThreads = std::max(node.operator int(), 1);
+            }
         }
         else if (extractorType == "SIFT")
         {
@@ -1388,15 +1433,15 @@ namespace ORB_SLAM3
         }
 
         mpORBextractorLeft = CreateFeatureExtractor(nFeatures, fScaleFactor, nLevels,
-                                                    fIniThFAST, fMinThFAST, extractorType);
+                                                    fIniThFAST, fMinThFAST, extractorType, nExtractorThreads);
 
         if (mSensor == System::STEREO || mSensor == System::IMU_STEREO)
             mpORBextractorRight = CreateFeatureExtractor(nFeatures, fScaleFactor, nLevels,
-                                                         fIniThFAST, fMinThFAST, extractorType);
+                                                         fIniThFAST, fMinThFAST, extractorType, nExtractorThreads);
 
         if (mSensor == System::MONOCULAR || mSensor == System::IMU_MONOCULAR)
             mpIniORBextractor = CreateFeatureExtractor(5 * nFeatures, fScaleFactor, nLevels,
-                                                       fIniThFAST, fMinThFAST, extractorType);
+                                                       fIniThFAST, fMinThFAST, extractorType, nExtractorThreads);
 
         cout << endl
              << "ORB Extractor Parameters: " << endl;
@@ -1597,19 +1642,22 @@ namespace ORB_SLAM3
 
         // cout << "Incoming frame creation" << endl;
 
+        TraceScope traceFrame("Frame");
         if (mSensor == System::STEREO && !mpCamera2)
-            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera);
+            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, static_cast<Frame*>(NULL), IMU::Calib(), mpStereoWorkers.get());
         else if (mSensor == System::STEREO && mpCamera2)
-            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, mpCamera2, mTlr);
+            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, mpCamera2, mTlr, static_cast<Frame*>(NULL), IMU::Calib(), mpStereoWorkers.get());
         else if (mSensor == System::IMU_STEREO && !mpCamera2)
-            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, &mLastFrame, *mpImuCalib);
+            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, &mLastFrame, *mpImuCalib, mpStereoWorkers.get());
         else if (mSensor == System::IMU_STEREO && mpCamera2)
-            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, mpCamera2, mTlr, &mLastFrame, *mpImuCalib);
+            mCurrentFrame = Frame(mImGray, imGrayRight, timestamp, mpORBextractorLeft, mpORBextractorRight, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera, mpCamera2, mTlr, &mLastFrame, *mpImuCalib, mpStereoWorkers.get());
 
         // cout << "Incoming frame ended" << endl;
 
         mCurrentFrame.mNameFile = filename;
         mCurrentFrame.mnDataset = mnNumDataset;
+        traceFrame.SetId(mCurrentFrame.mnId);
+        traceFrame.Stop();
 
 #ifdef REGISTER_TIMES
         vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
@@ -1617,7 +1665,9 @@ namespace ORB_SLAM3
 #endif
 
         // cout << "Tracking start" << endl;
+        TraceScope traceTrack("Track", mCurrentFrame.mnId);
         Track();
+        traceTrack.Stop();
         // cout << "Tracking end" << endl;
 
         return mCurrentFrame.GetPose();
@@ -1646,6 +1696,7 @@ namespace ORB_SLAM3
         if ((fabs(mDepthMapFactor - 1.0f) > 1e-5) || imDepth.type() != CV_32F)
             imDepth.convertTo(imDepth, CV_32F, mDepthMapFactor);
 
+        TraceScope traceFrame("Frame");
         if (mSensor == System::RGBD)
             mCurrentFrame = Frame(mImGray, imDepth, timestamp, mpORBextractorLeft, mpORBVocabulary, mK, mDistCoef, mbf, mThDepth, mpCamera);
         else if (mSensor == System::IMU_RGBD)
@@ -1653,12 +1704,16 @@ namespace ORB_SLAM3
 
         mCurrentFrame.mNameFile = filename;
         mCurrentFrame.mnDataset = mnNumDataset;
+        traceFrame.SetId(mCurrentFrame.mnId);
+        traceFrame.Stop();
 
 #ifdef REGISTER_TIMES
         vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
 #endif
 
+        TraceScope traceTrack("Track", mCurrentFrame.mnId);
         Track();
+        traceTrack.Stop();
 
         return mCurrentFrame.GetPose();
     }
@@ -1684,6 +1739,7 @@ namespace ORB_SLAM3
                 cvtColor(mImGray, mImGray, cv::COLOR_BGRA2GRAY);
         }
 
+        TraceScope traceFrame("Frame");
         if (mSensor == System::MONOCULAR)
         {
             if (mState == NOT_INITIALIZED || mState == NO_IMAGES_YET || (lastID - initID) < mMaxFrames)
@@ -1708,13 +1764,17 @@ namespace ORB_SLAM3
 
         mCurrentFrame.mNameFile = filename;
         mCurrentFrame.mnDataset = mnNumDataset;
+        traceFrame.SetId(mCurrentFrame.mnId);
+        traceFrame.Stop();
 
 #ifdef REGISTER_TIMES
         vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
 #endif
 
         lastID = mCurrentFrame.mnId;
+        TraceScope traceTrack("Track", mCurrentFrame.mnId);
         Track();
+        traceTrack.Stop();
 #ifdef DEBUG_PRINT
         if (std::getenv("DEBUG_GrabImageT") != nullptr)
         {
@@ -1727,7 +1787,7 @@ namespace ORB_SLAM3
     }
 
     // pipelined one
-    Sophus::SE3f Tracking::GrabImageMonocular(const ResultQueueItem &Input)
+    Sophus::SE3f Tracking::GrabImageMonocular(const ResultQueueItem &Input, PrecomputedBoW *pBoW)
     {
 
         // the viewer retrieves the image from mImGray
@@ -1747,21 +1807,26 @@ namespace ORB_SLAM3
                 cvtColor(mImGray, mImGray, cv::COLOR_BGRA2GRAY);
         }
 
+        TraceScope traceFrame("Frame");
         // Only for monocular
-        mCurrentFrame = Frame(Input, mpORBextractorLeft, mpORBVocabulary, mpCamera, mDistCoef, mbf, mThDepth);
+        mCurrentFrame = Frame(Input, mpORBextractorLeft, mpORBVocabulary, mpCamera, mDistCoef, mbf, mThDepth, static_cast<Frame *>(NULL), IMU::Calib(), pBoW);
 
         if (mState == NO_IMAGES_YET)
             t0 = Input.timestamp;
 
         mCurrentFrame.mNameFile = Input.filename;
         mCurrentFrame.mnDataset = mnNumDataset;
+        traceFrame.SetId(mCurrentFrame.mnId);
+        traceFrame.Stop();
 
 #ifdef REGISTER_TIMES
         vdORBExtract_ms.push_back(mCurrentFrame.mTimeORB_Ext);
 #endif
 
         lastID = mCurrentFrame.mnId;
+        TraceScope traceTrack("Track", mCurrentFrame.mnId);
         Track();
+        traceTrack.Stop();
 #ifdef DEBUG_PRINT
         if (std::getenv("DEBUG_GrabImageT") != nullptr)
         {
@@ -1954,20 +2019,21 @@ namespace ORB_SLAM3
 
     FeatureExtractor *Tracking::CreateFeatureExtractor(
         int nFeatures, float scaleFactor, int nLevels,
-        int iniThFAST, int minThFAST, const std::string &type)
+        int iniThFAST, int minThFAST, const std::string &type, int nThreads)
     {
         // Set the global feature extractor type
         GlobalFeatureExtractorInfo::SetFeatureExtractorType(type);
 
+        FeatureExtractor *pExtractor = nullptr;
         if (type == "ORB" || type.empty())
         {
-            std::cout << "Feature extractor type: ORB | nFeatures: " << nFeatures << std::endl;
-            return new ORBextractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
+            std::cout << "Feature extractor type: ORB | nFeatures: " << nFeatures << " | threads: " << nThreads << std::endl;
+            pExtractor = new ORBextractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST, nThreads);
         }
         else if (type == "SIFT")
         {
             std::cout << "Feature extractor type: SIFT | nFeatures: " << nFeatures << std::endl;
-            return new SIFTextractor(nFeatures);
+            pExtractor = new SIFTextractor(nFeatures);
         }
         else if (type == "SP DPU")
         {
@@ -1982,13 +2048,19 @@ namespace ORB_SLAM3
             // throw std::runtime_error("DUMMY extractor not implemented");
             std::cout << "Feature extractor not implemented using ORB" << std::endl;
             // return new ORBextractor(nFeatures, scaleFactor, nLevels, iniThFAST, minThFAST);
-            return new SIFTextractor(nFeatures);
+            pExtractor = new SIFTextractor(nFeatures);
         }
         else
         {
             throw std::runtime_error("Unknown feature extractor type: " + type);
             return nullptr;
         }
+
+        // Resolve the descriptor metric once so the matchers never query the extractor type
+        ORBmatcher::SetDescriptorMetric(DescriptorMetric::FromExtractor(pExtractor, type));
+        std::cout << "- Descriptor metric: " << ORBmatcher::GetDescriptorMetric().ToString() << std::endl;
+
+        return pExtractor;
     }
 
     void Tracking::Track()
@@ -2002,6 +2074,23 @@ namespace ORB_SLAM3
             mbStep = false;
         }
 
+        // Between frames Tracking only keeps map points in the last frame and the local map; drop the ones that
+        // turned bad so they can be reclaimed
+        MapPoint::Reclamation().Quiesce(mnQuiescenceId, [this]() {
+            for (MapPoint *&pMP : mLastFrame.mvpMapPoints)
+            {
+                if (pMP && pMP->isBad())
+                {
+                    MapPoint *pRep = pMP->GetReplaced();
+                    pMP = (pRep && !pRep->isBad()) ? pRep : static_cast<MapPoint *>(NULL);
+                }
+            }
+            mvpLocalMapPoints.erase(remove_if(mvpLocalMapPoints.begin(), mvpLocalMapPoints.end(),
+                                              [](MapPoint *pMP) { return pMP->isBad(); }),
+                                    mvpLocalMapPoints.end());
+            mvpLocalMapMatches.clear();
+        });
+
         if (mpLocalMapper->mbBadImu)
         {
             cout << "TRACK: Reset map because local mapper set the bad imu flag " << endl;
@@ -2180,6 +2269,7 @@ namespace ORB_SLAM3
 #ifdef REGISTER_TIMES
             std::chrono::steady_clock::time_point time_StartPosePred = std::chrono::steady_clock::now();
 #endif
+            TraceScope tracePosePred("PosePrediction", mCurrentFrame.mnId);
 
             // Initial camera pose estimation using motion model or relocalization (if tracking is lost)
             // mbOnlyTracking is false means normal SLAM mode (localization + map update), mbOnlyTracking is true means localization-only mode
@@ -2468,6 +2558,7 @@ namespace ORB_SLAM3
             // mpReferenceKF is first the reference keyframe from previous moment, if current is a new keyframe it becomes current keyframe, if not a new keyframe it's first previous frame's reference keyframe, then redetermined after updating local keyframes
             if (!mCurrentFrame.mpReferenceKF)
                 mCurrentFrame.mpReferenceKF = mpReferenceKF;
+            tracePosePred.Stop();
 
 #ifdef REGISTER_TIMES
             std::chrono::steady_clock::time_point time_EndPosePred = std::chrono::steady_clock::now();
@@ -2835,7 +2926,7 @@ void Tracking::StereoInitialization()
         if(!mpCamera2){
             for(int i=0; i<mCurrentFrame.N;i++)
             {
-                float z = mCurrentFrame.mvDepth[i];
+                float z = mCurrentFrame.mpFeatures->mvDepth[i];
                 if(z>0)
                 {
                     Eigen::Vector3f x3D;
@@ -2852,9 +2943,9 @@ void Tracking::StereoInitialization()
             }
         } else{
             for(int i = 0; i < mCurrentFrame.Nleft; i++){
-                int rightIndex = mCurrentFrame.mvLeftToRightMatch[i];
+                int rightIndex = mCurrentFrame.mpFeatures->mvLeftToRightMatch[i];
                 if(rightIndex != -1){
-                    Eigen::Vector3f x3D = mCurrentFrame.mvStereo3Dpoints[i];
+                    Eigen::Vector3f x3D = mCurrentFrame.mpFeatures->mvStereo3Dpoints[i];
 
                     MapPoint* pNewMP = new MapPoint(x3D, pKFini, mpAtlas->GetCurrentMap());
 
@@ -2908,7 +2999,7 @@ void Tracking::MonocularInitialization()
     if(std::getenv("DEBUG_MonocularInitializationT") != nullptr )
     {
     std::cout << "\n[DEBUG][MonoInit] ENTER  FrameID=" << mCurrentFrame.mnId
-            << "  keypoints=" << mCurrentFrame.mvKeys.size()
+            << "  keypoints=" << mCurrentFrame.mpFeatures->mvKeys.size()
             << "  readyFlag=" << std::boolalpha << mbReadyToInitializate
             << std::noboolalpha << std::endl;
     }
@@ -2916,14 +3007,14 @@ void Tracking::MonocularInitialization()
     if(!mbReadyToInitializate)
     {
         // Set Reference Frame
-        if(mCurrentFrame.mvKeys.size()>100)
+        if(mCurrentFrame.mpFeatures->mvKeys.size()>100)
         {
 
             mInitialFrame = Frame(mCurrentFrame);
             mLastFrame = Frame(mCurrentFrame);
-            mvbPrevMatched.resize(mCurrentFrame.mvKeysUn.size());
-            for(size_t i=0; i<mCurrentFrame.mvKeysUn.size(); i++)
-                mvbPrevMatched[i]=mCurrentFrame.mvKeysUn[i].pt;
+            mvbPrevMatched.resize(mCurrentFrame.mpFeatures->mvKeysUn.size());
+            for(size_t i=0; i<mCurrentFrame.mpFeatures->mvKeysUn.size(); i++)
+                mvbPrevMatched[i]=mCurrentFrame.mpFeatures->mvKeysUn[i].pt;
 
             fill(mvIniMatches.begin(),mvIniMatches.end(),-1);
 
@@ -2955,7 +3046,7 @@ void Tracking::MonocularInitialization()
     }
     else
     {
-        if (((int)mCurrentFrame.mvKeys.size()<=100)||((mSensor == System::IMU_MONOCULAR)&&(mLastFrame.mTimeStamp-mInitialFrame.mTimeStamp>1.0)))
+        if (((int)mCurrentFrame.mpFeatures->mvKeys.size()<=100)||((mSensor == System::IMU_MONOCULAR)&&(mLastFrame.mTimeStamp-mInitialFrame.mTimeStamp>1.0)))
         {
             mbReadyToInitializate = false;
             /* ---------- DEBUG F: end of MonocularInitialization ---------- */
@@ -2977,7 +3068,7 @@ void Tracking::MonocularInitialization()
         if(std::getenv("DEBUG_MonocularInitializationT") != nullptr )
         {
         std::cout << "[DEBUG][MonoInit] invoking SearchForInitialization  "
-                << "CurrentKFkeys=" << mCurrentFrame.mvKeysUn.size() << std::endl;
+                << "CurrentKFkeys=" << mCurrentFrame.mpFeatures->mvKeysUn.size() << std::endl;
         }
 #endif
         // Find correspondences
@@ -3005,15 +3096,15 @@ void Tracking::MonocularInitialization()
                     cv::cvtColor(currImg, currImg, cv::COLOR_GRAY2BGR);
                 
                 // MatchVisualizer::ShowMatches(
-                //     initImg, mInitialFrame.mvKeysUn, 
-                //     currImg, mCurrentFrame.mvKeysUn, 
+                //     initImg, mInitialFrame.mpFeatures->mvKeysUn, 
+                //     currImg, mCurrentFrame.mpFeatures->mvKeysUn, 
                 //     mvIniMatches, "MonoInit Matches", true); 
 
                 MatchVisualizer::SaveMatchImage(
                     initImg,
-                    mInitialFrame.mvKeysUn,
+                    mInitialFrame.mpFeatures->mvKeysUn,
                     currImg,
-                    mCurrentFrame.mvKeysUn,
+                    mCurrentFrame.mpFeatures->mvKeysUn,
                     mvIniMatches,
                         "/mnt/sda1/FYP_2024/Ruchith/FYP_SLAM/_results/InitMatches_" + std::to_string(mCurrentFrame.mnId) + ".jpg"
                     );
@@ -3051,8 +3142,8 @@ void Tracking::MonocularInitialization()
         if(std::getenv("DEBUG_MonocularInitializationShowMatchedCoords") != nullptr )
         {
             std::cout << "[DEBUG][MonoInit] nmatches=" << nmatches
-                    << "  mInitialFrame.mvKeysUn.size()=" << mInitialFrame.mvKeysUn.size()
-                    << "  mCurrentFrame.mvKeysUn.size()=" << mCurrentFrame.mvKeysUn.size()
+                    << "  mInitialFrame.mpFeatures->mvKeysUn.size()=" << mInitialFrame.mpFeatures->mvKeysUn.size()
+                    << "  mCurrentFrame.mpFeatures->mvKeysUn.size()=" << mCurrentFrame.mpFeatures->mvKeysUn.size()
                     << std::endl;
 
             int count = 0;
@@ -3064,15 +3155,15 @@ void Tracking::MonocularInitialization()
                         // Print every 10 matches
                         if(count % 10 == 0){
                             std::cout << "[DEBUG][MonoInit] idx: " << i << " = " << mvIniMatches[i]
-                                    << " InFPt: " << mInitialFrame.mvKeysUn[i].pt
-                                    << " |  CurFPt: " << mCurrentFrame.mvKeysUn[mvIniMatches[i]].pt
+                                    << " InFPt: " << mInitialFrame.mpFeatures->mvKeysUn[i].pt
+                                    << " |  CurFPt: " << mCurrentFrame.mpFeatures->mvKeysUn[mvIniMatches[i]].pt
                                     << std::endl;
                         }
                     }
             }
         }
 #endif
-        bool success = mpCamera->ReconstructWithTwoViews(mInitialFrame.mvKeysUn,mCurrentFrame.mvKeysUn,mvIniMatches,Tcw,mvIniP3D,vbTriangulated);
+        bool success = mpCamera->ReconstructWithTwoViews(mInitialFrame.mpFeatures->mvKeysUn,mCurrentFrame.mpFeatures->mvKeysUn,mvIniMatches,Tcw,mvIniP3D,vbTriangulated);
 
 #ifdef DEBUG_PRINT
         if(std::getenv("DEBUG_MonocularInitializationT") != nullptr )
@@ -3383,7 +3474,7 @@ void Tracking::UpdateLastFrame()
     vDepthIdx.reserve(Nfeat);
     for(int i=0; i<Nfeat;i++)
     {
-        float z = mLastFrame.mvDepth[i];
+        float z = mLastFrame.mpFeatures->mvDepth[i];
         if(z>0)
         {
             vDepthIdx.push_back(make_pair(z,i));
@@ -3612,6 +3703,7 @@ bool Tracking::TrackWithMotionModel()
 
     bool Tracking::TrackLocalMap()
     {
+        TraceScope trace("TrackLocalMap", mCurrentFrame.mnId);
 #ifdef DEBUG_PRINT
         if(std::getenv("DEBUG_TrackLM") != nullptr)
         {
@@ -3894,7 +3986,7 @@ bool Tracking::TrackWithMotionModel()
             for (int i = 0; i < N; i++)
             {
                 // Only consider points with valid depth in a certain range
-                if (mCurrentFrame.mvDepth[i] > 0 && mCurrentFrame.mvDepth[i] < mThDepth)
+                if (mCurrentFrame.mpFeatures->mvDepth[i] > 0 && mCurrentFrame.mpFeatures->mvDepth[i] < mThDepth)
                 {
                     if (mCurrentFrame.mvpMapPoints[i] && !mCurrentFrame.mvbOutlier[i])
                         nTrackedClose++;
@@ -4128,6 +4220,7 @@ bool Tracking::TrackWithMotionModel()
 
     void Tracking::CreateNewKeyFrame()
     {
+        TraceScope trace("CreateNewKeyFrame", mCurrentFrame.mnId);
         if (mpLocalMapper->IsInitializing() && !mpAtlas->isImuInitialized())
             return;
 
@@ -4181,7 +4274,7 @@ bool Tracking::TrackWithMotionModel()
             vDepthIdx.reserve(mCurrentFrame.N);
             for (int i = 0; i < N; i++)
             {
-                float z = mCurrentFrame.mvDepth[i];
+                float z = mCurrentFrame.mpFeatures->mvDepth[i];
                 if (z > 0)
                 {
                     vDepthIdx.push_back(make_pair(z, i));
@@ -4226,11 +4319,11 @@ bool Tracking::TrackWithMotionModel()
 
                         // Check if it is a stereo observation in order to not
                         // duplicate mappoints
-                        if (mCurrentFrame.Nleft != -1 && mCurrentFrame.mvLeftToRightMatch[i] >= 0)
+                        if (mCurrentFrame.Nleft != -1 && mCurrentFrame.mpFeatures->mvLeftToRightMatch[i] >= 0)
                         {
-                            mCurrentFrame.mvpMapPoints[mCurrentFrame.Nleft + mCurrentFrame.mvLeftToRightMatch[i]] = pNewMP;
-                            pNewMP->AddObservation(pKF, mCurrentFrame.Nleft + mCurrentFrame.mvLeftToRightMatch[i]);
-                            pKF->AddMapPoint(pNewMP, mCurrentFrame.Nleft + mCurrentFrame.mvLeftToRightMatch[i]);
+                            mCurrentFrame.mvpMapPoints[mCurrentFrame.Nleft + mCurrentFrame.mpFeatures->mvLeftToRightMatch[i]] = pNewMP;
+                            pNewMP->AddObservation(pKF, mCurrentFrame.Nleft + mCurrentFrame.mpFeatures->mvLeftToRightMatch[i]);
+                            pKF->AddMapPoint(pNewMP, mCurrentFrame.Nleft + mCurrentFrame.mpFeatures->mvLeftToRightMatch[i]);
                         }
 
                         pKF->AddMapPoint(pNewMP, i);
@@ -4294,26 +4387,8 @@ bool Tracking::TrackWithMotionModel()
         int nToMatch = 0;
 
 
-        // Project points in frame and check its visibility
-        for (vector<MapPoint *>::iterator vit = mvpLocalMapPoints.begin(), vend = mvpLocalMapPoints.end(); vit != vend; vit++)
-        {
-            MapPoint *pMP = *vit;
-
-            if (pMP->mnLastFrameSeen == mCurrentFrame.mnId)
-                continue;
-            if (pMP->isBad())
-                continue;
-            // Project (this fills MapPoint variables for matching)
-            if (mCurrentFrame.isInFrustum(pMP, 0.5))
-            {
-                pMP->IncreaseVisible();
-                nToMatch++;
-            }
-            if (pMP->mbTrackInView)
-            {
-                mCurrentFrame.mmProjectPoints[pMP->mnId] = cv::Point2f(pMP->mTrackProjX, pMP->mTrackProjY);
-            }
-        }
+        // Project points in frame and check its visibility (this fills MapPoint variables for matching)
+        nToMatch = mFrustumCuller.Run(mCurrentFrame, mvpLocalMapPoints, 0.5, mpTrackingPool.get());
 #ifdef DEBUG_PRINT
         if(std::getenv("DEBUG_TrackLM") != nullptr)
         {
@@ -4397,7 +4472,8 @@ bool Tracking::TrackWithMotionModel()
         for (vector<KeyFrame *>::const_reverse_iterator itKF = mvpLocalKeyFrames.rbegin(), itEndKF = mvpLocalKeyFrames.rend(); itKF != itEndKF; ++itKF)
         {
             KeyFrame *pKF = *itKF;
-            const vector<MapPoint *> vpMPs = pKF->GetMapPointMatches();
+            vector<MapPoint *> &vpMPs = mvpLocalMapMatches;
+            pKF->GetMapPointMatches(vpMPs);
 
             for (vector<MapPoint *>::const_iterator itMP = vpMPs.begin(), itEndMP = vpMPs.end(); itMP != itEndMP; itMP++)
             {
@@ -4419,8 +4495,22 @@ bool Tracking::TrackWithMotionModel()
 
     void Tracking::UpdateLocalKeyFrames()
     {
-        // Each map point vote for the keyframes in which it has been observed
-        map<KeyFrame *, int> keyframeCounter;
+        // Each map point vote for the keyframes in which it has been observed.
+        // Votes are kept in the keyframes themselves, stamped with the epoch of this call.
+        const long unsigned int nEpoch = ++mnLocalMapEpoch;
+        vector<KeyFrame *> &vpVoted = mvpLocalMapVoted;
+        vpVoted.clear();
+        auto vote = [nEpoch, &vpVoted](KeyFrame *pKF, const tuple<int, int> &)
+        {
+            if (pKF->mnLocalMapEpoch != nEpoch)
+            {
+                pKF->mnLocalMapEpoch = nEpoch;
+                pKF->mnLocalMapVotes = 0;
+                vpVoted.push_back(pKF);
+            }
+            pKF->mnLocalMapVotes++;
+        };
+
         if (!mpAtlas->isImuInitialized() || (mCurrentFrame.mnId < mnLastRelocFrameId + 2))
         {
             for (int i = 0; i < mCurrentFrame.N; i++)
@@ -4429,11 +4519,7 @@ bool Tracking::TrackWithMotionModel()
                 if (pMP)
                 {
                     if (!pMP->isBad())
-                    {
-                        const map<KeyFrame *, tuple<int, int>> observations = pMP->GetObservations();
-                        for (map<KeyFrame *, tuple<int, int>>::const_iterator it = observations.begin(), itend = observations.end(); it != itend; it++)
-                            keyframeCounter[it->first]++;
-                    }
+                        pMP->ForEachObservation(vote);
                     else
                     {
                         mCurrentFrame.mvpMapPoints[i] = NULL;
@@ -4452,11 +4538,7 @@ bool Tracking::TrackWithMotionModel()
                     if (!pMP)
                         continue;
                     if (!pMP->isBad())
-                    {
-                        const map<KeyFrame *, tuple<int, int>> observations = pMP->GetObservations();
-                        for (map<KeyFrame *, tuple<int, int>>::const_iterator it = observations.begin(), itend = observations.end(); it != itend; it++)
-                            keyframeCounter[it->first]++;
-                    }
+                        pMP->ForEachObservation(vote);
                     else
                     {
                         // MODIFICATION
@@ -4470,19 +4552,20 @@ bool Tracking::TrackWithMotionModel()
         KeyFrame *pKFmax = static_cast<KeyFrame *>(NULL);
 
         mvpLocalKeyFrames.clear();
-        mvpLocalKeyFrames.reserve(3 * keyframeCounter.size());
+        mvpLocalKeyFrames.reserve(3 * vpVoted.size());
+
+        // Visit the keyframes by address, the order the vote map used to give, so the local map does not change
+        sort(vpVoted.begin(), vpVoted.end());
 
         // All keyframes that observe a map point are included in the local map. Also check which keyframe shares most points
-        for (map<KeyFrame *, int>::const_iterator it = keyframeCounter.begin(), itEnd = keyframeCounter.end(); it != itEnd; it++)
+        for (KeyFrame *pKF : vpVoted)
         {
-            KeyFrame *pKF = it->first;
-
             if (pKF->isBad())
                 continue;
 
-            if (it->second > max)
+            if (pKF->mnLocalMapVotes > max)
             {
-                max = it->second;
+                max = pKF->mnLocalMapVotes;
                 pKFmax = pKF;
             }
 
@@ -4570,6 +4653,7 @@ bool Tracking::TrackWithMotionModel()
 
     bool Tracking::Relocalization()
     {
+        TraceScope trace("Relocalization", mCurrentFrame.mnId);
         Verbose::PrintMess("Starting relocalization", Verbose::VERBOSITY_NORMAL);
         // Compute Bag of Words Vector
         mCurrentFrame.ComputeBoW();
@@ -4585,87 +4669,124 @@ bool Tracking::TrackWithMotionModel()
         }
 
         const int nKFs = vpCandidateKFs.size();
+        const bool bCheckOrientation = GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "ORB" || GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "SIFT";
+
+        // Run f(0..n-1) on the tracking pool if there is one, otherwise in turn on this thread
+        ThreadPool *pPool = mpTrackingPool.get();
+        auto forEachCandidate = [pPool](int n, const std::function<void(int)> &f)
+        {
+            if (pPool)
+                pPool->ParallelFor(n, f);
+            else
+                for (int i = 0; i < n; i++)
+                    f(i);
+        };
 
         // We perform first an ORB matching with each candidate
         // If enough matches are found we setup a PnP solver
-        ORBmatcher matcher(0.75, GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "ORB" || GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "SIFT");
-
-        vector<MLPnPsolver *> vpMLPnPsolvers;
-        vpMLPnPsolvers.resize(nKFs);
+        // Each candidate only reads the frame and its keyframe, so they are matched concurrently (one matcher per
+        // task, since the matcher keeps scratch buffers)
+        vector<std::unique_ptr<MLPnPsolver>> vpMLPnPsolvers(nKFs);
 
         vector<vector<MapPoint *>> vvpMapPointMatches;
         vvpMapPointMatches.resize(nKFs);
 
-        vector<bool> vbDiscarded;
-        vbDiscarded.resize(nKFs);
+        vector<char> vbDiscarded(nKFs, false);
 
-        int nCandidates = 0;
-
-        for (int i = 0; i < nKFs; i++)
+        forEachCandidate(nKFs, [&](int i)
         {
             KeyFrame *pKF = vpCandidateKFs[i];
             if (pKF->isBad())
+            {
                 vbDiscarded[i] = true;
-            else
+                return;
+            }
+
+            ORBmatcher matcher(0.75, bCheckOrientation);
+            int nmatches = matcher.SearchByBoW(pKF, mCurrentFrame, vvpMapPointMatches[i]);
+            if (nmatches < 15)
             {
-                int nmatches = matcher.SearchByBoW(pKF, mCurrentFrame, vvpMapPointMatches[i]);
-                if (nmatches < 15)
-                {
-                    vbDiscarded[i] = true;
-                    continue;
-                }
-                else
-                {
-                    MLPnPsolver *pSolver = new MLPnPsolver(mCurrentFrame, vvpMapPointMatches[i]);
-                    pSolver->SetRansacParameters(0.99, 10, 300, 6, 0.5, 5.991); // This solver needs at least 6 points
-                    vpMLPnPsolvers[i] = pSolver;
-                    nCandidates++;
-                }
+                vbDiscarded[i] = true;
+                return;
             }
-        }
+
+            vpMLPnPsolvers[i].reset(new MLPnPsolver(mCurrentFrame, vvpMapPointMatches[i]));
+            vpMLPnPsolvers[i]->SetRansacParameters(0.99, 10, 300, 6, 0.5, 5.991); // This solver needs at least 6 points
+        });
+
+        int nCandidates = 0;
+        for (int i = 0; i < nKFs; i++)
+            if (!vbDiscarded[i])
+                nCandidates++;
 
         // Alternatively perform some iterations of P4P RANSAC
         // Until we found a camera pose supported by enough inliers
         bool bMatch = false;
-        ORBmatcher matcher2(0.9, GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "ORB" || GlobalFeatureExtractorInfo::GetFeatureExtractorType() == "SIFT");
+        ORBmatcher matcher2(0.9, bCheckOrientation);
+
+        // RANSAC state of one candidate after a round
+        struct RansacResult
+        {
+            bool bTcw;
+            bool bNoMore;
+            vector<bool> vbInliers;
+            int nInliers;
+            Eigen::Matrix4f eigTcw;
+        };
+        vector<RansacResult> vResults(nKFs);
+        vector<int> vActive;
+        vActive.reserve(nKFs);
 
         while (nCandidates > 0 && !bMatch)
         {
+            vActive.clear();
             for (int i = 0; i < nKFs; i++)
-            {
-                if (vbDiscarded[i])
-                    continue;
+                if (!vbDiscarded[i])
+                    vActive.push_back(i);
+
+            // Hypothesis generation runs on the pool. Every candidate performs 5 Ransac iterations; with a pool, it
+            // keeps going in steps of 5 until some candidate has a pose, which cancels the rest of the round.
+            // Without a pool every candidate performs exactly 5 iterations per round, as the serial loop did.
+            std::atomic<bool> bHypothesis(false);
+            forEachCandidate(vActive.size(), [&](int k)
+            {
+                const int i = vActive[k];
+                RansacResult &res = vResults[i];
+                do
+                {
+                    res.bTcw = vpMLPnPsolvers[i]->iterate(5, res.bNoMore, res.vbInliers, res.nInliers, res.eigTcw);
+                } while (pPool && !res.bTcw && !res.bNoMore && !bHypothesis.load(std::memory_order_relaxed));
 
-                // Perform 5 Ransac Iterations
-                vector<bool> vbInliers;
-                int nInliers;
-                bool bNoMore;
+                if (res.bTcw)
+                    bHypothesis.store(true, std::memory_order_relaxed);
+            });
 
-                MLPnPsolver *pSolver = vpMLPnPsolvers[i];
-                Eigen::Matrix4f eigTcw;
-                bool bTcw = pSolver->iterate(5, bNoMore, vbInliers, nInliers, eigTcw);
+            // Hypotheses are verified in candidate order on this thread, since verification modifies the frame
+            for (int i : vActive)
+            {
+                RansacResult &res = vResults[i];
 
                 // If Ransac reachs max. iterations discard keyframe
-                if (bNoMore)
+                if (res.bNoMore)
                 {
                     vbDiscarded[i] = true;
                     nCandidates--;
                 }
 
                 // If a Camera Pose is computed, optimize
-                if (bTcw)
+                if (res.bTcw)
                 {
-                    Sophus::SE3f Tcw(eigTcw);
+                    Sophus::SE3f Tcw(res.eigTcw);
                     mCurrentFrame.SetPose(Tcw);
                     // Tcw.copyTo(mCurrentFrame.mTcw);
 
                     set<MapPoint *> sFound;
 
-                    const int np = vbInliers.size();
+                    const int np = res.vbInliers.size();
 
                     for (int j = 0; j < np; j++)
                     {
-                        if (vbInliers[j])
+                        if (res.vbInliers[j])
                         {
                             mCurrentFrame.mvpMapPoints[j] = vvpMapPointMatches[i][j];
                             sFound.insert(vvpMapPointMatches[i][j]);
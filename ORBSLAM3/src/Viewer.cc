@@ -163,6 +163,8 @@ void Viewer::Run()
 {
     mbFinished = false;
     mbStopped = false;
+    // The drawers read map points anew each frame and keep none between iterations
+    QuiescenceScope quiescence(MapPoint::Reclamation());
 
     pangolin::CreateWindowAndBind("ORB-SLAM3: Map Viewer",1024,768);
 
@@ -368,10 +370,13 @@ void Viewer::Run()
             menuStop = false;
         }
 
+        quiescence.Quiesce();
+
         if(Stop())
         {
             while(isStopped())
             {
+                quiescence.Quiesce();
                 usleep(3000);
             }
         }
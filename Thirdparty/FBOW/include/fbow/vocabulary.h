@@ -56,6 +56,10 @@ public:
     //transform the features stored as rows in the returned BagOfWords
     BoWVector transform(const cv::Mat& features);
     void transform(const cv::Mat& features, int level, BoWVector& result, BoWFeatVector& result2);
+    //maximum number of threads a transform may split the features across (1 by default). The extra threads are
+    //created here and kept for the following transforms; do not call it while a transform is running
+    void setNumThreads(int nthreads);
+    int getNumThreads() const { return _nthreads; }
 
     //loads/saves from a file
     void readFromFile(const std::string& filepath);
@@ -95,6 +99,10 @@ private:
     };
     params _params;
     char* _data = nullptr; //pointer to data
+    int _nthreads = 1;
+    //persistent threads of the batched transform (_nthreads-1 of them), shared by copies of the vocabulary
+    struct worker_pool;
+    std::shared_ptr<worker_pool> _pool;
 
     //structure represeting a information about node in a block
     struct block_node_info {
@@ -170,6 +178,22 @@ private:
 
     //information about the cpu so that mmx,sse or avx extensions can be employed
     std::shared_ptr<cpu> cpu_info;
+    //detects the host once, when the vocabulary is created or loaded, so concurrent transforms only read it
+    void initCpuInfo();
+
+    //outcome of descending the tree with one feature
+    struct descent_result {
+        uint32_t word;   //id of the leaf reached, or invalid_id
+        float weight;    //weight of that leaf
+        uint32_t node;   //node the feature was assigned at the store level, or invalid_id
+    };
+    static const uint32_t invalid_id = 0xFFFFFFFF;
+
+    //batched transform: descends the tree for groups of features at once with the vector kernels, optionally on
+    //several threads, then accumulates in feature order. Returns false if no kernel suits this vocabulary/host.
+    bool _transformBatched(const cv::Mat& features, uint32_t storeLevel, BoWVector& r1, BoWFeatVector* r2);
+    template<typename Nearest>
+    void _descend(const cv::Mat& features, uint32_t storeLevel, int begin, int end, descent_result* out);
 
     template<typename Computer>
     BoWVector _transform(const cv::Mat& features) {
@@ -30,6 +30,13 @@ THE SOFTWARE.
 #include <limits>
 #include <cstdint>
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace fbow{
 
@@ -59,6 +66,103 @@ inline void AlignedFree(void* ptr) {
     std::free(uptr);
 }
 
+//32 byte aligned buffer that only grows, kept per thread so the batched descents do not allocate on every call
+struct AlignedScratch {
+    char* ptr = nullptr;
+    size_t size = 0;
+    ~AlignedScratch() {
+        if (ptr) AlignedFree(ptr);
+    }
+    char* get(size_t n) {
+        if (n > size) {
+            if (ptr) AlignedFree(ptr);
+            ptr = (char*)AlignedAlloc(32, (int)n);
+            size = n;
+        }
+        return ptr;
+    }
+};
+
+//threads kept for the batched transform. Several transforms may use them at once (tracking, local mapping and
+//loop closing each transform on their own thread): every call queues its ranges and also runs them itself, so it
+//never waits for a range that no thread has started
+struct Vocabulary::worker_pool {
+    struct job {
+        std::function<void(int)> run;
+        int n = 0;
+        std::atomic<int> next{0};
+        int done = 0;
+        std::mutex mutex;
+        std::condition_variable cond;
+    };
+
+    explicit worker_pool(int nworkers) {
+        for (int i = 0; i < nworkers; i++)
+            threads.emplace_back([this]() { loop(); });
+    }
+
+    ~worker_pool() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cond.notify_all();
+        for (auto& t : threads)
+            t.join();
+    }
+
+    //runs f(0) ... f(n-1) and returns when all of them have finished
+    void parallel_for(int n, const std::function<void(int)>& f) {
+        std::shared_ptr<job> j = std::make_shared<job>();
+        j->run = f;
+        j->n = n;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (int i = 1; i < n; i++)
+                queue.push_back(j);
+        }
+        cond.notify_all();
+
+        work(*j);
+        std::unique_lock<std::mutex> lock(j->mutex);
+        j->cond.wait(lock, [&]() { return j->done == j->n; });
+    }
+
+private:
+    //runs the ranges of j nobody has claimed yet
+    static void work(job& j) {
+        for (int i = j.next.fetch_add(1); i < j.n; i = j.next.fetch_add(1)) {
+            j.run(i);
+            {
+                std::unique_lock<std::mutex> lock(j.mutex);
+                j.done++;
+            }
+            j.cond.notify_all();
+        }
+    }
+
+    void loop() {
+        while (true) {
+            std::shared_ptr<job> j;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [&]() { return stop || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                j = std::move(queue.front());
+                queue.pop_front();
+            }
+            work(*j);
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::deque<std::shared_ptr<job>> queue;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool stop = false;
+};
+
 ////////////////////////////////////////////////////////////
 //base class for computing distances between feature vectors
 template<typename register_type, typename distType, int aligment>
@@ -221,10 +325,114 @@ struct L1_61bytes : public Lx<uint64_t, uint64_t, 8> {
 };
 
 
+////////////////////////////////////////////////////////////
+//kernels of the batched transform: index of the node of a block nearest to a feature.
+//Features and nodes are zero padded to _desc_size_bytes_wp bytes. Ties keep the first node and distances are
+//accumulated exactly as in the single feature computers above, so both paths pick the same nodes.
+#if !defined(__ANDROID__) && !defined(__arm64__) && !defined(__arm__) && !defined(__aarch64__) && defined(USE_AVX) && defined(__GNUC__)
+#define FBOW_BATCHED_KERNELS
+
+//hamming distance, 32 bytes at a time (pshufb nibble popcount)
+struct HammingAvx2 {
+    typedef uint64_t DType;
+    int _wp;
+    explicit HammingAvx2(int wp) : _wp(wp) {}
+
+    __attribute__((target("avx2")))
+    uint32_t nearest(const char* feat, const char* nodes, int n, uint32_t best) const {
+        const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i low = _mm256_set1_epi8(0x0f);
+        DType best_dist = std::numeric_limits<uint32_t>::max();
+        for (int i = 0; i < n; i++) {
+            const char* node = nodes + i * _wp;
+            __m256i acc = _mm256_setzero_si256();
+            for (int b = 0; b < _wp; b += 32) {
+                __m256i x = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(feat + b)), _mm256_loadu_si256((const __m256i*)(node + b)));
+                __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                              _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+                acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
+            }
+            __m128i sum = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            DType d = (DType)_mm_cvtsi128_si64(sum) + (DType)_mm_extract_epi64(sum, 1);
+            if (d < best_dist) {
+                best_dist = d;
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+
+//hamming distance, 8 bytes at a time with the popcnt instruction
+struct HammingPopcnt {
+    typedef uint64_t DType;
+    int _wp;
+    explicit HammingPopcnt(int wp) : _wp(wp) {}
+
+    __attribute__((target("popcnt")))
+    uint32_t nearest(const char* feat, const char* nodes, int n, uint32_t best) const {
+        const uint64_t* f = (const uint64_t*)feat;
+        const int nwords = _wp / 8;
+        DType best_dist = std::numeric_limits<uint32_t>::max();
+        for (int i = 0; i < n; i++) {
+            const uint64_t* node = (const uint64_t*)(nodes + i * _wp);
+            DType d = 0;
+            for (int w = 0; w < nwords; w++)
+                d += __builtin_popcountll(f[w] ^ node[w]);
+            if (d < best_dist) {
+                best_dist = d;
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+
+//squared L2 distance, same operation order as L2_avx_generic/L2_avx_8w
+struct L2Avx {
+    typedef float DType;
+    int _wp;
+    explicit L2Avx(int wp) : _wp(wp) {}
+
+    uint32_t nearest(const char* feat, const char* nodes, int n, uint32_t best) const {
+        const __m256* f = (const __m256*)feat;
+        const int nwords = _wp / 32;
+        DType best_dist = std::numeric_limits<uint32_t>::max();
+        for (int i = 0; i < n; i++) {
+            const __m256* node = (const __m256*)(nodes + i * _wp);
+            __m256 sum = _mm256_setzero_ps(), sub_mult;
+            for (int w = 0; w < nwords; w++) {
+                sub_mult = _mm256_sub_ps(f[w], node[w]);
+                sub_mult = _mm256_mul_ps(sub_mult, sub_mult);
+                sum = _mm256_add_ps(sum, sub_mult);
+            }
+            sum = _mm256_hadd_ps(sum, sum);
+            sum = _mm256_hadd_ps(sum, sum);
+            float* sum_ptr = (float*)&sum;
+            DType d = sum_ptr[0] + sum_ptr[4];
+            if (d < best_dist) {
+                best_dist = d;
+                best = i;
+            }
+        }
+        return best;
+    }
+};
+#endif
+
+
 Vocabulary::~Vocabulary(){
     if (_data!=nullptr) AlignedFree( _data);
 }
 
+void Vocabulary::setNumThreads(int nthreads) {
+    _nthreads = nthreads < 1 ? 1 : nthreads;
+    _pool.reset();
+    if (_nthreads > 1)
+        _pool = std::make_shared<worker_pool>(_nthreads - 1);
+}
+
 
 void Vocabulary::setParams(int aligment, int k, int desc_type, int desc_size, int nblocks, std::string desc_name) {
     auto ns= desc_name.size()<static_cast<size_t>(49)?desc_name.size():128;
@@ -263,6 +471,7 @@ void Vocabulary::setParams(int aligment, int k, int desc_type, int desc_size, in
     _params._total_size=_params._block_size_bytes_wp*_params._nblocks;
     _data=(char*)AlignedAlloc(_params._aligment,_params._total_size);
     memset( _data,0,_params._total_size);
+    initCpuInfo();
 
 }
 
@@ -272,12 +481,12 @@ void Vocabulary::transform(const cv::Mat &features, int level,BoWVector &result,
     if (features.cols *  features.elemSize() !=size_t(_params._desc_size)) throw std::runtime_error("Vocabulary::transform features are of different size than the vocabulary ones");
 
     //get host info to decide the version to execute
-    if (!cpu_info){
-        cpu_info=std::make_shared<cpu>();
-        cpu_info->detect_host();
+    initCpuInfo();
+    //decide the version to employ according to the type of features, aligment and cpu capabilities
+    if (_transformBatched(features,level,result,&result2)){
+        //done
     }
-     //decide the version to employ according to the type of features, aligment and cpu capabilities
-    if (_params._desc_type==CV_8UC1){
+    else if (_params._desc_type==CV_8UC1){
         //orb
         if (cpu_info->HW_x64){
             if (_params._desc_size==32)
@@ -296,12 +505,12 @@ void Vocabulary::transform(const cv::Mat &features, int level,BoWVector &result,
             if ( _params._desc_size==256)  _transform2<L2_avx_8w>(features,level,result,result2);//specific for surf 256 bytes
             else  _transform2<L2_avx_generic>(features,level,result,result2);//any other
         }
-        if( cpu_info->isSafeSSE() && _params._aligment%16==0){//SSE version
+        else if( cpu_info->isSafeSSE() && _params._aligment%16==0){//SSE version
             if ( _params._desc_size==256) _transform2<L2_sse3_16w>(features,level,result,result2);//specific for surf 256 bytes
             else _transform2<L2_se3_generic>(features,level,result,result2);//any other
         }
         //generic version
-        _transform2<L2_generic>(features,level,result,result2);
+        else _transform2<L2_generic>(features,level,result,result2);
     }
     else throw std::runtime_error("Vocabulary::transform invalid feature type. Should be CV_8UC1 or CV_32FC1");
 
@@ -328,12 +537,12 @@ BoWVector Vocabulary::transform(const cv::Mat &features)
     if (features.cols *  features.elemSize() !=size_t(_params._desc_size)) throw std::runtime_error("Vocabulary::transform features are of different size than the vocabulary ones");
 
     //get host info to decide the version to execute
-    if (!cpu_info){
-        cpu_info=std::make_shared<cpu>();
-        cpu_info->detect_host();
-    }
+    initCpuInfo();
     //decide the version to employ according to the type of features, aligment and cpu capabilities
-    if (_params._desc_type==CV_8UC1){
+    if (_transformBatched(features,invalid_id,result,nullptr)){
+        //done
+    }
+    else if (_params._desc_type==CV_8UC1){
         //orb
         if (cpu_info->HW_x64){
             if (_params._desc_size==32)
@@ -352,12 +561,12 @@ BoWVector Vocabulary::transform(const cv::Mat &features)
             if ( _params._desc_size==256) result= _transform<L2_avx_8w>(features);//specific for surf 256 bytes
             else result= _transform<L2_avx_generic>(features);//any other
         }
-        if( cpu_info->isSafeSSE() && _params._aligment%16==0){//SSE version
+        else if( cpu_info->isSafeSSE() && _params._aligment%16==0){//SSE version
             if ( _params._desc_size==256) result= _transform<L2_sse3_16w>(features);//specific for surf 256 bytes
             else result=_transform<L2_se3_generic>(features);//any other
         }
         //generic version
-        result=_transform<L2_generic>(features);
+        else result=_transform<L2_generic>(features);
     }
     else throw std::runtime_error("Vocabulary::transform invalid feature type. Should be CV_8UC1 or CV_32FC1");
 
@@ -376,6 +585,131 @@ BoWVector Vocabulary::transform(const cv::Mat &features)
 
 
 
+template<typename Nearest>
+void Vocabulary::_descend(const cv::Mat& features, uint32_t storeLevel, int begin, int end, descent_result* out) {
+    //number of features descending together. Interleaving independent descents hides the latency of fetching
+    //the next block of each one
+    const int nlanes = 8;
+    struct lane {
+        int feature;
+        uint32_t block, level, node, best;
+        const char* feat;
+    };
+
+    const Nearest nearest(_params._desc_size_bytes_wp);
+    const int nbits = ceil(log2(_params._m_k));
+    const uint64_t prefetch_bytes = std::min<uint64_t>(_params._block_size_bytes_wp, 512);
+
+    //zero padded copies of the features, as the single feature computers use
+    static thread_local AlignedScratch scratch;
+    char* buffer = scratch.get(nlanes * _params._desc_size_bytes_wp);
+    memset(buffer, 0, nlanes * _params._desc_size_bytes_wp);
+
+    lane lanes[nlanes];
+    for (int first = begin; first < end; first += nlanes) {
+        int nactive = std::min(nlanes, end - first);
+        for (int i = 0; i < nactive; i++) {
+            char* feat = buffer + i * _params._desc_size_bytes_wp;
+            memcpy(feat, features.ptr<char>(first + i), _params._desc_size);
+            lanes[i] = {first + i, 0, 0, 0, 0, feat};
+            out[first + i] = {invalid_id, 0.f, invalid_id};
+        }
+
+        while (nactive > 0) {
+            for (int i = 0; i < nactive;) {
+                lane& ln = lanes[i];
+                Block c_block = getBlock(ln.block);
+                ln.best = nearest.nearest(ln.feat, c_block._blockstart + _params._feature_off_start, c_block.getN(), ln.best);
+                descent_result& res = out[ln.feature];
+                if (ln.level == storeLevel)
+                    res.node = ln.node;
+
+                block_node_info* bn_info = c_block.getBlockNodeInfo(ln.best);
+                bool done = false;
+                if (bn_info->isleaf()) {
+                    res.word = bn_info->getId();
+                    res.weight = bn_info->weight;
+                    if (ln.level < storeLevel)
+                        res.node = ln.node;
+                    done = true;
+                }
+                else {
+                    ln.block = bn_info->getId();
+                    ln.node = (ln.node << nbits) | ln.best;
+                    ln.level++;
+                    //a non leaf pointing at the root ends the descent, as in _transform2
+                    done = ln.block == 0;
+                    if (!done) {
+                        const char* next = _data + ln.block * _params._block_size_bytes_wp;
+                        for (uint64_t b = 0; b < prefetch_bytes; b += 64)
+                            __builtin_prefetch(next + b);
+                    }
+                }
+
+                if (done) {
+                    //a finished lane is replaced by the last active one; its buffer stays valid until the group ends
+                    lanes[i] = lanes[--nactive];
+                }
+                else
+                    i++;
+            }
+        }
+    }
+}
+
+bool Vocabulary::_transformBatched(const cv::Mat& features, uint32_t storeLevel, BoWVector& r1, BoWFeatVector* r2) {
+#ifdef FBOW_BATCHED_KERNELS
+    void (Vocabulary::*descend)(const cv::Mat&, uint32_t, int, int, descent_result*) = nullptr;
+    if (_params._desc_type == CV_8UC1) {
+        if (cpu_info->isSafeAVX() && cpu_info->HW_AVX2 && _params._desc_size_bytes_wp % 32 == 0)
+            descend = &Vocabulary::_descend<HammingAvx2>;
+        else if (cpu_info->HW_POPCNT && _params._desc_size_bytes_wp % 8 == 0)
+            descend = &Vocabulary::_descend<HammingPopcnt>;
+    }
+    else if (_params._desc_type == CV_32FC1) {
+        if (cpu_info->isSafeAVX() && _params._aligment % 32 == 0)
+            descend = &Vocabulary::_descend<L2Avx>;
+    }
+    if (descend == nullptr)
+        return false;
+
+    r1.clear();
+    if (r2)
+        r2->clear();
+
+    //reused by the following transforms of this thread. The pool threads write through out: a thread_local
+    //named inside the lambda would be their own copy
+    static thread_local std::vector<descent_result> results;
+    results.resize(features.rows);
+    descent_result* out = results.data();
+
+    //split in contiguous ranges, not smaller than min_features, one per thread
+    const int min_features = 128;
+    const int nthreads = _pool ? std::max(1, std::min(_nthreads, features.rows / min_features)) : 1;
+    auto run = [&, out](int t) {
+        int begin = (int)((int64_t)features.rows * t / nthreads);
+        int end = (int)((int64_t)features.rows * (t + 1) / nthreads);
+        (this->*descend)(features, storeLevel, begin, end, out);
+    };
+    if (nthreads > 1)
+        _pool->parallel_for(nthreads, run);
+    else
+        run(0);
+
+    //accumulate in feature order so the result does not depend on the batching or the number of threads
+    for (int f = 0; f < features.rows; f++) {
+        const descent_result& res = out[f];
+        if (r2 && res.node != invalid_id)
+            (*r2)[res.node].push_back(f);
+        if (res.word != invalid_id)
+            r1[res.word] += res.weight;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 void Vocabulary::clear()
 {
     if (_data!=0) AlignedFree(_data);
@@ -420,6 +754,14 @@ void Vocabulary::fromStream(std::istream &str)
     _data=(char*)AlignedAlloc(_params._aligment,_params._total_size);
     if (_data==0) throw std::runtime_error("Vocabulary::fromStream Could not allocate data");
     str.read(_data,_params._total_size);
+    initCpuInfo();
+}
+
+void Vocabulary::initCpuInfo(){
+    if (!cpu_info){
+        cpu_info=std::make_shared<cpu>();
+        cpu_info->detect_host();
+    }
 }
 
 double BoWVector::score (const  BoWVector &v1,const BoWVector &v2){